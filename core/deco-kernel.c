@@ -0,0 +1,408 @@
+// SPDX-License-Identifier: GPL-2.0
+/* deco-kernel.c
+ *
+ * The per-compartment arithmetic of the Buehlmann model, applied to all 16
+ * tissues at once. deco.c keeps the model logic and calls in here for the
+ * loops that dominate planner and profile run time.
+ *
+ * On x86 there are SSE2 and AVX2 versions next to the portable one. They
+ * pick between saturation and desaturation multipliers with masked blends
+ * instead of branches, but evaluate every expression in the same order as
+ * the scalar code, so all kernels give identical results. The kernel is
+ * chosen at run time from what the CPU supports; set_deco_kernel() can
+ * force one, which the tests use to compare them.
+ *
+ * saturate_tissues()		- expose the tissues to the inspired inert gas pressures
+ * buehlmann_coefficients()	- a and b coefficients of the N2/He mix in each tissue
+ * buehlmann_lowest_ceiling()	- deepest ceiling of all tissues at gf_low
+ * buehlmann_tolerated()	- tolerated ambient pressure of the tissues
+ */
+#include "ssrf.h"
+#include "dive.h"
+#include "deco.h"
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define DECO_KERNEL_X86 1
+#include <immintrin.h>
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+extern const double buehlmann_N2_a[], buehlmann_N2_b[];
+extern const double buehlmann_He_a[], buehlmann_He_b[];
+
+static enum deco_kernel deco_kernel = DECO_KERNEL_AUTO;
+
+static void saturate_tissues_scalar(double n2_sat[], double he_sat[], double inertgas_sat[],
+				    double pn2, double phe, const double n2_f[], const double he_f[],
+				    double satmult, double desatmult)
+{
+	int ci;
+
+	for (ci = 0; ci < 16; ci++) {
+		double pn2_oversat = pn2 - n2_sat[ci];
+		double phe_oversat = phe - he_sat[ci];
+		double n2_satmult = pn2_oversat > 0 ? satmult : desatmult;
+		double he_satmult = phe_oversat > 0 ? satmult : desatmult;
+
+		n2_sat[ci] += n2_satmult * pn2_oversat * n2_f[ci];
+		he_sat[ci] += he_satmult * phe_oversat * he_f[ci];
+		inertgas_sat[ci] = n2_sat[ci] + he_sat[ci];
+	}
+}
+
+static void buehlmann_coefficients_scalar(const double n2_sat[], const double he_sat[], const double inertgas_sat[],
+					  double a[], double b[])
+{
+	int ci;
+
+	for (ci = 0; ci < 16; ci++) {
+		a[ci] = ((buehlmann_N2_a[ci] * n2_sat[ci]) + (buehlmann_He_a[ci] * he_sat[ci])) / inertgas_sat[ci];
+		b[ci] = ((buehlmann_N2_b[ci] * n2_sat[ci]) + (buehlmann_He_b[ci] * he_sat[ci])) / inertgas_sat[ci];
+	}
+}
+
+static double buehlmann_lowest_ceiling_scalar(const double a[], const double b[], const double inertgas_sat[], double gf_low)
+{
+	int ci;
+	double lowest_ceiling = 0.0;
+
+	for (ci = 0; ci < 16; ci++) {
+		double ceiling = (b[ci] * inertgas_sat[ci] - gf_low * a[ci] * b[ci]) / ((1.0 - b[ci]) * gf_low + b[ci]);
+		if (ceiling > lowest_ceiling)
+			lowest_ceiling = ceiling;
+	}
+	return lowest_ceiling;
+}
+
+static unsigned int buehlmann_tolerated_scalar(const double a[], const double b[], const double inertgas_sat[],
+					       double gf_low, double gf_high, double gf_low_pressure, double surface,
+					       double tolerated[])
+{
+	int ci;
+	unsigned int mask = 0;
+
+	for (ci = 0; ci < 16; ci++) {
+		if ((surface / b[ci] + a[ci] - surface) * gf_high + surface <
+		    (gf_low_pressure / b[ci] + a[ci] - gf_low_pressure) * gf_low + gf_low_pressure) {
+			tolerated[ci] = (-a[ci] * b[ci] * (gf_high * gf_low_pressure - gf_low * surface) -
+					 (1.0 - b[ci]) * (gf_high - gf_low) * gf_low_pressure * surface +
+					 b[ci] * (gf_low_pressure - surface) * inertgas_sat[ci]) /
+					(-a[ci] * b[ci] * (gf_high - gf_low) +
+					 (1.0 - b[ci]) * (gf_low * gf_low_pressure - gf_high * surface) +
+					 b[ci] * (gf_low_pressure - surface));
+			mask |= 1u << ci;
+		}
+	}
+	return mask;
+}
+
+#ifdef DECO_KERNEL_X86
+static TARGET_SSE2 void saturate_tissues_sse2(double n2_sat[], double he_sat[], double inertgas_sat[],
+					      double pn2, double phe, const double n2_f[], const double he_f[],
+					      double satmult, double desatmult)
+{
+	int ci;
+	const __m128d zero = _mm_setzero_pd();
+	const __m128d sat = _mm_set1_pd(satmult), desat = _mm_set1_pd(desatmult);
+	const __m128d pn2_v = _mm_set1_pd(pn2), phe_v = _mm_set1_pd(phe);
+
+	for (ci = 0; ci < 16; ci += 2) {
+		__m128d n2 = _mm_loadu_pd(n2_sat + ci);
+		__m128d he = _mm_loadu_pd(he_sat + ci);
+		__m128d pn2_oversat = _mm_sub_pd(pn2_v, n2);
+		__m128d phe_oversat = _mm_sub_pd(phe_v, he);
+		__m128d n2_mask = _mm_cmpgt_pd(pn2_oversat, zero);
+		__m128d he_mask = _mm_cmpgt_pd(phe_oversat, zero);
+		__m128d n2_satmult = _mm_or_pd(_mm_and_pd(n2_mask, sat), _mm_andnot_pd(n2_mask, desat));
+		__m128d he_satmult = _mm_or_pd(_mm_and_pd(he_mask, sat), _mm_andnot_pd(he_mask, desat));
+
+		n2 = _mm_add_pd(n2, _mm_mul_pd(_mm_mul_pd(n2_satmult, pn2_oversat), _mm_loadu_pd(n2_f + ci)));
+		he = _mm_add_pd(he, _mm_mul_pd(_mm_mul_pd(he_satmult, phe_oversat), _mm_loadu_pd(he_f + ci)));
+		_mm_storeu_pd(n2_sat + ci, n2);
+		_mm_storeu_pd(he_sat + ci, he);
+		_mm_storeu_pd(inertgas_sat + ci, _mm_add_pd(n2, he));
+	}
+}
+
+static TARGET_SSE2 void buehlmann_coefficients_sse2(const double n2_sat[], const double he_sat[], const double inertgas_sat[],
+						    double a[], double b[])
+{
+	int ci;
+
+	for (ci = 0; ci < 16; ci += 2) {
+		__m128d n2 = _mm_loadu_pd(n2_sat + ci);
+		__m128d he = _mm_loadu_pd(he_sat + ci);
+		__m128d sum = _mm_loadu_pd(inertgas_sat + ci);
+
+		_mm_storeu_pd(a + ci, _mm_div_pd(_mm_add_pd(_mm_mul_pd(_mm_loadu_pd(buehlmann_N2_a + ci), n2),
+							    _mm_mul_pd(_mm_loadu_pd(buehlmann_He_a + ci), he)), sum));
+		_mm_storeu_pd(b + ci, _mm_div_pd(_mm_add_pd(_mm_mul_pd(_mm_loadu_pd(buehlmann_N2_b + ci), n2),
+							    _mm_mul_pd(_mm_loadu_pd(buehlmann_He_b + ci), he)), sum));
+	}
+}
+
+static TARGET_SSE2 double buehlmann_lowest_ceiling_sse2(const double a[], const double b[], const double inertgas_sat[], double gf_low)
+{
+	int ci;
+	double lanes[2];
+	const __m128d one = _mm_set1_pd(1.0), gf_low_v = _mm_set1_pd(gf_low);
+	__m128d lowest_ceiling = _mm_setzero_pd();
+
+	for (ci = 0; ci < 16; ci += 2) {
+		__m128d a_v = _mm_loadu_pd(a + ci);
+		__m128d b_v = _mm_loadu_pd(b + ci);
+		__m128d ceiling = _mm_div_pd(_mm_sub_pd(_mm_mul_pd(b_v, _mm_loadu_pd(inertgas_sat + ci)),
+							_mm_mul_pd(_mm_mul_pd(gf_low_v, a_v), b_v)),
+					     _mm_add_pd(_mm_mul_pd(_mm_sub_pd(one, b_v), gf_low_v), b_v));
+		// maxpd(x, y) is x > y ? x : y, the same test as the scalar loop
+		lowest_ceiling = _mm_max_pd(ceiling, lowest_ceiling);
+	}
+	_mm_storeu_pd(lanes, lowest_ceiling);
+	return lanes[1] > lanes[0] ? lanes[1] : lanes[0];
+}
+
+static TARGET_SSE2 unsigned int buehlmann_tolerated_sse2(const double a[], const double b[], const double inertgas_sat[],
+							 double gf_low, double gf_high, double gf_low_pressure, double surface,
+							 double tolerated[])
+{
+	int ci;
+	unsigned int mask = 0;
+	const __m128d sign = _mm_set1_pd(-0.0), one = _mm_set1_pd(1.0);
+	const __m128d gf_low_v = _mm_set1_pd(gf_low), gf_high_v = _mm_set1_pd(gf_high);
+	const __m128d gflp = _mm_set1_pd(gf_low_pressure), surface_v = _mm_set1_pd(surface);
+	const __m128d num_gf = _mm_set1_pd(gf_high * gf_low_pressure - gf_low * surface);
+	const __m128d gf_diff = _mm_set1_pd(gf_high - gf_low);
+	const __m128d den_gf = _mm_set1_pd(gf_low * gf_low_pressure - gf_high * surface);
+	const __m128d p_diff = _mm_set1_pd(gf_low_pressure - surface);
+
+	for (ci = 0; ci < 16; ci += 2) {
+		__m128d a_v = _mm_loadu_pd(a + ci);
+		__m128d b_v = _mm_loadu_pd(b + ci);
+		__m128d one_minus_b = _mm_sub_pd(one, b_v);
+		__m128d minus_ab = _mm_mul_pd(_mm_xor_pd(a_v, sign), b_v);
+		__m128d surface_limit = _mm_add_pd(_mm_mul_pd(_mm_sub_pd(_mm_add_pd(_mm_div_pd(surface_v, b_v), a_v), surface_v), gf_high_v), surface_v);
+		__m128d gf_low_limit = _mm_add_pd(_mm_mul_pd(_mm_sub_pd(_mm_add_pd(_mm_div_pd(gflp, b_v), a_v), gflp), gf_low_v), gflp);
+		__m128d num = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(minus_ab, num_gf),
+						    _mm_mul_pd(_mm_mul_pd(_mm_mul_pd(one_minus_b, gf_diff), gflp), surface_v)),
+					 _mm_mul_pd(_mm_mul_pd(b_v, p_diff), _mm_loadu_pd(inertgas_sat + ci)));
+		__m128d den = _mm_add_pd(_mm_add_pd(_mm_mul_pd(minus_ab, gf_diff),
+						    _mm_mul_pd(one_minus_b, den_gf)),
+					 _mm_mul_pd(b_v, p_diff));
+
+		_mm_storeu_pd(tolerated + ci, _mm_div_pd(num, den));
+		mask |= (unsigned int)_mm_movemask_pd(_mm_cmplt_pd(surface_limit, gf_low_limit)) << ci;
+	}
+	return mask;
+}
+
+static TARGET_AVX2 void saturate_tissues_avx2(double n2_sat[], double he_sat[], double inertgas_sat[],
+					      double pn2, double phe, const double n2_f[], const double he_f[],
+					      double satmult, double desatmult)
+{
+	int ci;
+	const __m256d zero = _mm256_setzero_pd();
+	const __m256d sat = _mm256_set1_pd(satmult), desat = _mm256_set1_pd(desatmult);
+	const __m256d pn2_v = _mm256_set1_pd(pn2), phe_v = _mm256_set1_pd(phe);
+
+	for (ci = 0; ci < 16; ci += 4) {
+		__m256d n2 = _mm256_loadu_pd(n2_sat + ci);
+		__m256d he = _mm256_loadu_pd(he_sat + ci);
+		__m256d pn2_oversat = _mm256_sub_pd(pn2_v, n2);
+		__m256d phe_oversat = _mm256_sub_pd(phe_v, he);
+		__m256d n2_satmult = _mm256_blendv_pd(desat, sat, _mm256_cmp_pd(pn2_oversat, zero, _CMP_GT_OQ));
+		__m256d he_satmult = _mm256_blendv_pd(desat, sat, _mm256_cmp_pd(phe_oversat, zero, _CMP_GT_OQ));
+
+		n2 = _mm256_add_pd(n2, _mm256_mul_pd(_mm256_mul_pd(n2_satmult, pn2_oversat), _mm256_loadu_pd(n2_f + ci)));
+		he = _mm256_add_pd(he, _mm256_mul_pd(_mm256_mul_pd(he_satmult, phe_oversat), _mm256_loadu_pd(he_f + ci)));
+		_mm256_storeu_pd(n2_sat + ci, n2);
+		_mm256_storeu_pd(he_sat + ci, he);
+		_mm256_storeu_pd(inertgas_sat + ci, _mm256_add_pd(n2, he));
+	}
+}
+
+static TARGET_AVX2 void buehlmann_coefficients_avx2(const double n2_sat[], const double he_sat[], const double inertgas_sat[],
+						    double a[], double b[])
+{
+	int ci;
+
+	for (ci = 0; ci < 16; ci += 4) {
+		__m256d n2 = _mm256_loadu_pd(n2_sat + ci);
+		__m256d he = _mm256_loadu_pd(he_sat + ci);
+		__m256d sum = _mm256_loadu_pd(inertgas_sat + ci);
+
+		_mm256_storeu_pd(a + ci, _mm256_div_pd(_mm256_add_pd(_mm256_mul_pd(_mm256_loadu_pd(buehlmann_N2_a + ci), n2),
+								     _mm256_mul_pd(_mm256_loadu_pd(buehlmann_He_a + ci), he)), sum));
+		_mm256_storeu_pd(b + ci, _mm256_div_pd(_mm256_add_pd(_mm256_mul_pd(_mm256_loadu_pd(buehlmann_N2_b + ci), n2),
+								     _mm256_mul_pd(_mm256_loadu_pd(buehlmann_He_b + ci), he)), sum));
+	}
+}
+
+static TARGET_AVX2 double buehlmann_lowest_ceiling_avx2(const double a[], const double b[], const double inertgas_sat[], double gf_low)
+{
+	int ci, i;
+	double lanes[4], ret = 0.0;
+	const __m256d one = _mm256_set1_pd(1.0), gf_low_v = _mm256_set1_pd(gf_low);
+	__m256d lowest_ceiling = _mm256_setzero_pd();
+
+	for (ci = 0; ci < 16; ci += 4) {
+		__m256d a_v = _mm256_loadu_pd(a + ci);
+		__m256d b_v = _mm256_loadu_pd(b + ci);
+		__m256d ceiling = _mm256_div_pd(_mm256_sub_pd(_mm256_mul_pd(b_v, _mm256_loadu_pd(inertgas_sat + ci)),
+							      _mm256_mul_pd(_mm256_mul_pd(gf_low_v, a_v), b_v)),
+						_mm256_add_pd(_mm256_mul_pd(_mm256_sub_pd(one, b_v), gf_low_v), b_v));
+		lowest_ceiling = _mm256_max_pd(ceiling, lowest_ceiling);
+	}
+	_mm256_storeu_pd(lanes, lowest_ceiling);
+	for (i = 0; i < 4; i++) {
+		if (lanes[i] > ret)
+			ret = lanes[i];
+	}
+	return ret;
+}
+
+static TARGET_AVX2 unsigned int buehlmann_tolerated_avx2(const double a[], const double b[], const double inertgas_sat[],
+							 double gf_low, double gf_high, double gf_low_pressure, double surface,
+							 double tolerated[])
+{
+	int ci;
+	unsigned int mask = 0;
+	const __m256d sign = _mm256_set1_pd(-0.0), one = _mm256_set1_pd(1.0);
+	const __m256d gf_low_v = _mm256_set1_pd(gf_low), gf_high_v = _mm256_set1_pd(gf_high);
+	const __m256d gflp = _mm256_set1_pd(gf_low_pressure), surface_v = _mm256_set1_pd(surface);
+	const __m256d num_gf = _mm256_set1_pd(gf_high * gf_low_pressure - gf_low * surface);
+	const __m256d gf_diff = _mm256_set1_pd(gf_high - gf_low);
+	const __m256d den_gf = _mm256_set1_pd(gf_low * gf_low_pressure - gf_high * surface);
+	const __m256d p_diff = _mm256_set1_pd(gf_low_pressure - surface);
+
+	for (ci = 0; ci < 16; ci += 4) {
+		__m256d a_v = _mm256_loadu_pd(a + ci);
+		__m256d b_v = _mm256_loadu_pd(b + ci);
+		__m256d one_minus_b = _mm256_sub_pd(one, b_v);
+		__m256d minus_ab = _mm256_mul_pd(_mm256_xor_pd(a_v, sign), b_v);
+		__m256d surface_limit = _mm256_add_pd(_mm256_mul_pd(_mm256_sub_pd(_mm256_add_pd(_mm256_div_pd(surface_v, b_v), a_v), surface_v), gf_high_v), surface_v);
+		__m256d gf_low_limit = _mm256_add_pd(_mm256_mul_pd(_mm256_sub_pd(_mm256_add_pd(_mm256_div_pd(gflp, b_v), a_v), gflp), gf_low_v), gflp);
+		__m256d num = _mm256_add_pd(_mm256_sub_pd(_mm256_mul_pd(minus_ab, num_gf),
+							  _mm256_mul_pd(_mm256_mul_pd(_mm256_mul_pd(one_minus_b, gf_diff), gflp), surface_v)),
+					    _mm256_mul_pd(_mm256_mul_pd(b_v, p_diff), _mm256_loadu_pd(inertgas_sat + ci)));
+		__m256d den = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(minus_ab, gf_diff),
+							  _mm256_mul_pd(one_minus_b, den_gf)),
+					    _mm256_mul_pd(b_v, p_diff));
+
+		_mm256_storeu_pd(tolerated + ci, _mm256_div_pd(num, den));
+		mask |= (unsigned int)_mm256_movemask_pd(_mm256_cmp_pd(surface_limit, gf_low_limit, _CMP_LT_OQ)) << ci;
+	}
+	return mask;
+}
+#endif
+
+static bool deco_kernel_supported(enum deco_kernel kernel)
+{
+	switch (kernel) {
+	case DECO_KERNEL_SCALAR:
+		return true;
+#ifdef DECO_KERNEL_X86
+	case DECO_KERNEL_SSE2:
+		return __builtin_cpu_supports("sse2");
+	case DECO_KERNEL_AVX2:
+		return __builtin_cpu_supports("avx2");
+#endif
+	default:
+		return false;
+	}
+}
+
+/* The kernel the deco calculations currently use */
+enum deco_kernel get_deco_kernel()
+{
+	if (deco_kernel != DECO_KERNEL_AUTO)
+		return deco_kernel;
+	if (deco_kernel_supported(DECO_KERNEL_AVX2))
+		return DECO_KERNEL_AVX2;
+	if (deco_kernel_supported(DECO_KERNEL_SSE2))
+		return DECO_KERNEL_SSE2;
+	return DECO_KERNEL_SCALAR;
+}
+
+/*
+ * Force a kernel, or go back to picking the best one with DECO_KERNEL_AUTO.
+ * A kernel the CPU can't run is ignored. Returns the kernel now in use.
+ * Not meant to be called while deco calculations are running.
+ */
+enum deco_kernel set_deco_kernel(enum deco_kernel kernel)
+{
+	deco_kernel = deco_kernel_supported(kernel) ? kernel : DECO_KERNEL_AUTO;
+	return get_deco_kernel();
+}
+
+void saturate_tissues(double n2_sat[], double he_sat[], double inertgas_sat[],
+		      double pn2, double phe, const double n2_f[], const double he_f[],
+		      double satmult, double desatmult)
+{
+	switch (get_deco_kernel()) {
+#ifdef DECO_KERNEL_X86
+	case DECO_KERNEL_AVX2:
+		saturate_tissues_avx2(n2_sat, he_sat, inertgas_sat, pn2, phe, n2_f, he_f, satmult, desatmult);
+		return;
+	case DECO_KERNEL_SSE2:
+		saturate_tissues_sse2(n2_sat, he_sat, inertgas_sat, pn2, phe, n2_f, he_f, satmult, desatmult);
+		return;
+#endif
+	default:
+		saturate_tissues_scalar(n2_sat, he_sat, inertgas_sat, pn2, phe, n2_f, he_f, satmult, desatmult);
+	}
+}
+
+void buehlmann_coefficients(const double n2_sat[], const double he_sat[], const double inertgas_sat[],
+			    double a[], double b[])
+{
+	switch (get_deco_kernel()) {
+#ifdef DECO_KERNEL_X86
+	case DECO_KERNEL_AVX2:
+		buehlmann_coefficients_avx2(n2_sat, he_sat, inertgas_sat, a, b);
+		return;
+	case DECO_KERNEL_SSE2:
+		buehlmann_coefficients_sse2(n2_sat, he_sat, inertgas_sat, a, b);
+		return;
+#endif
+	default:
+		buehlmann_coefficients_scalar(n2_sat, he_sat, inertgas_sat, a, b);
+	}
+}
+
+/* Deepest ceiling (as ambient pressure) of all tissues at gf_low, but never less than 0 */
+double buehlmann_lowest_ceiling(const double a[], const double b[], const double inertgas_sat[], double gf_low)
+{
+	switch (get_deco_kernel()) {
+#ifdef DECO_KERNEL_X86
+	case DECO_KERNEL_AVX2:
+		return buehlmann_lowest_ceiling_avx2(a, b, inertgas_sat, gf_low);
+	case DECO_KERNEL_SSE2:
+		return buehlmann_lowest_ceiling_sse2(a, b, inertgas_sat, gf_low);
+#endif
+	default:
+		return buehlmann_lowest_ceiling_scalar(a, b, inertgas_sat, gf_low);
+	}
+}
+
+/*
+ * Tolerated ambient pressure of each tissue with the gradient factor
+ * interpolated between gf_low at gf_low_pressure and gf_high at the surface.
+ * Only tissues whose bit is set in the returned mask have a valid entry in
+ * tolerated[], for the others the caller applies its own limit.
+ */
+unsigned int buehlmann_tolerated(const double a[], const double b[], const double inertgas_sat[],
+				 double gf_low, double gf_high, double gf_low_pressure, double surface,
+				 double tolerated[])
+{
+	switch (get_deco_kernel()) {
+#ifdef DECO_KERNEL_X86
+	case DECO_KERNEL_AVX2:
+		return buehlmann_tolerated_avx2(a, b, inertgas_sat, gf_low, gf_high, gf_low_pressure, surface, tolerated);
+	case DECO_KERNEL_SSE2:
+		return buehlmann_tolerated_sse2(a, b, inertgas_sat, gf_low, gf_high, gf_low_pressure, surface, tolerated);
+#endif
+	default:
+		return buehlmann_tolerated_scalar(a, b, inertgas_sat, gf_low, gf_high, gf_low_pressure, surface, tolerated);
+	}
+}
@@ -9,7 +9,10 @@
  * (C) Robert C. Helling 2013 and released under the GPLv2
  *
  * add_segment()	- add <seconds> at the given pressure, breathing gasmix
+ * add_segments()	- add <count> periods of <seconds> at constant pressure in one go
+ * periods_to_surfacing_limit() - closed-form time until a ceiling appears at constant depth
  * deco_allowed_depth() - ceiling based on lead tissue, surface pressure, 3m increments or smooth
+ * init_deco_config()	- set up the model parameters of a calculation from the preferences
  * set_gf()		- set Buehlmann gradient factors
  * set_vpmb_conservatism() - set VPM-B conservatism value
  * clear_deco()
@@ -20,7 +23,9 @@
 #include "ssrf.h"
 #include <math.h>
 #include <string.h>
+#include <limits.h>
 #include "dive.h"
+#include "deco.h"
 #include "subsurface-string.h"
 #include <assert.h>
 #include "core/planner.h"
@@ -33,19 +38,9 @@
 // was introduced in v4.6.3 this can be set to a value of 1.0 which means no correction.
 #define subsurface_conservatism_factor 1.0
 
-extern int plot_depth;
-
-//! Option structure for Buehlmann decompression.
-struct buehlmann_config {
-	double satmult;			//! safety at inert gas accumulation as percentage of effect (more than 100).
-	double desatmult;		//! safety at inert gas depletion as percentage of effect (less than 100).
-	int last_deco_stop_in_mtr;	//! depth of last_deco_stop.
-	double gf_high;			//! gradient factor high (at surface).
-	double gf_low;			//! gradient factor low (at bottom/start of deco calculation).
-	double gf_low_position_min;	//! gf_low_position below surface_min_shallow.
-};
-
-struct buehlmann_config buehlmann_config = {
+// Default model parameters. These are only read: every calculation works on
+// its own copy in deco_state::config, see init_deco_config().
+static const struct buehlmann_config buehlmann_config = {
 	.satmult = 1.0,
 	.desatmult = 1.0,
 	.last_deco_stop_in_mtr =  0,
@@ -54,20 +49,7 @@ struct buehlmann_config buehlmann_config = {
 	.gf_low_position_min = 1.0,
 };
 
-//! Option structure for VPM-B decompression.
-struct vpmb_config {
-	double crit_radius_N2;            //! Critical radius of N2 nucleon (microns).
-	double crit_radius_He;            //! Critical radius of He nucleon (microns).
-	double crit_volume_lambda;        //! Constant corresponding to critical gas volume (bar * min).
-	double gradient_of_imperm;        //! Gradient after which bubbles become impermeable (bar).
-	double surface_tension_gamma;     //! Nucleons surface tension constant (N / bar = m2).
-	double skin_compression_gammaC;   //! Skin compression gammaC (N / bar = m2).
-	double regeneration_time;         //! Time needed for the bubble to regenerate to the start radius (min).
-	double other_gases_pressure;      //! Always present pressure of other gasses in tissues (bar).
-	short conservatism;		  //! VPM-B conservatism level (0-4)
-};
-
-struct vpmb_config vpmb_config = {
+static const struct vpmb_config vpmb_config = {
 	.crit_radius_N2 = 0.55,
 	.crit_radius_He = 0.45,
 	.crit_volume_lambda = 199.58,
@@ -94,14 +76,6 @@ const double buehlmann_N2_t_halflife[] = { 5.0, 8.0, 12.5, 18.5,
 					   109.0, 146.0, 187.0, 239.0,
 					   305.0, 390.0, 498.0, 635.0 };
 
-// 1 - exp(-1 / (halflife * 60) * ln(2))
-const double buehlmann_N2_factor_expositon_one_second[] = {
-	2.30782347297664E-003, 1.44301447809736E-003, 9.23769302935806E-004, 6.24261986779007E-004,
-	4.27777107246730E-004, 3.01585140931371E-004, 2.12729727268379E-004, 1.50020603047807E-004,
-	1.05980191127841E-004, 7.91232600646508E-005, 6.17759153688224E-005, 4.83354552742732E-005,
-	3.78761777920511E-005, 2.96212356654113E-005, 2.31974277413727E-005, 1.81926738960225E-005
-};
-
 const double buehlmann_He_a[] = { 1.6189, 1.383, 1.1919, 1.0458,
 				  0.922, 0.8205, 0.7305, 0.6502,
 				  0.595, 0.5545, 0.5333, 0.5189,
@@ -117,13 +91,75 @@ const double buehlmann_He_t_halflife[] = { 1.88, 3.02, 4.72, 6.99,
 					   41.20, 55.19, 70.69, 90.34,
 					   115.29, 147.42, 188.24, 240.03 };
 
-const double buehlmann_He_factor_expositon_one_second[] = {
-	6.12608039419837E-003, 3.81800836683133E-003, 2.44456078654209E-003, 1.65134647076792E-003,
-	1.13084424730725E-003, 7.97503165599123E-004, 5.62552521860549E-004, 3.96776399429366E-004,
-	2.80360036664540E-004, 2.09299583354805E-004, 1.63410794820518E-004, 1.27869320250551E-004,
-	1.00198406028040E-004, 7.83611475491108E-005, 6.13689891868496E-005, 4.81280465299827E-005
+/*
+ * Exposure factors 1 - exp(-period / (halflife * 60) * ln(2)) for the time
+ * steps the profile, the planner and the NDL calculation advance the tissues
+ * with. Other periods are computed on the fly, see exposure_factors().
+ */
+struct exposure_factors {
+	double n2[16];
+	double he[16];
 };
 
+static const struct exposure_factors exposure_factors_one_second = {
+	.n2 = {
+		2.30782347297664E-003, 1.44301447809736E-003, 9.23769302935806E-004, 6.24261986779007E-004,
+		4.27777107246730E-004, 3.01585140931371E-004, 2.12729727268379E-004, 1.50020603047807E-004,
+		1.05980191127841E-004, 7.91232600646508E-005, 6.17759153688224E-005, 4.83354552742732E-005,
+		3.78761777920511E-005, 2.96212356654113E-005, 2.31974277413727E-005, 1.81926738960225E-005
+	},
+	.he = {
+		6.12608039419837E-003, 3.81800836683133E-003, 2.44456078654209E-003, 1.65134647076792E-003,
+		1.13084424730725E-003, 7.97503165599123E-004, 5.62552521860549E-004, 3.96776399429366E-004,
+		2.80360036664540E-004, 2.09299583354805E-004, 1.63410794820518E-004, 1.27869320250551E-004,
+		1.00198406028040E-004, 7.83611475491108E-005, 6.13689891868496E-005, 4.81280465299827E-005
+	},
+};
+
+static const struct exposure_factors exposure_factors_two_seconds = {
+	.n2 = {
+		4.6103208970367238E-003, 2.8839466655772306E-003, 1.8466852562531999E-003, 1.2481342706021081E-003,
+		8.5537122128931387E-004, 6.0307932830039324E-004, 4.2541420062447433E-004, 3.0001869993157015E-004,
+		2.1194915046696128E-004, 1.5824025964805699E-004, 1.2354801448111186E-004, 9.6668574237845917E-005,
+		7.5750920983552739E-005, 5.9241593916681268E-005, 4.6394317364861770E-005, 3.6385016820905669E-005
+	},
+	.he = {
+		1.2214631928102238E-002, 7.6214395462123052E-003, 4.8831456959265163E-003, 3.2999659965596839E-003,
+		2.2604096860333600E-003, 1.5943703199911008E-003, 1.1247885784462230E-003, 7.9339536739331251E-004,
+		5.6064147161116740E-004, 4.1855536041834895E-004, 3.2679488657194611E-004, 2.5572228995274227E-004,
+		2.0038677234712754E-004, 1.5671615463774824E-004, 1.2273421222785963E-004, 9.6253776756816123E-005
+	},
+};
+
+static const struct exposure_factors exposure_factors_twenty_seconds = {
+	.n2 = {
+		4.5158396092133124E-002, 2.8468058848015509E-002, 1.8314144754294048E-002, 1.2411472762149489E-002,
+		8.5208625048123210E-003, 6.0144528659480390E-003, 4.2460072623105027E-003, 2.9961397333071460E-003,
+		2.1174711368912025E-003, 1.5812762727392959E-003, 1.2347934860300613E-003, 9.6626533416610538E-004,
+		7.5725104289858791E-004, 5.9225803362361606E-004, 4.6384632615981136E-004, 3.6379059986346718E-004
+	},
+	.he = {
+		1.1564652376831019E-001, 7.3652932206574984E-002, 4.7772280916053567E-002, 3.2513907566291356E-002,
+		2.2375551989680109E-002, 1.5829797443158933E-002, 1.1191124491273796E-002, 7.9056870922179501E-003,
+		5.5922914931152423E-003, 4.1776789103379341E-003, 3.2631472809235840E-003, 2.5542821803201665E-003,
+		2.0020617200796620E-003, 1.5660568102331407E-003, 1.2266644781823155E-003, 9.6212095903291939E-004
+	},
+};
+
+static const struct exposure_factors exposure_factors_one_minute = {
+	.n2 = {
+		1.2944943671084974E-001, 8.2995956799920112E-002, 5.3942353277435573E-002, 3.6774196239125256E-002,
+		2.5345390879014773E-002, 1.7935055232686570E-002, 1.2684012603388473E-002, 8.9615155359237253E-003,
+		6.3389718526983829E-003, 4.7363314681437840E-003, 3.6998081959388474E-003, 2.8959958985818046E-003,
+		2.2700332754995722E-003, 1.7757219998818519E-003, 1.3908936180346831E-003, 1.0909748169339872E-003
+	},
+	.he = {
+		3.0836388623417677E-001, 2.0508408242157294E-001, 1.3657929573753824E-001, 9.4404632356647977E-002,
+		6.5635862651562071E-002, 4.6741611538215877E-002, 3.3199051262298385E-002, 2.3530055716014520E-002,
+		1.6683228198695499E-002, 1.2480750640814664E-002, 9.7575321986567154E-003, 7.6432901336404013E-003,
+		5.9941684316120458E-003, 4.6908166697082754E-003, 3.6754811630900219E-003, 2.8835867374922275E-003
+	},
+};
 const double vpmb_conservatism_lvls[] = { 1.0, 1.05, 1.12, 1.22, 1.35 };
 
 /* Inspired gas loading equations depend on the partial pressure of inert gas in the alveolar.
@@ -153,22 +189,24 @@ const double vpmb_conservatism_lvls[] = { 1.0, 1.05, 1.12, 1.22, 1.35 };
 
 #define TISSUE_ARRAY_SZ sizeof(ds->tissue_n2_sat)
 
-int  sum1;
-long sumx, sumxx;
-double sumy, sumxy;
+static double get_crit_radius_He(const struct vpmb_config *vpmb)
+{
+	if (vpmb->conservatism <= 4)
+		return vpmb->crit_radius_He * vpmb_conservatism_lvls[vpmb->conservatism] * subsurface_conservatism_factor;
+	return vpmb->crit_radius_He;
+}
 
-double get_crit_radius_He()
+static double get_crit_radius_N2(const struct vpmb_config *vpmb)
 {
-	if (vpmb_config.conservatism <= 4)
-		return vpmb_config.crit_radius_He * vpmb_conservatism_lvls[vpmb_config.conservatism] * subsurface_conservatism_factor;
-	return vpmb_config.crit_radius_He;
+	if (vpmb->conservatism <= 4)
+		return vpmb->crit_radius_N2 * vpmb_conservatism_lvls[vpmb->conservatism] * subsurface_conservatism_factor;
+	return vpmb->crit_radius_N2;
 }
 
-double get_crit_radius_N2()
+/* The planner uses the Schreiner value for the water vapour pressure with VPM-B */
+static double water_vapour_pressure(const struct deco_config *config)
 {
-	if (vpmb_config.conservatism <= 4)
-		return vpmb_config.crit_radius_N2 * vpmb_conservatism_lvls[vpmb_config.conservatism] * subsurface_conservatism_factor;
-	return vpmb_config.crit_radius_N2;
+	return config->in_planner && config->deco_mode == VPMB ? WV_PRESSURE_SCHREINER : WV_PRESSURE;
 }
 
 // Solve another cubic equation, this time
@@ -216,7 +254,7 @@ double vpmb_tolerated_ambient_pressure(struct deco_state *ds, double reference_p
 
 	total_gradient = ((n2_gradient * ds->tissue_n2_sat[ci]) + (he_gradient * ds->tissue_he_sat[ci])) / (ds->tissue_n2_sat[ci] + ds->tissue_he_sat[ci]);
 
-	return ds->tissue_n2_sat[ci] + ds->tissue_he_sat[ci] + vpmb_config.other_gases_pressure - total_gradient;
+	return ds->tissue_n2_sat[ci] + ds->tissue_he_sat[ci] + ds->config.vpmb.other_gases_pressure - total_gradient;
 }
 
 
@@ -224,44 +262,34 @@ double tissue_tolerance_calc(struct deco_state *ds, const struct dive *dive, dou
 {
 	int ci = -1;
 	double ret_tolerance_limit_ambient_pressure = 0.0;
-	double gf_high = buehlmann_config.gf_high;
-	double gf_low = buehlmann_config.gf_low;
+	double gf_high = ds->config.buehlmann.gf_high;
+	double gf_low = ds->config.buehlmann.gf_low;
 	double surface = get_surface_pressure_in_mbar(dive, true) / 1000.0;
-	double lowest_ceiling = 0.0;
-	double tissue_lowest_ceiling[16];
-
-	for (ci = 0; ci < 16; ci++) {
-		ds->buehlmann_inertgas_a[ci] = ((buehlmann_N2_a[ci] * ds->tissue_n2_sat[ci]) + (buehlmann_He_a[ci] * ds->tissue_he_sat[ci])) / ds->tissue_inertgas_saturation[ci];
-		ds->buehlmann_inertgas_b[ci] = ((buehlmann_N2_b[ci] * ds->tissue_n2_sat[ci]) + (buehlmann_He_b[ci] * ds->tissue_he_sat[ci])) / ds->tissue_inertgas_saturation[ci];
-	}
-
-	if (decoMode() != VPMB) {
-		for (ci = 0; ci < 16; ci++) {
-
-			/* tolerated = (tissue_inertgas_saturation - buehlmann_inertgas_a) * buehlmann_inertgas_b; */
-
-			tissue_lowest_ceiling[ci] = (ds->buehlmann_inertgas_b[ci] * ds->tissue_inertgas_saturation[ci] - gf_low * ds->buehlmann_inertgas_a[ci] * ds->buehlmann_inertgas_b[ci]) /
-						     ((1.0 - ds->buehlmann_inertgas_b[ci]) * gf_low + ds->buehlmann_inertgas_b[ci]);
-			if (tissue_lowest_ceiling[ci] > lowest_ceiling)
-				lowest_ceiling = tissue_lowest_ceiling[ci];
-			if (lowest_ceiling > ds->gf_low_pressure_this_dive)
-				ds->gf_low_pressure_this_dive = lowest_ceiling;
-		}
+	double lowest_ceiling;
+	double tolerated_by_tissue[16];
+	unsigned int tolerated_mask;
+
+	buehlmann_coefficients(ds->tissue_n2_sat, ds->tissue_he_sat, ds->tissue_inertgas_saturation,
+			       ds->buehlmann_inertgas_a, ds->buehlmann_inertgas_b);
+
+	if (ds->config.deco_mode != VPMB) {
+		/* tolerated = (tissue_inertgas_saturation - buehlmann_inertgas_a) * buehlmann_inertgas_b; */
+		lowest_ceiling = buehlmann_lowest_ceiling(ds->buehlmann_inertgas_a, ds->buehlmann_inertgas_b,
+							  ds->tissue_inertgas_saturation, gf_low);
+		if (lowest_ceiling > ds->gf_low_pressure_this_dive)
+			ds->gf_low_pressure_this_dive = lowest_ceiling;
+
+		tolerated_mask = buehlmann_tolerated(ds->buehlmann_inertgas_a, ds->buehlmann_inertgas_b,
+						     ds->tissue_inertgas_saturation, gf_low, gf_high,
+						     ds->gf_low_pressure_this_dive, surface, tolerated_by_tissue);
 		for (ci = 0; ci < 16; ci++) {
 			double tolerated;
 
-			if ((surface / ds->buehlmann_inertgas_b[ci] + ds->buehlmann_inertgas_a[ci] - surface) * gf_high + surface <
-			    (ds->gf_low_pressure_this_dive / ds->buehlmann_inertgas_b[ci] + ds->buehlmann_inertgas_a[ci] - ds->gf_low_pressure_this_dive) * gf_low + ds->gf_low_pressure_this_dive)
-				tolerated = (-ds->buehlmann_inertgas_a[ci] * ds->buehlmann_inertgas_b[ci] * (gf_high * ds->gf_low_pressure_this_dive - gf_low * surface) -
-					     (1.0 - ds->buehlmann_inertgas_b[ci]) * (gf_high - gf_low) * ds->gf_low_pressure_this_dive * surface +
-					     ds->buehlmann_inertgas_b[ci] * (ds->gf_low_pressure_this_dive - surface) * ds->tissue_inertgas_saturation[ci]) /
-					    (-ds->buehlmann_inertgas_a[ci] * ds->buehlmann_inertgas_b[ci] * (gf_high - gf_low) +
-					     (1.0 - ds->buehlmann_inertgas_b[ci]) * (gf_low * ds->gf_low_pressure_this_dive - gf_high * surface) +
-					     ds->buehlmann_inertgas_b[ci] * (ds->gf_low_pressure_this_dive - surface));
+			if (tolerated_mask & (1u << ci))
+				tolerated = tolerated_by_tissue[ci];
 			else
 				tolerated = ret_tolerance_limit_ambient_pressure;
 
-
 			ds->tolerated_by_tissue[ci] = tolerated;
 
 			if (tolerated >= ret_tolerance_limit_ambient_pressure) {
@@ -289,62 +317,60 @@ double tissue_tolerance_calc(struct deco_state *ds, const struct dive *dive, dou
 		// We are doing ok if the gradient was computed within ten centimeters of the ceiling.
 		} while (fabs(ret_tolerance_limit_ambient_pressure - reference_pressure) > 0.01);
 
-		if (plot_depth) {
-			++sum1;
-			sumx += plot_depth;
-			sumxx += (long)plot_depth * plot_depth;
+		if (ds->regression.plot_depth) {
+			struct deco_regression *r = &ds->regression;
+			++r->sum1;
+			r->sumx += r->plot_depth;
+			r->sumxx += (long)r->plot_depth * r->plot_depth;
 			double n2_gradient, he_gradient, total_gradient;
-			n2_gradient = update_gradient(ds, depth_to_bar(plot_depth, &displayed_dive), ds->bottom_n2_gradient[ds->ci_pointing_to_guiding_tissue]);
-			he_gradient = update_gradient(ds, depth_to_bar(plot_depth, &displayed_dive), ds->bottom_he_gradient[ds->ci_pointing_to_guiding_tissue]);
+			n2_gradient = update_gradient(ds, depth_to_bar(r->plot_depth, dive), ds->bottom_n2_gradient[ds->ci_pointing_to_guiding_tissue]);
+			he_gradient = update_gradient(ds, depth_to_bar(r->plot_depth, dive), ds->bottom_he_gradient[ds->ci_pointing_to_guiding_tissue]);
 			total_gradient = ((n2_gradient * ds->tissue_n2_sat[ds->ci_pointing_to_guiding_tissue]) + (he_gradient * ds->tissue_he_sat[ds->ci_pointing_to_guiding_tissue]))
 					/ (ds->tissue_n2_sat[ds->ci_pointing_to_guiding_tissue] + ds->tissue_he_sat[ds->ci_pointing_to_guiding_tissue]);
 
-			double buehlmann_gradient = (1.0 / ds->buehlmann_inertgas_b[ds->ci_pointing_to_guiding_tissue] - 1.0) * depth_to_bar(plot_depth, &displayed_dive) + ds->buehlmann_inertgas_a[ds->ci_pointing_to_guiding_tissue];
-			double gf = (total_gradient - vpmb_config.other_gases_pressure) / buehlmann_gradient;
-			sumxy += gf * plot_depth;
-			sumy += gf;
-			plot_depth = 0;
+			double buehlmann_gradient = (1.0 / ds->buehlmann_inertgas_b[ds->ci_pointing_to_guiding_tissue] - 1.0) * depth_to_bar(r->plot_depth, dive) + ds->buehlmann_inertgas_a[ds->ci_pointing_to_guiding_tissue];
+			double gf = (total_gradient - ds->config.vpmb.other_gases_pressure) / buehlmann_gradient;
+			r->sumxy += gf * r->plot_depth;
+			r->sumy += gf;
+			r->plot_depth = 0;
 		}
 	}
 	return ret_tolerance_limit_ambient_pressure;
 }
 
 /*
- * Return buelman factor for a particular period and tissue index.
+ * Return the buelman factors of all tissues for a particular period.
  *
- * We cache the factor, since we commonly call this with the
- * same values... We have a special "fixed cache" for the one second
- * case, although I wonder if that's even worth it considering the
- * more general-purpose cache.
+ * The common periods come from the precomputed tables above. Anything
+ * else is calculated into the caller-provided buffer. There is no shared
+ * cache, so concurrent deco calculations don't have to synchronize.
  */
-
-
-double factor(int period_in_seconds, int ci, enum inertgas gas)
+static const struct exposure_factors *exposure_factors(int period_in_seconds, struct exposure_factors *buf)
 {
-	double factor;
-	if (period_in_seconds == 1) {
-		if (gas == N2)
-			return buehlmann_N2_factor_expositon_one_second[ci];
-		else
-			return buehlmann_He_factor_expositon_one_second[ci];
-	}
+	int ci;
 
-	factor = cache_value(ci, period_in_seconds, gas);
-	if (!factor) {
-		// ln(2)/60 = 1.155245301e-02
-		if (gas == N2)
-			factor = 1 - exp(-period_in_seconds * 1.155245301e-02 / buehlmann_N2_t_halflife[ci]);
-		else
-			factor = 1 - exp(-period_in_seconds * 1.155245301e-02 / buehlmann_He_t_halflife[ci]);
-		cache_insert(ci, period_in_seconds, gas, factor);
+	switch (period_in_seconds) {
+	case 1:
+		return &exposure_factors_one_second;
+	case 2:
+		return &exposure_factors_two_seconds;
+	case 20:
+		return &exposure_factors_twenty_seconds;
+	case 60:
+		return &exposure_factors_one_minute;
 	}
 
-	return factor;
+	// ln(2)/60 = 1.155245301e-02
+	for (ci = 0; ci < 16; ci++) {
+		buf->n2[ci] = 1 - exp(-period_in_seconds * 1.155245301e-02 / buehlmann_N2_t_halflife[ci]);
+		buf->he[ci] = 1 - exp(-period_in_seconds * 1.155245301e-02 / buehlmann_He_t_halflife[ci]);
+	}
+	return buf;
 }
 
-double calc_surface_phase(double surface_pressure, double he_pressure, double n2_pressure, double he_time_constant, double n2_time_constant)
+double calc_surface_phase(const struct deco_config *config, double surface_pressure, double he_pressure, double n2_pressure, double he_time_constant, double n2_time_constant)
 {
-	double inspired_n2 = (surface_pressure - ((in_planner() && (decoMode() == VPMB)) ? WV_PRESSURE_SCHREINER : WV_PRESSURE)) * NITROGEN_FRACTION;
+	double inspired_n2 = (surface_pressure - water_vapour_pressure(config)) * NITROGEN_FRACTION;
 
 	if (n2_pressure > inspired_n2)
 		return (he_pressure / he_time_constant + (n2_pressure - inspired_n2) / n2_time_constant) / (he_pressure + n2_pressure - inspired_n2);
@@ -361,10 +387,11 @@ double calc_surface_phase(double surface_pressure, double he_pressure, double n2
 void vpmb_start_gradient(struct deco_state *ds)
 {
 	int ci;
+	const struct vpmb_config *vpmb = &ds->config.vpmb;
 
 	for (ci = 0; ci < 16; ++ci) {
-		ds->initial_n2_gradient[ci] = ds->bottom_n2_gradient[ci] = 2.0 * (vpmb_config.surface_tension_gamma / vpmb_config.skin_compression_gammaC) * ((vpmb_config.skin_compression_gammaC - vpmb_config.surface_tension_gamma) / ds->n2_regen_radius[ci]);
-		ds->initial_he_gradient[ci] = ds->bottom_he_gradient[ci] = 2.0 * (vpmb_config.surface_tension_gamma / vpmb_config.skin_compression_gammaC) * ((vpmb_config.skin_compression_gammaC - vpmb_config.surface_tension_gamma) / ds->he_regen_radius[ci]);
+		ds->initial_n2_gradient[ci] = ds->bottom_n2_gradient[ci] = 2.0 * (vpmb->surface_tension_gamma / vpmb->skin_compression_gammaC) * ((vpmb->skin_compression_gammaC - vpmb->surface_tension_gamma) / ds->n2_regen_radius[ci]);
+		ds->initial_he_gradient[ci] = ds->bottom_he_gradient[ci] = 2.0 * (vpmb->surface_tension_gamma / vpmb->skin_compression_gammaC) * ((vpmb->skin_compression_gammaC - vpmb->surface_tension_gamma) / ds->he_regen_radius[ci]);
 	}
 }
 
@@ -374,18 +401,19 @@ void vpmb_next_gradient(struct deco_state *ds, double deco_time, double surface_
 	double n2_b, n2_c;
 	double he_b, he_c;
 	double desat_time;
+	const struct vpmb_config *vpmb = &ds->config.vpmb;
 	deco_time /= 60.0;
 
 	for (ci = 0; ci < 16; ++ci) {
-		desat_time = deco_time + calc_surface_phase(surface_pressure, ds->tissue_he_sat[ci], ds->tissue_n2_sat[ci], log(2.0) / buehlmann_He_t_halflife[ci], log(2.0) / buehlmann_N2_t_halflife[ci]);
+		desat_time = deco_time + calc_surface_phase(&ds->config, surface_pressure, ds->tissue_he_sat[ci], ds->tissue_n2_sat[ci], log(2.0) / buehlmann_He_t_halflife[ci], log(2.0) / buehlmann_N2_t_halflife[ci]);
 
-		n2_b = ds->initial_n2_gradient[ci] + (vpmb_config.crit_volume_lambda * vpmb_config.surface_tension_gamma) / (vpmb_config.skin_compression_gammaC * desat_time);
-		he_b = ds->initial_he_gradient[ci] + (vpmb_config.crit_volume_lambda * vpmb_config.surface_tension_gamma) / (vpmb_config.skin_compression_gammaC * desat_time);
+		n2_b = ds->initial_n2_gradient[ci] + (vpmb->crit_volume_lambda * vpmb->surface_tension_gamma) / (vpmb->skin_compression_gammaC * desat_time);
+		he_b = ds->initial_he_gradient[ci] + (vpmb->crit_volume_lambda * vpmb->surface_tension_gamma) / (vpmb->skin_compression_gammaC * desat_time);
 
-		n2_c = vpmb_config.surface_tension_gamma * vpmb_config.surface_tension_gamma * vpmb_config.crit_volume_lambda * ds->max_n2_crushing_pressure[ci];
-		n2_c = n2_c / (vpmb_config.skin_compression_gammaC * vpmb_config.skin_compression_gammaC * desat_time);
-		he_c = vpmb_config.surface_tension_gamma * vpmb_config.surface_tension_gamma * vpmb_config.crit_volume_lambda * ds->max_he_crushing_pressure[ci];
-		he_c = he_c / (vpmb_config.skin_compression_gammaC * vpmb_config.skin_compression_gammaC * desat_time);
+		n2_c = vpmb->surface_tension_gamma * vpmb->surface_tension_gamma * vpmb->crit_volume_lambda * ds->max_n2_crushing_pressure[ci];
+		n2_c = n2_c / (vpmb->skin_compression_gammaC * vpmb->skin_compression_gammaC * desat_time);
+		he_c = vpmb->surface_tension_gamma * vpmb->surface_tension_gamma * vpmb->crit_volume_lambda * ds->max_he_crushing_pressure[ci];
+		he_c = he_c / (vpmb->skin_compression_gammaC * vpmb->skin_compression_gammaC * desat_time);
 
 		ds->bottom_n2_gradient[ci] = 0.5 * ( n2_b + sqrt(n2_b * n2_b - 4.0 * n2_c));
 		ds->bottom_he_gradient[ci] = 0.5 * ( he_b + sqrt(he_b * he_b - 4.0 * he_c));
@@ -419,25 +447,26 @@ void nuclear_regeneration(struct deco_state *ds, double time)
 	time /= 60.0;
 	int ci;
 	double crushing_radius_N2, crushing_radius_He;
+	const struct vpmb_config *vpmb = &ds->config.vpmb;
 	for (ci = 0; ci < 16; ++ci) {
 		//rm
-		crushing_radius_N2 = 1.0 / (ds->max_n2_crushing_pressure[ci] / (2.0 * (vpmb_config.skin_compression_gammaC - vpmb_config.surface_tension_gamma)) + 1.0 / get_crit_radius_N2());
-		crushing_radius_He = 1.0 / (ds->max_he_crushing_pressure[ci] / (2.0 * (vpmb_config.skin_compression_gammaC - vpmb_config.surface_tension_gamma)) + 1.0 / get_crit_radius_He());
+		crushing_radius_N2 = 1.0 / (ds->max_n2_crushing_pressure[ci] / (2.0 * (vpmb->skin_compression_gammaC - vpmb->surface_tension_gamma)) + 1.0 / get_crit_radius_N2(vpmb));
+		crushing_radius_He = 1.0 / (ds->max_he_crushing_pressure[ci] / (2.0 * (vpmb->skin_compression_gammaC - vpmb->surface_tension_gamma)) + 1.0 / get_crit_radius_He(vpmb));
 		//rs
-		ds->n2_regen_radius[ci] = crushing_radius_N2 + (get_crit_radius_N2() - crushing_radius_N2) * (1.0 - exp (-time / vpmb_config.regeneration_time));
-		ds->he_regen_radius[ci] = crushing_radius_He + (get_crit_radius_He() - crushing_radius_He) * (1.0 - exp (-time / vpmb_config.regeneration_time));
+		ds->n2_regen_radius[ci] = crushing_radius_N2 + (get_crit_radius_N2(vpmb) - crushing_radius_N2) * (1.0 - exp (-time / vpmb->regeneration_time));
+		ds->he_regen_radius[ci] = crushing_radius_He + (get_crit_radius_He(vpmb) - crushing_radius_He) * (1.0 - exp (-time / vpmb->regeneration_time));
 	}
 }
 
 
 // Calculates the nucleons inner pressure during the impermeable period
-double calc_inner_pressure(double crit_radius, double onset_tension, double current_ambient_pressure)
+double calc_inner_pressure(const struct vpmb_config *vpmb, double crit_radius, double onset_tension, double current_ambient_pressure)
 {
-	double onset_radius = 1.0 / (vpmb_config.gradient_of_imperm / (2.0 * (vpmb_config.skin_compression_gammaC - vpmb_config.surface_tension_gamma)) + 1.0 / crit_radius);
+	double onset_radius = 1.0 / (vpmb->gradient_of_imperm / (2.0 * (vpmb->skin_compression_gammaC - vpmb->surface_tension_gamma)) + 1.0 / crit_radius);
 
 
-	double A = current_ambient_pressure - vpmb_config.gradient_of_imperm + (2.0 * (vpmb_config.skin_compression_gammaC - vpmb_config.surface_tension_gamma)) / onset_radius;
-	double B = 2.0 * (vpmb_config.skin_compression_gammaC - vpmb_config.surface_tension_gamma);
+	double A = current_ambient_pressure - vpmb->gradient_of_imperm + (2.0 * (vpmb->skin_compression_gammaC - vpmb->surface_tension_gamma)) / onset_radius;
+	double B = 2.0 * (vpmb->skin_compression_gammaC - vpmb->surface_tension_gamma);
 	double C = onset_tension * pow(onset_radius, 3);
 
 	double current_radius = solve_cubic(A, B, C);
@@ -453,12 +482,13 @@ void calc_crushing_pressure(struct deco_state *ds, double pressure)
 	double gas_tension;
 	double n2_crushing_pressure, he_crushing_pressure;
 	double n2_inner_pressure, he_inner_pressure;
+	const struct vpmb_config *vpmb = &ds->config.vpmb;
 
 	for (ci = 0; ci < 16; ++ci) {
-		gas_tension = ds->tissue_n2_sat[ci] + ds->tissue_he_sat[ci] + vpmb_config.other_gases_pressure;
+		gas_tension = ds->tissue_n2_sat[ci] + ds->tissue_he_sat[ci] + vpmb->other_gases_pressure;
 		gradient = pressure - gas_tension;
 
-		if (gradient <= vpmb_config.gradient_of_imperm) {	// permeable situation
+		if (gradient <= vpmb->gradient_of_imperm) {	// permeable situation
 			n2_crushing_pressure = he_crushing_pressure = gradient;
 			ds->crushing_onset_tension[ci] = gas_tension;
 		}
@@ -466,8 +496,8 @@ void calc_crushing_pressure(struct deco_state *ds, double pressure)
 			if (ds->max_ambient_pressure >= pressure)
 				return;
 
-			n2_inner_pressure = calc_inner_pressure(get_crit_radius_N2(), ds->crushing_onset_tension[ci], pressure);
-			he_inner_pressure = calc_inner_pressure(get_crit_radius_He(), ds->crushing_onset_tension[ci], pressure);
+			n2_inner_pressure = calc_inner_pressure(vpmb, get_crit_radius_N2(vpmb), ds->crushing_onset_tension[ci], pressure);
+			he_inner_pressure = calc_inner_pressure(vpmb, get_crit_radius_He(vpmb), ds->crushing_onset_tension[ci], pressure);
 
 			n2_crushing_pressure = pressure - n2_inner_pressure;
 			he_crushing_pressure = pressure - he_inner_pressure;
@@ -485,33 +515,123 @@ void add_segment(struct deco_state *ds, double pressure, struct gasmix gasmix, i
 	int ci;
 	struct gas_pressures pressures;
 	bool icd = false;
-	fill_pressures(&pressures, pressure - ((in_planner() && (decoMode() == VPMB)) ? WV_PRESSURE_SCHREINER : WV_PRESSURE),
+	const struct buehlmann_config *buehlmann = &ds->config.buehlmann;
+	struct exposure_factors buf;
+	const struct exposure_factors *f = exposure_factors(period_in_seconds, &buf);
+	fill_pressures(&pressures, pressure - water_vapour_pressure(&ds->config),
 		       gasmix, (double) ccpo2 / 1000.0, divemode);
 
-	for (ci = 0; ci < 16; ci++) {
+	// Report ICD if N2 is more on-gasing than He off-gasing in leading tissue
+	ci = ds->ci_pointing_to_guiding_tissue;
+	if (ci >= 0 && ci < 16) {
 		double pn2_oversat = pressures.n2 - ds->tissue_n2_sat[ci];
 		double phe_oversat = pressures.he - ds->tissue_he_sat[ci];
-		double n2_f = factor(period_in_seconds, ci, N2);
-		double he_f = factor(period_in_seconds, ci, HE);
-		double n2_satmult = pn2_oversat > 0 ? buehlmann_config.satmult : buehlmann_config.desatmult;
-		double he_satmult = phe_oversat > 0 ? buehlmann_config.satmult : buehlmann_config.desatmult;
-
-		// Report ICD if N2 is more on-gasing than He off-gasing in leading tissue
-		if (ci == ds->ci_pointing_to_guiding_tissue && pn2_oversat > 0.0 && phe_oversat < 0.0 &&
-		    pn2_oversat * n2_satmult * n2_f + phe_oversat * he_satmult * he_f > 0)
+		double n2_satmult = pn2_oversat > 0 ? buehlmann->satmult : buehlmann->desatmult;
+		double he_satmult = phe_oversat > 0 ? buehlmann->satmult : buehlmann->desatmult;
+
+		if (pn2_oversat > 0.0 && phe_oversat < 0.0 &&
+		    pn2_oversat * n2_satmult * f->n2[ci] + phe_oversat * he_satmult * f->he[ci] > 0)
 			icd = true;
+	}
 
-		ds->tissue_n2_sat[ci] += n2_satmult * pn2_oversat * n2_f;
-		ds->tissue_he_sat[ci] += he_satmult * phe_oversat * he_f;
-		ds->tissue_inertgas_saturation[ci] = ds->tissue_n2_sat[ci] + ds->tissue_he_sat[ci];
+	saturate_tissues(ds->tissue_n2_sat, ds->tissue_he_sat, ds->tissue_inertgas_saturation,
+			 pressures.n2, pressures.he, f->n2, f->he, buehlmann->satmult, buehlmann->desatmult);
 
-	}
-	if (decoMode() == VPMB)
+	if (ds->config.deco_mode == VPMB)
 		calc_crushing_pressure(ds, pressure);
 	ds->icd_warning = icd;
 	return;
 }
 
+/*
+ * Add count periods of period_in_seconds at constant pressure and gas.
+ * At constant depth every tissue approaches the inspired pressure
+ * geometrically, so this gives the loadings of count add_segment() calls
+ * (up to rounding) in constant time.
+ */
+void add_segments(struct deco_state *ds, double pressure, struct gasmix gasmix, int period_in_seconds, int count, int ccpo2, enum divemode_t divemode)
+{
+	int ci;
+	struct gas_pressures pressures;
+	const struct buehlmann_config *buehlmann = &ds->config.buehlmann;
+	struct exposure_factors buf;
+	const struct exposure_factors *f;
+
+	if (count <= 0)
+		return;
+	f = exposure_factors(period_in_seconds, &buf);
+	fill_pressures(&pressures, pressure - water_vapour_pressure(&ds->config),
+		       gasmix, (double) ccpo2 / 1000.0, divemode);
+
+	for (ci = 0; ci < 16; ci++) {
+		double pn2_oversat = pressures.n2 - ds->tissue_n2_sat[ci];
+		double phe_oversat = pressures.he - ds->tissue_he_sat[ci];
+		double n2_satmult = pn2_oversat > 0 ? buehlmann->satmult : buehlmann->desatmult;
+		double he_satmult = phe_oversat > 0 ? buehlmann->satmult : buehlmann->desatmult;
+
+		ds->tissue_n2_sat[ci] = pressures.n2 - pn2_oversat * pow(1.0 - n2_satmult * f->n2[ci], count);
+		ds->tissue_he_sat[ci] = pressures.he - phe_oversat * pow(1.0 - he_satmult * f->he[ci], count);
+		ds->tissue_inertgas_saturation[ci] = ds->tissue_n2_sat[ci] + ds->tissue_he_sat[ci];
+	}
+	if (ds->config.deco_mode == VPMB)
+		calc_crushing_pressure(ds, pressure);
+}
+
+/*
+ * Closed-form estimate of the number of periods of period_in_seconds the
+ * tissues can stay at the given pressure and gas before the first of them
+ * passes its surfacing limit, i.e. before there is a ceiling. The limit is
+ * the surface M-value scaled by gf_high, or the bottom gradient for VPM-B.
+ *
+ * Per tissue this solves P(n) = P_insp - (P_insp - P_0) * (1 - satmult * f)^n
+ * for the loading that hits the limit. For mixes of N2 and He the rate is
+ * weighted by the oversaturation of either gas and the limit is that of the
+ * current mix in the tissue, so trimix results are approximate. Callers
+ * that need the exact step verify the estimate with tissue_tolerance_calc().
+ * Returns INT_MAX if no tissue reaches its limit at this depth.
+ */
+int periods_to_surfacing_limit(const struct deco_state *ds, double pressure, double surface_pressure, struct gasmix gasmix, int period_in_seconds, int ccpo2, enum divemode_t divemode)
+{
+	int ci;
+	double periods = INT_MAX;
+	struct gas_pressures pressures;
+	struct exposure_factors buf;
+	const struct exposure_factors *f = exposure_factors(period_in_seconds, &buf);
+	const struct deco_config *config = &ds->config;
+
+	fill_pressures(&pressures, pressure - water_vapour_pressure(config),
+		       gasmix, (double) ccpo2 / 1000.0, divemode);
+
+	for (ci = 0; ci < 16; ci++) {
+		double n2 = ds->tissue_n2_sat[ci], he = ds->tissue_he_sat[ci];
+		double loading = n2 + he;
+		double inspired = pressures.n2 + pressures.he;
+		double pn2_oversat = pressures.n2 - n2, phe_oversat = pressures.he - he;
+		double limit, rate, n;
+
+		if (config->deco_mode == VPMB) {
+			double gradient = (ds->bottom_n2_gradient[ci] * n2 + ds->bottom_he_gradient[ci] * he) / loading;
+			limit = surface_pressure - config->vpmb.other_gases_pressure + gradient;
+		} else {
+			double a = (buehlmann_N2_a[ci] * n2 + buehlmann_He_a[ci] * he) / loading;
+			double b = (buehlmann_N2_b[ci] * n2 + buehlmann_He_b[ci] * he) / loading;
+			limit = surface_pressure + config->buehlmann.gf_high * (surface_pressure / b + a - surface_pressure);
+		}
+		if (loading >= limit)
+			return 0;
+		if (inspired <= limit)
+			continue;
+
+		rate = config->buehlmann.satmult * (pn2_oversat * f->n2[ci] + phe_oversat * f->he[ci]) / (inspired - loading);
+		if (rate <= 0.0 || rate >= 1.0)
+			continue;
+		n = log((inspired - limit) / (inspired - loading)) / log(1.0 - rate);
+		if (n < periods)
+			periods = n;
+	}
+	return periods >= INT_MAX ? INT_MAX : (int)ceil(periods);
+}
+
 #if DECO_CALC_DEBUG
 void dump_tissues(struct deco_state *ds)
 {
@@ -538,21 +658,56 @@ void clear_vpmb_state(struct deco_state *ds)
 	ds->max_bottom_ceiling_pressure.mbar = 0;
 }
 
+/* Set up the model parameters of a calculation from the preferences.
+ * Callers that want different gradient factors or conservatism (i.e. the planner)
+ * override them with set_gf() and set_vpmb_conservatism() before calling clear_deco(). */
+void init_deco_config(struct deco_config *config, bool in_planner)
+{
+	config->deco_mode = in_planner ? prefs.planner_deco_mode : prefs.display_deco_mode;
+	config->in_planner = in_planner;
+	config->buehlmann = buehlmann_config;
+	config->vpmb = vpmb_config;
+	set_gf(config, prefs.gflow, prefs.gfhigh);
+	set_vpmb_conservatism(config, prefs.vpmb_conservatism);
+}
+
+/* True if both configurations load the tissues the same way. The gradient factors only
+ * enter the ceilings, so configurations that only differ in those are the same model. */
+bool same_deco_model(const struct deco_config *a, const struct deco_config *b)
+{
+	const struct buehlmann_config *ba = &a->buehlmann, *bb = &b->buehlmann;
+	const struct vpmb_config *va = &a->vpmb, *vb = &b->vpmb;
+
+	return a->deco_mode == b->deco_mode && a->in_planner == b->in_planner &&
+	       ba->satmult == bb->satmult && ba->desatmult == bb->desatmult &&
+	       ba->last_deco_stop_in_mtr == bb->last_deco_stop_in_mtr &&
+	       ba->gf_low_position_min == bb->gf_low_position_min &&
+	       va->crit_radius_N2 == vb->crit_radius_N2 && va->crit_radius_He == vb->crit_radius_He &&
+	       va->crit_volume_lambda == vb->crit_volume_lambda && va->gradient_of_imperm == vb->gradient_of_imperm &&
+	       va->surface_tension_gamma == vb->surface_tension_gamma &&
+	       va->skin_compression_gammaC == vb->skin_compression_gammaC &&
+	       va->regeneration_time == vb->regeneration_time && va->other_gases_pressure == vb->other_gases_pressure &&
+	       va->conservatism == vb->conservatism;
+}
+
+/* Reset the tissues to surface saturation. The model parameters in ds->config are kept. */
 void clear_deco(struct deco_state *ds, double surface_pressure)
 {
 	int ci;
+	struct deco_config config = ds->config;
 
 	memset(ds, 0, sizeof(*ds));
+	ds->config = config;
 	clear_vpmb_state(ds);
 	for (ci = 0; ci < 16; ci++) {
-		ds->tissue_n2_sat[ci] = (surface_pressure - ((in_planner() && (decoMode() == VPMB)) ? WV_PRESSURE_SCHREINER : WV_PRESSURE)) * N2_IN_AIR / 1000;
+		ds->tissue_n2_sat[ci] = (surface_pressure - water_vapour_pressure(&ds->config)) * N2_IN_AIR / 1000;
 		ds->tissue_he_sat[ci] = 0.0;
 		ds->max_n2_crushing_pressure[ci] = 0.0;
 		ds->max_he_crushing_pressure[ci] = 0.0;
-		ds->n2_regen_radius[ci] = get_crit_radius_N2();
-		ds->he_regen_radius[ci] = get_crit_radius_He();
+		ds->n2_regen_radius[ci] = get_crit_radius_N2(&ds->config.vpmb);
+		ds->he_regen_radius[ci] = get_crit_radius_He(&ds->config.vpmb);
 	}
-	ds->gf_low_pressure_this_dive = surface_pressure + buehlmann_config.gf_low_position_min;
+	ds->gf_low_pressure_this_dive = surface_pressure + ds->config.buehlmann.gf_low_position_min;
 	ds->max_ambient_pressure = 0.0;
 	ds->ci_pointing_to_guiding_tissue = -1;
 }
@@ -570,6 +725,10 @@ void cache_deco_state(struct deco_state *src, struct deco_state **cached_datap)
 
 void restore_deco_state(struct deco_state *data, struct deco_state *target, bool keep_vpmb_state)
 {
+	/* The model parameters belong to the calculation and the regression
+	 * accumulates over trial ascents. Don't roll these back. */
+	data->config = target->config;
+	data->regression = target->regression;
 	if (keep_vpmb_state) {
 		int ci;
 		for (ci = 0; ci < 16; ci++) {
@@ -598,35 +757,36 @@ int deco_allowed_depth(double tissues_tolerance, double surface_pressure, const
 	if (!smooth)
 		depth = lrint(ceil(depth / DECO_STOPS_MULTIPLIER_MM) * DECO_STOPS_MULTIPLIER_MM);
 
+	/* The last stop depth isn't configurable, so use the default */
 	if (depth > 0 && depth < buehlmann_config.last_deco_stop_in_mtr * 1000)
 		depth = buehlmann_config.last_deco_stop_in_mtr * 1000;
 
 	return depth;
 }
 
-void set_gf(short gflow, short gfhigh)
+void set_gf(struct deco_config *config, short gflow, short gfhigh)
 {
 	if (gflow != -1)
-		buehlmann_config.gf_low = (double)gflow / 100.0;
+		config->buehlmann.gf_low = (double)gflow / 100.0;
 	if (gfhigh != -1)
-		buehlmann_config.gf_high = (double)gfhigh / 100.0;
+		config->buehlmann.gf_high = (double)gfhigh / 100.0;
 }
 
-void set_vpmb_conservatism(short conservatism)
+void set_vpmb_conservatism(struct deco_config *config, short conservatism)
 {
 	if (conservatism < 0)
-		vpmb_config.conservatism = 0;
+		config->vpmb.conservatism = 0;
 	else if (conservatism > 4)
-		vpmb_config.conservatism = 4;
+		config->vpmb.conservatism = 4;
 	else
-		vpmb_config.conservatism = conservatism;
+		config->vpmb.conservatism = conservatism;
 }
 
 double get_gf(struct deco_state *ds, double ambpressure_bar, const struct dive *dive)
 {
 	double surface_pressure_bar = get_surface_pressure_in_mbar(dive, true) / 1000.0;
-	double gf_low = buehlmann_config.gf_low;
-	double gf_high = buehlmann_config.gf_high;
+	double gf_low = ds->config.buehlmann.gf_low;
+	double gf_high = ds->config.buehlmann.gf_high;
 	double gf;
 	if (ds->gf_low_pressure_this_dive > surface_pressure_bar)
 		gf = MAX((double)gf_low, (ambpressure_bar - surface_pressure_bar) /
@@ -636,30 +796,33 @@ double get_gf(struct deco_state *ds, double ambpressure_bar, const struct dive *
 	return gf;
 }
 
-double regressiona()
+double regressiona(const struct deco_state *ds)
 {
-	if (sum1 > 1) {
-		double avxy = sumxy / sum1;
-		double avx = (double)sumx / sum1;
-		double avy = sumy / sum1;
-		double avxx = (double) sumxx / sum1;
+	const struct deco_regression *r = &ds->regression;
+	if (r->sum1 > 1) {
+		double avxy = r->sumxy / r->sum1;
+		double avx = (double)r->sumx / r->sum1;
+		double avy = r->sumy / r->sum1;
+		double avxx = (double) r->sumxx / r->sum1;
 		return (avxy - avx * avy) / (avxx - avx*avx);
 	}
 	else
 		return 0.0;
 }
 
-double regressionb()
+double regressionb(const struct deco_state *ds)
 {
-	if (sum1)
-		return sumy / sum1 - sumx * regressiona() / sum1;
+	const struct deco_regression *r = &ds->regression;
+	if (r->sum1)
+		return r->sumy / r->sum1 - r->sumx * regressiona(ds) / r->sum1;
 	else
 		return 0.0;
 }
 
-void reset_regression()
+void reset_regression(struct deco_state *ds)
 {
-	sum1 = 0;
-	sumxx = sumx = 0L;
-	sumy = sumxy = 0.0;
+	struct deco_regression *r = &ds->regression;
+	r->sum1 = 0;
+	r->sumxx = r->sumx = 0L;
+	r->sumy = r->sumxy = 0.0;
 }
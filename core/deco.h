@@ -6,12 +6,36 @@
 extern "C" {
 #endif
 
-extern double buehlmann_N2_t_halflife[];
+extern const double buehlmann_N2_t_halflife[];
 
 extern int deco_allowed_depth(double tissues_tolerance, double surface_pressure, const struct dive *dive, bool smooth);
 
 double get_gf(struct deco_state *ds, double ambpressure_bar, const struct dive *dive);
 
+extern double regressiona(const struct deco_state *ds);
+extern double regressionb(const struct deco_state *ds);
+extern void reset_regression(struct deco_state *ds);
+
+/* Implementations of the per-tissue kernels in deco-kernel.c */
+enum deco_kernel {
+	DECO_KERNEL_AUTO,
+	DECO_KERNEL_SCALAR,
+	DECO_KERNEL_SSE2,
+	DECO_KERNEL_AVX2
+};
+
+extern enum deco_kernel get_deco_kernel();
+extern enum deco_kernel set_deco_kernel(enum deco_kernel kernel);
+extern void saturate_tissues(double n2_sat[], double he_sat[], double inertgas_sat[],
+			     double pn2, double phe, const double n2_f[], const double he_f[],
+			     double satmult, double desatmult);
+extern void buehlmann_coefficients(const double n2_sat[], const double he_sat[], const double inertgas_sat[],
+				   double a[], double b[]);
+extern double buehlmann_lowest_ceiling(const double a[], const double b[], const double inertgas_sat[], double gf_low);
+extern unsigned int buehlmann_tolerated(const double a[], const double b[], const double inertgas_sat[],
+					double gf_low, double gf_high, double gf_low_pressure, double surface,
+					double tolerated[]);
+
 #ifdef __cplusplus
 }
 #endif
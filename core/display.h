@@ -9,6 +9,7 @@ extern "C" {
 #endif
 
 struct membuffer;
+struct plot_pressure_data;
 
 #define SCALE_SCREEN 1.0
 #define SCALE_PRINT (1.0 / get_screen_dpi())
@@ -16,9 +17,16 @@ struct membuffer;
 extern double get_screen_dpi(void);
 
 /* Plot info with smoothing, velocity indication
- * and one-, two- and three-minute minimums and maximums */
+ * and one-, two- and three-minute minimums and maximums.
+ *
+ * The per-entry scalars live in entry[]. The bulky series are kept
+ * apart and are only allocated when the dive has them: pressures for
+ * nr_cylinders cylinders, and the per-tissue ceilings and percentages
+ * when the deco information was calculated. Access them through the
+ * get_plot_*() helpers in profile.h. */
 struct plot_info {
 	int nr;
+	int nr_cylinders;
 	int maxtime;
 	int meandepth, maxdepth;
 	int minpressure, maxpressure;
@@ -28,6 +36,9 @@ struct plot_info {
 	double endtempcoord;
 	double maxpp;
 	struct plot_data *entry;
+	struct plot_pressure_data *pressures;	/* nr blocks of nr_cylinders entries */
+	int *ceilings;				/* nr blocks of 16 tissues, or NULL */
+	int *percentages;			/* nr blocks of 16 tissues, or NULL */
 };
 
 typedef enum {
@@ -5,6 +5,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <limits.h>
+#include "ssrf.h"
 #include "gettext.h"
 #include "subsurface-string.h"
 #include "libdivecomputer.h"
@@ -14,6 +15,7 @@
 #include "qthelper.h"
 #include "metadata.h"
 #include "membuffer.h"
+#include "hash-index.h"
 
 /* one could argue about the best place to have this variable -
  * it's used in the UI, but it seems to make the most sense to have it
@@ -3831,17 +3833,10 @@ timestamp_t dive_endtime(const struct dive *dive)
 
 struct dive *find_dive_including(timestamp_t when)
 {
-	int i;
-	struct dive *dive;
-
-	/* binary search, anyone? Too lazy for now;
-	 * also we always use the duration from the first divecomputer
+	/* we always use the duration from the first divecomputer
 	 *     could this ever be a problem? */
-	for_each_dive (i, dive) {
-		if (dive->when <= when && when <= dive_endtime(dive))
-			return dive;
-	}
-	return NULL;
+	int i = dive_overlapping(0, when, when);
+	return i >= 0 ? get_dive(i) : NULL;
 }
 
 bool time_during_dive_with_offset(struct dive *dive, timestamp_t when, timestamp_t offset)
@@ -3863,9 +3858,10 @@ bool dive_within_time_range(struct dive *dive, timestamp_t when, timestamp_t off
 struct dive *find_dive_n_near(timestamp_t when, int n, timestamp_t offset)
 {
 	int i, j = 0;
-	struct dive *dive;
 
-	for_each_dive (i, dive) {
+	/* the dives within the range are among those overlapping it */
+	for_each_dive_overlapping (i, when - offset, when + offset) {
+		struct dive *dive = get_dive(i);
 		if (dive_within_time_range(dive, when, offset))
 			if (++j == n)
 				return dive;
@@ -4011,31 +4007,15 @@ static bool dive_check_picture_time(const struct dive *d, timestamp_t timestamp)
 	return time_from_dive(d, timestamp) < D30MIN;
 }
 
+static bool dive_is_selected(const struct dive *d)
+{
+	return d->selected;
+}
+
 /* Return dive closest selected dive to given timestamp or NULL if no dives are selected. */
 static struct dive *nearest_selected_dive(timestamp_t timestamp)
 {
-	struct dive *d, *res = NULL;
-	int i;
-	timestamp_t offset, min = 0;
-
-	for_each_dive(i, d) {
-		if (!d->selected)
-			continue;
-		offset = time_from_dive(d, timestamp);
-		if (!res || offset < min) {
-			res = d;
-			min = offset;
-		}
-
-		/* We suppose that dives are sorted chronologically. Thus
-		 * if the offset starts to increase, we can end. This ignores
-		 * pathological cases such as overlapping dives. In such a
-		 * case the user will have to add pictures manually.
-		 */
-		if (offset == 0 || offset > min)
-			break;
-	}
-	return res;
+	return find_nearest_dive(timestamp, &dive_is_selected);
 }
 
 bool picture_check_valid_time(timestamp_t timestamp, int shift_time)
@@ -4054,7 +4034,7 @@ static void dive_set_geodata_from_picture(struct dive *dive, struct picture *pic
 	struct dive_site *ds = dive->dive_site;
 	if (!dive_site_has_gps_location(ds) && has_location(&picture->location)) {
 		if (ds) {
-			ds->location = picture->location;
+			set_dive_site_location(ds, &picture->location);
 		} else {
 			ds = create_dive_site_with_gps("", &picture->location, table);
 			add_dive_to_dive_site(dive, ds);
@@ -4066,11 +4046,18 @@ static void dive_set_geodata_from_picture(struct dive *dive, struct picture *pic
 void create_picture(const char *filename, int shift_time, bool match_all)
 {
 	struct metadata metadata;
+
+	get_metadata(filename, &metadata);
+	create_picture_with_metadata(filename, &metadata, shift_time, match_all);
+}
+
+/* As create_picture(), for media files whose metadata were already read */
+void create_picture_with_metadata(const char *filename, const struct metadata *metadata, int shift_time, bool match_all)
+{
 	struct dive *dive;
 	timestamp_t timestamp;
 
-	get_metadata(filename, &metadata);
-	timestamp = metadata.timestamp + shift_time;
+	timestamp = metadata->timestamp + shift_time;
 	dive = nearest_selected_dive(timestamp);
 
 	if (!dive)
@@ -4082,8 +4069,8 @@ void create_picture(const char *filename, int shift_time, bool match_all)
 
 	struct picture *picture = alloc_picture();
 	picture->filename = strdup(filename);
-	picture->offset.seconds = metadata.timestamp - dive->when + shift_time;
-	picture->location = metadata.location;
+	picture->offset.seconds = metadata->timestamp - dive->when + shift_time;
+	picture->location = metadata->location;
 
 	dive_add_picture(dive, picture);
 	dive_set_geodata_from_picture(dive, picture, &dive_site_table);
@@ -4287,6 +4274,10 @@ bool gasmix_is_air(struct gasmix gasmix)
 void invalidate_dive_cache(struct dive *dive)
 {
 	memset(dive->git_id, 0, 20);
+	/* the edit may have changed the time of the dive */
+	invalidate_dive_time_index();
+	/* and the tissues at the end of it and the following dives */
+	invalidate_deco_cache(dive->when);
 }
 
 bool dive_cache_is_valid(const struct dive *dive)
@@ -4452,40 +4443,67 @@ struct divecomputer *get_dive_dc(struct dive *dive, int nr)
 	return dc;
 }
 
-struct dive *get_dive_by_uniq_id(int id)
+/*
+ * Lookups by unique id go through a hash index from id to dive. The
+ * dives are entered and removed as they are added to and removed from
+ * dive_table (see divelist.c). Dives that the parsers add to the table
+ * directly are entered by rebuilding the index when a lookup fails.
+ * The id of a dive must not change while the dive is in the table.
+ */
+static struct hash_index dive_id_index;
+
+static bool dive_id_match(uintptr_t value, const void *key, const void *data)
 {
-	int i;
-	struct dive *dive = NULL;
+	UNUSED(data);
+	return ((const struct dive *)value)->id == *(const int *)key;
+}
 
-	for_each_dive (i, dive) {
-		if (dive->id == id)
-			break;
-	}
-#ifdef DEBUG
-	if (dive == NULL) {
-		fprintf(stderr, "Invalid id %x passed to get_dive_by_diveid, try to fix the code\n", id);
-		exit(1);
-	}
-#endif
-	return dive;
+void add_to_dive_id_index(struct dive *dive)
+{
+	hash_index_add(&dive_id_index, hash_uint32(dive->id), (uintptr_t)dive);
 }
 
-int get_idx_by_uniq_id(int id)
+void remove_from_dive_id_index(struct dive *dive)
+{
+	hash_index_remove(&dive_id_index, hash_uint32(dive->id), (uintptr_t)dive);
+}
+
+void clear_dive_id_index(void)
+{
+	hash_index_reset(&dive_id_index, 0);
+}
+
+static void rebuild_dive_id_index(void)
 {
 	int i;
-	struct dive *dive = NULL;
+	struct dive *dive;
 
-	for_each_dive (i, dive) {
-		if (dive->id == id)
-			break;
-	}
+	hash_index_reset(&dive_id_index, dive_table.nr);
+	for_each_dive (i, dive)
+		add_to_dive_id_index(dive);
+}
+
+struct dive *get_dive_by_uniq_id(int id)
+{
+	uintptr_t dive;
+
+	if (!hash_index_find(&dive_id_index, hash_uint32(id), dive_id_match, &id, NULL, &dive)) {
+		rebuild_dive_id_index();
+		if (!hash_index_find(&dive_id_index, hash_uint32(id), dive_id_match, &id, NULL, &dive)) {
 #ifdef DEBUG
-	if (dive == NULL) {
-		fprintf(stderr, "Invalid id %x passed to get_dive_by_diveid, try to fix the code\n", id);
-		exit(1);
-	}
+			fprintf(stderr, "Invalid id %x passed to get_dive_by_diveid, try to fix the code\n", id);
+			exit(1);
 #endif
-	return i;
+			return NULL;
+		}
+	}
+	return (struct dive *)dive;
+}
+
+int get_idx_by_uniq_id(int id)
+{
+	struct dive *dive = get_dive_by_uniq_id(id);
+	return dive ? get_divenr(dive) : dive_table.nr;
 }
 
 bool dive_site_has_gps_location(const struct dive_site *ds)
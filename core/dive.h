@@ -14,6 +14,7 @@
 #include <sys/stat.h>
 
 #include "units.h"
+#include "pref.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -289,6 +290,7 @@ typedef struct trip_table {
 } trip_table_t;
 
 struct picture;
+struct metadata;
 struct dive_site;
 struct dive_site_table;
 struct dive {
@@ -371,6 +373,7 @@ struct picture {
 extern struct picture *alloc_picture();
 extern void free_picture(struct picture *picture);
 extern void create_picture(const char *filename, int shift_time, bool match_all);
+extern void create_picture_with_metadata(const char *filename, const struct metadata *metadata, int shift_time, bool match_all);
 extern void dive_add_picture(struct dive *d, struct picture *newpic);
 extern bool dive_remove_picture(struct dive *d, const char *filename);
 extern unsigned int dive_get_picture_count(struct dive *d);
@@ -457,11 +460,17 @@ void split_divecomputer(const struct dive *src, int num, struct dive **out1, str
 
 extern struct dive *get_dive_by_uniq_id(int id);
 extern int get_idx_by_uniq_id(int id);
+extern void add_to_dive_id_index(struct dive *dive);
+extern void remove_from_dive_id_index(struct dive *dive);
+extern void clear_dive_id_index(void);
 extern bool dive_site_has_gps_location(const struct dive_site *ds);
 extern int dive_has_gps_location(const struct dive *dive);
 
 extern int report_error(const char *fmt, ...);
 extern void set_error_cb(void(*cb)(char *));	// Callback takes ownership of passed string
+struct membuffer;
+extern void collect_errors(struct membuffer *b);	// NULL stops collecting
+extern void report_collected_errors(struct membuffer *b);
 
 extern struct dive *find_dive_including(timestamp_t when);
 extern bool dive_within_time_range(struct dive *dive, timestamp_t when, timestamp_t offset);
@@ -604,6 +613,50 @@ extern void subsurface_command_line_exit(int *, char ***);
 
 #define DECOTIMESTEP 60 /* seconds. Unit of deco stop times */
 
+//! Option structure for Buehlmann decompression.
+struct buehlmann_config {
+	double satmult;			//! safety at inert gas accumulation as percentage of effect (more than 100).
+	double desatmult;		//! safety at inert gas depletion as percentage of effect (less than 100).
+	int last_deco_stop_in_mtr;	//! depth of last_deco_stop.
+	double gf_high;			//! gradient factor high (at surface).
+	double gf_low;			//! gradient factor low (at bottom/start of deco calculation).
+	double gf_low_position_min;	//! gf_low_position below surface_min_shallow.
+};
+
+//! Option structure for VPM-B decompression.
+struct vpmb_config {
+	double crit_radius_N2;            //! Critical radius of N2 nucleon (microns).
+	double crit_radius_He;            //! Critical radius of He nucleon (microns).
+	double crit_volume_lambda;        //! Constant corresponding to critical gas volume (bar * min).
+	double gradient_of_imperm;        //! Gradient after which bubbles become impermeable (bar).
+	double surface_tension_gamma;     //! Nucleons surface tension constant (N / bar = m2).
+	double skin_compression_gammaC;   //! Skin compression gammaC (N / bar = m2).
+	double regeneration_time;         //! Time needed for the bubble to regenerate to the start radius (min).
+	double other_gases_pressure;      //! Always present pressure of other gasses in tissues (bar).
+	short conservatism;		  //! VPM-B conservatism level (0-4)
+};
+
+/* The model parameters of one deco calculation. Every deco_state carries its
+ * own copy, so that independent calculations (profile, planner, variations)
+ * don't share any global state and can run concurrently.
+ * Set up with init_deco_config() before calling clear_deco(). */
+struct deco_config {
+	enum deco_mode deco_mode;
+	bool in_planner;		// the planner uses the Schreiner water vapour pressure for VPM-B
+	struct buehlmann_config buehlmann;
+	struct vpmb_config vpmb;
+};
+
+/* Accumulators for the linear regression of the effective VPM-B gradient
+ * factors, see regressiona() and regressionb(). These are not rolled back
+ * by restore_deco_state(). */
+struct deco_regression {
+	int plot_depth;
+	int sum1;
+	long sumx, sumxx;
+	double sumy, sumxy;
+};
+
 struct deco_state {
 	double tissue_n2_sat[16];
 	double tissue_he_sat[16];
@@ -631,13 +684,20 @@ struct deco_state {
 	double gf_low_pressure_this_dive;
 	int deco_time;
 	bool icd_warning;
+
+	struct deco_config config;
+	struct deco_regression regression;
 };
 
 extern void add_segment(struct deco_state *ds, double pressure, struct gasmix gasmix, int period_in_seconds, int setpoint, enum divemode_t divemode, int sac);
+extern void add_segments(struct deco_state *ds, double pressure, struct gasmix gasmix, int period_in_seconds, int count, int setpoint, enum divemode_t divemode);
+extern int periods_to_surfacing_limit(const struct deco_state *ds, double pressure, double surface_pressure, struct gasmix gasmix, int period_in_seconds, int setpoint, enum divemode_t divemode);
 extern void clear_deco(struct deco_state *ds, double surface_pressure);
 extern void dump_tissues(struct deco_state *ds);
-extern void set_gf(short gflow, short gfhigh);
-extern void set_vpmb_conservatism(short conservatism);
+extern void init_deco_config(struct deco_config *config, bool in_planner);
+extern void set_gf(struct deco_config *config, short gflow, short gfhigh);
+extern bool same_deco_model(const struct deco_config *a, const struct deco_config *b);
+extern void set_vpmb_conservatism(struct deco_config *config, short conservatism);
 extern void cache_deco_state(struct deco_state *source, struct deco_state **datap);
 extern void restore_deco_state(struct deco_state *data, struct deco_state *target, bool keep_vpmb_state);
 extern void nuclear_regeneration(struct deco_state *ds, double time);
@@ -660,6 +720,8 @@ struct divedatapoint {
 	enum divemode_t divemode;
 };
 
+struct waypoint_cache;
+
 struct diveplan {
 	timestamp_t when;
 	int surface_pressure; /* mbar */
@@ -672,10 +734,19 @@ struct diveplan {
 	struct divedatapoint *dp;
 	int eff_gflow, eff_gfhigh;
 	int surface_interval;
+	/* polled by plan() to give up early, e.g. when the plan has become stale */
+	bool (*cancelled)(void *data);
+	void *cancel_data;
+	/* optional, deco states of the previous plans, see alloc_waypoint_cache() */
+	struct waypoint_cache *waypoint_cache;
+	/* for plans that are only calculated for their numbers, e.g. in worker
+	 * threads: don't write the notes of the dive and don't report errors */
+	bool quiet;
 };
 
 struct divedatapoint *plan_add_segment(struct diveplan *diveplan, int duration, int depth, int cylinderid, int po2, bool entered, enum divemode_t divemode);
 struct divedatapoint *create_dp(int time_incr, int depth, int cylinderid, int po2);
+void plan_add_gases(struct diveplan *diveplan, const struct dive *dive);
 #if DEBUG_PLAN
 void dump_plan(struct diveplan *diveplan);
 #endif
@@ -761,6 +832,4 @@ Q_DECLARE_METATYPE(trip_table_t *);
 
 #endif
 
-#include "pref.h"
-
 #endif // DIVE_H
@@ -84,6 +84,22 @@ extern "C" void create_device_node(const char *model, uint32_t deviceid, const c
 	dcList.addDC(model, deviceid, nickname, serial, firmware);
 }
 
+/* Copies of the dive computer list, to undo the nodes a failed import has added */
+extern "C" void *save_device_nodes()
+{
+	return new QVector<DiveComputerNode>(dcList.dcs);
+}
+
+extern "C" void restore_device_nodes(void *saved)
+{
+	dcList.dcs = *(QVector<DiveComputerNode> *)saved;
+}
+
+extern "C" void free_device_nodes(void *saved)
+{
+	delete (QVector<DiveComputerNode> *)saved;
+}
+
 static bool compareDCById(const DiveComputerNode &a, const DiveComputerNode &b)
 {
 	return a.deviceId < b.deviceId;
@@ -0,0 +1,120 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "core/diveinfocache.h"
+#include "core/divelist.h"
+#include "core/divesite.h"
+#include "core/qthelper.h"
+#include "core/statistics.h"
+#include "core/subsurface-qt/DiveListNotifier.h"
+
+extern "C" void diveinfo_invalidate(const struct dive *d)
+{
+	DiveInfoCache::instance()->invalidate(d);
+}
+
+extern "C" void diveinfo_invalidate_all()
+{
+	DiveInfoCache::instance()->invalidateAll();
+}
+
+DiveInfoCache *DiveInfoCache::instance()
+{
+	static DiveInfoCache self;
+	return &self;
+}
+
+DiveInfoCache::DiveInfoCache()
+{
+	connect(&diveListNotifier, &DiveListNotifier::divesChanged, this, &DiveInfoCache::divesChanged);
+	connect(&diveListNotifier, &DiveListNotifier::cylindersReset, this, &DiveInfoCache::divesReset);
+	connect(&diveListNotifier, &DiveListNotifier::weightsystemsReset, this, &DiveInfoCache::divesReset);
+	connect(&diveListNotifier, &DiveListNotifier::divesDeleted, this, &DiveInfoCache::divesDeleted);
+	connect(&diveListNotifier, &DiveListNotifier::diveSiteChanged, this, &DiveInfoCache::diveSiteChanged);
+}
+
+void DiveInfoCache::invalidate(const struct dive *d)
+{
+	infos.remove(d);
+}
+
+void DiveInfoCache::invalidateAll()
+{
+	infos.clear();
+}
+
+const DiveInfoCache::Info &DiveInfoCache::info(const struct dive *d)
+{
+	auto it = infos.find(d);
+	if (it != infos.end())
+		return *it;
+
+	Info info;
+	char *gas_string = get_dive_gas_string(d);
+	info.gasString = gas_string;
+	free(gas_string);
+	int o2, he, o2max;
+	get_dive_gas(d, &o2, &he, &o2max);
+	info.gasSortValue = he * 1000 + o2;
+	memset(info.gasUsed, 0, sizeof(info.gasUsed));
+	get_gas_used(d, info.gasUsed);
+	info.totalWeight = total_weight(d);
+	info.tags = get_taglist_string(d->tag_list);
+	const char *location = get_dive_location(d);
+	if (location)
+		info.location = QString::fromUtf8(location);
+	return *infos.insert(d, info);
+}
+
+QString DiveInfoCache::gasString(const struct dive *d)
+{
+	return info(d).gasString;
+}
+
+int DiveInfoCache::gasSortValue(const struct dive *d)
+{
+	return info(d).gasSortValue;
+}
+
+volume_t DiveInfoCache::gasUsed(const struct dive *d, int cylinder)
+{
+	return info(d).gasUsed[cylinder];
+}
+
+int DiveInfoCache::totalWeight(const struct dive *d)
+{
+	return info(d).totalWeight;
+}
+
+QString DiveInfoCache::tags(const struct dive *d)
+{
+	return info(d).tags;
+}
+
+QString DiveInfoCache::location(const struct dive *d)
+{
+	return info(d).location;
+}
+
+void DiveInfoCache::divesChanged(dive_trip *, const QVector<dive *> &dives, DiveField)
+{
+	for (dive *d: dives)
+		invalidate(d);
+}
+
+void DiveInfoCache::divesReset(dive_trip *, const QVector<dive *> &dives)
+{
+	for (dive *d: dives)
+		invalidate(d);
+}
+
+// The dives may be freed and their addresses reused for other dives
+void DiveInfoCache::divesDeleted(dive_trip *, bool, const QVector<dive *> &dives)
+{
+	for (dive *d: dives)
+		invalidate(d);
+}
+
+void DiveInfoCache::diveSiteChanged(dive_site *ds, int)
+{
+	for (int i = 0; i < ds->dives.nr; ++i)
+		invalidate(ds->dives.dives[i]);
+}
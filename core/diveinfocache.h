@@ -0,0 +1,71 @@
+// SPDX-License-Identifier: GPL-2.0
+// A cache of the values that are derived from the dives for the dive list, the
+// statistics and the exports: the gas summary, the gas used per cylinder, the total
+// weight, the tags and the location. The values of a dive are calculated on first
+// use and kept until the dive changes.
+//
+// The cache follows the signals of the DiveListNotifier. Changes of the dive list
+// that are not signaled (the mobile and profile edits and rewritten plans) have to
+// be registered with the functions below. Only use the cache from the UI thread.
+#ifndef DIVEINFOCACHE_H
+#define DIVEINFOCACHE_H
+
+struct dive;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void diveinfo_invalidate(const struct dive *d);	// doesn't access the dive
+void diveinfo_invalidate_all(void);
+
+#ifdef __cplusplus
+}
+
+#include "core/dive.h"
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <QHash>
+
+struct dive_trip;
+struct dive_site;
+enum class DiveField;
+
+class DiveInfoCache : public QObject {
+	Q_OBJECT
+public:
+	static DiveInfoCache *instance();
+	void invalidate(const struct dive *d);
+	void invalidateAll();
+
+	QString gasString(const struct dive *d);		// see get_dive_gas_string()
+	int gasSortValue(const struct dive *d);			// helium, then oxygen of get_dive_gas()
+	volume_t gasUsed(const struct dive *d, int cylinder);	// see get_gas_used()
+	int totalWeight(const struct dive *d);			// in grams
+	QString tags(const struct dive *d);
+	QString location(const struct dive *d);			// null if there is no dive site
+private:
+	struct Info {
+		QString gasString;
+		int gasSortValue;
+		volume_t gasUsed[MAX_CYLINDERS];
+		int totalWeight;
+		QString tags;
+		QString location;
+	};
+	DiveInfoCache();
+	const Info &info(const struct dive *d);	// valid until the next call
+
+	QHash<const struct dive *, Info> infos;
+private
+slots:
+	void divesChanged(dive_trip *trip, const QVector<dive *> &dives, DiveField field);
+	void divesReset(dive_trip *trip, const QVector<dive *> &dives);
+	void divesDeleted(dive_trip *trip, bool deleteTrip, const QVector<dive *> &dives);
+	void diveSiteChanged(dive_site *ds, int field);
+};
+
+#endif
+
+#endif
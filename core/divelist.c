@@ -19,6 +19,8 @@
 #include "qthelper.h"
 #include "git-access.h"
 #include "table.h"
+#include "fulltext.h"
+#include "diveinfocache.h"
 
 /* This flag is set to true by operations that are not implemented in the
  * undo system. It is therefore only cleared on save and load. */
@@ -241,6 +243,172 @@ static double calculate_cns_dive(const struct dive *dive)
 	return cns;
 }
 
+/*
+ * A cache of the tissue state and the CNS at the end of the dives, so that the
+ * calculations for a dive can continue from the end of the previous dive instead
+ * of simulating the whole series of repetitive dives leading up to it. The states
+ * are kept sorted by the start time of their dives. Since a state only depends on
+ * the dive and the dives before it, a change of the dive list at a given time
+ * invalidates the states of the dives starting at that time or later, see
+ * invalidate_deco_cache(). Dives in the table are edited via invalidate_dive_cache(),
+ * which takes care of that, added and removed via the functions of this file.
+ *
+ * Which dives are part of the series depends on the dive that the calculation is
+ * for, as do the model parameters. Therefore, each state records the series it
+ * was calculated for and is only used for calculations of the same series.
+ * The calculations run concurrently in the planner, so access to the cache is
+ * protected by lock_deco_cache().
+ */
+struct deco_series {
+	const struct dive *first;	/* first dive after the gap found by the backwards walk */
+	const struct dive_trip *trip;	/* if set, only dives of this trip are considered */
+	const struct dive *skip;	/* the dive in the table that is being calculated, if earlier */
+	enum divemode_t divemode;	/* of the surface intervals */
+	int sac;			/* of the surface intervals */
+	struct deco_config config;
+};
+
+struct dive_end_state {
+	const struct dive *dive;
+	timestamp_t when, end;
+	bool has_deco, has_cns;
+	struct deco_series deco_series, cns_series;
+	struct deco_state ds;
+	double cns;
+};
+
+static struct {
+	int nr, allocated;
+	struct dive_end_state *states;
+} deco_cache;
+
+/* index of the first state of a dive starting at or after 'when' */
+static int deco_cache_bound(timestamp_t when)
+{
+	int lo = 0, hi = deco_cache.nr;
+
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+		if (deco_cache.states[mid].when < when)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/* Call with the cache locked. The returned pointer is valid until the cache is modified. */
+static struct dive_end_state *find_end_state(const struct dive *dive)
+{
+	int i;
+
+	for (i = deco_cache_bound(dive->when); i < deco_cache.nr && deco_cache.states[i].when == dive->when; i++) {
+		if (deco_cache.states[i].dive == dive)
+			return &deco_cache.states[i];
+	}
+	return NULL;
+}
+
+/* The state of a dive, created if necessary. Call with the cache locked. */
+static struct dive_end_state *get_end_state(const struct dive *dive)
+{
+	struct dive_end_state *state = find_end_state(dive);
+	timestamp_t end = dive_endtime(dive);
+	int idx;
+
+	if (state) {
+		if (state->end != end) {
+			state->end = end;
+			state->has_deco = state->has_cns = false;
+		}
+		return state;
+	}
+	if (deco_cache.nr >= deco_cache.allocated) {
+		deco_cache.allocated = (deco_cache.nr + 32) * 3 / 2;
+		deco_cache.states = realloc(deco_cache.states, deco_cache.allocated * sizeof(*deco_cache.states));
+		if (!deco_cache.states)
+			exit(1);
+	}
+	idx = deco_cache_bound(dive->when + 1);
+	state = &deco_cache.states[idx];
+	memmove(state + 1, state, (deco_cache.nr - idx) * sizeof(*state));
+	deco_cache.nr++;
+	state->dive = dive;
+	state->when = dive->when;
+	state->end = end;
+	state->has_deco = state->has_cns = false;
+	return state;
+}
+
+/* Forget the states of the dives starting at or after 'when'. Has to be called whenever
+ * a dive starting at 'when' is added, removed or changed. */
+void invalidate_deco_cache(timestamp_t when)
+{
+	lock_deco_cache();
+	deco_cache.nr = deco_cache_bound(when);
+	unlock_deco_cache();
+}
+
+void clear_deco_cache(void)
+{
+	lock_deco_cache();
+	deco_cache.nr = 0;
+	unlock_deco_cache();
+}
+
+/* The series of the calculation for 'dive', which starts after the dive at index 'i'.
+ * The config is only set for the tissue calculation. */
+static void init_deco_series(struct deco_series *series, int i, const struct dive *dive, int divenr, const struct deco_config *config)
+{
+	memset(series, 0, sizeof(*series));
+	series->first = get_dive(i + 1);
+	series->trip = dive->divetrip;
+	if (divenr >= 0 && get_dive(divenr)->when < dive->when)
+		series->skip = get_dive(divenr);
+	if (config) {
+		series->divemode = dive->dc.divemode;
+		series->sac = prefs.decosac;
+		series->config = *config;
+	}
+}
+
+static bool same_deco_series(const struct deco_series *a, const struct deco_series *b)
+{
+	return a->first == b->first && a->trip == b->trip && a->skip == b->skip &&
+	       a->divemode == b->divemode && a->sac == b->sac && same_deco_model(&a->config, &b->config);
+}
+
+/* Of the dives that the calculation for 'dive' adds after the dive at index 'i', the index of
+ * the last one with a cached state of the series, or 'i' if there is none. The dives are
+ * checked with the same conditions as in the forward walks of calculate_cns() and
+ * init_decompression(). Call with the cache locked. */
+static int last_cached_dive(int i, const struct dive *dive, int divenr, const struct deco_series *series,
+			    bool cns, const struct dive_end_state **res)
+{
+	int last = i;
+
+	*res = NULL;
+	while (++i < dive_table.nr) {
+		const struct dive *pdive = get_dive(i);
+		const struct dive_end_state *state;
+		if (dive->divetrip && dive->divetrip != pdive->divetrip)
+			continue;
+		if (pdive->when >= dive->when)
+			break;
+		if (i == divenr)
+			continue;
+		state = find_end_state(pdive);
+		if (!state || state->end != dive_endtime(pdive))
+			break;
+		if (cns ? !state->has_cns || !same_deco_series(&state->cns_series, series) :
+			  !state->has_deco || !same_deco_series(&state->deco_series, series))
+			break;
+		last = i;
+		*res = state;
+	}
+	return last;
+}
+
 /* this only gets called if dive->maxcns == 0 which means we know that
  * none of the divecomputers has tracked any CNS for us
  * so we calculated it "by hand" */
@@ -249,6 +417,9 @@ static int calculate_cns(struct dive *dive)
 	int i, divenr;
 	double cns = 0.0;
 	timestamp_t last_starttime, last_endtime = 0;
+	struct deco_series series;
+	const struct dive_end_state *state;
+	struct dive_end_state *stored;
 
 	/* shortcut */
 	if (dive->cns)
@@ -262,20 +433,8 @@ static int calculate_cns(struct dive *dive)
 	else
 		printf("\n\n*** CNS for dive #%d\n", i);
 #endif
-	/* Look at next dive in dive list table and correct i when needed */
-	while (i < dive_table.nr - 1) {
-		struct dive *pdive = get_dive(i);
-		if (!pdive || pdive->when > dive->when)
-			break;
-		i++;
-	}
-	/* Look at previous dive in dive list table and correct i when needed */
-	while (i > 0) {
-		struct dive *pdive = get_dive(i - 1);
-		if (!pdive || pdive->when < dive->when)
-			break;
-		i--;
-	}
+	/* The dive may not be in the table (yet) or the table may not be sorted, go by its start time */
+	i = dive_index_by_time(dive->when);
 #if DECO_CALC_DEBUG & 2
 	printf("Dive number corrected to #%d\n", i);
 #endif
@@ -307,6 +466,16 @@ static int calculate_cns(struct dive *dive)
 		printf("Yes\n");
 #endif
 	}
+	/* Continue after the last dive of the series with a known CNS */
+	init_deco_series(&series, i, dive, divenr, NULL);
+	lock_deco_cache();
+	i = last_cached_dive(i, dive, divenr, &series, true, &state);
+	if (state) {
+		cns = state->cns;
+		last_starttime = state->when;
+		last_endtime = state->end;
+	}
+	unlock_deco_cache();
 	/* Walk forward and add dives and surface intervals to CNS */
 	while (++i < dive_table.nr) {
 #if DECO_CALC_DEBUG & 2
@@ -352,6 +521,13 @@ static int calculate_cns(struct dive *dive)
 
 		last_starttime = pdive->when;
 		last_endtime = dive_endtime(pdive);
+
+		lock_deco_cache();
+		stored = get_end_state(pdive);
+		stored->cns_series = series;
+		stored->cns = cns;
+		stored->has_cns = true;
+		unlock_deco_cache();
 	}
 
 	/* CNS reduced with 90min halftime during surface interval */
@@ -455,16 +631,215 @@ static void add_dive_to_deco(struct deco_state *ds, struct dive *dive)
 	}
 }
 
+/*
+ * An index of the global dive table by time: the end of every dive and the
+ * latest end of the dives up to it. Since the table is sorted by start time,
+ * the latter only grows, so that the dives overlapping a time span can be
+ * found by two binary searches. The index is rebuilt lazily on the first
+ * lookup after invalidate_dive_time_index(), which has to be called whenever
+ * dives are added to or removed from the table or their times change. As a
+ * safety net, it is also rebuilt when the size of the table changes. The
+ * planner looks up dives from worker threads, so the rebuild and the lookups
+ * that read the index hold lock_dive_time_index().
+ */
+struct dive_time {
+	timestamp_t end;
+	timestamp_t max_end;
+};
+
+static struct {
+	bool valid;
+	bool sorted;	/* false while the dive table is not sorted by time */
+	int nr, allocated;
+	struct dive **dives;
+	struct dive_time *times;
+} time_index;
+
+void invalidate_dive_time_index(void)
+{
+	lock_dive_time_index();
+	time_index.valid = false;
+	unlock_dive_time_index();
+}
+
+/* Called with lock_dive_time_index() held */
+static void update_dive_time_index(void)
+{
+	int i;
+
+	if (time_index.valid && time_index.nr == dive_table.nr && time_index.dives == dive_table.dives)
+		return;
+	if (dive_table.nr > time_index.allocated) {
+		time_index.allocated = (dive_table.nr + 32) * 3 / 2;
+		time_index.times = realloc(time_index.times, time_index.allocated * sizeof(*time_index.times));
+		if (!time_index.times)
+			exit(1);
+	}
+	time_index.sorted = true;
+	for (i = 0; i < dive_table.nr; i++) {
+		struct dive_time *t = &time_index.times[i];
+		t->end = dive_endtime(dive_table.dives[i]);
+		t->max_end = i > 0 && t[-1].max_end > t->end ? t[-1].max_end : t->end;
+		if (i > 0 && dive_table.dives[i]->when < dive_table.dives[i - 1]->when)
+			time_index.sorted = false;
+	}
+	time_index.nr = dive_table.nr;
+	time_index.dives = dive_table.dives;
+	time_index.valid = true;
+}
+
+/* index of the first dive starting after 'when' (or at 'when' if 'at' is set) */
+static int dive_start_bound(timestamp_t when, bool at)
+{
+	int lo = 0, hi = dive_table.nr;
+
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+		timestamp_t start = dive_table.dives[mid]->when;
+		if (start < when || (!at && start == when))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/* Index of the first dive that starts at or after 'when', i.e. where a dive starting at 'when' goes */
+int dive_index_by_time(timestamp_t when)
+{
+	int i;
+
+	lock_dive_time_index();
+	update_dive_time_index();
+	if (time_index.sorted) {
+		i = dive_start_bound(when, true);
+	} else {
+		for (i = 0; i < dive_table.nr; i++) {
+			if (dive_table.dives[i]->when >= when)
+				break;
+		}
+	}
+	unlock_dive_time_index();
+	return i;
+}
+
+/* Index of the first dive from 'idx' on that overlaps [start, end], or -1. See for_each_dive_overlapping(). */
+int dive_overlapping(int idx, timestamp_t start, timestamp_t end)
+{
+	int lo = 0, hi = dive_table.nr, res = -1;
+
+	lock_dive_time_index();
+	update_dive_time_index();
+	if (time_index.sorted) {
+		/* skip the dives that all ended before start */
+		while (lo < hi) {
+			int mid = lo + (hi - lo) / 2;
+			if (time_index.times[mid].max_end < start)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		if (idx < lo)
+			idx = lo;
+	}
+	for (; idx < dive_table.nr; idx++) {
+		struct dive *d = dive_table.dives[idx];
+		if (d->when > end) {
+			if (time_index.sorted)
+				break;
+			continue;
+		}
+		if (time_index.times[idx].end >= start) {
+			res = idx;
+			break;
+		}
+	}
+	unlock_dive_time_index();
+	return res;
+}
+
+static timestamp_t time_from_indexed_dive(int idx, timestamp_t when)
+{
+	if (when < dive_table.dives[idx]->when)
+		return dive_table.dives[idx]->when - when;
+	else if (when > time_index.times[idx].end)
+		return when - time_index.times[idx].end;
+	else
+		return 0;
+}
+
+/* The dive closest to 'when' for which filter() returns true (any dive if filter is NULL),
+ * 0 seconds away if 'when' is during the dive. Of equally close dives the first one wins. */
+struct dive *find_nearest_dive(timestamp_t when, bool (*filter)(const struct dive *))
+{
+	int i, first, res = -1;
+	timestamp_t offset, min = 0;
+
+	lock_dive_time_index();
+	update_dive_time_index();
+	if (!time_index.sorted) {
+		for (i = 0; i < dive_table.nr; i++) {
+			if (filter && !filter(dive_table.dives[i]))
+				continue;
+			offset = time_from_indexed_dive(i, when);
+			if (res < 0 || offset < min) {
+				res = i;
+				min = offset;
+			}
+		}
+		goto out;
+	}
+
+	/* Of the dives starting after 'when', the first one is the closest */
+	first = dive_start_bound(when, false);
+	for (i = first; i < dive_table.nr; i++) {
+		if (!filter || filter(dive_table.dives[i])) {
+			res = i;
+			min = dive_table.dives[i]->when - when;
+			break;
+		}
+	}
+	/* The earlier dives can't be closer than the latest end of all of them */
+	for (i = first - 1; i >= 0; i--) {
+		timestamp_t max_end = time_index.times[i].max_end;
+		if (res >= 0 && max_end < when && when - max_end > min)
+			break;
+		if (filter && !filter(dive_table.dives[i]))
+			continue;
+		offset = time_from_indexed_dive(i, when);
+		if (res < 0 || offset <= min) {
+			res = i;
+			min = offset;
+		}
+	}
+out:
+	unlock_dive_time_index();
+	return res >= 0 ? dive_table.dives[res] : NULL;
+}
+
 int get_divenr(const struct dive *dive)
 {
 	int i;
 	const struct dive *d;
 	// tempting as it may be, don't die when called with dive=NULL
-	if (dive)
-		for_each_dive(i, d) {
-			if (d->id == dive->id) // don't compare pointers, we could be passing in a copy of the dive
+	if (!dive)
+		return -1;
+	// first look among the dives starting at the same time
+	lock_dive_time_index();
+	update_dive_time_index();
+	if (time_index.sorted) {
+		for (i = dive_start_bound(dive->when, true); i < dive_table.nr && dive_table.dives[i]->when == dive->when; i++) {
+			if (dive_table.dives[i]->id == dive->id) {
+				unlock_dive_time_index();
 				return i;
+			}
 		}
+	}
+	unlock_dive_time_index();
+	for_each_dive(i, d) {
+		if (d->id == dive->id) // don't compare pointers, we could be passing in a copy of the dive
+			return i;
+	}
 	return -1;
 }
 
@@ -482,32 +857,22 @@ int init_decompression(struct deco_state *ds, struct dive *dive)
 	timestamp_t last_endtime = 0, last_starttime = 0;
 	bool deco_init = false;
 	double surface_pressure;
+	struct deco_series series;
+	const struct dive_end_state *state;
+	struct dive_end_state *stored;
 
 	if (!dive)
 		return false;
 
 	divenr = get_divenr(dive);
-	i = divenr >= 0 ? divenr : dive_table.nr;
 #if DECO_CALC_DEBUG & 2
-	if (i >= 0 && i < dive_table.nr)
-		printf("\n\n*** Init deco for dive #%d %d\n", i, get_dive(i)->number);
+	if (divenr >= 0)
+		printf("\n\n*** Init deco for dive #%d %d\n", divenr, get_dive(divenr)->number);
 	else
-		printf("\n\n*** Init deco for dive #%d\n", i);
+		printf("\n\n*** Init deco for dive #%d\n", dive_table.nr);
 #endif
-	/* Look at next dive in dive list table and correct i when needed */
-	while (i < dive_table.nr - 1) {
-		struct dive *pdive = get_dive(i);
-		if (!pdive || pdive->when > dive->when)
-			break;
-		i++;
-	}
-	/* Look at previous dive in dive list table and correct i when needed */
-	while (i > 0) {
-		struct dive *pdive = get_dive(i - 1);
-		if (!pdive || pdive->when < dive->when)
-			break;
-		i--;
-	}
+	/* The dive may not be in the table (yet) or the table may not be sorted, go by its start time */
+	i = dive_index_by_time(dive->when);
 #if DECO_CALC_DEBUG & 2
 	printf("Dive number corrected to #%d\n", i);
 #endif
@@ -539,6 +904,23 @@ int init_decompression(struct deco_state *ds, struct dive *dive)
 		printf("Yes\n");
 #endif
 	}
+	/* Continue after the last dive of the series with known tissues */
+	init_deco_series(&series, i, dive, divenr, &ds->config);
+	lock_deco_cache();
+	i = last_cached_dive(i, dive, divenr, &series, false, &state);
+	if (state) {
+		struct deco_config config = ds->config;
+		*ds = state->ds;
+		ds->config = config;
+		deco_init = true;
+		last_starttime = state->when;
+		last_endtime = state->end;
+	}
+	unlock_deco_cache();
+#if DECO_CALC_DEBUG & 2
+	if (deco_init)
+		printf("Continue after cached dive #%d\n", i);
+#endif
 	/* Walk forward an add dives and surface intervals to deco */
 	while (++i < dive_table.nr) {
 #if DECO_CALC_DEBUG & 2
@@ -603,6 +985,13 @@ int init_decompression(struct deco_state *ds, struct dive *dive)
 		last_starttime = pdive->when;
 		last_endtime = dive_endtime(pdive);
 		clear_vpmb_state(ds);
+
+		lock_deco_cache();
+		stored = get_end_state(pdive);
+		stored->deco_series = series;
+		stored->ds = *ds;
+		stored->has_deco = true;
+		unlock_deco_cache();
 #if DECO_CALC_DEBUG & 2
 		printf("Tissues after added dive #%d:\n", pdive->number);
 		dump_tissues(ds);
@@ -836,8 +1225,10 @@ static MAKE_ADD_TO(trip_table, struct dive_trip *, trips)
 static MAKE_REMOVE_FROM(dive_table, dives)
 static MAKE_REMOVE_FROM(trip_table, trips)
 
-static MAKE_GET_IDX(dive_table, struct dive *, dives)
-static MAKE_GET_IDX(trip_table, struct dive_trip *, trips)
+static MAKE_GET_IDX(dive_table, struct dive *, dives, dive_less_than)
+static MAKE_GET_IDX(trip_table, struct dive_trip *, trips, trip_less_than)
+
+static MAKE_ADD_SORTED(dive_table, struct dive *, dives, dive_less_than)
 
 MAKE_SORT(dive_table, struct dive *, dives, comp_dives)
 MAKE_SORT(trip_table, struct dive_trip *, trips, comp_trips)
@@ -864,6 +1255,7 @@ struct dive_trip *unregister_dive_from_trip(struct dive *dive)
 
 	remove_dive(dive, &trip->dives);
 	dive->divetrip = NULL;
+	invalidate_deco_cache(dive->when);
 	return trip;
 }
 
@@ -890,6 +1282,7 @@ void add_dive_to_trip(struct dive *dive, dive_trip_t *trip)
 		fprintf(stderr, "Warning: adding dive to trip that has trip set\n");
 	insert_dive(&trip->dives, dive);
 	dive->divetrip = trip;
+	invalidate_deco_cache(dive->when);
 }
 
 dive_trip_t *alloc_trip(void)
@@ -1055,6 +1448,8 @@ static void autogroup_dives(struct dive_table *table, struct trip_table *trip_ta
  * It simply shrinks the table and frees the trip */
 void delete_dive_from_table(struct dive_table *table, int idx)
 {
+	if (table == &dive_table)
+		remove_from_dive_id_index(table->dives[idx]);
 	free_dive(table->dives[idx]);
 	remove_from_dive_table(table, idx);
 }
@@ -1069,12 +1464,30 @@ struct dive *unregister_dive(int idx)
 	if (!dive)
 		return NULL; /* this should never happen */
 	remove_from_dive_table(&dive_table, idx);
+	remove_from_dive_id_index(dive);
+	invalidate_dive_time_index();
+	invalidate_deco_cache(dive->when);
+	fulltext_unregister(dive);
+	diveinfo_invalidate(dive);
 	if (dive->selected)
 		amount_selected--;
 	dive->selected = false;
 	return dive;
 }
 
+/* Detach a dive of the global dive table that is about to be deleted
+ * from the selection, its trip, its dive site and the caches. */
+static void unlink_dive(struct dive *dive)
+{
+	if (dive->selected)
+		deselect_dive(dive);
+	remove_dive_from_trip(dive, &trip_table);
+	unregister_dive_from_dive_site(dive);
+	fulltext_unregister(dive);
+	diveinfo_invalidate(dive);
+	invalidate_deco_cache(dive->when);
+}
+
 /* this implements the mechanics of removing the dive from the global
  * dive table and the trip, but doesn't deal with updating dive trips, etc */
 void delete_single_dive(int idx)
@@ -1082,11 +1495,61 @@ void delete_single_dive(int idx)
 	struct dive *dive = get_dive(idx);
 	if (!dive)
 		return; /* this should never happen */
-	if (dive->selected)
-		deselect_dive(dive);
-	remove_dive_from_trip(dive, &trip_table);
-	unregister_dive_from_dive_site(dive);
+	unlink_dive(dive);
 	delete_dive_from_table(&dive_table, idx);
+	invalidate_dive_time_index();
+}
+
+/* Delete a table of dives from the global dive table. Does the same as
+ * delete_single_dive() for each of them, but compacts the table in a
+ * single pass. The table of dives is emptied. */
+static void delete_dives(struct dive_table *dives)
+{
+	int i, j, nr = 0;
+	int *idx = malloc(dives->nr * sizeof(*idx));
+
+	if (dives->nr && !idx)
+		exit(1);
+
+	/* Look the dives up while they are still in their trips,
+	 * since the order of the dive table depends on the trips. */
+	for (i = 0; i < dives->nr; i++) {
+		int n = get_idx_in_dive_table(&dive_table, dives->dives[i]);
+		if (n >= 0)
+			idx[nr++] = n;
+	}
+	for (i = 0; i < nr; i++)
+		unlink_dive(dive_table.dives[idx[i]]);
+	for (i = 0; i < nr; i++) {
+		remove_from_dive_id_index(dive_table.dives[idx[i]]);
+		free_dive(dive_table.dives[idx[i]]);
+		dive_table.dives[idx[i]] = NULL;
+	}
+	for (i = j = 0; i < dive_table.nr; i++) {
+		if (dive_table.dives[i])
+			dive_table.dives[j++] = dive_table.dives[i];
+	}
+	for (i = j; i < dive_table.nr; i++)
+		dive_table.dives[i] = NULL;
+	dive_table.nr = j;
+	invalidate_dive_time_index();
+	dives->nr = 0;
+	free(idx);
+}
+
+/* Add a dive to the global dive table at the given index. This is the
+ * counterpart of unregister_dive(): the caller must add the dive to its
+ * trip and keep the table sorted. */
+void add_single_dive(int idx, struct dive *dive)
+{
+	add_to_dive_table(&dive_table, idx, dive);
+	add_to_dive_id_index(dive);
+	invalidate_dive_time_index();
+	invalidate_deco_cache(dive->when);
+	fulltext_register(dive);
+	diveinfo_invalidate(dive);
+	if (dive->selected)
+		amount_selected++;
 }
 
 /* add a dive at the end of the global dive table and keep track
@@ -1094,10 +1557,39 @@ void delete_single_dive(int idx)
 void append_dive(struct dive *dive)
 {
 	add_to_dive_table(&dive_table, dive_table.nr, dive);
+	add_to_dive_id_index(dive);
+	invalidate_dive_time_index();
+	invalidate_deco_cache(dive->when);
+	fulltext_register(dive);
+	diveinfo_invalidate(dive);
 	if (dive->selected)
 		amount_selected++;
 }
 
+/* Move a dive of the global dive table to another time. The tissues after
+ * both the old and the new time are affected. The caller must keep the
+ * dive and trip tables sorted. */
+void set_dive_time(struct dive *dive, timestamp_t when)
+{
+	invalidate_deco_cache(MIN(dive->when, when));
+	dive->when = when;
+	invalidate_dive_time_index();
+}
+
+/* Copy an edited version of a dive of the global dive table, such as a
+ * rewritten plan, into the dive. copy_dive() only knows the new time of
+ * the dive, but the edit may have moved it. The caller must keep the dive
+ * and trip tables sorted. */
+void replace_dive_contents(struct dive *dive, const struct dive *edited)
+{
+	timestamp_t old_when = dive->when;
+
+	copy_dive(edited, dive);
+	invalidate_deco_cache(MIN(old_when, dive->when));
+	fulltext_register(dive);
+	diveinfo_invalidate(dive);
+}
+
 bool consecutive_selected()
 {
 	struct dive *d;
@@ -1236,9 +1728,16 @@ void process_loaded_dives()
 
 	sort_dive_table(&dive_table);
 	sort_trip_table(&trip_table);
+	invalidate_dive_time_index();
+	clear_deco_cache();
+	diveinfo_invalidate_all();
 
 	/* Autogroup dives if desired by user. */
 	autogroup_dives(&dive_table, &trip_table);
+
+	/* Index the words of the dives for the filters, after the
+	 * autogrouping has set the trip locations. */
+	fulltext_populate();
 }
 
 /*
@@ -1287,6 +1786,8 @@ static void merge_imported_dives(struct dive_table *table)
  */
 void clear_table(struct dive_table *table)
 {
+	if (table == &dive_table)
+		clear_dive_id_index();
 	for (int i = 0; i < table->nr; i++)
 		free_dive(table->dives[i]);
 	table->nr = 0;
@@ -1438,7 +1939,7 @@ static bool merge_dive_tables(struct dive_table *dives_from, struct dive_table *
  * precedence */
 void add_imported_dives(struct dive_table *import_table, struct trip_table *import_trip_table, struct dive_site_table *import_sites_table, int flags)
 {
-	int i, idx;
+	int i;
 	struct dive_table dives_to_add = { 0 };
 	struct dive_table dives_to_remove = { 0 };
 	struct trip_table trips_to_add = { 0 };
@@ -1461,15 +1962,20 @@ void add_imported_dives(struct dive_table *import_table, struct trip_table *impo
 	}
 
 	/* Remove old dives */
-	for (i = 0; i < dives_to_remove.nr; i++) {
-		idx = get_divenr(dives_to_remove.dives[i]);
-		delete_single_dive(idx);
+	delete_dives(&dives_to_remove);
+
+	/* Add new dives. They were sorted before they were added to
+	 * their trips, which may have changed the order of dives with
+	 * the same start time. */
+	sort_dive_table(&dives_to_add);
+	add_sorted_to_dive_table(&dive_table, dives_to_add.dives, dives_to_add.nr);
+	invalidate_dive_time_index();
+	for (i = 0; i < dives_to_add.nr; i++) {
+		add_to_dive_id_index(dives_to_add.dives[i]);
+		invalidate_deco_cache(dives_to_add.dives[i]->when);
+		fulltext_register(dives_to_add.dives[i]);
+		diveinfo_invalidate(dives_to_add.dives[i]);
 	}
-	dives_to_remove.nr = 0;
-
-	/* Add new dives */
-	for (i = 0; i < dives_to_add.nr; i++)
-		insert_dive(&dive_table, dives_to_add.dives[i]);
 	dives_to_add.nr = 0;
 
 	/* Add new trips */
@@ -1659,13 +2165,10 @@ void process_imported_dives(struct dive_table *import_table, struct trip_table *
 
 		/* If no trip to merge-into was found, add trip as-is.
 		 * First, add dives to list of dives to add */
+		add_sorted_to_dive_table(dives_to_add, trip_import->dives.dives, trip_import->dives.nr);
 		for (j = 0; j < trip_import->dives.nr; j++) {
 			struct dive *d = trip_import->dives.dives[j];
-
-			/* Add dive to list of dives to-be-added. */
-			insert_dive(dives_to_add, d);
 			sequence_changed |= !dive_is_after_last(d);
-
 			remove_dive(d, import_table);
 		}
 
@@ -1684,9 +2187,9 @@ void process_imported_dives(struct dive_table *import_table, struct trip_table *
 		for (i = 0; i < import_table->nr; i++) {
 			struct dive *d = import_table->dives[i];
 			d->divetrip = new_trip;
-			insert_dive(dives_to_add, d);
 			sequence_changed |= !dive_is_after_last(d);
 		}
+		add_sorted_to_dive_table(dives_to_add, import_table->dives, import_table->nr);
 
 		import_table->nr = 0; /* All dives were consumed */
 	} else if (import_table->nr > 0) {
@@ -1852,11 +2355,8 @@ timestamp_t get_surface_interval(timestamp_t when)
 	int i;
 	timestamp_t prev_end;
 
-	/* find previous dive. might want to use a binary search. */
-	for (i = dive_table.nr - 1; i >= 0; --i) {
-		if (dive_table.dives[i]->when < when)
-			break;
-	}
+	/* find previous dive */
+	i = dive_index_by_time(when) - 1;
 	if (i < 0)
 		return -1;
 
@@ -1875,11 +2375,7 @@ struct dive *find_next_visible_dive(timestamp_t when)
 	if (!dive_table.nr)
 		return NULL;
 
-	/* we might want to use binary search here */
-	for (i = 0; i < dive_table.nr; i++) {
-		if (when <= get_dive(i)->when)
-			break;
-	}
+	i = dive_index_by_time(when);
 
 	for (j = i - 1; j > 0; j--) {
 		if (!get_dive(j)->hidden_by_filter)
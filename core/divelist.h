@@ -34,9 +34,18 @@ extern char *get_dive_gas_string(const struct dive *dive);
 extern struct dive **grow_dive_table(struct dive_table *table);
 extern int dive_table_get_insertion_index(struct dive_table *table, struct dive *dive);
 extern void add_to_dive_table(struct dive_table *table, int idx, struct dive *dive);
+extern void add_single_dive(int idx, struct dive *dive);
 extern void append_dive(struct dive *dive);
+extern void set_dive_time(struct dive *dive, timestamp_t when);
+extern void replace_dive_contents(struct dive *dive, const struct dive *edited);
 extern void get_dive_gas(const struct dive *dive, int *o2_p, int *he_p, int *o2low_p);
 extern int get_divenr(const struct dive *dive);
+extern void invalidate_dive_time_index(void);
+extern int dive_index_by_time(timestamp_t when);
+extern void invalidate_deco_cache(timestamp_t when);
+extern void clear_deco_cache(void);
+extern int dive_overlapping(int idx, timestamp_t start, timestamp_t end);
+extern struct dive *find_nearest_dive(timestamp_t when, bool (*filter)(const struct dive *));
 extern struct dive_trip *unregister_dive_from_trip(struct dive *dive);
 extern int remove_dive(const struct dive *dive, struct dive_table *table);
 extern void remove_dive_from_trip(struct dive *dive, struct trip_table *trip_table_arg);
@@ -70,6 +79,10 @@ int get_dive_id_closest_to(timestamp_t when);
 void clear_dive_file_data();
 void clear_table(struct dive_table *table);
 
+/* iterate over the indices of the dives in dive_table that overlap [start, end] */
+#define for_each_dive_overlapping(_i, _start, _end) \
+	for ((_i) = dive_overlapping(0, (_start), (_end)); (_i) >= 0; (_i) = dive_overlapping((_i) + 1, (_start), (_end)))
+
 typedef enum {PO2VAL, SINGLE_EXP, SINGLE_SLOPE, DAILY_EXP, DAILY_SLOPE, NO_COLUMNS} cns_table_headers;
 
 #ifdef DEBUG_TRIP
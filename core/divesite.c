@@ -7,45 +7,359 @@
 #include "membuffer.h"
 #include "table.h"
 #include "sha1.h"
+#include "hash-index.h"
 
 #include <math.h>
 
 struct dive_site_table dive_site_table;
 
+/* The tables are sorted by uuid and a uuid appears only once per table
+ * (see add_dive_site_to_table()), so uuid lookups can bisect. Returns
+ * the index of the site with the given uuid or -1. */
+static int get_idx_by_uuid(uint32_t uuid, const struct dive_site_table *ds_table)
+{
+	int lo = 0, hi = ds_table->nr;
+
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+		uint32_t mid_uuid = ds_table->dive_sites[mid]->uuid;
+		if (mid_uuid == uuid)
+			return mid;
+		if (mid_uuid < uuid)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return -1;
+}
+
 int get_divesite_idx(const struct dive_site *ds, struct dive_site_table *ds_table)
 {
-	int i;
-	const struct dive_site *d;
+	int idx;
 	// tempting as it may be, don't die when called with ds=NULL
-	if (ds)
-		for_each_dive_site(i, d, ds_table) {
-			if (d == ds)
-				return i;
-		}
-	return -1;
+	if (!ds)
+		return -1;
+	idx = get_idx_by_uuid(ds->uuid, ds_table);
+	return idx >= 0 && ds_table->dive_sites[idx] == ds ? idx : -1;
 }
 
-// TODO: keep table sorted by UUID and do a binary search?
 struct dive_site *get_dive_site_by_uuid(uint32_t uuid, struct dive_site_table *ds_table)
+{
+	return get_dive_site(get_idx_by_uuid(uuid, ds_table), ds_table);
+}
+
+/*
+ * Names are looked up through a hash index from name to uuid of the last
+ * table searched by name, which normally is the table being filled by an
+ * import. Sites are entered and removed as they are added to and removed
+ * from that table, and renaming a site of the table has to go through
+ * set_dive_site_name(). Every site is entered, so that the first of
+ * several sites of the same name is found. The sites remember the
+ * generation of the index they are in, which is bumped on every rebuild,
+ * so that the index never has to look at a table it was built for before.
+ */
+static struct {
+	const struct dive_site_table *table;
+	int generation;
+	struct hash_index index;
+} site_name_index;
+
+static void add_to_site_name_index(struct dive_site *ds)
+{
+	hash_index_add(&site_name_index.index, hash_string(ds->name), ds->uuid);
+	ds->name_index = site_name_index.generation;
+}
+
+static void remove_from_site_name_index(struct dive_site *ds)
+{
+	if (!ds->name_index || ds->name_index != site_name_index.generation)
+		return;
+	hash_index_remove(&site_name_index.index, hash_string(ds->name), ds->uuid);
+	ds->name_index = 0;
+}
+
+static void rebuild_site_name_index(struct dive_site_table *ds_table)
 {
 	int i;
-	struct dive_site *ds;
-	for_each_dive_site (i, ds, ds_table)
-		if (ds->uuid == uuid)
-			return get_dive_site(i, ds_table);
-	return NULL;
+
+	site_name_index.table = ds_table;
+	site_name_index.generation++;
+	hash_index_reset(&site_name_index.index, ds_table->nr);
+	for (i = 0; i < ds_table->nr; i++)
+		add_to_site_name_index(ds_table->dive_sites[i]);
+}
+
+struct site_name_search {
+	struct dive_site_table *table;
+	struct dive_site *found;
+};
+
+/* The table is sorted by uuid, so the first site of a name is the one with the lowest uuid */
+static bool site_name_match(uintptr_t uuid, const void *name, const void *data)
+{
+	struct site_name_search *search = (struct site_name_search *)data;
+	struct dive_site *ds = get_dive_site_by_uuid(uuid, search->table);
+
+	if (ds && same_string(ds->name, name) && (!search->found || ds->uuid < search->found->uuid))
+		search->found = ds;
+	return false;	/* look at all sites of the name */
 }
 
 /* there could be multiple sites of the same name - return the first one */
 struct dive_site *get_dive_site_by_name(const char *name, struct dive_site_table *ds_table)
 {
+	struct site_name_search search = { ds_table, NULL };
+	uintptr_t uuid;
+
+	if (site_name_index.table != ds_table)
+		rebuild_site_name_index(ds_table);
+	hash_index_find(&site_name_index.index, hash_string(name), site_name_match, name, &search, &uuid);
+	return search.found;
+}
+
+void set_dive_site_name(struct dive_site *ds, const char *name)
+{
+	bool indexed = ds->name_index && ds->name_index == site_name_index.generation;
+
+	remove_from_site_name_index(ds);
+	free(ds->name);
+	ds->name = copy_string(name);
+	if (indexed)
+		add_to_site_name_index(ds);
+}
+
+/*
+ * Sites with a location are found through a grid of 0.01 degree cells.
+ * The grid is an array of entries sorted by cell, so that the sites in
+ * a row of cells are found by bisection. There is one grid for the global
+ * dive site table and one for the last other table that was searched,
+ * typically the table of an import. The grids are built when needed.
+ *
+ * Sites added with add_dive_site_to_table() are entered right away and
+ * moving a site has to go through set_dive_site_location(), which has
+ * the grids rebuilt on the next search. Entries are checked against the
+ * table when they are found, which takes care of removed sites.
+ */
+#define GRID_CELL 10000	/* in micro-degrees */
+#define GRID_ROWS (180000000 / GRID_CELL)
+#define GRID_COLUMNS (360000000 / GRID_CELL)
+
+struct grid_entry {
+	uint64_t cell;
+	uint32_t uuid;
+	location_t location;
+};
+
+static struct site_grid {
+	const struct dive_site_table *table;
+	bool valid;
+	int nr, allocated;
+	struct grid_entry *entries;
+} site_grids[2];
+
+/* a table of the sites found in the grid */
+struct site_list {
+	int nr, allocated;
+	struct dive_site **sites;
+};
+
+static int grid_row(int lat)
+{
+	int row = (lat + 90000000) / GRID_CELL;
+	return row < 0 ? 0 : row >= GRID_ROWS ? GRID_ROWS - 1 : row;
+}
+
+static int grid_column(int lon)
+{
+	int column = (lon + 180000000) / GRID_CELL;
+	return column < 0 ? 0 : column >= GRID_COLUMNS ? GRID_COLUMNS - 1 : column;
+}
+
+static uint64_t grid_cell(int row, int column)
+{
+	return (uint64_t)row << 32 | (uint32_t)column;
+}
+
+static uint64_t grid_cell_of(const location_t *loc)
+{
+	return grid_cell(grid_row(loc->lat.udeg), grid_column(loc->lon.udeg));
+}
+
+static int compare_grid_entries(const void *_a, const void *_b)
+{
+	const struct grid_entry *a = _a, *b = _b;
+
+	if (a->cell != b->cell)
+		return a->cell < b->cell ? -1 : 1;
+	return a->uuid < b->uuid ? -1 : a->uuid > b->uuid ? 1 : 0;
+}
+
+/* index of the first entry that doesn't come before the given one */
+static int grid_lower_bound(const struct site_grid *grid, const struct grid_entry *entry)
+{
+	int lo = 0, hi = grid->nr;
+
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+		if (compare_grid_entries(grid->entries + mid, entry) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+static void grow_grid(struct site_grid *grid, int nr)
+{
+	if (nr > grid->allocated) {
+		grid->allocated = (nr + 32) * 3 / 2;
+		grid->entries = realloc(grid->entries, grid->allocated * sizeof(*grid->entries));
+		if (!grid->entries)
+			exit(1);
+	}
+}
+
+static void set_grid_entry(struct grid_entry *entry, const struct dive_site *ds)
+{
+	entry->cell = grid_cell_of(&ds->location);
+	entry->uuid = ds->uuid;
+	entry->location = ds->location;
+}
+
+static struct site_grid *get_grid(const struct dive_site_table *ds_table)
+{
+	struct site_grid *grid = &site_grids[ds_table == &dive_site_table ? 0 : 1];
 	int i;
-	struct dive_site *ds;
-	for_each_dive_site (i, ds, ds_table) {
-		if (same_string(ds->name, name))
-			return ds;
+
+	if (grid->table == ds_table && grid->valid)
+		return grid;
+	grid->table = ds_table;
+	grid->valid = true;
+	grid->nr = 0;
+	grow_grid(grid, ds_table->nr);
+	for (i = 0; i < ds_table->nr; i++) {
+		const struct dive_site *ds = ds_table->dive_sites[i];
+		if (dive_site_has_gps_location(ds))
+			set_grid_entry(grid->entries + grid->nr++, ds);
 	}
-	return NULL;
+	qsort(grid->entries, grid->nr, sizeof(*grid->entries), compare_grid_entries);
+	return grid;
+}
+
+static void add_to_grid(const struct dive_site *ds, const struct dive_site_table *ds_table)
+{
+	struct site_grid *grid = &site_grids[ds_table == &dive_site_table ? 0 : 1];
+	struct grid_entry entry;
+	int idx;
+
+	if (grid->table != ds_table || !grid->valid || !dive_site_has_gps_location(ds))
+		return;
+	set_grid_entry(&entry, ds);
+	idx = grid_lower_bound(grid, &entry);
+	grow_grid(grid, grid->nr + 1);
+	memmove(grid->entries + idx + 1, grid->entries + idx, (grid->nr - idx) * sizeof(entry));
+	grid->entries[idx] = entry;
+	grid->nr++;
+}
+
+void set_dive_site_location(struct dive_site *ds, const location_t *loc)
+{
+	ds->location = *loc;
+	site_grids[0].valid = site_grids[1].valid = false;
+}
+
+static bool in_longitude_range(int lon, int lon0, int lon1)
+{
+	return lon0 <= lon1 ? lon >= lon0 && lon <= lon1 : lon >= lon0 || lon <= lon1;
+}
+
+/* Add the sites in columns column0 to column1 of a row that are in the rectangle to
+ * the list. Returns false if an entry is stale, i.e. the grid must be rebuilt. */
+static bool find_in_row(const struct site_grid *grid, struct dive_site_table *ds_table, int row, int column0, int column1,
+			int lat0, int lat1, int lon0, int lon1, struct site_list *list)
+{
+	struct grid_entry first = { grid_cell(row, column0), 0 };
+	uint64_t last = grid_cell(row, column1);
+	int i;
+
+	for (i = grid_lower_bound(grid, &first); i < grid->nr && grid->entries[i].cell <= last; i++) {
+		const struct grid_entry *entry = grid->entries + i;
+		struct dive_site *ds;
+
+		if (entry->location.lat.udeg < lat0 || entry->location.lat.udeg > lat1 ||
+		    !in_longitude_range(entry->location.lon.udeg, lon0, lon1))
+			continue;
+		ds = get_dive_site_by_uuid(entry->uuid, ds_table);
+		if (!ds)
+			continue;
+		if (!same_location(&ds->location, &entry->location))
+			return false;
+		if (list->nr >= list->allocated) {
+			list->allocated = (list->nr + 32) * 3 / 2;
+			list->sites = realloc(list->sites, list->allocated * sizeof(*list->sites));
+			if (!list->sites)
+				exit(1);
+		}
+		list->sites[list->nr++] = ds;
+	}
+	return true;
+}
+
+/* Find the sites with a location from lat0 to lat1 and lon0 to lon1. If lon0 is greater
+ * than lon1, the rectangle crosses the 180th meridian. The caller frees list->sites. */
+static void find_in_rectangle(struct dive_site_table *ds_table, int lat0, int lat1, int lon0, int lon1, struct site_list *list)
+{
+	struct site_grid *grid = get_grid(ds_table);
+	int row, row0 = grid_row(lat0), row1 = grid_row(lat1);
+	int column0 = grid_column(lon0), column1 = grid_column(lon1);
+	bool ok;
+
+	do {
+		ok = true;
+		list->nr = 0;
+		for (row = row0; row <= row1 && ok; row++) {
+			if (lon0 <= lon1) {
+				ok = find_in_row(grid, ds_table, row, column0, column1, lat0, lat1, lon0, lon1, list);
+			} else {
+				ok = find_in_row(grid, ds_table, row, column0, GRID_COLUMNS - 1, lat0, lat1, lon0, lon1, list) &&
+				     find_in_row(grid, ds_table, row, 0, column1, lat0, lat1, lon0, lon1, list);
+			}
+		}
+		if (!ok) {
+			grid->valid = false;
+			grid = get_grid(ds_table);
+		}
+	} while (!ok);
+}
+
+void for_each_dive_site_in_rectangle(const location_t *sw, const location_t *ne, struct dive_site_table *ds_table,
+				     void (*fn)(struct dive_site *ds, void *data), void *data)
+{
+	struct site_list list = { 0 };
+	int i;
+
+	find_in_rectangle(ds_table, sw->lat.udeg, ne->lat.udeg, sw->lon.udeg, ne->lon.udeg, &list);
+	for (i = 0; i < list.nr; i++)
+		fn(list.sites[i], data);
+	free(list.sites);
+}
+
+/* Of the sites at a given location, return the first in the table for which match() is true */
+static struct dive_site *find_at_location(const location_t *loc, struct dive_site_table *ds_table,
+					  bool (*match)(const struct dive_site *ds, const void *data), const void *data)
+{
+	struct site_list list = { 0 };
+	struct dive_site *res = NULL;
+	int i;
+
+	find_in_rectangle(ds_table, loc->lat.udeg, loc->lat.udeg, loc->lon.udeg, loc->lon.udeg, &list);
+	for (i = 0; i < list.nr; i++) {
+		struct dive_site *ds = list.sites[i];
+		if ((!res || ds->uuid < res->uuid) && (!match || match(ds, data)))
+			res = ds;
+	}
+	free(list.sites);
+	return res;
 }
 
 /* there could be multiple sites at the same GPS fix - return the first one */
@@ -53,6 +367,9 @@ struct dive_site *get_dive_site_by_gps(const location_t *loc, struct dive_site_t
 {
 	int i;
 	struct dive_site *ds;
+
+	if (has_location(loc))
+		return find_at_location(loc, ds_table, NULL, NULL);
 	for_each_dive_site (i, ds, ds_table) {
 		if (same_location(loc, &ds->location))
 			return ds;
@@ -60,6 +377,11 @@ struct dive_site *get_dive_site_by_gps(const location_t *loc, struct dive_site_t
 	return NULL;
 }
 
+static bool site_has_name(const struct dive_site *ds, const void *name)
+{
+	return same_string(ds->name, name);
+}
+
 /* to avoid a bug where we have two dive sites with different name and the same GPS coordinates
  * and first get the gps coordinates (reading a V2 file) and happen to get back "the other" name,
  * this function allows us to verify if a very specific name/GPS combination already exists */
@@ -67,6 +389,9 @@ struct dive_site *get_dive_site_by_gps_and_name(char *name, const location_t *lo
 {
 	int i;
 	struct dive_site *ds;
+
+	if (has_location(loc))
+		return find_at_location(loc, ds_table, site_has_name, name);
 	for_each_dive_site (i, ds, ds_table) {
 		if (same_location(loc, &ds->location) && same_string(ds->name, name))
 			return ds;
@@ -92,19 +417,54 @@ unsigned int get_distance(const location_t *loc1, const location_t *loc2)
 	return lrint(6371000 * c);
 }
 
+/* The rectangle around a location that contains all points up to distance meters
+ * away. Returns false if the rectangle spans all longitudes. */
+static bool rectangle_around(const location_t *loc, int distance, int *lat0, int *lat1, int *lon0, int *lon1)
+{
+	double angle = (distance + 1.0) / 6371000;
+	double lat = udeg_to_radians(loc->lat.udeg);
+	int dlat = (int)ceil(angle * 180 / M_PI * 1000000) + 1;
+
+	*lat0 = loc->lat.udeg - dlat;
+	*lat1 = loc->lat.udeg + dlat;
+	if (*lat0 <= -90000000 || *lat1 >= 90000000 || sin(angle) >= cos(lat))
+		return false;
+	int dlon = (int)ceil(asin(sin(angle) / cos(lat)) * 180 / M_PI * 1000000) + 1;
+	if (dlon >= 180000000)
+		return false;
+	*lon0 = loc->lon.udeg - dlon;
+	*lon1 = loc->lon.udeg + dlon;
+	if (*lon0 < -180000000)
+		*lon0 += 360000000;
+	if (*lon1 > 180000000)
+		*lon1 -= 360000000;
+	return true;
+}
+
 /* find the closest one, no more than distance meters away - if more than one at same distance, pick the first */
 struct dive_site *get_dive_site_by_gps_proximity(const location_t *loc, int distance, struct dive_site_table *ds_table)
 {
-	int i;
+	struct site_list list = { 0 };
 	struct dive_site *ds, *res = NULL;
 	unsigned int cur_distance, min_distance = distance;
-	for_each_dive_site (i, ds, ds_table) {
-		if (dive_site_has_gps_location(ds) &&
-		    (cur_distance = get_distance(&ds->location, loc)) < min_distance) {
+	int i, lat0, lat1, lon0 = -180000000, lon1 = 180000000;
+
+	if (distance <= 0)
+		return NULL;
+	if (!rectangle_around(loc, distance, &lat0, &lat1, &lon0, &lon1)) {
+		lon0 = -180000000;
+		lon1 = 180000000;
+	}
+	find_in_rectangle(ds_table, lat0, lat1, lon0, lon1, &list);
+	for (i = 0; i < list.nr; i++) {
+		ds = list.sites[i];
+		cur_distance = get_distance(&ds->location, loc);
+		if (cur_distance < min_distance || (res && cur_distance == min_distance && ds->uuid < res->uuid)) {
 			min_distance = cur_distance;
 			res = ds;
 		}
 	}
+	free(list.sites);
 	return res;
 }
 
@@ -127,7 +487,7 @@ static MAKE_GROW_TABLE(dive_site_table, struct dive_site *, dive_sites)
 static MAKE_GET_INSERTION_INDEX(dive_site_table, struct dive_site *, dive_sites, site_less_than)
 static MAKE_ADD_TO(dive_site_table, struct dive_site *, dive_sites)
 static MAKE_REMOVE_FROM(dive_site_table, dive_sites)
-static MAKE_GET_IDX(dive_site_table, struct dive_site *, dive_sites)
+static MAKE_GET_IDX(dive_site_table, struct dive_site *, dive_sites, site_less_than)
 MAKE_SORT(dive_site_table, struct dive_site *, dive_sites, compare_sites)
 static MAKE_REMOVE(dive_site_table, struct dive_site *, dive_site)
 
@@ -157,6 +517,9 @@ int add_dive_site_to_table(struct dive_site *ds, struct dive_site_table *ds_tabl
 
 	int idx = dive_site_table_get_insertion_index(ds_table, ds);
 	add_to_dive_site_table(ds_table, idx, ds);
+	if (site_name_index.table == ds_table)
+		add_to_site_name_index(ds);
+	add_to_grid(ds, ds_table);
 	return idx;
 }
 
@@ -218,6 +581,7 @@ void free_dive_site(struct dive_site *ds)
 
 int unregister_dive_site(struct dive_site *ds)
 {
+	remove_from_site_name_index(ds);
 	return remove_dive_site(ds, &dive_site_table);
 }
 
@@ -225,6 +589,7 @@ void delete_dive_site(struct dive_site *ds, struct dive_site_table *ds_table)
 {
 	if (!ds)
 		return;
+	remove_from_site_name_index(ds);
 	remove_dive_site(ds, ds_table);
 	free_dive_site(ds);
 }
@@ -261,12 +626,11 @@ bool dive_site_is_empty(struct dive_site *ds)
 
 void copy_dive_site(struct dive_site *orig, struct dive_site *copy)
 {
-	free(copy->name);
 	free(copy->notes);
 	free(copy->description);
 
-	copy->location = orig->location;
-	copy->name = copy_string(orig->name);
+	set_dive_site_location(copy, &orig->location);
+	set_dive_site_name(copy, orig->name);
 	copy->notes = copy_string(orig->notes);
 	copy->description = copy_string(orig->description);
 	copy_taxonomy(&orig->taxonomy, &copy->taxonomy);
@@ -305,10 +669,17 @@ static bool same_dive_site(const struct dive_site *a, const struct dive_site *b)
 	    && same_string(a->notes, b->notes);
 }
 
+static bool is_same_dive_site(const struct dive_site *ds, const void *site)
+{
+	return same_dive_site(ds, site);
+}
+
 struct dive_site *get_same_dive_site(const struct dive_site *site)
 {
 	int i;
 	struct dive_site *ds;
+	if (has_location(&site->location))
+		return find_at_location(&site->location, &dive_site_table, is_same_dive_site, site);
 	for_each_dive_site (i, ds, &dive_site_table)
 		if (same_dive_site(ds, site))
 			return ds;
@@ -317,8 +688,12 @@ struct dive_site *get_same_dive_site(const struct dive_site *site)
 
 void merge_dive_site(struct dive_site *a, struct dive_site *b)
 {
-	if (!has_location(&a->location)) a->location = b->location;
-	merge_string(&a->name, &b->name);
+	char *name = copy_string(a->name);
+
+	if (!has_location(&a->location)) set_dive_site_location(a, &b->location);
+	merge_string(&name, &b->name);
+	set_dive_site_name(a, name);
+	free(name);
 	merge_string(&a->notes, &b->notes);
 	merge_string(&a->description, &b->description);
 
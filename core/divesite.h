@@ -24,6 +24,7 @@ struct dive_site
 	char *description;
 	char *notes;
 	struct taxonomy_data taxonomy;
+	int name_index;		/* set while the site is in the index of get_dive_site_by_name() */
 };
 
 typedef struct dive_site_table {
@@ -62,9 +63,13 @@ struct dive_site *get_dive_site_by_name(const char *name, struct dive_site_table
 struct dive_site *get_dive_site_by_gps(const location_t *, struct dive_site_table *ds_table);
 struct dive_site *get_dive_site_by_gps_and_name(char *name, const location_t *, struct dive_site_table *ds_table);
 struct dive_site *get_dive_site_by_gps_proximity(const location_t *, int distance, struct dive_site_table *ds_table);
+void for_each_dive_site_in_rectangle(const location_t *sw, const location_t *ne, struct dive_site_table *ds_table,
+				     void (*fn)(struct dive_site *ds, void *data), void *data);
+void set_dive_site_location(struct dive_site *ds, const location_t *loc);
 struct dive_site *get_same_dive_site(const struct dive_site *);
 bool dive_site_is_empty(struct dive_site *ds);
 void copy_dive_site_taxonomy(struct dive_site *orig, struct dive_site *copy);
+void set_dive_site_name(struct dive_site *ds, const char *name);
 void copy_dive_site(struct dive_site *orig, struct dive_site *copy);
 void merge_dive_site(struct dive_site *a, struct dive_site *b);
 unsigned int get_distance(const location_t *loc1, const location_t *loc2);
@@ -92,10 +92,11 @@ void get_gas_string(struct gasmix gasmix, char *text, int len)
 		snprintf(text, len, "(%d/%d)", (get_o2(gasmix) + 5) / 10, (get_he(gasmix) + 5) / 10);
 }
 
-/* Returns a static char buffer - only good for immediate use by printf etc */
+/* Returns a static char buffer - only good for immediate use by printf etc.
+ * The buffer is per thread, since plans are also calculated in worker threads. */
 const char *gasname(struct gasmix gasmix)
 {
-	static char gas[64];
+	static __thread char gas[64];
 	get_gas_string(gasmix, gas, sizeof(gas));
 	return gas;
 }
@@ -11,10 +11,24 @@
 
 static void (*error_cb)(char *) = NULL;
 
+/*
+ * The error callback must only be called from the thread that set it.
+ * Worker threads collect their errors instead, and the calling thread
+ * reports them once the work is done.
+ */
+static __thread struct membuffer *collected_errors = NULL;
+
 int report_error(const char *fmt, ...)
 {
 	struct membuffer buf = { 0 };
 
+	/* collected errors are stored one after another, each with its '\0' */
+	if (collected_errors) {
+		VA_BUF(collected_errors, fmt);
+		put_bytes(collected_errors, "", 1);
+		return -1;
+	}
+
 	/* if there is no error callback registered, don't produce errors */
 	if (!error_cb)
 		return -1;
@@ -30,3 +44,20 @@ void set_error_cb(void(*cb)(char *))
 {
 	error_cb = cb;
 }
+
+void collect_errors(struct membuffer *b)
+{
+	collected_errors = b;
+}
+
+void report_collected_errors(struct membuffer *b)
+{
+	unsigned int i = 0;
+
+	while (i < b->len) {
+		const char *msg = b->buffer + i;
+		report_error("%s", msg);
+		i += strlen(msg) + 1;
+	}
+	free_buffer(b);
+}
@@ -0,0 +1,247 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "core/fulltext.h"
+#include "core/dive.h"
+#include "core/divesite.h"
+#include "core/gettextfromc.h"
+#include "core/subsurface-qt/DiveListNotifier.h"
+
+#include <algorithm>
+
+extern "C" void fulltext_register(struct dive *d)
+{
+	FullText::instance()->registerDive(d);
+}
+
+extern "C" void fulltext_unregister(struct dive *d)
+{
+	FullText::instance()->unregisterDive(d);
+}
+
+extern "C" void fulltext_populate()
+{
+	FullText::instance()->populate();
+}
+
+FullText *FullText::instance()
+{
+	static FullText self;
+	return &self;
+}
+
+FullText::FullText() : generation(1)
+{
+	connect(&diveListNotifier, &DiveListNotifier::divesAdded, this, &FullText::divesAdded);
+	connect(&diveListNotifier, &DiveListNotifier::divesDeleted, this, &FullText::divesDeleted);
+	connect(&diveListNotifier, &DiveListNotifier::divesChanged, this, &FullText::divesChanged);
+	connect(&diveListNotifier, &DiveListNotifier::divesMovedBetweenTrips, this, &FullText::divesMovedBetweenTrips);
+	connect(&diveListNotifier, &DiveListNotifier::tripChanged, this, &FullText::tripChanged);
+	connect(&diveListNotifier, &DiveListNotifier::diveSiteChanged, this, &FullText::diveSiteChanged);
+}
+
+QStringList FullText::splitIntoWords(const QString &s)
+{
+	QStringList res;
+	QString word;
+	for (QChar c: s) {
+		if (c.isLetterOrNumber()) {
+			word += c.toCaseFolded();
+		} else if (!word.isEmpty()) {
+			res.append(word);
+			word.clear();
+		}
+	}
+	if (!word.isEmpty())
+		res.append(word);
+	return res;
+}
+
+static void addWords(QHash<QString, unsigned> &res, const QString &s, unsigned field)
+{
+	for (const QString &word: FullText::splitIntoWords(s))
+		res[word] |= field;
+}
+
+std::vector<FullText::DiveWord> FullText::wordsOfDive(const struct dive *d)
+{
+	QHash<QString, unsigned> words;
+	addWords(words, d->notes, FULLTEXT_NOTES);
+	addWords(words, d->buddy, FULLTEXT_PEOPLE);
+	addWords(words, d->divemaster, FULLTEXT_PEOPLE);
+	for (const struct tag_entry *tag = d->tag_list; tag; tag = tag->next)
+		addWords(words, tag->tag->name, FULLTEXT_TAGS);
+	addWords(words, gettextFromC::tr(divemode_text_ui[d->dc.divemode]), FULLTEXT_MODE);
+	addWords(words, d->suit, FULLTEXT_SUIT);
+	if (d->dive_site)
+		addWords(words, d->dive_site->name, FULLTEXT_LOCATION);
+	if (d->divetrip)
+		addWords(words, d->divetrip->location, FULLTEXT_LOCATION);
+
+	std::vector<DiveWord> res;
+	res.reserve(words.size());
+	for (auto it = words.cbegin(); it != words.cend(); ++it)
+		res.push_back({ it.key(), it.value() });
+	return res;
+}
+
+void FullText::registerDive(struct dive *d)
+{
+	unregisterDive(d);
+	std::vector<DiveWord> dw = wordsOfDive(d);
+	for (const DiveWord &w: dw)
+		words[w.word].insert(d, w.fields);
+	diveWords.insert(d, std::move(dw));
+	++generation;
+}
+
+void FullText::unregisterDive(struct dive *d)
+{
+	auto it = diveWords.find(d);
+	if (it == diveWords.end())
+		return;
+	for (const DiveWord &w: *it) {
+		auto word = words.find(w.word);
+		if (word == words.end())
+			continue;
+		word->second.remove(d);
+		if (word->second.isEmpty())
+			words.erase(word);
+	}
+	diveWords.erase(it);
+	++generation;
+}
+
+void FullText::populate()
+{
+	int i;
+	struct dive *d;
+
+	words.clear();
+	diveWords.clear();
+	++generation;
+	for_each_dive (i, d)
+		registerDive(d);
+}
+
+int FullText::wordCount() const
+{
+	return (int)words.size();
+}
+
+// The dives containing all words as prefixes of their words in the given fields
+QSet<const struct dive *> FullText::find(const QStringList &queryWords, unsigned fields) const
+{
+	QSet<const struct dive *> res;
+	bool first = true;
+	for (const QString &queryWord: queryWords) {
+		QSet<const struct dive *> found;
+		for (auto it = words.lower_bound(queryWord); it != words.end() && it->first.startsWith(queryWord); ++it) {
+			for (auto entry = it->second.cbegin(); entry != it->second.cend(); ++entry) {
+				if ((entry.value() & fields) && (first || res.contains(entry.key())))
+					found.insert(entry.key());
+			}
+		}
+		res = std::move(found);
+		first = false;
+		if (res.isEmpty())
+			break;
+	}
+	return res;
+}
+
+bool FullText::matches(const std::vector<DiveWord> &dw, const QStringList &queryWords, unsigned fields)
+{
+	return std::all_of(queryWords.begin(), queryWords.end(), [&dw, fields](const QString &queryWord)
+			   { return std::any_of(dw.begin(), dw.end(), [&queryWord, fields](const DiveWord &w)
+						{ return (w.fields & fields) && w.word.startsWith(queryWord); }); });
+}
+
+void FullText::divesAdded(dive_trip *, bool, const QVector<dive *> &dives)
+{
+	for (dive *d: dives)
+		registerDive(d);
+}
+
+void FullText::divesDeleted(dive_trip *, bool, const QVector<dive *> &dives)
+{
+	for (dive *d: dives)
+		unregisterDive(d);
+}
+
+void FullText::divesChanged(dive_trip *, const QVector<dive *> &dives, DiveField field)
+{
+	switch (field) {
+	case DiveField::DIVESITE:
+	case DiveField::DIVEMASTER:
+	case DiveField::BUDDY:
+	case DiveField::SUIT:
+	case DiveField::TAGS:
+	case DiveField::MODE:
+	case DiveField::NOTES:
+		for (dive *d: dives)
+			registerDive(d);
+		break;
+	default:
+		break;
+	}
+}
+
+void FullText::divesMovedBetweenTrips(dive_trip *, dive_trip *, bool, bool, const QVector<dive *> &dives)
+{
+	for (dive *d: dives)
+		registerDive(d);
+}
+
+void FullText::tripChanged(dive_trip *trip, TripField field)
+{
+	if (field != TripField::LOCATION)
+		return;
+	for (int i = 0; i < trip->dives.nr; ++i)
+		registerDive(trip->dives.dives[i]);
+}
+
+void FullText::diveSiteChanged(dive_site *ds, int)
+{
+	for (int i = 0; i < ds->dives.nr; ++i)
+		registerDive(ds->dives.dives[i]);
+}
+
+FullTextQuery::FullTextQuery(const QString &term, unsigned fields) :
+	words(FullText::splitIntoWords(term)),
+	fields(fields),
+	generation(0)
+{
+}
+
+bool FullTextQuery::isEmpty() const
+{
+	return words.isEmpty();
+}
+
+bool FullTextQuery::matches(const struct dive *d) const
+{
+	if (words.isEmpty())
+		return true;
+	const FullText *index = FullText::instance();
+
+	// Dives that are about to be added to the dive list are not yet indexed
+	auto it = index->diveWords.constFind(d);
+	if (it == index->diveWords.cend())
+		return FullText::matches(FullText::wordsOfDive(d), words, fields);
+
+	if (generation != index->generation) {
+		dives = index->find(words, fields);
+		generation = index->generation;
+	}
+	return dives.contains(d);
+}
+
+// True if every word of q starts a word of this query, which is searched in fewer fields.
+// E.g. "john" implies "jo", but not the other way round.
+bool FullTextQuery::implies(const FullTextQuery &q) const
+{
+	if (fields & ~q.fields)
+		return false;
+	return std::all_of(q.words.begin(), q.words.end(), [this](const QString &word)
+			   { return std::any_of(words.begin(), words.end(), [&word](const QString &w)
+						{ return w.startsWith(word); }); });
+}
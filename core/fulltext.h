@@ -0,0 +1,104 @@
+// SPDX-License-Identifier: GPL-2.0
+// A full-text index of the dive list. It maps the words of the notes, buddies,
+// divemasters, tags, dive mode, suit, dive site and trip location of the dives to
+// the dives containing them. Words are case-folded and searched by prefix.
+//
+// The index follows the signals of the DiveListNotifier. Changes of the dive list
+// that are not signaled (loading, importing, replanning and the mobile edits) have
+// to be registered with the functions below.
+#ifndef FULLTEXT_H
+#define FULLTEXT_H
+
+struct dive;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void fulltext_register(struct dive *d);		// add a dive or update its words
+void fulltext_unregister(struct dive *d);	// doesn't access the dive
+void fulltext_populate(void);			// index all dives of the dive list
+
+#ifdef __cplusplus
+}
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+#include <QSet>
+#include <map>
+#include <vector>
+
+struct dive_trip;
+struct dive_site;
+enum class DiveField;
+enum class TripField;
+
+// The indexed fields of a dive. Buddies and divemasters are searched together,
+// as are the names of the dive site and of the trip.
+enum FullTextField {
+	FULLTEXT_NOTES = 1,
+	FULLTEXT_PEOPLE = 2,
+	FULLTEXT_TAGS = 4,
+	FULLTEXT_SUIT = 8,
+	FULLTEXT_LOCATION = 16,
+	FULLTEXT_MODE = 32,	// the dive mode, which the desktop filter treats as a tag
+	FULLTEXT_ALL = 63
+};
+
+// A search term split into words. A dive matches if every word of the term starts
+// a word of the dive in one of the given fields. The matching dives are looked up
+// in the index once and cached until the index changes.
+class FullTextQuery {
+public:
+	FullTextQuery(const QString &term = QString(), unsigned fields = FULLTEXT_ALL);
+	bool isEmpty() const;
+	bool matches(const struct dive *d) const;	// Empty queries match all dives
+	bool implies(const FullTextQuery &q) const;	// Every dive matching this query matches q
+private:
+	QStringList words;
+	unsigned fields;
+	mutable quint64 generation;
+	mutable QSet<const struct dive *> dives;
+};
+
+class FullText : public QObject {
+	Q_OBJECT
+public:
+	static FullText *instance();
+	void registerDive(struct dive *d);
+	void unregisterDive(struct dive *d);
+	void populate();
+	int wordCount() const;
+
+	// Split a string into case-folded words. Everything but letters and digits separates words.
+	static QStringList splitIntoWords(const QString &s);
+private:
+	friend FullTextQuery;
+	struct DiveWord {
+		QString word;
+		unsigned fields;
+	};
+	FullText();
+	static std::vector<DiveWord> wordsOfDive(const struct dive *d);
+	static bool matches(const std::vector<DiveWord> &dw, const QStringList &words, unsigned fields);
+	QSet<const struct dive *> find(const QStringList &words, unsigned fields) const;
+
+	std::map<QString, QHash<const struct dive *, unsigned>> words;	// word -> dives and the fields containing it
+	QHash<const struct dive *, std::vector<DiveWord>> diveWords;		// the words of each indexed dive
+	quint64 generation;							// incremented on every change of the index
+private
+slots:
+	void divesAdded(dive_trip *trip, bool addTrip, const QVector<dive *> &dives);
+	void divesDeleted(dive_trip *trip, bool deleteTrip, const QVector<dive *> &dives);
+	void divesChanged(dive_trip *trip, const QVector<dive *> &dives, DiveField field);
+	void divesMovedBetweenTrips(dive_trip *from, dive_trip *to, bool deleteFrom, bool createTo, const QVector<dive *> &dives);
+	void tripChanged(dive_trip *trip, TripField field);
+	void diveSiteChanged(dive_site *ds, int field);
+};
+
+#endif
+
+#endif
@@ -239,13 +239,10 @@ static void fill_missing_tank_pressures(struct dive *dive, struct plot_info *pi,
 		double magic;
 		pr_track_t *segment;
 		int pressure;
-		int *save_pressure, *save_interpolated;
 
 		entry = pi->entry + i;
 
-		save_pressure = &(entry->pressure[cyl][SENSOR_PR]);
-		save_interpolated = &(entry->pressure[cyl][INTERPOLATED_PR]);
-		pressure = *save_pressure ? *save_pressure : *save_interpolated;
+		pressure = get_plot_pressure(pi, i, cyl);
 
 		if (pressure) {			// If there is a valid pressure value,
 			last_segment = NULL;	// get rid of interpolation data,
@@ -267,7 +264,7 @@ static void fill_missing_tank_pressures(struct dive *dive, struct plot_info *pi,
 			continue;
 
 		if (!segment->pressure_time) {		// Empty segment?
-			*save_pressure = cur_pr;	// Just use our current pressure
+			set_plot_pressure_data(pi, i, SENSOR_PR, cyl, cur_pr); // Just use our current pressure
 			continue;			// and skip to next point.
 		}
 
@@ -294,7 +291,7 @@ static void fill_missing_tank_pressures(struct dive *dive, struct plot_info *pi,
 			magic = (interpolate.end - interpolate.start) /  (segment->t_end - segment->t_start);
 			cur_pr = lrint(segment->start + magic * (entry->sec - segment->t_start));
 		}
-		*save_interpolated = cur_pr; // and store the interpolated data in plot_info
+		set_plot_pressure_data(pi, i, INTERPOLATED_PR, cyl, cur_pr); // and store the interpolated data in plot_info
 	}
 }
 
@@ -326,21 +323,21 @@ static inline int calc_pressure_time(struct dive *dive, struct plot_data *a, str
 static void debug_print_pressures(struct plot_info *pi)
 {
 	int i;
-	for (i = 0; i < pi->nr; i++) {
-		struct plot_data *entry = pi->entry + i;
-		printf("%5d |%9d | %9d || %9d | %9d |\n", i, SENSOR_PRESSURE(entry), INTERPOLATED_PRESSURE(entry), DILUENT_PRESSURE(entry), INTERPOLATED_DILUENT_PRESSURE(entry));
-	}
+	for (i = 0; i < pi->nr; i++)
+		printf("%5d |%9d | %9d || %9d | %9d |\n", i,
+		       get_plot_sensor_pressure(pi, i, 0), get_plot_interpolated_pressure(pi, i, 0),
+		       get_plot_sensor_pressure(pi, i, 1), get_plot_interpolated_pressure(pi, i, 1));
 }
 #endif
 
-/* This function goes through the list of tank pressures, either SENSOR_PRESSURE(entry) or O2CYLINDER_PRESSURE(entry),
+/* This function goes through the list of tank pressures, either get_plot_sensor_pressure() or O2CYLINDER_PRESSURE(entry),
  * of structure plot_info for the dive profile where each item in the list corresponds to one point (node) of the
  * profile. It finds values for which there are no tank pressures (pressure==0). For each missing item (node) of
  * tank pressure it creates a pr_track_alloc structure that represents a segment on the dive profile and that
  * contains tank pressures. There is a linked list of pr_track_alloc structures for each cylinder. These pr_track_alloc
  * structures ultimately allow for filling the missing tank pressure values on the dive profile using the depth_pressure
  * of the dive. To do this, it calculates the summed pressure-time value for the duration of the dive and stores these
- * in the pr_track_alloc structures. If diluent_flag = 1, then DILUENT_PRESSURE(entry) is used instead of SENSOR_PRESSURE.
+ * in the pr_track_alloc structures. If diluent_flag = 1, then DILUENT_PRESSURE(entry) is used instead of the sensor pressure.
  * This function is called by create_plot_info_new() in profile.c
  */
 void populate_pressure_information(struct dive *dive, struct divecomputer *dc, struct plot_info *pi, int sensor)
@@ -363,8 +360,7 @@ void populate_pressure_information(struct dive *dive, struct divecomputer *dc, s
 	/* Get a rough range of where we have any pressures at all */
 	first = last = -1;
 	for (int i = 0; i < pi->nr; i++) {
-		struct plot_data *entry = pi->entry + i;
-		unsigned pressure = SENSOR_PRESSURE(entry, sensor);
+		unsigned pressure = get_plot_sensor_pressure(pi, i, sensor);
 
 		if (!pressure)
 			continue;
@@ -393,7 +389,7 @@ void populate_pressure_information(struct dive *dive, struct divecomputer *dc, s
 
 	for (int i = first; i <= last; i++) {
 		struct plot_data *entry = pi->entry + i;
-		unsigned pressure = SENSOR_PRESSURE(entry, sensor);
+		unsigned pressure = get_plot_sensor_pressure(pi, i, sensor);
 		int time = entry->sec;
 
 		while (ev && ev->time.seconds <= time) {   // Find 1st gaschange event after 
@@ -422,7 +418,7 @@ void populate_pressure_information(struct dive *dive, struct divecomputer *dc, s
 		// until we get back to this cylinder.
 		if (cyl != sensor) {
 			current = NULL;
-			SENSOR_PRESSURE(entry, sensor) = 0;
+			set_plot_pressure_data(pi, i, SENSOR_PR, sensor, 0);
 			continue;
 		}
 
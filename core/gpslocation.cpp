@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: GPL-2.0
 #include "core/gpslocation.h"
 #include "core/divesite.h"
+#include "core/divelist.h"
 #include "qt-models/gpslistmodel.h"
 #include "core/pref.h"
 #include "core/qthelper.h"
@@ -12,6 +13,7 @@
 #include <QUrlQuery>
 #include <QApplication>
 #include <QTimer>
+#include <algorithm>
 
 GpsLocation *GpsLocation::m_Instance = NULL;
 
@@ -215,7 +217,7 @@ static void copy_gps_location(struct gpsTracker &gps, struct dive *d)
 		ds = create_dive_site(qPrintable(gps.name), &dive_site_table);
 		add_dive_to_dive_site(d, ds);
 	}
-	ds->location = gps.location;
+	set_dive_site_location(ds, &gps.location);
 }
 
 #define SAME_GROUP 6 * 3600 /* six hours */
@@ -238,12 +240,15 @@ bool GpsLocation::applyLocations()
 	// create a table with the GPS information
 	QList<struct gpsTracker> gpsTable = m_trackers.values();
 
-	// now walk the dive table and see if we can fill in missing gps data
-	struct dive *d;
-	for_each_dive(i, d) {
+	// now walk the dives within six hours of the gps fixes and see if we can fill in missing gps data
+	for_each_dive_overlapping (i, gpsTable.first().when - SAME_GROUP, gpsTable.last().when + SAME_GROUP) {
+		struct dive *d = get_dive(i);
 		if (dive_has_gps_location(d))
 			continue;
-		for (int j = last; j < cnt; j++) {
+		// the gps fixes are sorted, skip the ones that are too early for this dive
+		auto first = std::lower_bound(gpsTable.begin() + last, gpsTable.end(), d->when - SAME_GROUP,
+					      [](const gpsTracker &fix, timestamp_t when) { return fix.when < when; });
+		for (int j = first - gpsTable.begin(); j < cnt; j++) {
 			if (time_during_dive_with_offset(d, gpsTable[j].when, SAME_GROUP)) {
 				if (verbose)
 					qDebug() << "processing gpsFix @" << get_dive_date_string(gpsTable[j].when) <<
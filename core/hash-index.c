@@ -0,0 +1,116 @@
+// SPDX-License-Identifier: GPL-2.0
+/* hash-index.c */
+#include "hash-index.h"
+#include <stdlib.h>
+#include <string.h>
+
+void hash_index_clear(struct hash_index *index)
+{
+	free(index->slots);
+	memset(index, 0, sizeof(*index));
+}
+
+/* Empty the index and make room for nr entries at a load factor of at most one half */
+void hash_index_reset(struct hash_index *index, int nr)
+{
+	int size = 16;
+
+	while (size < 2 * nr)
+		size *= 2;
+	if (size != index->size) {
+		free(index->slots);
+		index->slots = malloc(size * sizeof(*index->slots));
+		if (!index->slots)
+			exit(1);
+		index->size = size;
+	}
+	memset(index->slots, 0, size * sizeof(*index->slots));
+	index->nr = 0;
+}
+
+static void insert_slot(struct hash_index *index, uint32_t hash, uintptr_t value)
+{
+	unsigned int mask = index->size - 1;
+	unsigned int i = hash & mask;
+
+	while (index->slots[i].used)
+		i = (i + 1) & mask;
+	index->slots[i].hash = hash;
+	index->slots[i].value = value;
+	index->slots[i].used = true;
+	index->nr++;
+}
+
+void hash_index_add(struct hash_index *index, uint32_t hash, uintptr_t value)
+{
+	if (2 * (index->nr + 1) > index->size) {
+		struct hash_index old = *index;
+		int i;
+
+		memset(index, 0, sizeof(*index));
+		hash_index_reset(index, old.nr + 1);
+		for (i = 0; i < old.size; i++) {
+			if (old.slots[i].used)
+				insert_slot(index, old.slots[i].hash, old.slots[i].value);
+		}
+		free(old.slots);
+	}
+	insert_slot(index, hash, value);
+}
+
+/* Remove a value added under this hash. The following slots of the probe
+ * sequence are moved up, so that no lookup has to step over a hole. */
+void hash_index_remove(struct hash_index *index, uint32_t hash, uintptr_t value)
+{
+	unsigned int mask = index->size - 1;
+	unsigned int i, j, home;
+
+	if (!index->size)
+		return;
+	for (i = hash & mask; index->slots[i].used; i = (i + 1) & mask) {
+		if (index->slots[i].hash == hash && index->slots[i].value == value)
+			break;
+	}
+	if (!index->slots[i].used)
+		return;
+	for (j = (i + 1) & mask; index->slots[j].used; j = (j + 1) & mask) {
+		/* a slot may fill the hole if its home isn't between the hole and itself */
+		home = index->slots[j].hash & mask;
+		if (i < j ? home <= i || home > j : home <= i && home > j) {
+			index->slots[i] = index->slots[j];
+			i = j;
+		}
+	}
+	index->slots[i].used = false;
+	index->nr--;
+}
+
+/* Find a value added under this hash for which match() succeeds */
+bool hash_index_find(const struct hash_index *index, uint32_t hash, hash_index_match_fn match,
+		     const void *key, const void *data, uintptr_t *value)
+{
+	unsigned int mask = index->size - 1;
+	unsigned int i;
+
+	if (!index->size)
+		return false;
+	for (i = hash & mask; index->slots[i].used; i = (i + 1) & mask) {
+		if (index->slots[i].hash == hash && match(index->slots[i].value, key, data)) {
+			*value = index->slots[i].value;
+			return true;
+		}
+	}
+	return false;
+}
+
+/* FNV-1a, NULL hashes like the empty string */
+uint32_t hash_string(const char *s)
+{
+	uint32_t hash = 2166136261u;
+
+	if (s) {
+		while (*s)
+			hash = (hash ^ (unsigned char)*s++) * 16777619u;
+	}
+	return hash;
+}
@@ -0,0 +1,51 @@
+// SPDX-License-Identifier: GPL-2.0
+#ifndef HASH_INDEX_H
+#define HASH_INDEX_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#else
+#include <stdbool.h>
+#endif
+
+/*
+ * A hash index maps keys to values that identify an item of one of our
+ * tables, for example a pointer or a uuid. The keys themselves are not
+ * stored, so every candidate is checked by the match function. The owner
+ * of the index adds and removes the items as its table changes, and may
+ * rebuild the index when a lookup comes up empty although the item exists.
+ */
+struct hash_index_slot {
+	uint32_t hash;
+	uintptr_t value;
+	bool used;
+};
+
+struct hash_index {
+	int size;	/* number of slots, a power of two or zero */
+	int nr;		/* number of used slots */
+	struct hash_index_slot *slots;
+};
+
+typedef bool (*hash_index_match_fn)(uintptr_t value, const void *key, const void *data);
+
+extern void hash_index_clear(struct hash_index *index);
+extern void hash_index_reset(struct hash_index *index, int nr);
+extern void hash_index_add(struct hash_index *index, uint32_t hash, uintptr_t value);
+extern void hash_index_remove(struct hash_index *index, uint32_t hash, uintptr_t value);
+extern bool hash_index_find(const struct hash_index *index, uint32_t hash, hash_index_match_fn match,
+			    const void *key, const void *data, uintptr_t *value);
+extern uint32_t hash_string(const char *s);
+
+static inline uint32_t hash_uint32(uint32_t v)
+{
+	return v * 2654435761u;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HASH_INDEX_H
@@ -7,6 +7,7 @@
 #include "videoframeextractor.h"
 #include "qt-models/divepicturemodel.h"
 #include "metadata.h"
+#include "thumbnailstore.h"
 #include <unistd.h>
 #include <QString>
 #include <QImageReader>
@@ -250,36 +251,27 @@ Thumbnailer::Thumbnail Thumbnailer::getVideoThumbnailFromStream(QDataStream &str
 	return { res, MEDIATYPE_VIDEO, (int32_t)duration };
 }
 
-// Fetch a thumbnail from cache.
+// Decode a thumbnail from the cache.
 // If Thumbnail::QImage is null, the thumbnail is scheduled for recreation.
-Thumbnailer::Thumbnail Thumbnailer::getThumbnailFromCache(const QString &picture_filename)
+Thumbnailer::Thumbnail Thumbnailer::thumbnailFromStore(const QString &picture_filename, const ThumbnailStore::Thumbnail &stored)
 {
-	QString filename = thumbnailFileName(picture_filename);
-	if (filename.isEmpty())
+	if (stored.data.isEmpty())
 		return { QImage(), MEDIATYPE_UNKNOWN, 0 };
-	QFile file(filename);
 
 	if (prefs.auto_recalculate_thumbnails) {
 		// Check if thumbnails is older than the (local) image file
 		QString filenameLocal = localFilePath(qPrintable(picture_filename));
-		QFileInfo pictureInfo(filenameLocal);
-		QFileInfo thumbnailInfo(file);
-		if (pictureInfo.exists() && thumbnailInfo.exists()) {
-			QDateTime pictureTime = pictureInfo.lastModified();
-			QDateTime thumbnailTime = thumbnailInfo.lastModified();
-			if (pictureTime.isValid() && thumbnailTime.isValid() && thumbnailTime < pictureTime) {
-				// Both files exist, have valid timestamps and thumbnail was calculated before picture.
-				// Return an empty thumbnail to signal recalculation of the thumbnail
-				return { QImage(), MEDIATYPE_UNKNOWN, 0 };
-			}
+		QDateTime pictureTime = QFileInfo(filenameLocal).lastModified();
+		if (pictureTime.isValid() && stored.created < pictureTime.toMSecsSinceEpoch()) {
+			// Picture exists, has a valid timestamp and thumbnail was calculated before picture.
+			// Return an empty thumbnail to signal recalculation of the thumbnail
+			return { QImage(), MEDIATYPE_UNKNOWN, 0 };
 		}
 	}
 
-	if (!file.open(QIODevice::ReadOnly))
-		return { QImage(), MEDIATYPE_UNKNOWN, 0 };
-	QDataStream stream(&file);
+	QDataStream stream(stored.data);
 
-	// Each thumbnail file is composed of a media-type and an image file.
+	// Each thumbnail is composed of a media-type and an image.
 	quint32 type;
 	QImage res;
 	stream >> type;
@@ -292,6 +284,12 @@ Thumbnailer::Thumbnail Thumbnailer::getThumbnailFromCache(const QString &picture
 	}
 }
 
+// Fetch a thumbnail from cache.
+Thumbnailer::Thumbnail Thumbnailer::getThumbnailFromCache(const QString &picture_filename)
+{
+	return thumbnailFromStore(picture_filename, ThumbnailStore::instance()->get(picture_filename));
+}
+
 Thumbnailer::Thumbnail Thumbnailer::addVideoThumbnailToCache(const QString &picture_filename, duration_t duration,
 							     const QImage &image, duration_t position)
 {
@@ -302,26 +300,23 @@ Thumbnailer::Thumbnail Thumbnailer::addVideoThumbnailToCache(const QString &pict
 	//	for each picture:
 	//		uint32	offset in msec from begining of video
 	//		QImage	frame
-	QString filename = thumbnailFileName(picture_filename);
-	QSaveFile file(filename);
-	if (file.open(QIODevice::WriteOnly)) {
-		QDataStream stream(&file);
-
-		stream << (quint32)MEDIATYPE_VIDEO;
-		stream << (quint32)duration.seconds;
+	QByteArray data;
+	QDataStream stream(&data, QIODevice::WriteOnly);
 
-		if (image.isNull()) {
-			// No image provided
-			stream << (quint32)0;
-		} else {
-			// Currently, we support at most one image
-			stream << (quint32)1;
-			stream << (quint32)position.seconds;
-			stream << image;
-		}
+	stream << (quint32)MEDIATYPE_VIDEO;
+	stream << (quint32)duration.seconds;
 
-		file.commit();
+	if (image.isNull()) {
+		// No image provided
+		stream << (quint32)0;
+	} else {
+		// Currently, we support at most one image
+		stream << (quint32)1;
+		stream << (quint32)position.seconds;
+		stream << image;
 	}
+
+	ThumbnailStore::instance()->put(picture_filename, data);
 	return { videoImage, MEDIATYPE_VIDEO, duration };
 }
 
@@ -344,26 +339,20 @@ Thumbnailer::Thumbnail Thumbnailer::addPictureThumbnailToCache(const QString &pi
 	// The format of a picture-thumbnail is very simple:
 	// 	uint32	MEDIATYPE_PICTURE
 	// 	QImage	thumbnail
-	QString filename = thumbnailFileName(picture_filename);
-	QSaveFile file(filename);
-	if (file.open(QIODevice::WriteOnly)) {
-		QDataStream stream(&file);
-
-		stream << (quint32)MEDIATYPE_PICTURE;
-		stream << thumbnail;
-		file.commit();
-	}
+	QByteArray data;
+	QDataStream stream(&data, QIODevice::WriteOnly);
+	stream << (quint32)MEDIATYPE_PICTURE;
+	stream << thumbnail;
+	ThumbnailStore::instance()->put(picture_filename, data);
 	return { thumbnail, MEDIATYPE_PICTURE, 0 };
 }
 
 Thumbnailer::Thumbnail Thumbnailer::addUnknownThumbnailToCache(const QString &picture_filename)
 {
-	QString filename = thumbnailFileName(picture_filename);
-	QSaveFile file(filename);
-	if (file.open(QIODevice::WriteOnly)) {
-		QDataStream stream(&file);
-		stream << (quint32)MEDIATYPE_UNKNOWN;
-	}
+	QByteArray data;
+	QDataStream stream(&data, QIODevice::WriteOnly);
+	stream << (quint32)MEDIATYPE_UNKNOWN;
+	ThumbnailStore::instance()->put(picture_filename, data);
 	return { unknownImage, MEDIATYPE_UNKNOWN, 0 };
 }
 
@@ -442,6 +431,28 @@ void Thumbnailer::processItem(QString filename, bool tryDownload)
 	workingOn.remove(filename);
 }
 
+// Process a batch of pictures, with a single lookup in the thumbnail cache.
+// Pictures that have to be thumbnailed are given their own job, so that they
+// can be cancelled individually and don't hold up the rest of the batch.
+void Thumbnailer::processItems(QVector<QString> filenames)
+{
+	QVector<ThumbnailStore::Thumbnail> stored = ThumbnailStore::instance()->get(filenames);
+	for (int i = 0; i < filenames.size(); ++i) {
+		const QString &filename = filenames[i];
+		Thumbnail thumbnail = thumbnailFromStore(filename, stored[i]);
+		QMutexLocker l(&lock);
+		// The work queue may have been cleared in the meantime
+		if (!workingOn.contains(filename))
+			continue;
+		if (thumbnail.img.isNull()) {
+			workingOn[filename] = QtConcurrent::run(&pool, [this, filename]() { processItem(filename, true); });
+			continue;
+		}
+		emit thumbnailChanged(filename, thumbnail.img, thumbnail.duration);
+		workingOn.remove(filename);
+	}
+}
+
 void Thumbnailer::imageDownloaded(QString filename)
 {
 	// Image was downloaded -> try thumbnailing again.
@@ -483,6 +494,24 @@ QImage Thumbnailer::fetchThumbnail(const QString &filename, bool synchronous)
 	return dummyImage;
 }
 
+QVector<QImage> Thumbnailer::fetchThumbnails(const QVector<QString> &filenames)
+{
+	QMutexLocker l(&lock);
+
+	// One job looks up all thumbnails we are not currently fetching, see processItems()
+	QVector<QString> todo;
+	for (const QString &filename: filenames) {
+		if (!workingOn.contains(filename) && !todo.contains(filename))
+			todo.append(filename);
+	}
+	if (!todo.isEmpty()) {
+		QFuture<void> future = QtConcurrent::run(&pool, [this, todo]() { processItems(todo); });
+		for (const QString &filename: todo)
+			workingOn.insert(filename, future);
+	}
+	return QVector<QImage>(filenames.size(), dummyImage);
+}
+
 void Thumbnailer::calculateThumbnails(const QVector<QString> &filenames)
 {
 	QMutexLocker l(&lock);
@@ -3,6 +3,7 @@
 #define IMAGEDOWNLOADER_H
 
 #include "metadata.h"
+#include "thumbnailstore.h"
 #include <QImage>
 #include <QFuture>
 #include <QNetworkReply>
@@ -39,6 +40,10 @@ public:
 	// images are not supported.
 	QImage fetchThumbnail(const QString &filename, bool synchronous);
 
+	// Schedule many thumbnails for fetching or calculation at once.
+	// Returns placeholder thumbnails, like fetchThumbnail() in asynchronous mode.
+	QVector<QImage> fetchThumbnails(const QVector<QString> &filenames);
+
 	// Schedule multiple thumbnails for forced recalculation
 	void calculateThumbnails(const QVector<QString> &filenames);
 
@@ -70,7 +75,9 @@ private:
 	Thumbnail addUnknownThumbnailToCache(const QString &picture_filename);
 	void recalculate(QString filename);
 	void processItem(QString filename, bool tryDownload);
+	void processItems(QVector<QString> filenames);
 	Thumbnail getThumbnailFromCache(const QString &picture_filename);
+	Thumbnail thumbnailFromStore(const QString &picture_filename, const ThumbnailStore::Thumbnail &stored);
 	Thumbnail getPictureThumbnailFromStream(QDataStream &stream);
 	Thumbnail getVideoThumbnailFromStream(QDataStream &stream, const QString &filename);
 	Thumbnail fetchImage(const QString &filename, const QString &originalFilename, bool tryDownload);
@@ -99,16 +99,13 @@ static int cobalt_dive(void *param, int columns, char **data, char **column)
 
 	int retval = 0;
 	struct parser_state *state = (struct parser_state *)param;
-	sqlite3 *handle = state->sql_handle;
-	char *err = NULL;
 	char *location, *location_site;
-	char get_profile_template[] = "select runtime*60,(DepthPressure*10000/SurfacePressure)-10000,p.Temperature from Dive AS d JOIN TrackPoints AS p ON d.Id=p.DiveId where d.Id=%d";
-	char get_cylinder_template[] = "select FO2,FHe,StartingPressure,EndingPressure,TankSize,TankPressure,TotalConsumption from GasMixes where DiveID=%d and StartingPressure>0 and EndingPressure > 0 group by FO2,FHe";
-	char get_buddy_template[] = "select l.Data from Items AS i, List AS l ON i.Value1=l.Id where i.DiveId=%d and l.Type=4";
-	char get_visibility_template[] = "select l.Data from Items AS i, List AS l ON i.Value1=l.Id where i.DiveId=%d and l.Type=3";
-	char get_location_template[] = "select l.Data from Items AS i, List AS l ON i.Value1=l.Id where i.DiveId=%d and l.Type=0";
-	char get_site_template[] = "select l.Data from Items AS i, List AS l ON i.Value1=l.Id where i.DiveId=%d and l.Type=1";
-	char get_buffer[1024];
+	char get_profile_template[] = "select runtime*60,(DepthPressure*10000/SurfacePressure)-10000,p.Temperature from Dive AS d JOIN TrackPoints AS p ON d.Id=p.DiveId where d.Id=?";
+	char get_cylinder_template[] = "select FO2,FHe,StartingPressure,EndingPressure,TankSize,TankPressure,TotalConsumption from GasMixes where DiveID=? and StartingPressure>0 and EndingPressure > 0 group by FO2,FHe";
+	char get_buddy_template[] = "select l.Data from Items AS i, List AS l ON i.Value1=l.Id where i.DiveId=? and l.Type=4";
+	char get_visibility_template[] = "select l.Data from Items AS i, List AS l ON i.Value1=l.Id where i.DiveId=? and l.Type=3";
+	char get_location_template[] = "select l.Data from Items AS i, List AS l ON i.Value1=l.Id where i.DiveId=? and l.Type=0";
+	char get_site_template[] = "select l.Data from Items AS i, List AS l ON i.Value1=l.Id where i.DiveId=? and l.Type=1";
 
 	dive_start(state);
 	state->cur_dive->number = atoi(data[0]);
@@ -154,36 +151,31 @@ static int cobalt_dive(void *param, int columns, char **data, char **column)
 		state->cur_dive->dc.model = strdup("Cobalt import");
 	}
 
-	snprintf(get_buffer, sizeof(get_buffer) - 1, get_cylinder_template, state->cur_dive->number);
-	retval = sqlite3_exec(handle, get_buffer, &cobalt_cylinders, state, &err);
+	retval = sql_exec_id(state, get_cylinder_template, state->cur_dive->number, &cobalt_cylinders, state);
 	if (retval != SQLITE_OK) {
 		fprintf(stderr, "%s", "Database query cobalt_cylinders failed.\n");
 		return 1;
 	}
 
-	snprintf(get_buffer, sizeof(get_buffer) - 1, get_buddy_template, state->cur_dive->number);
-	retval = sqlite3_exec(handle, get_buffer, &cobalt_buddies, state, &err);
+	retval = sql_exec_id(state, get_buddy_template, state->cur_dive->number, &cobalt_buddies, state);
 	if (retval != SQLITE_OK) {
 		fprintf(stderr, "%s", "Database query cobalt_buddies failed.\n");
 		return 1;
 	}
 
-	snprintf(get_buffer, sizeof(get_buffer) - 1, get_visibility_template, state->cur_dive->number);
-	retval = sqlite3_exec(handle, get_buffer, &cobalt_visibility, state, &err);
+	retval = sql_exec_id(state, get_visibility_template, state->cur_dive->number, &cobalt_visibility, state);
 	if (retval != SQLITE_OK) {
 		fprintf(stderr, "%s", "Database query cobalt_visibility failed.\n");
 		return 1;
 	}
 
-	snprintf(get_buffer, sizeof(get_buffer) - 1, get_location_template, state->cur_dive->number);
-	retval = sqlite3_exec(handle, get_buffer, &cobalt_location, &location, &err);
+	retval = sql_exec_id(state, get_location_template, state->cur_dive->number, &cobalt_location, &location);
 	if (retval != SQLITE_OK) {
 		fprintf(stderr, "%s", "Database query cobalt_location failed.\n");
 		return 1;
 	}
 
-	snprintf(get_buffer, sizeof(get_buffer) - 1, get_site_template, state->cur_dive->number);
-	retval = sqlite3_exec(handle, get_buffer, &cobalt_location, &location_site, &err);
+	retval = sql_exec_id(state, get_site_template, state->cur_dive->number, &cobalt_location, &location_site);
 	if (retval != SQLITE_OK) {
 		fprintf(stderr, "%s", "Database query cobalt_location (site) failed.\n");
 		return 1;
@@ -203,8 +195,7 @@ static int cobalt_dive(void *param, int columns, char **data, char **column)
 	free(location);
 	free(location_site);
 
-	snprintf(get_buffer, sizeof(get_buffer) - 1, get_profile_template, state->cur_dive->number);
-	retval = sqlite3_exec(handle, get_buffer, &cobalt_profile_sample, state, &err);
+	retval = sql_exec_id(state, get_profile_template, state->cur_dive->number, &cobalt_profile_sample, state);
 	if (retval != SQLITE_OK) {
 		fprintf(stderr, "%s", "Database query cobalt_profile_sample failed.\n");
 		return 1;
@@ -1,17 +1,21 @@
 #include <unistd.h>
 #include <errno.h>
+#include <math.h>
+#include <ctype.h>
 #include <libdivecomputer/parser.h>
 
 #include "dive.h"
 #include "ssrf.h"
 #include "subsurface-string.h"
 #include "divelist.h"
+#include "device.h"
 #include "file.h"
 #include "parse.h"
 #include "divelist.h"
 #include "gettext.h"
 #include "import-csv.h"
 #include "qthelper.h"
+#include "membuffer.h"
 
 #define MATCH(buffer, pattern) \
 	memcmp(buffer, pattern, strlen(pattern))
@@ -101,6 +105,897 @@ static char *parse_dan_new_line(char *buf, const char *NL)
 	return iter;
 }
 
+/*
+ * Native import of the sample CSV files that csv2xml.xslt handles.
+ *
+ * Wrapping the file into XML, building a DOM of it, transforming that
+ * into a second DOM and walking it is slow, and needs several copies
+ * of a big per-second export in memory. Instead the file is read in a
+ * single pass, and the samples are filled in directly with the column
+ * mapping of the import dialog. The conversions follow the stylesheet
+ * and the XML parser, quirks included, so both give the same dives.
+ * Parameters that only XPath could evaluate make the caller fall back
+ * to the stylesheet.
+ */
+enum csv_native_result {
+	CSV_NATIVE_DONE,
+	CSV_NATIVE_UNSUPPORTED
+};
+
+enum csv_param {
+	CP_DATE_FIELD, CP_DATE_FORMAT, CP_STARTTIME_FIELD, CP_TIME_FIELD, CP_DEPTH_FIELD,
+	CP_TEMP_FIELD, CP_PO2_FIELD, CP_SENSOR1_FIELD, CP_SENSOR2_FIELD, CP_SENSOR3_FIELD,
+	CP_CNS_FIELD, CP_NDL_FIELD, CP_TTS_FIELD, CP_STOPDEPTH_FIELD, CP_PRESSURE_FIELD,
+	CP_SETPOINT_FIELD, CP_NUMBER_FIELD, CP_DATE, CP_TIME, CP_UNITS, CP_SEPARATOR, CP_DELTA,
+	CP_HW, CP_DIVENRO, CP_DIVEMODE, CP_FIRMWARE, CP_SERIAL, CP_GF,
+	CP_MAXDEPTH, CP_MEANDEPTH, CP_AIRTEMP, CP_WATERTEMP,
+	CP_COUNT
+};
+
+static const char *csv_param_names[CP_COUNT] = {
+	"dateField", "datefmt", "starttimeField", "timeField", "depthField",
+	"tempField", "po2Field", "o2sensor1Field", "o2sensor2Field", "o2sensor3Field",
+	"cnsField", "ndlField", "ttsField", "stopdepthField", "pressureField",
+	"setpointField", "numberField", "date", "time", "units", "separatorIndex", "delta",
+	"hw", "diveNro", "diveMode", "Firmware", "Serial", "GF",
+	"maxDepth", "meanDepth", "airTemp", "waterTemp"
+};
+
+/* A missing parameter is an empty node-set, which behaves like NaN and '' */
+struct csv_param_value {
+	double number;
+	char *string;
+};
+
+struct csv_import {
+	struct csv_param_value param[CP_COUNT];
+	char fs;
+	bool metric;
+	double delta;
+	struct membuffer field, next;
+	struct parser_state state;
+};
+
+/* number() of XPath: a decimal number with an optional minus, no exponent */
+static double xpath_number(const char *s, const char *e, bool comma)
+{
+	double val = 0.0, decimal = 1.0;
+	bool sign = false, dot = false, digits = false;
+
+	while (s < e && isspace(*s))
+		s++;
+	while (e > s && isspace(e[-1]))
+		e--;
+	if (s < e && *s == '-') {
+		sign = true;
+		s++;
+	}
+	for (; s < e; s++) {
+		if ((*s == '.' || (comma && *s == ',')) && !dot) {
+			dot = true;
+		} else if (*s >= '0' && *s <= '9') {
+			digits = true;
+			val = val * 10 + (*s - '0');
+			if (dot)
+				decimal *= 10;
+		} else {
+			return NAN;
+		}
+	}
+	if (!digits)
+		return NAN;
+	return (sign ? -val : val) / decimal;
+}
+
+static double xpath_cnumber(const char *s)
+{
+	return xpath_number(s, s + strlen(s), false);
+}
+
+/* string() of an XPath number */
+static void xpath_string(char *buf, size_t size, double val)
+{
+	if (isnan(val))
+		snprintf(buf, size, "NaN");
+	else if (val == floor(val) && fabs(val) < 1e15)
+		snprintf(buf, size, "%.0f", val + 0.0);
+	else
+		snprintf(buf, size, "%.15g", val);
+}
+
+/* The rounding of format-number() */
+static double xpath_round(double val, double scale)
+{
+	return floor(val * scale + 0.5) / scale;
+}
+
+static bool csv_set_params(struct csv_import *imp, char **params)
+{
+	int i, j;
+
+	for (j = 0; j < CP_COUNT; j++)
+		imp->param[j].number = NAN;
+	for (i = 0; params[i]; i += 2) {
+		const char *value = params[i + 1];
+		size_t len = strlen(value);
+		struct csv_param_value *p;
+
+		for (j = 0; j < CP_COUNT && strcmp(params[i], csv_param_names[j]); j++)
+			;
+		if (j == CP_COUNT)
+			continue;	/* not used by the stylesheet */
+		p = &imp->param[j];
+		free(p->string);
+		if (len >= 2 && (*value == '"' || *value == '\'') && value[len - 1] == *value &&
+		    !memchr(value + 1, *value, len - 2)) {
+			/* a string literal */
+			p->string = malloc(len - 1);
+			if (!p->string)
+				exit(1);
+			memcpy(p->string, value + 1, len - 2);
+			p->string[len - 2] = 0;
+			p->number = xpath_cnumber(p->string);
+		} else {
+			char buf[64];
+
+			p->number = xpath_number(value, value + len, false);
+			if (isnan(p->number)) {
+				p->string = NULL;
+				return false;
+			}
+			xpath_string(buf, sizeof(buf), p->number);
+			p->string = strdup(buf);
+		}
+	}
+	for (j = 0; j < CP_COUNT; j++) {
+		if (!imp->param[j].string)
+			imp->param[j].string = strdup("");
+	}
+	return true;
+}
+
+static int csv_index(const struct csv_import *imp, enum csv_param param)
+{
+	/* getFieldByIndex recurses while the index is positive */
+	double index = imp->param[param].number;
+
+	return index > 0 ? (int)ceil(index) : 0;
+}
+
+static bool csv_has_field(const struct csv_import *imp, enum csv_param param)
+{
+	return imp->param[param].number >= 0;
+}
+
+/* unquote of commonTemplates.xsl, which drops the quotes of every pair */
+static void csv_unquote(struct membuffer *b, const char *s, const char *e)
+{
+	bool first = true;
+
+	for (;;) {
+		const char *q = memchr(s, '"', e - s);
+
+		if (!first)
+			put_bytes(b, "\"", 1);
+		if (!q || q == s) {
+			put_bytes(b, s, e - s);
+			return;
+		}
+		put_bytes(b, s, q - s);
+		q = memchr(q + 1, '"', e - q - 1);
+		s = q ? q + 1 : e;
+		first = false;
+	}
+}
+
+/*
+ * getFieldByIndex of commonTemplates.xsl. The text is split at every
+ * separator, even within quotes, and a quoted field runs up to the next
+ * quote followed by a separator. The fields of the dive itself are taken
+ * from the rest of the file from the third line on, which is what the
+ * stylesheet does. That text ends with a newline.
+ */
+static char *csv_field(struct membuffer *b, char fs, const char *s, const char *e, int index, bool rest)
+{
+	const char *p;
+
+	b->len = 0;
+	while (index-- > 0) {
+		p = s < e ? memchr(s, fs, e - s) : NULL;
+		if (!p) {
+			s = e;
+			rest = false;
+			break;
+		}
+		s = p + 1;
+	}
+	if (s < e && *s == '"') {
+		const char *a = s + 1, *end_quote = a;
+
+		for (p = a; (p = memchr(p, '"', e - p)) != NULL; p++) {
+			if (p + 1 < e && p[1] == fs) {
+				end_quote = p;
+				break;
+			}
+		}
+		p = memchr(a, '"', end_quote - a);
+		if (p && p > a) {
+			csv_unquote(b, a, end_quote);
+		} else if (!rest && e[-1] == '"') {
+			p = memchr(a, '"', e - a);
+			put_bytes(b, a, p ? p - a : 0);
+		} else {
+			put_bytes(b, a, end_quote - a);
+		}
+	} else {
+		p = s < e ? memchr(s, fs, e - s) : NULL;
+		if (!p) {
+			put_bytes(b, s, e - s);
+			if (rest)
+				put_bytes(b, "\n", 1);
+		} else if (p > s) {
+			put_bytes(b, s, p - s);
+		}
+	}
+	mb_cstring(b);
+	return b->buffer;
+}
+
+/* The lines of a file, read in chunks, or of a buffer in memory */
+struct csv_reader {
+	FILE *f;
+	const char *buffer;
+	size_t pos, len;
+	char chunk[16384];
+};
+
+static void csv_reader_buffer(struct csv_reader *r, const char *buffer, size_t size)
+{
+	r->f = NULL;
+	r->buffer = buffer ? buffer : "";
+	r->pos = 0;
+	r->len = size;
+}
+
+static void csv_reader_file(struct csv_reader *r, FILE *f)
+{
+	r->f = f;
+	r->buffer = r->chunk;
+	r->pos = r->len = 0;
+}
+
+static bool csv_fill(struct csv_reader *r)
+{
+	if (!r->f)
+		return false;
+	r->pos = 0;
+	r->len = fread(r->chunk, 1, sizeof(r->chunk), r->f);
+	return r->len > 0;
+}
+
+/*
+ * Read the next line, with its line end, into b. The XML parser sees
+ * "\r\n" and "\r" as "\n". Returns the length of the line end, which is
+ * 0 for the text after the last one: that is a line of its own.
+ */
+static int csv_read_line(struct csv_reader *r, struct membuffer *b)
+{
+	const char *s, *e, *p;
+
+	b->len = 0;
+	for (;;) {
+		s = r->buffer + r->pos;
+		e = r->buffer + r->len;
+		for (p = s; p < e && *p != '\n' && *p != '\r'; p++)
+			;
+		put_bytes(b, s, p - s);
+		r->pos = p - r->buffer;
+		if (p < e)
+			break;
+		if (!csv_fill(r))
+			return 0;
+	}
+	put_bytes(b, p, 1);
+	r->pos++;
+	if (*p == '\r' && (r->pos < r->len || csv_fill(r)) && r->buffer[r->pos] == '\n') {
+		put_bytes(b, "\n", 1);
+		r->pos++;
+		return 2;
+	}
+	return 1;
+}
+
+/* parse_float() of parse-xml.c */
+static bool csv_float(const char *buffer, double *res)
+{
+	const char *end;
+	double val;
+
+	errno = 0;
+	val = ascii_strtod(buffer, &end);
+	if (errno || end == buffer)
+		return false;
+	if (*end == ',' && IS_FP_SAME(val, rint(val)))
+		val = strtod_flags(buffer, &end, 0);
+	*res = val;
+	return true;
+}
+
+/* The number in translate(translate($v, translate($v, '0123456789,.', ''), ''), ',', '.') */
+static double csv_digits(const char *s)
+{
+	double val = 0.0, decimal = 1.0;
+	bool dot = false, digits = false;
+
+	for (; *s; s++) {
+		if (*s == '.' || *s == ',') {
+			if (dot)
+				return NAN;
+			dot = true;
+		} else if (*s >= '0' && *s <= '9') {
+			digits = true;
+			val = val * 10 + (*s - '0');
+			if (dot)
+				decimal *= 10;
+		}
+	}
+	return digits ? val / decimal : NAN;
+}
+
+static void csv_comma_to_dot(char *s)
+{
+	while ((s = strchr(s, ',')) != NULL)
+		*s = '.';
+}
+
+/* sampletime() of parse-xml.c */
+static void csv_sampletime(const char *buffer, duration_t *time)
+{
+	int hr, min, sec;
+
+	switch (sscanf(buffer, "%d:%d:%d", &hr, &min, &sec)) {
+	case 1:
+		min = hr;
+		hr = 0;
+	/* fallthrough */
+	case 2:
+		sec = min;
+		min = hr;
+		hr = 0;
+	/* fallthrough */
+	case 3:
+		time->seconds = (hr * 60 + min) * 60 + sec;
+		break;
+	}
+}
+
+/* sec2time of commonTemplates.xsl */
+static void csv_sec2time(double seconds, duration_t *time)
+{
+	if (!isnan(seconds))
+		time->seconds = (int)floor(seconds / 60) * 60 + (int)xpath_round(fmod(seconds, 60), 1);
+}
+
+static void csv_depth(const struct csv_import *imp, char *value, depth_t *depth)
+{
+	double val;
+
+	if (imp->metric) {
+		csv_comma_to_dot(value);
+		if (csv_float(value, &val))
+			depth->mm = lrint(val * 1000);
+	} else {
+		val = xpath_round(csv_digits(value) * 0.3048, 1000);
+		if (!isnan(val))
+			depth->mm = lrint(val * 1000);
+	}
+}
+
+static void csv_temperature(const struct csv_import *imp, char *value, temperature_t *temperature)
+{
+	double val;
+
+	if (imp->metric) {
+		csv_comma_to_dot(value);
+		if (csv_float(value, &val))
+			temperature->mkelvin = C_to_mkelvin(val);
+	} else {
+		val = xpath_round((csv_digits(value) - 32) * 5 / 9, 10);
+		if (!isnan(val))
+			temperature->mkelvin = C_to_mkelvin(val);
+	}
+	/* temperatures outside -40C .. +70C should be ignored */
+	if (temperature->mkelvin < ZERO_C_IN_MKELVIN - 40000 ||
+	    temperature->mkelvin > ZERO_C_IN_MKELVIN + 70000)
+		temperature->mkelvin = 0;
+}
+
+static void csv_pressure(const struct csv_import *imp, const char *value, pressure_t *pressure)
+{
+	double mbar = xpath_cnumber(value);
+
+	if (!(mbar >= 0))
+		return;
+	if (!imp->metric)
+		mbar = xpath_round(mbar / 14.5037738007, 1);
+	/* Just ignore zero values, and small values are bar */
+	if (!mbar)
+		return;
+	if (mbar < 5000)
+		mbar *= 1000;
+	if (mbar > 5 && mbar < 5000000)
+		pressure->mbar = lrint(mbar);
+}
+
+static void csv_stopdepth(const struct csv_import *imp, const char *value, struct sample *sample)
+{
+	double val = xpath_cnumber(value);
+
+	if (imp->metric) {
+		double mm;
+
+		if (csv_float(value, &mm))
+			sample->stopdepth.mm = lrint(mm * 1000);
+	} else if (!isnan(val)) {
+		sample->stopdepth.mm = lrint(xpath_round(val * 0.3048, 100) * 1000);
+	}
+	sample->in_deco = val > 0;
+}
+
+/* The XML parser never sees blank attributes, the sample keeps the copied value */
+static bool csv_blank(const char *value)
+{
+	return !value[strspn(value, " \t\r\n")];
+}
+
+static void csv_o2pressure(const char *value, o2pressure_t *pressure)
+{
+	if (!csv_blank(value))
+		pressure->mbar = lrint(ascii_strtod(value, NULL) * 1000.0);
+}
+
+static char *csv_column(struct csv_import *imp, const char *s, const char *e, enum csv_param param)
+{
+	return csv_field(&imp->field, imp->fs, s, e, csv_index(imp, param), false);
+}
+
+static char *csv_copy(struct csv_import *imp, const char *s)
+{
+	imp->field.len = 0;
+	put_string(&imp->field, s);
+	mb_cstring(&imp->field);
+	return imp->field.buffer;
+}
+
+/* The time of a sample, or false if the line isn't one */
+static bool csv_sample_time(struct csv_import *imp, const char *s, const char *e, int lineno, duration_t *time)
+{
+	const char *value, *end, *dot, *comma, *colon, *colon2;
+	char buf[80], minutes[64];
+	double t;
+
+	if (imp->delta > 0) {
+		csv_sec2time(lineno * imp->delta, time);
+		return true;
+	}
+	value = csv_column(imp, s, e, CP_TIME_FIELD);
+	end = value + strlen(value);
+	if (!isnan(xpath_number(value, end, true))) {
+		/* seconds, or minutes with a fraction */
+		dot = strchr(value, '.');
+		comma = strchr(value, ',');
+		if (dot && dot[1] && !strstr(imp->param[CP_HW].string, "APD"))
+			t = xpath_number(value, dot, false) * 60 + xpath_number(dot, end, false) * 60;
+		else if (comma && comma[1])
+			t = xpath_number(value, comma, false) * 60 + xpath_number(comma, end, true) * 60;
+		else
+			t = xpath_number(value, end, false);
+		csv_sec2time(t, time);
+		return true;
+	}
+	colon = strchr(value, ':');
+	if (!colon || isnan(xpath_number(value, colon, false)))
+		return false;
+	colon2 = strchr(colon + 1, ':');
+	if (!colon2 || !colon2[1]) {
+		/* m:s */
+		xpath_string(buf, sizeof(buf), xpath_number(value, colon, false) * 60 + xpath_number(colon + 1, end, false));
+	} else {
+		/* h:m:s */
+		xpath_string(minutes, sizeof(minutes), xpath_number(value, colon, false) * 60 + xpath_number(colon + 1, colon2, false));
+		snprintf(buf, sizeof(buf), "%s:%s", minutes, colon2 + 1);
+	}
+	csv_sampletime(buf, time);
+	return true;
+}
+
+static void csv_sample(struct csv_import *imp, const char *s, const char *e, int lineno)
+{
+	static const enum csv_param sensor_fields[] = { CP_SENSOR1_FIELD, CP_SENSOR2_FIELD, CP_SENSOR3_FIELD };
+	struct divecomputer *dc = get_dc(&imp->state);
+	struct sample *sample;
+	duration_t time = { 0 };
+	char *value;
+	int i;
+
+	/* samples start as a copy of the previous one */
+	if (dc->samples)
+		time = dc->sample[dc->samples - 1].time;
+	if (!csv_sample_time(imp, s, e, lineno, &time))
+		return;
+	sample_start(&imp->state);
+	sample = imp->state.cur_sample;
+	sample->time = time;
+
+	csv_depth(imp, csv_column(imp, s, e, CP_DEPTH_FIELD), &sample->depth);
+	if (csv_has_field(imp, CP_TEMP_FIELD)) {
+		value = csv_column(imp, s, e, CP_TEMP_FIELD);
+		if (*value)
+			csv_temperature(imp, value, &sample->temperature);
+	}
+	if (csv_has_field(imp, CP_SETPOINT_FIELD))
+		csv_o2pressure(csv_column(imp, s, e, CP_SETPOINT_FIELD), &sample->setpoint);
+	else if (csv_has_field(imp, CP_PO2_FIELD))
+		csv_o2pressure(csv_column(imp, s, e, CP_PO2_FIELD), &sample->setpoint);
+	for (i = 0; i < 3; i++) {
+		if (csv_has_field(imp, sensor_fields[i]))
+			csv_o2pressure(csv_column(imp, s, e, sensor_fields[i]), &sample->o2sensor[i]);
+	}
+	if (csv_has_field(imp, CP_CNS_FIELD)) {
+		value = csv_column(imp, s, e, CP_CNS_FIELD);
+		if (!csv_blank(value))
+			sample->cns = atoi(value);
+	}
+	if (csv_has_field(imp, CP_NDL_FIELD))
+		csv_sampletime(csv_column(imp, s, e, CP_NDL_FIELD), &sample->ndl);
+	if (csv_has_field(imp, CP_TTS_FIELD))
+		csv_sampletime(csv_column(imp, s, e, CP_TTS_FIELD), &sample->tts);
+	if (csv_has_field(imp, CP_STOPDEPTH_FIELD))
+		csv_stopdepth(imp, csv_column(imp, s, e, CP_STOPDEPTH_FIELD), sample);
+	if (csv_has_field(imp, CP_PRESSURE_FIELD))
+		csv_pressure(imp, csv_column(imp, s, e, CP_PRESSURE_FIELD), &sample->pressure[0]);
+	sample_end(&imp->state);
+}
+
+/* divedate() of parse-xml.c */
+static void csv_divedate(struct parser_state *state, const char *buffer, timestamp_t *when)
+{
+	int d, m, y;
+	int hh = 0, mm = 0, ss = 0;
+
+	if (sscanf(buffer, "%d.%d.%d %d:%d:%d", &d, &m, &y, &hh, &mm, &ss) >= 3) {
+		/* This is ok, and we got at least the date */
+	} else if (sscanf(buffer, "%d-%d-%d %d:%d:%d", &y, &m, &d, &hh, &mm, &ss) >= 3) {
+		/* This is also ok */
+	} else {
+		fprintf(stderr, "Unable to parse date '%s'\n", buffer);
+		return;
+	}
+	state->cur_tm.tm_year = y;
+	state->cur_tm.tm_mon = m - 1;
+	state->cur_tm.tm_mday = d;
+	state->cur_tm.tm_hour = hh;
+	state->cur_tm.tm_min = mm;
+	state->cur_tm.tm_sec = ss;
+	*when = utc_mktime(&state->cur_tm);
+}
+
+/* divetime() of parse-xml.c */
+static void csv_divetime(struct parser_state *state, const char *buffer, timestamp_t *when)
+{
+	int h, m, s = 0;
+
+	if (sscanf(buffer, "%d:%d:%d", &h, &m, &s) >= 2) {
+		state->cur_tm.tm_hour = h;
+		state->cur_tm.tm_min = m;
+		state->cur_tm.tm_sec = s;
+		*when = utc_mktime(&state->cur_tm);
+	}
+}
+
+/* substring($s, start) of XPath */
+static const char *xpath_substring(const char *s, int start)
+{
+	size_t len = strlen(s);
+
+	return s + (start - 1 < (int)len ? start - 1 : (int)len);
+}
+
+/* The date of the dive as the stylesheet reorders it to yyyy-mm-dd, without spaces */
+static void csv_date(struct membuffer *b, const char *date, double format)
+{
+	const char *sep = NULL, *parts[3][2];
+	int i, order[3];
+
+	for (i = 0; i < 3 && (!sep || sep == date); i++)
+		sep = strchr(date, ".-/"[i]);
+	if (sep && sep > date) {
+		const char *sep2 = strchr(sep + 1, *sep);
+
+		parts[0][0] = date;
+		parts[0][1] = sep;
+		parts[1][0] = sep + 1;
+		parts[1][1] = sep2 ? sep2 : sep + 1;
+		parts[2][0] = sep2 ? sep2 + 1 : "";
+	} else {
+		/* substring-before() of an empty string is empty, substring-after() is everything */
+		parts[0][0] = parts[0][1] = parts[1][0] = parts[1][1] = "";
+		parts[2][0] = date;
+	}
+	parts[2][1] = parts[2][0] + strlen(parts[2][0]);
+
+	if (format == 0) {
+		/* dd.mm.yyyy */
+		order[0] = 2; order[1] = 1; order[2] = 0;
+	} else if (format == 1) {
+		/* mm.dd.yyyy */
+		order[0] = 2; order[1] = 0; order[2] = 1;
+	} else if (format == 2) {
+		/* yyyy.mm.dd */
+		order[0] = 0; order[1] = 1; order[2] = 2;
+	} else {
+		put_string(b, "1900-1-1");
+		return;
+	}
+	for (i = 0; i < 3; i++) {
+		const char *p;
+
+		if (i)
+			put_bytes(b, "-", 1);
+		for (p = parts[order[i]][0]; p < parts[order[i]][1]; p++) {
+			if (*p != ' ')
+				put_bytes(b, p, 1);
+		}
+	}
+}
+
+static void csv_dive(struct csv_import *imp, const char *rest, const char *end, bool have_rest)
+{
+	struct parser_state *state = &imp->state;
+	struct dive *dive = state->cur_dive;
+	struct membuffer date = { 0 };
+	const char *value;
+	char buf[32];
+
+	if (csv_has_field(imp, CP_DATE_FIELD)) {
+		csv_date(&date, csv_field(&imp->field, imp->fs, rest, end, csv_index(imp, CP_DATE_FIELD), have_rest),
+			 imp->param[CP_DATE_FORMAT].number);
+	} else {
+		value = imp->param[CP_DATE].string;
+		put_format(&date, "%.4s-%.2s-%.2s", value, xpath_substring(value, 5), xpath_substring(value, 7));
+	}
+	csv_divedate(state, mb_cstring(&date), &dive->when);
+	free_buffer(&date);
+
+	if (csv_has_field(imp, CP_STARTTIME_FIELD)) {
+		value = csv_field(&imp->field, imp->fs, rest, end, csv_index(imp, CP_STARTTIME_FIELD), have_rest);
+	} else {
+		value = imp->param[CP_TIME].string;
+		snprintf(buf, sizeof(buf), "%.2s:%.2s", xpath_substring(value, 2), xpath_substring(value, 4));
+		value = buf;
+	}
+	csv_divetime(state, value, &dive->when);
+
+	if (csv_has_field(imp, CP_NUMBER_FIELD))
+		dive->number = atoi(csv_field(&imp->field, imp->fs, rest, end, csv_index(imp, CP_NUMBER_FIELD), have_rest));
+	if (*imp->param[CP_DIVENRO].string)
+		dive->number = atoi(imp->param[CP_DIVENRO].string);
+}
+
+/* utf8_string() of parse.c */
+static char *csv_trimmed(const char *s)
+{
+	char *res = strdup(s);
+
+	if (!trimspace(res)) {
+		free(res);
+		return NULL;
+	}
+	return res;
+}
+
+static void csv_extra_data(struct divecomputer *dc, const char *key, const char *value)
+{
+	char *trimmed;
+
+	if (!*value)
+		return;
+	trimmed = csv_trimmed(value);
+	if (trimmed)
+		add_extra_data(dc, key, trimmed);
+	free(trimmed);
+}
+
+static void csv_divecomputer(struct csv_import *imp, int o2sensors, bool ccr)
+{
+	struct divecomputer *dc = get_dc(&imp->state);
+	const char *hw = imp->param[CP_HW].string;
+	const char *mode = imp->param[CP_DIVEMODE].string;
+
+	set_dc_deviceid(dc, 0xffffffff);
+	dc->model = csv_trimmed(*hw ? hw : "Imported from CSV");
+	if (ccr) {
+		dc->divemode = CCR;
+		dc->no_o2sensors = o2sensors;
+	}
+	/* Seabear dive modes, OC ends up as an empty dctype which changes nothing */
+	if (!strcmp(mode, "APNEA"))
+		dc->divemode = FREEDIVE;
+	else if (!strcmp(mode, "CCR") || !strcmp(mode, "CCR SENSORBOARD"))
+		dc->divemode = CCR;
+	else if (!strcmp(mode, "OC"))
+		dc->divemode = OC;
+
+	csv_extra_data(dc, "Firmware version", imp->param[CP_FIRMWARE].string);
+	csv_extra_data(dc, "Serial number", imp->param[CP_SERIAL].string);
+	csv_extra_data(dc, "Gradient factors", imp->param[CP_GF].string);
+	if (*imp->param[CP_MAXDEPTH].string)
+		csv_depth(imp, csv_copy(imp, imp->param[CP_MAXDEPTH].string), &dc->maxdepth);
+	if (*imp->param[CP_MEANDEPTH].string)
+		csv_depth(imp, csv_copy(imp, imp->param[CP_MEANDEPTH].string), &dc->meandepth);
+	if (*imp->param[CP_AIRTEMP].string)
+		csv_temperature(imp, csv_copy(imp, imp->param[CP_AIRTEMP].string), &dc->airtemp);
+	if (*imp->param[CP_WATERTEMP].string)
+		csv_temperature(imp, csv_copy(imp, imp->param[CP_WATERTEMP].string), &dc->watertemp);
+}
+
+/* Rebreather dives get an oxygen and a diluent cylinder */
+static void csv_ccr_cylinders(struct parser_state *state)
+{
+	cylinder_t *cyl = state->cur_dive->cylinder;
+
+	cyl[0].type.description = strdup("oxygen");
+	cyl[0].gasmix.o2.permille = 1000;
+	cyl[0].cylinder_use = OXYGEN;
+	cyl[1].type.description = strdup("diluent");
+	cyl[1].gasmix.o2.permille = 210;
+	cyl[1].cylinder_use = DILUENT;
+	state->o2pressure_sensor = 0;
+	state->cur_cylinder_index = 2;
+}
+
+/* printLine: identical lines, and lines with the same time when it comes from the interval, are skipped */
+static bool csv_skip_line(struct csv_import *imp, const char *s, const char *e, const char *next, const char *next_end)
+{
+	int index;
+
+	if (e - s == next_end - next && !memcmp(s, next, e - s))
+		return true;
+	if (!(imp->delta > 0))
+		return false;
+	index = csv_index(imp, CP_TIME_FIELD);
+	csv_field(&imp->field, imp->fs, s, e, index, false);
+	csv_field(&imp->next, imp->fs, next, next_end, index, false);
+	return imp->field.len == imp->next.len && !memcmp(imp->field.buffer, imp->next.buffer, imp->field.len);
+}
+
+/*
+ * Whether the text from the third line on is long enough for csv_field
+ * to find the fields of the dive, so that more of it changes nothing.
+ * A field without a separator after it runs to the end of the text.
+ */
+static bool csv_header_complete(const struct csv_import *imp, const char *s, const char *e)
+{
+	static const enum csv_param fields[] = { CP_DATE_FIELD, CP_STARTTIME_FIELD, CP_NUMBER_FIELD };
+	const char *p;
+	unsigned int i;
+	int index;
+
+	for (i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+		if (!csv_has_field(imp, fields[i]))
+			continue;
+		p = s;
+		for (index = csv_index(imp, fields[i]); index > 0; index--) {
+			p = memchr(p, imp->fs, e - p);
+			if (!p)
+				return false;
+			p++;
+		}
+		if (p < e && *p == '"') {
+			for (p++; (p = memchr(p, '"', e - p)) != NULL; p++) {
+				if (p + 1 < e && p[1] == imp->fs)
+					break;
+			}
+			if (!p)
+				return false;
+		} else if (!memchr(p, imp->fs, e - p)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static void csv_free(struct csv_import *imp)
+{
+	int i;
+
+	for (i = 0; i < CP_COUNT; i++)
+		free(imp->param[i].string);
+	free_buffer(&imp->field);
+	free_buffer(&imp->next);
+}
+
+static enum csv_native_result parse_csv_samples(struct csv_reader *r, char **params,
+						struct dive_table *table, struct trip_table *trips, struct dive_site_table *sites)
+{
+	struct csv_import imp;
+	struct membuffer line = { 0 }, next = { 0 }, head = { 0 }, tmp;
+	const char *s, *n;
+	double separator;
+	bool have_rest = false, head_complete = false, ccr;
+	size_t head_check = 0;
+	int eol, next_eol, lineno, o2sensors;
+
+	memset(&imp, 0, sizeof(imp));
+	if (!csv_set_params(&imp, params)) {
+		csv_free(&imp);
+		return CSV_NATIVE_UNSUPPORTED;
+	}
+	separator = imp.param[CP_SEPARATOR].number;
+	imp.fs = separator == 0 ? '\t' : separator == 2 ? ';' : separator == 3 ? '|' : ',';
+	imp.metric = imp.param[CP_UNITS].number == 0;
+	imp.delta = imp.param[CP_DELTA].number;
+
+	o2sensors = csv_has_field(&imp, CP_SENSOR1_FIELD) + csv_has_field(&imp, CP_SENSOR2_FIELD) +
+		    csv_has_field(&imp, CP_SENSOR3_FIELD);
+	ccr = o2sensors || csv_has_field(&imp, CP_PO2_FIELD) || csv_has_field(&imp, CP_SETPOINT_FIELD);
+
+	init_parser_state(&imp.state);
+	imp.state.target_table = table;
+	imp.state.trips = trips;
+	imp.state.sites = sites;
+	dive_start(&imp.state);
+	if (ccr)
+		csv_ccr_cylinders(&imp.state);
+	divecomputer_start(&imp.state);
+	csv_divecomputer(&imp, o2sensors, ccr);
+
+	/*
+	 * Only the current and the next line are kept. The details of the
+	 * dive are taken from the text from the third line on, which is
+	 * collected until it holds their fields. It is checked each time
+	 * it has doubled, so that a header that never completes costs no
+	 * more than reading the file once.
+	 */
+	eol = csv_read_line(r, &line);
+	for (lineno = 1;; lineno++) {
+		next.len = 0;
+		next_eol = eol ? csv_read_line(r, &next) : 0;
+		if (eol && lineno >= 2) {
+			have_rest = true;
+			if (!head_complete) {
+				put_bytes(&head, next.buffer, next.len);
+				if (head.len >= head_check) {
+					head_complete = csv_header_complete(&imp, head.buffer, head.buffer + head.len);
+					head_check = 2 * head.len;
+				}
+			}
+		}
+		s = mb_cstring(&line);
+		n = mb_cstring(&next);
+		if (!csv_skip_line(&imp, s, s + line.len - eol, n, n + next.len - next_eol))
+			csv_sample(&imp, s, s + line.len - eol, lineno);
+		if (!eol)
+			break;
+		tmp = line;
+		line = next;
+		next = tmp;
+		eol = next_eol;
+	}
+
+	/* divecomputer_end() takes the time of the divecomputer from the dive */
+	s = mb_cstring(&head);
+	csv_dive(&imp, s, s + head.len, have_rest);
+	divecomputer_end(&imp.state);
+	dive_end(&imp.state);
+	free_parser_state(&imp.state);
+	free_buffer(&line);
+	free_buffer(&next);
+	free_buffer(&head);
+	csv_free(&imp);
+	return CSV_NATIVE_DONE;
+}
+
 static int try_to_xslt_open_csv(const char *filename, struct memblock *mem, const char *tag);
 static int parse_dan_format(const char *filename, char **params, int pnr, struct dive_table *table,
 			    struct trip_table *trips, struct dive_site_table *sites)
@@ -108,6 +1003,7 @@ static int parse_dan_format(const char *filename, char **params, int pnr, struct
 	int ret = 0, i;
 	size_t end_ptr = 0;
 	struct memblock mem, mem_csv;
+	struct csv_reader reader;
 	char tmpbuf[MAXCOLDIGITS];
 
 	char *ptr = NULL;
@@ -213,7 +1109,9 @@ static int parse_dan_format(const char *filename, char **params, int pnr, struct
 				}
 			}
 			params[pnr_local] = NULL;
-			ret |= parse_xml_buffer(filename, "<csv></csv>", 11, table, trips, sites, (const char **)params);
+			csv_reader_buffer(&reader, "", 0);
+			if (parse_csv_samples(&reader, params, table, trips, sites) == CSV_NATIVE_UNSUPPORTED)
+				ret |= parse_xml_buffer(filename, "<csv></csv>", 11, table, trips, sites, (const char **)params);
 			continue;
 		}
 
@@ -267,10 +1165,13 @@ static int parse_dan_format(const char *filename, char **params, int pnr, struct
 			params[pnr_local] = NULL;
 		}
 
-		if (try_to_xslt_open_csv(filename, &mem_csv, "csv"))
-			return -1;
+		csv_reader_buffer(&reader, mem_csv.buffer, mem_csv.size);
+		if (parse_csv_samples(&reader, params, table, trips, sites) == CSV_NATIVE_UNSUPPORTED) {
+			if (try_to_xslt_open_csv(filename, &mem_csv, "csv"))
+				return -1;
 
-		ret |= parse_xml_buffer(filename, mem_csv.buffer, mem_csv.size, table, trips, sites, (const char **)params);
+			ret |= parse_xml_buffer(filename, mem_csv.buffer, mem_csv.size, table, trips, sites, (const char **)params);
+		}
 		end_ptr += ptr - (char *)mem_csv.buffer;
 		free(mem_csv.buffer);
 	}
@@ -321,6 +1222,23 @@ int parse_csv_file(const char *filename, char **params, int pnr, const char *csv
 		params[pnr++] = NULL;
 	}
 
+	if (!strcmp(csvtemplate, "csv")) {
+		struct csv_reader reader;
+		enum csv_native_result res;
+		FILE *f = subsurface_fopen(filename, "rb");
+
+		if (!f)
+			return report_error(translate("gettextFromC", "Failed to read '%s'"), filename);
+		csv_reader_file(&reader, f);
+		res = parse_csv_samples(&reader, params, table, trips, sites);
+		fclose(f);
+		if (res == CSV_NATIVE_DONE) {
+			for (i = 0; params[i]; i += 2)
+				free(params[i + 1]);
+			return 0;
+		}
+	}
+
 	if (try_to_xslt_open_csv(filename, &mem, csvtemplate))
 		return -1;
 
@@ -805,6 +1723,7 @@ static int parse_seabear_csv_file(const char *filename, char **params, int pnr,
 {
 	int ret, i;
 	struct memblock mem;
+	struct csv_reader reader;
 	time_t now;
 	struct tm *timep = NULL;
 	char *ptr, *ptr_old = NULL;
@@ -904,6 +1823,15 @@ static int parse_seabear_csv_file(const char *filename, char **params, int pnr,
 	memmove(mem.buffer, ptr_old, mem.size - (ptr_old - (char*)mem.buffer));
 	mem.size = (int)mem.size - (ptr_old - (char*)mem.buffer);
 
+	csv_reader_buffer(&reader, mem.buffer, mem.size);
+	if (!strcmp(csvtemplate, "csv") &&
+	    parse_csv_samples(&reader, params, table, trips, sites) == CSV_NATIVE_DONE) {
+		free(mem.buffer);
+		for (i = 0; params[i]; i += 2)
+			free(params[i + 1]);
+		return 0;
+	}
+
 	if (try_to_xslt_open_csv(filename, &mem, csvtemplate))
 		return -1;
 
@@ -273,12 +273,9 @@ static int divinglog_dive(void *param, int columns, char **data, char **column)
 
 	int retval = 0, diveid;
 	struct parser_state *state = (struct parser_state *)param;
-	sqlite3 *handle = state->sql_handle;
-	char *err = NULL;
-	char get_profile_template[] = "select ProfileInt,Profile,Profile2,Profile3,Profile4,Profile5 from Logbook where ID = %d";
-	char get_cylinder0_template[] = "select 0,TankSize,PresS,PresE,PresW,O2,He,DblTank from Logbook where ID = %d";
-	char get_cylinder_template[] = "select TankID,TankSize,PresS,PresE,PresW,O2,He,DblTank from Tank where LogID = %d order by TankID";
-	char get_buffer[1024];
+	char get_profile_template[] = "select ProfileInt,Profile,Profile2,Profile3,Profile4,Profile5 from Logbook where ID = ?";
+	char get_cylinder0_template[] = "select 0,TankSize,PresS,PresE,PresW,O2,He,DblTank from Logbook where ID = ?";
+	char get_cylinder_template[] = "select TankID,TankSize,PresS,PresE,PresW,O2,He,DblTank from Tank where LogID = ? order by TankID";
 
 	dive_start(state);
 	diveid = atoi(data[13]);
@@ -346,15 +343,13 @@ static int divinglog_dive(void *param, int columns, char **data, char **column)
 		state->cur_settings.dc.model = strdup("Divinglog import");
 	}
 
-	snprintf(get_buffer, sizeof(get_buffer) - 1, get_cylinder0_template, diveid);
-	retval = sqlite3_exec(handle, get_buffer, &divinglog_cylinder, state, &err);
+	retval = sql_exec_id(state, get_cylinder0_template, diveid, &divinglog_cylinder, state);
 	if (retval != SQLITE_OK) {
 		fprintf(stderr, "%s", "Database query divinglog_cylinder0 failed.\n");
 		return 1;
 	}
 
-	snprintf(get_buffer, sizeof(get_buffer) - 1, get_cylinder_template, diveid);
-	retval = sqlite3_exec(handle, get_buffer, &divinglog_cylinder, state, &err);
+	retval = sql_exec_id(state, get_cylinder_template, diveid, &divinglog_cylinder, state);
 	if (retval != SQLITE_OK) {
 		fprintf(stderr, "%s", "Database query divinglog_cylinder failed.\n");
 		return 1;
@@ -383,8 +378,7 @@ static int divinglog_dive(void *param, int columns, char **data, char **column)
 		state->cur_dive->dc.model = strdup("Divinglog import");
 	}
 
-	snprintf(get_buffer, sizeof(get_buffer) - 1, get_profile_template, diveid);
-	retval = sqlite3_exec(handle, get_buffer, &divinglog_profile, state, &err);
+	retval = sql_exec_id(state, get_profile_template, diveid, &divinglog_profile, state);
 	if (retval != SQLITE_OK) {
 		fprintf(stderr, "%s", "Database query divinglog_profile failed.\n");
 		return 1;
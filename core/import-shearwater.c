@@ -200,14 +200,11 @@ static int shearwater_dive(void *param, int columns, char **data, char **column)
 
 	int retval = 0;
 	struct parser_state *state = (struct parser_state *)param;
-	sqlite3 *handle = state->sql_handle;
-	char *err = NULL;
-	char get_profile_template[] = "select currentTime,currentDepth,waterTemp,averagePPO2,currentNdl,CNSPercent,decoCeiling,firstStopDepth,firstStopTime from dive_log_records where diveLogId=%ld";
-	char get_profile_template_ai[] = "select currentTime,currentDepth,waterTemp,averagePPO2,currentNdl,CNSPercent,decoCeiling,aiSensor0_PressurePSI,aiSensor1_PressurePSI,firstStopDepth,firstStopTime from dive_log_records where diveLogId = %ld";
-	char get_cylinder_template[] = "select fractionO2,fractionHe from dive_log_records where diveLogId = %ld group by fractionO2,fractionHe";
-	char get_changes_template[] = "select a.currentTime,a.fractionO2,a.fractionHe from dive_log_records as a,dive_log_records as b where (a.id - 1) = b.id and (a.fractionO2 != b.fractionO2 or a.fractionHe != b.fractionHe) and a.diveLogId=b.divelogId and a.diveLogId = %ld";
-	char get_mode_template[] = "select distinct currentCircuitSetting from dive_log_records where diveLogId = %ld";
-	char get_buffer[1024];
+	char get_profile_template[] = "select currentTime,currentDepth,waterTemp,averagePPO2,currentNdl,CNSPercent,decoCeiling,firstStopDepth,firstStopTime from dive_log_records where diveLogId=?";
+	char get_profile_template_ai[] = "select currentTime,currentDepth,waterTemp,averagePPO2,currentNdl,CNSPercent,decoCeiling,aiSensor0_PressurePSI,aiSensor1_PressurePSI,firstStopDepth,firstStopTime from dive_log_records where diveLogId = ?";
+	char get_cylinder_template[] = "select fractionO2,fractionHe from dive_log_records where diveLogId = ? group by fractionO2,fractionHe";
+	char get_changes_template[] = "select a.currentTime,a.fractionO2,a.fractionHe from dive_log_records as a,dive_log_records as b where (a.id - 1) = b.id and (a.fractionO2 != b.fractionO2 or a.fractionHe != b.fractionHe) and a.diveLogId=b.divelogId and a.diveLogId = ?";
+	char get_mode_template[] = "select distinct currentCircuitSetting from dive_log_records where diveLogId = ?";
 
 	dive_start(state);
 	state->cur_dive->number = atoi(data[0]);
@@ -275,33 +272,28 @@ static int shearwater_dive(void *param, int columns, char **data, char **column)
 	}
 
 	if (data[11]) {
-		snprintf(get_buffer, sizeof(get_buffer) - 1, get_mode_template, dive_id);
-		retval = sqlite3_exec(handle, get_buffer, &shearwater_mode, state, &err);
+		retval = sql_exec_id(state, get_mode_template, dive_id, &shearwater_mode, state);
 		if (retval != SQLITE_OK) {
 			fprintf(stderr, "%s", "Database query shearwater_mode failed.\n");
 			return 1;
 		}
 	}
 
-	snprintf(get_buffer, sizeof(get_buffer) - 1, get_cylinder_template, dive_id);
-	retval = sqlite3_exec(handle, get_buffer, &shearwater_cylinders, state, &err);
+	retval = sql_exec_id(state, get_cylinder_template, dive_id, &shearwater_cylinders, state);
 	if (retval != SQLITE_OK) {
 		fprintf(stderr, "%s", "Database query shearwater_cylinders failed.\n");
 		return 1;
 	}
 
-	snprintf(get_buffer, sizeof(get_buffer) - 1, get_changes_template, dive_id);
-	retval = sqlite3_exec(handle, get_buffer, &shearwater_changes, state, &err);
+	retval = sql_exec_id(state, get_changes_template, dive_id, &shearwater_changes, state);
 	if (retval != SQLITE_OK) {
 		fprintf(stderr, "%s", "Database query shearwater_changes failed.\n");
 		return 1;
 	}
 
-	snprintf(get_buffer, sizeof(get_buffer) - 1, get_profile_template_ai, dive_id);
-	retval = sqlite3_exec(handle, get_buffer, &shearwater_ai_profile_sample, state, &err);
+	retval = sql_exec_id(state, get_profile_template_ai, dive_id, &shearwater_ai_profile_sample, state);
 	if (retval != SQLITE_OK) {
-		snprintf(get_buffer, sizeof(get_buffer) - 1, get_profile_template, dive_id);
-		retval = sqlite3_exec(handle, get_buffer, &shearwater_profile_sample, state, &err);
+		retval = sql_exec_id(state, get_profile_template, dive_id, &shearwater_profile_sample, state);
 		if (retval != SQLITE_OK) {
 			fprintf(stderr, "%s", "Database query shearwater_profile_sample failed.\n");
 			return 1;
@@ -320,14 +312,11 @@ static int shearwater_cloud_dive(void *param, int columns, char **data, char **c
 
 	int retval = 0;
 	struct parser_state *state = (struct parser_state *)param;
-	sqlite3 *handle = state->sql_handle;
-	char *err = NULL;
-	char get_profile_template[] = "select currentTime,currentDepth,waterTemp,averagePPO2,currentNdl,CNSPercent,decoCeiling,firstStopDepth,firstStopTime from dive_log_records where diveLogId=%ld";
-	char get_profile_template_ai[] = "select currentTime,currentDepth,waterTemp,averagePPO2,currentNdl,CNSPercent,decoCeiling,aiSensor0_PressurePSI,aiSensor1_PressurePSI,firstStopDepth,firstStopTime from dive_log_records where diveLogId = %ld";
-	char get_cylinder_template[] = "select fractionO2 / 100,fractionHe / 100 from dive_log_records where diveLogId = %ld group by fractionO2,fractionHe";
-	char get_changes_template[] = "select a.currentTime,a.fractionO2 / 100,a.fractionHe /100 from dive_log_records as a,dive_log_records as b where (a.id - 1) = b.id and (a.fractionO2 != b.fractionO2 or a.fractionHe != b.fractionHe) and a.diveLogId=b.divelogId and a.diveLogId = %ld";
-	char get_mode_template[] = "select distinct currentCircuitSetting from dive_log_records where diveLogId = %ld";
-	char get_buffer[1024];
+	char get_profile_template[] = "select currentTime,currentDepth,waterTemp,averagePPO2,currentNdl,CNSPercent,decoCeiling,firstStopDepth,firstStopTime from dive_log_records where diveLogId=?";
+	char get_profile_template_ai[] = "select currentTime,currentDepth,waterTemp,averagePPO2,currentNdl,CNSPercent,decoCeiling,aiSensor0_PressurePSI,aiSensor1_PressurePSI,firstStopDepth,firstStopTime from dive_log_records where diveLogId = ?";
+	char get_cylinder_template[] = "select fractionO2 / 100,fractionHe / 100 from dive_log_records where diveLogId = ? group by fractionO2,fractionHe";
+	char get_changes_template[] = "select a.currentTime,a.fractionO2 / 100,a.fractionHe /100 from dive_log_records as a,dive_log_records as b where (a.id - 1) = b.id and (a.fractionO2 != b.fractionO2 or a.fractionHe != b.fractionHe) and a.diveLogId=b.divelogId and a.diveLogId = ?";
+	char get_mode_template[] = "select distinct currentCircuitSetting from dive_log_records where diveLogId = ?";
 
 	dive_start(state);
 	state->cur_dive->number = atoi(data[0]);
@@ -399,33 +388,28 @@ static int shearwater_cloud_dive(void *param, int columns, char **data, char **c
 	}
 
 	if (data[11]) {
-		snprintf(get_buffer, sizeof(get_buffer) - 1, get_mode_template, dive_id);
-		retval = sqlite3_exec(handle, get_buffer, &shearwater_mode, state, &err);
+		retval = sql_exec_id(state, get_mode_template, dive_id, &shearwater_mode, state);
 		if (retval != SQLITE_OK) {
 			fprintf(stderr, "%s", "Database query shearwater_mode failed.\n");
 			return 1;
 		}
 	}
 
-	snprintf(get_buffer, sizeof(get_buffer) - 1, get_cylinder_template, dive_id);
-	retval = sqlite3_exec(handle, get_buffer, &shearwater_cylinders, state, &err);
+	retval = sql_exec_id(state, get_cylinder_template, dive_id, &shearwater_cylinders, state);
 	if (retval != SQLITE_OK) {
 		fprintf(stderr, "%s", "Database query shearwater_cylinders failed.\n");
 		return 1;
 	}
 
-	snprintf(get_buffer, sizeof(get_buffer) - 1, get_changes_template, dive_id);
-	retval = sqlite3_exec(handle, get_buffer, &shearwater_changes, state, &err);
+	retval = sql_exec_id(state, get_changes_template, dive_id, &shearwater_changes, state);
 	if (retval != SQLITE_OK) {
 		fprintf(stderr, "%s", "Database query shearwater_changes failed.\n");
 		return 1;
 	}
 
-	snprintf(get_buffer, sizeof(get_buffer) - 1, get_profile_template_ai, dive_id);
-	retval = sqlite3_exec(handle, get_buffer, &shearwater_ai_profile_sample, state, &err);
+	retval = sql_exec_id(state, get_profile_template_ai, dive_id, &shearwater_ai_profile_sample, state);
 	if (retval != SQLITE_OK) {
-		snprintf(get_buffer, sizeof(get_buffer) - 1, get_profile_template, dive_id);
-		retval = sqlite3_exec(handle, get_buffer, &shearwater_profile_sample, state, &err);
+		retval = sql_exec_id(state, get_profile_template, dive_id, &shearwater_profile_sample, state);
 		if (retval != SQLITE_OK) {
 			fprintf(stderr, "%s", "Database query shearwater_profile_sample failed.\n");
 			return 1;
@@ -165,14 +165,11 @@ static int dm4_dive(void *param, int columns, char **data, char **column)
 	int i;
 	int interval, retval = 0;
 	struct parser_state *state = (struct parser_state *)param;
-	sqlite3 *handle = state->sql_handle;
 	float *profileBlob;
 	unsigned char *tempBlob;
 	int *pressureBlob;
-	char *err = NULL;
-	char get_events_template[] = "select * from Mark where DiveId = %d";
-	char get_tags_template[] = "select Text from DiveTag where DiveId = %d";
-	char get_events[64];
+	char get_events_template[] = "select * from Mark where DiveId = ?";
+	char get_tags_template[] = "select Text from DiveTag where DiveId = ?";
 
 	dive_start(state);
 	state->cur_dive->number = atoi(data[0]);
@@ -258,15 +255,13 @@ static int dm4_dive(void *param, int columns, char **data, char **column)
 		sample_end(state);
 	}
 
-	snprintf(get_events, sizeof(get_events) - 1, get_events_template, state->cur_dive->number);
-	retval = sqlite3_exec(handle, get_events, &dm4_events, state, &err);
+	retval = sql_exec_id(state, get_events_template, state->cur_dive->number, &dm4_events, state);
 	if (retval != SQLITE_OK) {
 		fprintf(stderr, "%s", "Database query dm4_events failed.\n");
 		return 1;
 	}
 
-	snprintf(get_events, sizeof(get_events) - 1, get_tags_template, state->cur_dive->number);
-	retval = sqlite3_exec(handle, get_events, &dm4_tags, state, &err);
+	retval = sql_exec_id(state, get_tags_template, state->cur_dive->number, &dm4_tags, state);
 	if (retval != SQLITE_OK) {
 		fprintf(stderr, "%s", "Database query dm4_tags failed.\n");
 		return 1;
@@ -377,14 +372,11 @@ static int dm5_dive(void *param, int columns, char **data, char **column)
 	int tempformat = 0;
 	int interval, retval = 0, block_size;
 	struct parser_state *state = (struct parser_state *)param;
-	sqlite3 *handle = state->sql_handle;
 	unsigned const char *sampleBlob;
-	char *err = NULL;
-	char get_events_template[] = "select * from Mark where DiveId = %d";
-	char get_tags_template[] = "select Text from DiveTag where DiveId = %d";
-	char get_cylinders_template[] = "select * from DiveMixture where DiveId = %d";
-	char get_gaschange_template[] = "select GasChangeTime,Oxygen,Helium from DiveGasChange join DiveMixture on DiveGasChange.DiveMixtureId=DiveMixture.DiveMixtureId where DiveId = %d";
-	char get_events[512];
+	char get_events_template[] = "select * from Mark where DiveId = ?";
+	char get_tags_template[] = "select Text from DiveTag where DiveId = ?";
+	char get_cylinders_template[] = "select * from DiveMixture where DiveId = ?";
+	char get_gaschange_template[] = "select GasChangeTime,Oxygen,Helium from DiveGasChange join DiveMixture on DiveGasChange.DiveMixtureId=DiveMixture.DiveMixtureId where DiveId = ?";
 
 	dive_start(state);
 	state->cur_dive->number = atoi(data[0]);
@@ -426,8 +418,7 @@ static int dm5_dive(void *param, int columns, char **data, char **column)
 	if (data[5])
 		utf8_string(data[5], &state->cur_dive->dc.model);
 
-	snprintf(get_events, sizeof(get_events) - 1, get_cylinders_template, state->cur_dive->number);
-	retval = sqlite3_exec(handle, get_events, &dm5_cylinders, state, &err);
+	retval = sql_exec_id(state, get_cylinders_template, state->cur_dive->number, &dm5_cylinders, state);
 	if (retval != SQLITE_OK) {
 		fprintf(stderr, "%s", "Database query dm5_cylinders failed.\n");
 		return 1;
@@ -532,22 +523,19 @@ static int dm5_dive(void *param, int columns, char **data, char **column)
 		}
 	}
 
-	snprintf(get_events, sizeof(get_events) - 1, get_gaschange_template, state->cur_dive->number);
-	retval = sqlite3_exec(handle, get_events, &dm5_gaschange, state, &err);
+	retval = sql_exec_id(state, get_gaschange_template, state->cur_dive->number, &dm5_gaschange, state);
 	if (retval != SQLITE_OK) {
 		fprintf(stderr, "%s", "Database query dm5_gaschange failed.\n");
 		return 1;
 	}
 
-	snprintf(get_events, sizeof(get_events) - 1, get_events_template, state->cur_dive->number);
-	retval = sqlite3_exec(handle, get_events, &dm4_events, state, &err);
+	retval = sql_exec_id(state, get_events_template, state->cur_dive->number, &dm4_events, state);
 	if (retval != SQLITE_OK) {
 		fprintf(stderr, "%s", "Database query dm4_events failed.\n");
 		return 1;
 	}
 
-	snprintf(get_events, sizeof(get_events) - 1, get_tags_template, state->cur_dive->number);
-	retval = sqlite3_exec(handle, get_events, &dm4_tags, state, &err);
+	retval = sql_exec_id(state, get_tags_template, state->cur_dive->number, &dm4_tags, state);
 	if (retval != SQLITE_OK) {
 		fprintf(stderr, "%s", "Database query dm4_tags failed.\n");
 		return 1;
@@ -168,7 +168,7 @@ static void parse_dive_gps(char *line, struct membuffer *str, void *_dive)
 			ds->notes = add_to_string(ds->notes, translate("gettextFromC", "multiple GPS locations for this dive site; also %s\n"), coords);
 			free(coords);
 		}
-		ds->location = location;
+		set_dive_site_location(ds, &location);
 	}
 
 }
@@ -187,7 +187,7 @@ static void parse_dive_location(char *line, struct membuffer *str, void *_dive)
 	} else {
 		// we already had a dive site linked to the dive
 		if (empty_string(ds->name)) {
-			ds->name = strdup(name);
+			set_dive_site_name(ds, name);
 		} else {
 			// and that dive site had a name. that's weird - if our name is different, add it to the notes
 			if (!same_string(ds->name, name))
@@ -266,7 +266,7 @@ static void parse_site_description(char *line, struct membuffer *str, void *_ds)
 { UNUSED(line); struct dive_site *ds = _ds; ds->description = strdup(mb_cstring(str)); }
 
 static void parse_site_name(char *line, struct membuffer *str, void *_ds)
-{ UNUSED(line); struct dive_site *ds = _ds; ds->name = strdup(mb_cstring(str)); }
+{ UNUSED(line); struct dive_site *ds = _ds; set_dive_site_name(ds, mb_cstring(str)); }
 
 static void parse_site_notes(char *line, struct membuffer *str, void *_ds)
 { UNUSED(line); struct dive_site *ds = _ds; ds->notes = strdup(mb_cstring(str)); }
@@ -275,8 +275,10 @@ static void parse_site_gps(char *line, struct membuffer *str, void *_ds)
 {
 	UNUSED(str);
 	struct dive_site *ds = _ds;
+	location_t location;
 
-	parse_location(line, &ds->location);
+	parse_location(line, &location);
+	set_dive_site_location(ds, &location);
 }
 
 static void parse_site_geo(char *line, struct membuffer *str, void *_ds)
@@ -593,7 +595,7 @@ static char *parse_sample_unit(struct sample *sample, double val, char *unit)
  * or the second cylinder depending on what isn't an
  * oxygen cylinder.
  */
-static struct sample *new_sample(struct divecomputer *dc)
+static struct sample *new_sample(struct divecomputer *dc, int o2pressure_sensor)
 {
 	struct sample *sample = prepare_sample(dc);
 	if (sample != dc->sample) {
@@ -607,10 +609,10 @@ static struct sample *new_sample(struct divecomputer *dc)
 	return sample;
 }
 
-static void sample_parser(char *line, struct divecomputer *dc)
+static void sample_parser(char *line, struct divecomputer *dc, int o2pressure_sensor)
 {
 	int m, s = 0;
-	struct sample *sample = new_sample(dc);
+	struct sample *sample = new_sample(dc, o2pressure_sensor);
 
 	m = strtol(line, &line, 10);
 	if (*line == ':')
@@ -968,13 +970,31 @@ struct keyword_action dc_action[] = {
 	D(salinity), D(surfacepressure), D(surfacetime), D(time), D(watertemp)
 };
 
+/*
+ * A divecomputer file that still has to be parsed. The walk over
+ * the tree only records these, and they are read and parsed in
+ * parallel once the walk is done (see parse_dc_jobs()).
+ *
+ * The oxygen sensor of CCR dives depends on the cylinders of the
+ * dive, so it is remembered here rather than read from the global
+ * used while parsing the dive file. The errors of the file are
+ * collected and reported in tree order once all files are parsed.
+ */
+struct dc_job {
+	git_oid id;
+	struct divecomputer *dc;
+	int o2pressure_sensor;
+	struct membuffer errors;
+};
+
 /* Sample lines start with a space or a number */
-static void divecomputer_parser(char *line, struct membuffer *str, void *_dc)
+static void divecomputer_parser(char *line, struct membuffer *str, void *_job)
 {
+	struct dc_job *job = _job;
 	char c = *line;
 	if (c < 'a' || c > 'z')
-		sample_parser(line, _dc);
-	match_action(line, str, _dc, dc_action, ARRAY_SIZE(dc_action));
+		sample_parser(line, job->dc, job->o2pressure_sensor);
+	match_action(line, str, job->dc, dc_action, ARRAY_SIZE(dc_action));
 }
 
 /* These need to be sorted! */
@@ -1166,17 +1186,50 @@ static void for_each_line(git_blob *blob, line_fn_t *fn, void *fndata)
 #define GIT_WALK_OK   0
 #define GIT_WALK_SKIP 1
 
-static struct divecomputer *active_dc;
 static struct dive *active_dive;
 static dive_trip_t *active_trip;
 
+static struct {
+	int nr, allocated;
+	struct dc_job *jobs;
+} dc_jobs;
+
+/*
+ * Recording a dive runs the fixups, which need the samples. Therefore
+ * finished dives and trips are only queued during the walk and added
+ * to the tables, in the order of the walk, after the divecomputer
+ * files have been parsed. Exactly one of dive and trip is set.
+ */
+struct finished_entry {
+	struct dive *dive;
+	dive_trip_t *trip;
+};
+
+static struct {
+	int nr, allocated;
+	struct finished_entry *entries;
+} finished;
+
+static void queue_finished(struct dive *dive, dive_trip_t *trip)
+{
+	if (finished.nr >= finished.allocated) {
+		finished.allocated = (finished.nr + 32) * 3 / 2;
+		finished.entries = realloc(finished.entries, finished.allocated * sizeof(*finished.entries));
+		if (!finished.entries)
+			exit(1);
+	}
+	finished.entries[finished.nr].dive = dive;
+	finished.entries[finished.nr].trip = trip;
+	finished.nr++;
+}
+
 static void finish_active_trip(void)
 {
 	dive_trip_t *trip = active_trip;
 
 	if (trip) {
 		active_trip = NULL;
-		insert_trip(trip, &trip_table);
+		queue_finished(NULL, trip);
 	}
 }
 
@@ -1186,8 +1239,23 @@ static void finish_active_dive(void)
 
 	if (dive) {
 		active_dive = NULL;
-		record_dive(dive);
+		queue_finished(dive, NULL);
+	}
+}
+
+static void record_finished(void)
+{
+	int i;
+
+	for (i = 0; i < finished.nr; i++) {
+		struct finished_entry *entry = finished.entries + i;
+		if (entry->dive)
+			record_dive(entry->dive);
+		else
+			insert_trip(entry->trip, &trip_table);
 	}
+	free(finished.entries);
+	memset(&finished, 0, sizeof(finished));
 }
 
 static struct dive *create_new_dive(timestamp_t when)
@@ -1456,26 +1524,114 @@ static struct divecomputer *create_new_dc(struct dive *dive)
 }
 
 /*
- * We should *really* try to delay the dive computer data parsing
- * until necessary, in order to reduce load-time. The parsing is
- * cheap, but the loading of the git blob into memory can be pretty
- * costly.
+ * The divecomputer files contain the samples and are by far the
+ * bulk of the data. Loading the blob and parsing it is therefore
+ * deferred to parse_dc_jobs(), which does that on all cores. Here
+ * we only create the divecomputer, so that the order of the
+ * divecomputers of a dive stays that of the tree.
+ *
+ * Note that create_new_dc() sets the "when" of the divecomputer,
+ * so that the next divecomputer file of the same dive gets a new
+ * one, even though this one hasn't been filled in yet.
  */
 static int parse_divecomputer_entry(git_repository *repo, const git_tree_entry *entry, const char *suffix)
 {
+	UNUSED(repo);
 	UNUSED(suffix);
-	git_blob *blob = git_tree_entry_blob(repo, entry);
+	struct dc_job *job;
+	struct divecomputer *dc = create_new_dc(active_dive);
 
-	if (!blob)
+	if (!dc)
 		return report_error("Unable to read divecomputer file");
 
-	active_dc = create_new_dc(active_dive);
-	for_each_line(blob, divecomputer_parser, active_dc);
-	git_blob_free(blob);
-	active_dc = NULL;
+	if (dc_jobs.nr >= dc_jobs.allocated) {
+		dc_jobs.allocated = (dc_jobs.nr + 32) * 3 / 2;
+		dc_jobs.jobs = realloc(dc_jobs.jobs, dc_jobs.allocated * sizeof(*dc_jobs.jobs));
+		if (!dc_jobs.jobs)
+			exit(1);
+	}
+	job = dc_jobs.jobs + dc_jobs.nr++;
+	git_oid_cpy(&job->id, git_tree_entry_id(entry));
+	job->dc = dc;
+	job->o2pressure_sensor = o2pressure_sensor;
+	memset(&job->errors, 0, sizeof(job->errors));
 	return 0;
 }
 
+/*
+ * Every chunk of divecomputer files is parsed with its own handle to
+ * the repository, since libgit2 objects must not be shared between
+ * threads. If the repository can't be opened a second time, all
+ * files are parsed in a single chunk using the original handle.
+ */
+struct dc_load {
+	git_repository *repo;
+	const char *path;
+	int chunk_size;
+};
+
+static void parse_dc_job(git_repository *repo, struct dc_job *job)
+{
+	git_blob *blob;
+
+	collect_errors(&job->errors);
+	if (git_blob_lookup(&blob, repo, &job->id)) {
+		report_error("Unable to read divecomputer file");
+	} else {
+		for_each_line(blob, divecomputer_parser, job);
+		git_blob_free(blob);
+	}
+	collect_errors(NULL);
+}
+
+static void parse_dc_chunk(void *_load, int chunk)
+{
+	struct dc_load *load = _load;
+	git_repository *repo = load->repo;
+	int i = chunk * load->chunk_size;
+	int end = MIN(i + load->chunk_size, dc_jobs.nr);
+
+	if (load->path && git_repository_open(&repo, load->path)) {
+		/* reported with the first file of the chunk */
+		collect_errors(&dc_jobs.jobs[i].errors);
+		report_error("Unable to open git repository at '%s'", load->path);
+		collect_errors(NULL);
+		return;
+	}
+	for (; i < end; i++)
+		parse_dc_job(repo, dc_jobs.jobs + i);
+	if (load->path)
+		git_repository_free(repo);
+}
+
+static void parse_dc_jobs(git_repository *repo)
+{
+	struct dc_load load = { repo, NULL, dc_jobs.nr };
+	const char *path = git_repository_path(repo);
+	git_repository *test;
+	int i;
+
+	/*
+	 * A couple of chunks per thread, so that a thread that got the
+	 * files with long profiles doesn't hold up everybody else.
+	 */
+	int nr_chunks = ideal_thread_count() * 4;
+
+	if (nr_chunks > 1 && dc_jobs.nr > nr_chunks && path && !git_repository_open(&test, path)) {
+		git_repository_free(test);
+		load.path = path;
+		load.chunk_size = (dc_jobs.nr + nr_chunks - 1) / nr_chunks;
+		nr_chunks = (dc_jobs.nr + load.chunk_size - 1) / load.chunk_size;
+		run_parallel(nr_chunks, parse_dc_chunk, &load);
+	} else if (dc_jobs.nr) {
+		parse_dc_chunk(&load, 0);
+	}
+	for (i = 0; i < dc_jobs.nr; i++)
+		report_collected_errors(&dc_jobs.jobs[i].errors);
+	free(dc_jobs.jobs);
+	memset(&dc_jobs, 0, sizeof(dc_jobs));
+}
+
 /*
  * NOTE! The "git_id" for the dive is the hash for the whole dive directory.
  * As such, it covers not just the dive, but the divecomputers and the
@@ -1610,9 +1766,19 @@ static int walk_tree_cb(const char *root, const git_tree_entry *entry, void *pay
 	return GIT_WALK_OK;
 }
 
+/*
+ * Loading happens in three steps: the walk over the tree parses
+ * everything but the divecomputer files, which are then parsed in
+ * parallel. Finally, the dives and trips are added to the tables in
+ * the order they were found in the tree.
+ */
 static int load_dives_from_tree(git_repository *repo, git_tree *tree)
 {
 	git_tree_walk(tree, GIT_TREEWALK_PRE, walk_tree_cb, repo);
+	finish_active_dive();
+	finish_active_trip();
+	parse_dc_jobs(repo);
+	record_finished();
 	return 0;
 }
 
@@ -1689,7 +1855,5 @@ int git_load_dives(struct git_repository *repo, const char *branch)
 	ret = do_git_load(repo, branch);
 	git_repository_free(repo);
 	free((void *)branch);
-	finish_active_dive();
-	finish_active_trip();
 	return ret;
 }
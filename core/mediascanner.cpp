@@ -0,0 +1,53 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "mediascanner.h"
+
+#include <QtConcurrent>
+
+// Small batches, so that the UI can show progress
+static const int batchSize = 16;
+
+MediaScanner::MediaScanner(QObject *parent) : QObject(parent)
+{
+	qRegisterMetaType<QVector<MediaMetadata>>();
+}
+
+MediaScanner::~MediaScanner()
+{
+	cancel();
+	pool.waitForDone();
+}
+
+void MediaScanner::scan(const QStringList &fileNames)
+{
+	canceled.storeRelease(0);
+	remaining.storeRelease((fileNames.size() + batchSize - 1) / batchSize);
+	if (fileNames.isEmpty()) {
+		// Nothing to do, but the caller expects the signal to arrive after this call
+		QMetaObject::invokeMethod(this, "finished", Qt::QueuedConnection);
+		return;
+	}
+	for (int first = 0; first < fileNames.size(); first += batchSize)
+		QtConcurrent::run(&pool, [this, fileNames, first]() { scanBatch(fileNames.mid(first, batchSize), first); });
+}
+
+void MediaScanner::cancel()
+{
+	canceled.storeRelease(1);
+}
+
+void MediaScanner::scanBatch(const QStringList &fileNames, int first)
+{
+	if (!canceled.loadAcquire()) {
+		QVector<MediaMetadata> batch;
+		batch.reserve(fileNames.size());
+		for (const QString &filename: fileNames) {
+			MediaMetadata item;
+			item.filename = filename;
+			item.type = get_metadata(qPrintable(filename), &item.data);
+			batch.append(item);
+		}
+		emit scanned(first, batch);
+	}
+	if (remaining.fetchAndAddOrdered(-1) == 1)
+		emit finished();
+}
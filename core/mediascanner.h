@@ -0,0 +1,47 @@
+// SPDX-License-Identifier: GPL-2.0
+#ifndef MEDIASCANNER_H
+#define MEDIASCANNER_H
+
+#include "core/metadata.h"
+
+#include <QObject>
+#include <QThreadPool>
+#include <QAtomicInt>
+#include <QStringList>
+#include <QVector>
+#include <QMetaType>
+
+struct MediaMetadata {
+	QString filename;
+	mediatype_t type;
+	metadata data;
+};
+
+Q_DECLARE_METATYPE(MediaMetadata)
+
+// Reads the metadata of media files on a thread pool. The results are passed on in
+// batches by the scanned() signal, which arrives in the thread of the receiver, i.e.
+// typically in the UI thread, where the files can be matched to dives.
+// Only one scan is run at a time.
+class MediaScanner : public QObject {
+	Q_OBJECT
+public:
+	MediaScanner(QObject *parent = nullptr);
+	~MediaScanner();
+	void scan(const QStringList &fileNames);
+public slots:
+	void cancel();
+signals:
+	// The metadata of fileNames[first] to fileNames[first + batch.size() - 1].
+	// The batches come in no particular order.
+	void scanned(int first, const QVector<MediaMetadata> &batch);
+	// Emitted after the last batch, also if the scan was canceled
+	void finished();
+private:
+	void scanBatch(const QStringList &fileNames, int first);
+	QThreadPool pool;
+	QAtomicInt canceled;
+	QAtomicInt remaining;
+};
+
+#endif
@@ -3,9 +3,18 @@
 #include "xmp_parser.h"
 #include "exif.h"
 #include "qthelper.h"
+#include "pref.h"
 #include <QString>
 #include <QFile>
+#include <QSaveFile>
+#include <QDataStream>
 #include <QDateTime>
+#include <QFileInfo>
+#include <QMutex>
+#include <QHash>
+#include <QDebug>
+#include <algorithm>
+#include <vector>
 
 // Weirdly, android builds fail owing to undefined UINT64_MAX
 #ifndef UINT64_MAX
@@ -516,14 +525,130 @@ static bool parseASF(QFile &f, metadata *metadata)
 	return false;
 }
 
-extern "C" mediatype_t get_metadata(const char *filename_in, metadata *data)
+// The metadata of media files are kept in a cache, which is saved to disk by write_metadata_cache(),
+// so that adding the same files to dives again doesn't parse them again. The entries are keyed by
+// the canonical filename and are only used if size and modification time of the file didn't change,
+// so that a changed file replaces its entry. The cache is only kept in memory while files are read:
+// write_metadata_cache() drops it. It is limited to maxMetadataCacheEntries, beyond which the least
+// recently used half is dropped. The entries are saved in the order of their last use.
+struct MetadataCacheEntry {
+	qint64 size;
+	qint64 mtime;		// msecs since epoch
+	mediatype_t type;
+	metadata data;
+	quint64 lastUse;
+};
+
+static QMutex metadataCacheMutex;
+static QHash<QString, MetadataCacheEntry> metadataCache;
+static quint64 metadataCacheClock = 0;
+static bool metadataCacheRead = false;
+static bool metadataCacheChanged = false;
+static const quint32 metadataCacheVersion = 1;
+static const int maxMetadataCacheEntries = 20000;
+
+static QString metadataCacheName()
 {
-	data->timestamp = 0;
-	data->duration.seconds = 0;
-	data->location.lat.udeg = 0;
-	data->location.lon.udeg = 0;
+	return QString(system_default_directory()).append("/metadata");
+}
 
-	QString filename = localFilePath(QString(filename_in));
+// Read the cache on first use. Call with metadataCacheMutex locked.
+static void readMetadataCache()
+{
+	if (metadataCacheRead)
+		return;
+	metadataCacheRead = true;
+
+	QFile file(metadataCacheName());
+	if (!file.open(QIODevice::ReadOnly))
+		return;
+	QDataStream stream(&file);
+	quint32 version, nr;
+	stream >> version >> nr;
+	if (stream.status() != QDataStream::Ok || version != metadataCacheVersion)
+		return;
+	for (quint32 i = 0; i < nr; ++i) {
+		QString filename;
+		MetadataCacheEntry entry;
+		quint32 type;
+		qint64 timestamp;
+		qint32 duration, lat, lon;
+		stream >> filename >> entry.size >> entry.mtime >> type >> timestamp >> duration >> lat >> lon;
+		// Keep what we got from a truncated file
+		if (stream.status() != QDataStream::Ok)
+			break;
+		entry.type = (mediatype_t)type;
+		entry.data.timestamp = timestamp;
+		entry.data.duration.seconds = duration;
+		entry.data.location.lat.udeg = lat;
+		entry.data.location.lon.udeg = lon;
+		entry.lastUse = ++metadataCacheClock;
+		metadataCache.insert(filename, entry);
+	}
+}
+
+// Drop the least recently used half of the entries. Call with metadataCacheMutex locked.
+static void shrinkMetadataCache()
+{
+	std::vector<quint64> uses;
+	uses.reserve(metadataCache.size());
+	for (const MetadataCacheEntry &entry: metadataCache)
+		uses.push_back(entry.lastUse);
+	auto median = uses.begin() + uses.size() / 2;
+	std::nth_element(uses.begin(), median, uses.end());
+	for (auto it = metadataCache.begin(); it != metadataCache.end(); ) {
+		if (it->lastUse < *median)
+			it = metadataCache.erase(it);
+		else
+			++it;
+	}
+	metadataCacheChanged = true;
+}
+
+// Drop the cache from memory. It is read again on the next use. Call with metadataCacheMutex locked.
+static void releaseMetadataCache()
+{
+	metadataCache.clear();
+	metadataCache.squeeze();
+	metadataCacheRead = false;
+}
+
+// Save the cache, if it changed, and drop it from memory. Call once the media files are read.
+extern "C" void write_metadata_cache()
+{
+	QMutexLocker locker(&metadataCacheMutex);
+	if (!metadataCacheChanged) {
+		releaseMetadataCache();
+		return;
+	}
+
+	QSaveFile file(metadataCacheName());
+	if (!file.open(QIODevice::WriteOnly)) {
+		qWarning() << "Cannot open metadata cache for writing: " << file.fileName();
+		return;
+	}
+	std::vector<QHash<QString, MetadataCacheEntry>::const_iterator> entries;
+	entries.reserve(metadataCache.size());
+	for (auto it = metadataCache.cbegin(); it != metadataCache.cend(); ++it)
+		entries.push_back(it);
+	std::sort(entries.begin(), entries.end(), [](const QHash<QString, MetadataCacheEntry>::const_iterator &a,
+						     const QHash<QString, MetadataCacheEntry>::const_iterator &b)
+		  { return a->lastUse < b->lastUse; });
+	QDataStream stream(&file);
+	stream << metadataCacheVersion << (quint32)entries.size();
+	for (const auto &it: entries) {
+		const MetadataCacheEntry &entry = it.value();
+		stream << it.key() << entry.size << entry.mtime << (quint32)entry.type << (qint64)entry.data.timestamp
+		       << (qint32)entry.data.duration.seconds << (qint32)entry.data.location.lat.udeg << (qint32)entry.data.location.lon.udeg;
+	}
+	if (file.commit()) {
+		metadataCacheChanged = false;
+		releaseMetadataCache();
+	}
+}
+
+static mediatype_t parseMetadata(const QString &filename, metadata *data)
+{
 	QFile f(filename);
 	if (!f.open(QIODevice::ReadOnly))
 		return MEDIATYPE_IO_ERROR;
@@ -546,6 +671,43 @@ extern "C" mediatype_t get_metadata(const char *filename_in, metadata *data)
 	return res;
 }
 
+// This is thread safe, media files are scanned in the background.
+extern "C" mediatype_t get_metadata(const char *filename_in, metadata *data)
+{
+	data->timestamp = 0;
+	data->duration.seconds = 0;
+	data->location.lat.udeg = 0;
+	data->location.lon.udeg = 0;
+
+	QString filename = localFilePath(QString(filename_in));
+	QFileInfo info(filename);
+	QString canonicalFilename = info.canonicalFilePath();	// empty if the file doesn't exist
+	qint64 size = info.size();
+	qint64 mtime = info.lastModified().toMSecsSinceEpoch();
+
+	if (!canonicalFilename.isEmpty()) {
+		QMutexLocker locker(&metadataCacheMutex);
+		readMetadataCache();
+		auto it = metadataCache.find(canonicalFilename);
+		if (it != metadataCache.end() && it->size == size && it->mtime == mtime) {
+			it->lastUse = ++metadataCacheClock;
+			*data = it->data;
+			return it->type;
+		}
+	}
+
+	mediatype_t res = parseMetadata(filename, data);
+	if (res != MEDIATYPE_IO_ERROR && !canonicalFilename.isEmpty()) {
+		QMutexLocker locker(&metadataCacheMutex);
+		readMetadataCache();
+		metadataCache.insert(canonicalFilename, { size, mtime, res, *data, ++metadataCacheClock });
+		metadataCacheChanged = true;
+		if (metadataCache.size() > maxMetadataCacheEntries)
+			shrinkMetadataCache();
+	}
+	return res;
+}
+
 extern "C" timestamp_t picture_get_timestamp(const char *filename)
 {
 	struct metadata data;
@@ -23,6 +23,7 @@ extern "C" {
 
 enum mediatype_t get_metadata(const char *filename, struct metadata *data);
 timestamp_t picture_get_timestamp(const char *filename);
+void write_metadata_cache(void);
 
 #ifdef __cplusplus
 }
@@ -864,92 +864,179 @@ static void try_to_fill_dc(struct divecomputer *dc, const char *name, char *buf,
 	nonmatch("divecomputer", name, buf);
 }
 
+/*
+ * The attributes of <sample> make up the bulk of a dive log, so they are
+ * dispatched by a switch on the attribute name instead of trying every
+ * pattern in turn.
+ */
+enum sample_field {
+	SAMPLE_NONE,
+	SAMPLE_PRESSURE, SAMPLE_O2PRESSURE,
+	SAMPLE_PRESSURE0, SAMPLE_PRESSURE1, SAMPLE_PRESSURE2, SAMPLE_PRESSURE3, SAMPLE_PRESSURE4,
+	SAMPLE_CYLINDERINDEX, SAMPLE_SENSOR, SAMPLE_DEPTH, SAMPLE_TEMPERATURE, SAMPLE_TIME,
+	SAMPLE_NDL, SAMPLE_TTS, SAMPLE_IN_DECO, SAMPLE_STOPTIME, SAMPLE_STOPDEPTH, SAMPLE_CNS, SAMPLE_RBT,
+	SAMPLE_SENSOR1, SAMPLE_SENSOR2, SAMPLE_SENSOR3, SAMPLE_SETPOINT,
+	SAMPLE_HEARTBEAT, SAMPLE_BEARING, SAMPLE_PPO2, SAMPLE_DECO
+};
+
+#define SAMPLE_FIELD(str, field) \
+	if (len == sizeof(str) - 1 && !memcmp(name, str, len)) return field
+
+/* Map "<attribute>.sample" to the sample field it sets */
+static enum sample_field sample_field(const char *name)
+{
+	const char *dot = strchr(name, '.');
+	int len;
+
+	if (!dot || !match_name("sample", dot + 1))
+		return SAMPLE_NONE;
+	len = dot - name;
+	switch (name[0]) {
+	case 'b':
+		SAMPLE_FIELD("bearing", SAMPLE_BEARING);
+		break;
+	case 'c':
+		SAMPLE_FIELD("cylpress", SAMPLE_PRESSURE);
+		SAMPLE_FIELD("cylinderindex", SAMPLE_CYLINDERINDEX);
+		SAMPLE_FIELD("cns", SAMPLE_CNS);
+		break;
+	case 'd':
+		SAMPLE_FIELD("depth", SAMPLE_DEPTH);
+		SAMPLE_FIELD("deco", SAMPLE_DECO);
+		break;
+	case 'h':
+		SAMPLE_FIELD("heartbeat", SAMPLE_HEARTBEAT);
+		break;
+	case 'i':
+		SAMPLE_FIELD("in_deco", SAMPLE_IN_DECO);
+		break;
+	case 'n':
+		SAMPLE_FIELD("ndl", SAMPLE_NDL);
+		break;
+	case 'o':
+		SAMPLE_FIELD("o2pressure", SAMPLE_O2PRESSURE);
+		break;
+	case 'p':
+		if (len == 9 && !memcmp(name, "pressure", 8) && name[8] >= '0' && name[8] <= '4')
+			return SAMPLE_PRESSURE0 + name[8] - '0';
+		SAMPLE_FIELD("pressure", SAMPLE_PRESSURE);
+		SAMPLE_FIELD("pdiluent", SAMPLE_PRESSURE);
+		SAMPLE_FIELD("po2", SAMPLE_SETPOINT);
+		SAMPLE_FIELD("ppo2", SAMPLE_PPO2);
+		break;
+	case 'r':
+		SAMPLE_FIELD("rbt", SAMPLE_RBT);
+		break;
+	case 's':
+		if (len == 7 && !memcmp(name, "sensor", 6) && name[6] >= '1' && name[6] <= '3')
+			return SAMPLE_SENSOR1 + name[6] - '1';
+		SAMPLE_FIELD("sensor", SAMPLE_SENSOR);
+		SAMPLE_FIELD("sampletime", SAMPLE_TIME);
+		SAMPLE_FIELD("stoptime", SAMPLE_STOPTIME);
+		SAMPLE_FIELD("stopdepth", SAMPLE_STOPDEPTH);
+		SAMPLE_FIELD("setpoint", SAMPLE_SETPOINT);
+		break;
+	case 't':
+		SAMPLE_FIELD("time", SAMPLE_TIME);
+		SAMPLE_FIELD("temp", SAMPLE_TEMPERATURE);
+		SAMPLE_FIELD("temperature", SAMPLE_TEMPERATURE);
+		SAMPLE_FIELD("tts", SAMPLE_TTS);
+		break;
+	}
+	return SAMPLE_NONE;
+}
+
+#undef SAMPLE_FIELD
+
 /* We're in samples - try to convert the random xml value to something useful */
 static void try_to_fill_sample(struct sample *sample, const char *name, char *buf, struct parser_state *state)
 {
 	int in_deco;
 	pressure_t p;
+	enum sample_field field;
 
 	start_match("sample", name, buf);
-	if (MATCH_STATE("pressure.sample", pressure, &sample->pressure[0]))
-		return;
-	if (MATCH_STATE("cylpress.sample", pressure, &sample->pressure[0]))
+	switch (field = sample_field(name)) {
+	case SAMPLE_PRESSURE:
+		pressure(buf, &sample->pressure[0], state);
 		return;
-	if (MATCH_STATE("pdiluent.sample", pressure, &sample->pressure[0]))
-		return;
-	if (MATCH_STATE("o2pressure.sample", pressure, &sample->pressure[1]))
+	case SAMPLE_O2PRESSURE:
+		pressure(buf, &sample->pressure[1], state);
 		return;
 	/* Christ, this is ugly */
-	if (MATCH_STATE("pressure0.sample", pressure, &p)) {
-		add_sample_pressure(sample, 0, p.mbar);
-		return;
-	}
-	if (MATCH_STATE("pressure1.sample", pressure, &p)) {
-		add_sample_pressure(sample, 1, p.mbar);
-		return;
-	}
-	if (MATCH_STATE("pressure2.sample", pressure, &p)) {
-		add_sample_pressure(sample, 2, p.mbar);
-		return;
-	}
-	if (MATCH_STATE("pressure3.sample", pressure, &p)) {
-		add_sample_pressure(sample, 3, p.mbar);
+	case SAMPLE_PRESSURE0:
+	case SAMPLE_PRESSURE1:
+	case SAMPLE_PRESSURE2:
+	case SAMPLE_PRESSURE3:
+	case SAMPLE_PRESSURE4:
+		pressure(buf, &p, state);
+		add_sample_pressure(sample, field - SAMPLE_PRESSURE0, p.mbar);
 		return;
-	}
-	if (MATCH_STATE("pressure4.sample", pressure, &p)) {
-		add_sample_pressure(sample, 4, p.mbar);
-		return;
-	}
-	if (MATCH_STATE("cylinderindex.sample", get_cylinderindex, &sample->sensor[0]))
+	case SAMPLE_CYLINDERINDEX:
+		get_cylinderindex(buf, &sample->sensor[0], state);
 		return;
-	if (MATCH("sensor.sample", get_sensor, &sample->sensor[0]))
+	case SAMPLE_SENSOR:
+		get_sensor(buf, &sample->sensor[0]);
 		return;
-	if (MATCH_STATE("depth.sample", depth, &sample->depth))
+	case SAMPLE_DEPTH:
+		depth(buf, &sample->depth, state);
 		return;
-	if (MATCH_STATE("temp.sample", temperature, &sample->temperature))
+	case SAMPLE_TEMPERATURE:
+		temperature(buf, &sample->temperature, state);
 		return;
-	if (MATCH_STATE("temperature.sample", temperature, &sample->temperature))
+	case SAMPLE_TIME:
+		sampletime(buf, &sample->time);
 		return;
-	if (MATCH("sampletime.sample", sampletime, &sample->time))
+	case SAMPLE_NDL:
+		sampletime(buf, &sample->ndl);
 		return;
-	if (MATCH("time.sample", sampletime, &sample->time))
+	case SAMPLE_TTS:
+		sampletime(buf, &sample->tts);
 		return;
-	if (MATCH("ndl.sample", sampletime, &sample->ndl))
+	case SAMPLE_IN_DECO:
+		get_index(buf, &in_deco);
+		sample->in_deco = (in_deco == 1);
 		return;
-	if (MATCH("tts.sample", sampletime, &sample->tts))
+	case SAMPLE_STOPTIME:
+		sampletime(buf, &sample->stoptime);
 		return;
-	if (MATCH("in_deco.sample", get_index, &in_deco)) {
-		sample->in_deco = (in_deco == 1);
+	case SAMPLE_STOPDEPTH:
+		depth(buf, &sample->stopdepth, state);
 		return;
-	}
-	if (MATCH("stoptime.sample", sampletime, &sample->stoptime))
+	case SAMPLE_CNS:
+		get_uint16(buf, &sample->cns);
 		return;
-	if (MATCH_STATE("stopdepth.sample", depth, &sample->stopdepth))
+	case SAMPLE_RBT:
+		sampletime(buf, &sample->rbt);
 		return;
-	if (MATCH("cns.sample", get_uint16, &sample->cns))
+	case SAMPLE_SENSOR1: // CCR O2 sensor data, up to 3 sensors
+	case SAMPLE_SENSOR2:
+	case SAMPLE_SENSOR3:
+		double_to_o2pressure(buf, &sample->o2sensor[field - SAMPLE_SENSOR1]);
 		return;
-	if (MATCH("rbt.sample", sampletime, &sample->rbt))
+	case SAMPLE_SETPOINT:
+		double_to_o2pressure(buf, &sample->setpoint);
 		return;
-	if (MATCH("sensor1.sample", double_to_o2pressure, &sample->o2sensor[0])) // CCR O2 sensor data
+	case SAMPLE_HEARTBEAT:
+		get_uint8(buf, &sample->heartbeat);
 		return;
-	if (MATCH("sensor2.sample", double_to_o2pressure, &sample->o2sensor[1]))
+	case SAMPLE_BEARING:
+		get_bearing(buf, &sample->bearing);
 		return;
-	if (MATCH("sensor3.sample", double_to_o2pressure, &sample->o2sensor[2])) // up to 3 CCR sensors
+	case SAMPLE_PPO2:
+		double_to_o2pressure(buf, &sample->o2sensor[state->next_o2_sensor]);
+		state->next_o2_sensor++;
 		return;
-	if (MATCH("po2.sample", double_to_o2pressure, &sample->setpoint))
+	case SAMPLE_DECO:
+		parse_libdc_deco(buf, sample);
 		return;
+	case SAMPLE_NONE:
+		break;
+	}
 	if (MATCH("heartbeat", get_uint8, &sample->heartbeat))
 		return;
 	if (MATCH("bearing", get_bearing, &sample->bearing))
 		return;
-	if (MATCH("setpoint.sample", double_to_o2pressure, &sample->setpoint))
-		return;
-	if (MATCH("ppo2.sample", double_to_o2pressure, &sample->o2sensor[state->next_o2_sensor])) {
-		state->next_o2_sensor++;
-		return;
-	}
-	if (MATCH("deco.sample", parse_libdc_deco, sample))
-		return;
 	if (MATCH("time.deco", sampletime, &sample->stoptime))
 		return;
 	if (MATCH_STATE("depth.deco", depth, &sample->stopdepth))
@@ -1143,7 +1230,8 @@ static void gps_lat(char *buffer, struct dive *dive, struct parser_state *state)
 	} else {
 		if (ds->location.lat.udeg && ds->location.lat.udeg != location.lat.udeg)
 			fprintf(stderr, "Oops, changing the latitude of existing dive site id %8x name %s; not good\n", ds->uuid, ds->name ?: "(unknown)");
-		ds->location.lat = location.lat;
+		location.lon = ds->location.lon;
+		set_dive_site_location(ds, &location);
 	}
 }
 
@@ -1159,7 +1247,8 @@ static void gps_long(char *buffer, struct dive *dive, struct parser_state *state
 	} else {
 		if (ds->location.lon.udeg && ds->location.lon.udeg != location.lon.udeg)
 			fprintf(stderr, "Oops, changing the longitude of existing dive site id %8x name %s; not good\n", ds->uuid, ds->name ?: "(unknown)");
-		ds->location.lon = location.lon;
+		location.lat = ds->location.lat;
+		set_dive_site_location(ds, &location);
 	}
 }
 
@@ -1174,7 +1263,10 @@ void parse_location(char *buffer, location_t *loc)
 
 static void gps_location(char *buffer, struct dive_site *ds)
 {
-	parse_location(buffer, &ds->location);
+	location_t location;
+
+	parse_location(buffer, &location);
+	set_dive_site_location(ds, &location);
 }
 
 static void gps_in_dive(char *buffer, struct dive *dive, struct parser_state *state)
@@ -1206,7 +1298,7 @@ static void gps_in_dive(char *buffer, struct dive *dive, struct parser_state *st
 			ds->notes = add_to_string(ds->notes, translate("gettextFromC", "multiple GPS locations for this dive site; also %s\n"), coords);
 			free(coords);
 		} else {
-			ds->location = location;
+			set_dive_site_location(ds, &location);
 		}
 	}
 }
@@ -1567,13 +1659,25 @@ static struct nesting {
 	  { NULL, }
 };
 
+static const struct nesting *find_nesting(const char *name)
+{
+	const struct nesting *rule = nesting;
+
+	do {
+		if (!strcmp(rule->name, name))
+			break;
+		rule++;
+	} while (rule->name);
+	return rule;
+}
+
 static bool traverse(xmlNode *root, struct parser_state *state)
 {
 	xmlNode *n;
 	bool ret = true;
 
 	for (n = root; n; n = n->next) {
-		struct nesting *rule = nesting;
+		const struct nesting *rule;
 
 		if (!n->name) {
 			if ((ret = visit(n, state)) == false)
@@ -1581,11 +1685,7 @@ static bool traverse(xmlNode *root, struct parser_state *state)
 			continue;
 		}
 
-		do {
-			if (!strcmp(rule->name, (const char *)n->name))
-				break;
-			rule++;
-		} while (rule->name);
+		rule = find_nesting((const char *)n->name);
 
 		if (rule->start)
 			rule->start(state);
@@ -1611,6 +1711,316 @@ static void reset_all(struct parser_state *state)
 	state->import_source = UNKNOWN;
 }
 
+/*
+ * Native Subsurface XML doesn't need XSLT, so it doesn't need a DOM
+ * either. It is fed through the libxml2 push parser in chunks, and
+ * the SAX events are turned into the same entry() calls and nesting
+ * rules that traverse() uses for the DOM. That keeps the memory use
+ * independent of the size of the log.
+ */
+#define XML_STREAM_CHUNK 65536
+
+enum xml_stream_result {
+	XML_STREAM_DONE,
+	XML_STREAM_NOT_NATIVE,
+	XML_STREAM_FAILED
+};
+
+struct xml_stream_element {
+	const struct nesting *rule;
+	char name[MAXNAME];		/* lower-cased, like nodename() */
+};
+
+struct xml_stream {
+	struct parser_state *state;
+	xmlParserCtxtPtr ctxt;
+	struct xml_stream_element *elements;
+	int depth, allocated;
+	struct membuffer text;		/* pending text or CDATA of the current element */
+	bool cdata;
+	bool not_native;
+
+	/* What the tables held before, to undo a file that turns out to be broken */
+	bool have_snapshot;
+	int old_nr_dives, old_nr_trips, old_nr_sites;
+	void **old_trips, **old_sites;	/* sorted by address */
+	void *old_devices;
+};
+
+static int compare_pointers(const void *a, const void *b)
+{
+	const void *pa = *(const void **)a;
+	const void *pb = *(const void **)b;
+	return pa < pb ? -1 : pa != pb;
+}
+
+static void **sorted_pointers(void *const *items, int nr)
+{
+	void **res;
+
+	if (!nr)
+		return NULL;
+	res = malloc(nr * sizeof(*res));
+	memcpy(res, items, nr * sizeof(*res));
+	qsort(res, nr, sizeof(*res), compare_pointers);
+	return res;
+}
+
+static bool in_sorted_pointers(void **sorted, int nr, const void *item)
+{
+	return nr && bsearch(&item, sorted, nr, sizeof(*sorted), compare_pointers);
+}
+
+static void stream_snapshot(struct xml_stream *stream)
+{
+	struct parser_state *state = stream->state;
+
+	stream->have_snapshot = true;
+	stream->old_nr_dives = state->target_table->nr;
+	stream->old_nr_trips = state->trips->nr;
+	stream->old_nr_sites = state->sites->nr;
+	stream->old_trips = sorted_pointers((void *const *)state->trips->trips, state->trips->nr);
+	stream->old_sites = sorted_pointers((void *const *)state->sites->dive_sites, state->sites->nr);
+	stream->old_devices = save_device_nodes();
+}
+
+/* Throw away the dives, trips, dive sites and dive computers a failed parse
+ * has added. Go through the usual removal functions, so that the indexes and
+ * caches of the tables are kept up to date. */
+static void stream_rollback(struct xml_stream *stream)
+{
+	struct parser_state *state = stream->state;
+	struct dive_table *table = state->target_table;
+	int i;
+
+	if (!stream->have_snapshot)
+		return;
+
+	if (state->cur_dive)
+		unregister_dive_from_dive_site(state->cur_dive);
+	for (i = table->nr - 1; i >= stream->old_nr_dives; i--) {
+		struct dive *d = table->dives[i];
+
+		if (table == &dive_table) {
+			delete_single_dive(i);
+			continue;
+		}
+		remove_dive_from_trip(d, state->trips);
+		unregister_dive_from_dive_site(d);
+		delete_dive_from_table(table, i);
+	}
+	if (table == &dive_table)
+		invalidate_dive_time_index();
+
+	for (i = state->trips->nr - 1; i >= 0; i--) {
+		dive_trip_t *trip = state->trips->trips[i];
+		if (!in_sorted_pointers(stream->old_trips, stream->old_nr_trips, trip)) {
+			remove_trip(trip, state->trips);
+			free_trip(trip);
+		}
+	}
+
+	for (i = state->sites->nr - 1; i >= 0; i--) {
+		struct dive_site *ds = state->sites->dive_sites[i];
+		if (!in_sorted_pointers(stream->old_sites, stream->old_nr_sites, ds))
+			delete_dive_site(ds, state->sites);
+	}
+
+	restore_device_nodes(stream->old_devices);
+}
+
+static void lower_name(char *dest, const char *name)
+{
+	int i;
+
+	for (i = 0; i < MAXNAME - 1 && name[i]; i++)
+		dest[i] = (name[i] >= 'A' && name[i] <= 'Z') ? name[i] - 'A' + 'a' : name[i];
+	dest[i] = 0;
+}
+
+static bool is_blank(const char *text, int len)
+{
+	while (len-- > 0) {
+		if (!IS_BLANK_CH(*text))
+			return false;
+		text++;
+	}
+	return true;
+}
+
+/* Hand the text collected for the current element to the parser */
+static void stream_flush_text(struct xml_stream *stream)
+{
+	char buffer[MAXNAME];
+	const char *name;
+	char *text;
+
+	if (!stream->text.len)
+		return;
+	if (stream->depth > 0 && !is_blank(stream->text.buffer, stream->text.len)) {
+		struct xml_stream_element *element = stream->elements + stream->depth - 1;
+
+		text = (char *)mb_cstring(&stream->text);
+		if (stream->depth > 1) {
+			snprintf(buffer, sizeof(buffer), "%s.%s", element->name, element[-1].name);
+			name = buffer;
+		} else {
+			name = element->name;
+		}
+		entry(name, text, stream->state);
+	}
+	stream->text.len = 0;
+	stream->cdata = false;
+}
+
+static void stream_start_element(void *ctx, const xmlChar *localname, const xmlChar *prefix, const xmlChar *uri,
+				 int nb_namespaces, const xmlChar **namespaces,
+				 int nb_attributes, int nb_defaulted, const xmlChar **attributes)
+{
+	UNUSED(prefix);
+	UNUSED(uri);
+	UNUSED(nb_namespaces);
+	UNUSED(namespaces);
+	UNUSED(nb_defaulted);
+	struct xml_stream *stream = ctx;
+	struct xml_stream_element *element;
+	char attribute[MAXNAME], buffer[MAXNAME];
+	int i;
+
+	if (!stream->depth) {
+		if (strcmp((const char *)localname, "divelog")) {
+			stream->not_native = true;
+			xmlStopParser(stream->ctxt);
+			return;
+		}
+		stream_snapshot(stream);
+	}
+
+	stream_flush_text(stream);
+	if (stream->depth == stream->allocated) {
+		stream->allocated = stream->allocated * 2 + 8;
+		stream->elements = realloc(stream->elements, stream->allocated * sizeof(*stream->elements));
+	}
+	element = stream->elements + stream->depth++;
+	lower_name(element->name, (const char *)localname);
+	element->rule = find_nesting((const char *)localname);
+	if (element->rule->start)
+		element->rule->start(stream->state);
+
+	/* Attributes come as (localname, prefix, URI, value, end) */
+	for (i = 0; i < nb_attributes; i++, attributes += 5) {
+		int len = attributes[4] - attributes[3];
+
+		if (is_blank((const char *)attributes[3], len))
+			continue;
+		stream->text.len = 0;
+		put_bytes(&stream->text, (const char *)attributes[3], len);
+		lower_name(attribute, (const char *)attributes[0]);
+		snprintf(buffer, sizeof(buffer), "%s.%s", attribute, element->name);
+		entry(buffer, (char *)mb_cstring(&stream->text), stream->state);
+	}
+	stream->text.len = 0;
+}
+
+static void stream_end_element(void *ctx, const xmlChar *localname, const xmlChar *prefix, const xmlChar *uri)
+{
+	UNUSED(localname);
+	UNUSED(prefix);
+	UNUSED(uri);
+	struct xml_stream *stream = ctx;
+	struct xml_stream_element *element;
+
+	stream_flush_text(stream);
+	element = stream->elements + --stream->depth;
+	if (element->rule->end)
+		element->rule->end(stream->state);
+}
+
+static void stream_characters(void *ctx, const xmlChar *ch, int len)
+{
+	struct xml_stream *stream = ctx;
+
+	if (stream->cdata)
+		stream_flush_text(stream);
+	put_bytes(&stream->text, (const char *)ch, len);
+}
+
+static void stream_cdata(void *ctx, const xmlChar *value, int len)
+{
+	struct xml_stream *stream = ctx;
+
+	if (!stream->cdata)
+		stream_flush_text(stream);
+	put_bytes(&stream->text, (const char *)value, len);
+	stream->cdata = true;
+}
+
+/* A comment splits the text around it into separate nodes */
+static void stream_comment(void *ctx, const xmlChar *value)
+{
+	UNUSED(value);
+	stream_flush_text(ctx);
+}
+
+/* Errors are reported by the DOM parser we fall back to */
+static void stream_error(void *ctx, const char *msg, ...)
+{
+	UNUSED(ctx);
+	UNUSED(msg);
+}
+
+static enum xml_stream_result stream_native_xml(const char *url, const char *buffer, struct parser_state *state)
+{
+	xmlSAXHandler sax;
+	struct xml_stream stream = { 0 };
+	int offset, size = strlen(buffer);
+	enum xml_stream_result res;
+
+	memset(&sax, 0, sizeof(sax));
+	sax.initialized = XML_SAX2_MAGIC;
+	sax.startElementNs = stream_start_element;
+	sax.endElementNs = stream_end_element;
+	sax.characters = stream_characters;
+	sax.ignorableWhitespace = stream_characters;
+	sax.cdataBlock = stream_cdata;
+	sax.comment = stream_comment;
+	sax.warning = stream_error;
+	sax.error = stream_error;
+	sax.fatalError = stream_error;
+
+	stream.state = state;
+	stream.ctxt = xmlCreatePushParserCtxt(&sax, &stream, NULL, 0, url);
+	if (!stream.ctxt)
+		return XML_STREAM_NOT_NATIVE;
+	/* Get attribute values with the entities already decoded */
+	xmlCtxtUseOptions(stream.ctxt, XML_PARSE_NOENT);
+
+	for (offset = 0; offset < size; offset += XML_STREAM_CHUNK) {
+		if (xmlParseChunk(stream.ctxt, buffer + offset, MIN(size - offset, XML_STREAM_CHUNK), 0))
+			break;
+	}
+	if (offset >= size)
+		xmlParseChunk(stream.ctxt, NULL, 0, 1);
+
+	if (stream.not_native) {
+		res = XML_STREAM_NOT_NATIVE;
+	} else if (!stream.ctxt->wellFormed || stream.depth) {
+		stream_rollback(&stream);
+		res = XML_STREAM_FAILED;
+	} else {
+		res = XML_STREAM_DONE;
+	}
+
+	xmlFreeParserCtxt(stream.ctxt);
+	free(stream.elements);
+	free(stream.old_trips);
+	free(stream.old_sites);
+	if (stream.old_devices)
+		free_device_nodes(stream.old_devices);
+	free_buffer(&stream.text);
+	return res;
+}
+
 /* divelog.de sends us xml files that claim to be iso-8859-1
  * but once we decode the HTML encoded characters they turn
  * into UTF-8 instead. So skip the incorrect encoding
@@ -1642,10 +2052,30 @@ int parse_xml_buffer(const char *url, const char *buffer, int size,
 {
 	UNUSED(size);
 	xmlDoc *doc;
-	const char *res = preprocess_divelog_de(buffer);
+	const char *res;
 	int ret = 0;
 	struct parser_state state;
 
+	/* Native logs are streamed; anything else, or a file the streaming
+	 * parser chokes on, goes through the DOM and the XSLT transforms */
+	if (!params) {
+		enum xml_stream_result stream_res;
+
+		init_parser_state(&state);
+		state.target_table = table;
+		state.trips = trips;
+		state.sites = sites;
+		reset_all(&state);
+		dive_start(&state);
+		stream_res = stream_native_xml(url, buffer, &state);
+		if (stream_res == XML_STREAM_DONE)
+			dive_end(&state);
+		free_parser_state(&state);
+		if (stream_res == XML_STREAM_DONE)
+			return 0;
+	}
+
+	res = preprocess_divelog_de(buffer);
 	init_parser_state(&state);
 	state.target_table = table;
 	state.trips = trips;
@@ -16,6 +16,89 @@
 
 struct dive_table dive_table;
 
+/*
+ * The SQL based parsers run a handful of queries for every dive. These
+ * are prepared once per import and only bound to the id of the dive,
+ * instead of formatting and parsing the SQL again for every dive.
+ */
+struct sql_query {
+	char *sql;
+	sqlite3_stmt *stmt;		/* NULL if the database doesn't support the query */
+	int columns;
+	char **data;			/* the values of a row, followed by the column names */
+	struct sql_query *next;
+};
+
+static void free_sql_queries(struct parser_state *state)
+{
+	struct sql_query *query = state->sql_queries;
+
+	while (query) {
+		struct sql_query *next = query->next;
+
+		sqlite3_finalize(query->stmt);
+		free(query->sql);
+		free(query->data);
+		free(query);
+		query = next;
+	}
+	state->sql_queries = NULL;
+}
+
+static struct sql_query *get_sql_query(struct parser_state *state, const char *sql)
+{
+	struct sql_query *query;
+	int i;
+
+	for (query = state->sql_queries; query; query = query->next) {
+		if (!strcmp(query->sql, sql))
+			return query;
+	}
+	query = calloc(1, sizeof(*query));
+	if (!query)
+		exit(1);
+	query->sql = strdup(sql);
+	if (sqlite3_prepare_v2(state->sql_handle, sql, -1, &query->stmt, NULL) != SQLITE_OK) {
+		sqlite3_finalize(query->stmt);
+		query->stmt = NULL;
+	} else {
+		query->columns = sqlite3_column_count(query->stmt);
+	}
+	query->data = calloc(2 * query->columns + 1, sizeof(char *));
+	if (!query->data)
+		exit(1);
+	for (i = 0; i < query->columns; i++)
+		query->data[query->columns + i] = (char *)sqlite3_column_name(query->stmt, i);
+	query->next = state->sql_queries;
+	state->sql_queries = query;
+	return query;
+}
+
+/*
+ * Like sqlite3_exec() for a query with a single parameter, the "?" in
+ * the SQL, which is bound to the given id. The callback gets the row
+ * as text, just like with sqlite3_exec().
+ */
+int sql_exec_id(struct parser_state *state, const char *sql, long id, sqlite3_callback callback, void *param)
+{
+	struct sql_query *query = get_sql_query(state, sql);
+	int i, retval;
+
+	if (!query->stmt)
+		return SQLITE_ERROR;
+	sqlite3_bind_int64(query->stmt, 1, id);
+	while ((retval = sqlite3_step(query->stmt)) == SQLITE_ROW) {
+		for (i = 0; i < query->columns; i++)
+			query->data[i] = (char *)sqlite3_column_text(query->stmt, i);
+		if (callback(param, query->columns, query->data, query->data + query->columns)) {
+			retval = SQLITE_ABORT;
+			break;
+		}
+	}
+	sqlite3_reset(query->stmt);
+	return retval == SQLITE_DONE ? SQLITE_OK : retval;
+}
+
 void init_parser_state(struct parser_state *state)
 {
 	memset(state, 0, sizeof(*state));
@@ -39,6 +122,7 @@ void free_parser_state(struct parser_state *state)
 	free((void *)state->cur_settings.dc.firmware);
 	free(state->country);
 	free(state->city);
+	free_sql_queries(state);
 }
 
 /*
@@ -424,7 +508,7 @@ void add_dive_site(char *ds_name, struct dive *dive, struct parser_state *state)
 		if (ds) {
 			// we have a dive site, let's hope there isn't a different name
 			if (empty_string(ds->name)) {
-				ds->name = copy_string(buffer);
+				set_dive_site_name(ds, buffer);
 			} else if (!same_string(ds->name, buffer)) {
 				// if it's not the same name, it's not the same dive site
 				// but wait, we could have gotten this one based on GPS coords and could
@@ -440,9 +524,9 @@ void add_dive_site(char *ds_name, struct dive *dive, struct parser_state *state)
 					add_dive_to_dive_site(dive, newds);
 					if (has_location(&state->cur_location)) {
 						// we started this uuid with GPS data, so lets use those
-						newds->location = state->cur_location;
+						set_dive_site_location(newds, &state->cur_location);
 					} else {
-						newds->location = ds->location;
+						set_dive_site_location(newds, &ds->location);
 					}
 					newds->notes = add_to_string(newds->notes, translate("gettextFromC", "additional name for site: %s\n"), ds->name);
 				}
@@ -6,6 +6,8 @@
 
 #include <sqlite3.h>
 
+struct sql_query;
+
 typedef union {
 	struct event event;
 	char allocation[sizeof(struct event) + MAX_EVENT_NAME];
@@ -65,6 +67,7 @@ struct parser_state {
 	struct dive_site_table *sites;		/* non-owning */
 
 	sqlite3 *sql_handle;			/* for SQL based parsers */
+	struct sql_query *sql_queries;		/* owning, prepared by sql_exec_id() */
 	event_allocation_t event_allocation;
 };
 
@@ -117,6 +120,7 @@ void utf8_string(char *buffer, void *_res);
 
 void add_dive_site(char *ds_name, struct dive *dive, struct parser_state *state);
 int atoi_n(char *ptr, unsigned int len);
+int sql_exec_id(struct parser_state *state, const char *sql, long id, sqlite3_callback callback, void *param);
 
 int parse_dm4_buffer(sqlite3 *handle, const char *url, const char *buf, int size, struct dive_table *table, struct trip_table *trips, struct dive_site_table *sites);
 int parse_dm5_buffer(sqlite3 *handle, const char *url, const char *buf, int size, struct dive_table *table, struct trip_table *trips, struct dive_site_table *sites);
@@ -22,13 +22,13 @@
 
 #define TIMESTEP 2 /* second */
 
-int decostoplevels_metric[] = { 0, 3000, 6000, 9000, 12000, 15000, 18000, 21000, 24000, 27000,
+static const int decostoplevels_metric[] = { 0, 3000, 6000, 9000, 12000, 15000, 18000, 21000, 24000, 27000,
 				  30000, 33000, 36000, 39000, 42000, 45000, 48000, 51000, 54000, 57000,
 				  60000, 63000, 66000, 69000, 72000, 75000, 78000, 81000, 84000, 87000,
 				  90000, 100000, 110000, 120000, 130000, 140000, 150000, 160000, 170000,
 				  180000, 190000, 200000, 220000, 240000, 260000, 280000, 300000,
 				  320000, 340000, 360000, 380000 };
-int decostoplevels_imperial[] = { 0, 3048, 6096, 9144, 12192, 15240, 18288, 21336, 24384, 27432,
+static const int decostoplevels_imperial[] = { 0, 3048, 6096, 9144, 12192, 15240, 18288, 21336, 24384, 27432,
 				30480, 33528, 36576, 39624, 42672, 45720, 48768, 51816, 54864, 57912,
 				60960, 64008, 67056, 70104, 73152, 76200, 79248, 82296, 85344, 88392,
 				91440, 101600, 111760, 121920, 132080, 142240, 152400, 162560, 172720,
@@ -37,12 +37,7 @@ int decostoplevels_imperial[] = { 0, 3048, 6096, 9144, 12192, 15240, 18288, 2133
 
 double plangflow, plangfhigh;
 
-extern double regressiona();
-extern double regressionb();
-extern void reset_regression();
-
 char *disclaimer;
-int plot_depth = 0;
 #if DEBUG_PLAN
 void dump_plan(struct diveplan *diveplan)
 {
@@ -109,11 +104,151 @@ void interpolate_transition(struct deco_state *ds, struct dive *dive, duration_t
 		add_segment(ds, depth_to_bar(depth, dive), gasmix, 1, po2.mbar, divemode, prefs.bottomsac);
 	}
 	if (d1.mm > d0.mm)
-		calc_crushing_pressure(ds, depth_to_bar(d1.mm, &displayed_dive));
+		calc_crushing_pressure(ds, depth_to_bar(d1.mm, dive));
+}
+
+/*
+ * The deco state after each sample of the (partial) dive, as computed by
+ * tissue_at_end(). Editing a plan usually leaves most of it unchanged, so a
+ * new plan only has to be simulated from the first sample that differs from
+ * the previous plan. A chain of states is keyed by the deco state, the dive
+ * parameters and the preferences it started from. Every plan() calls
+ * tissue_at_end() from two different starting states, hence two chains.
+ */
+#define WAYPOINT_CHAINS 2
+
+struct waypoint_state {
+	duration_t time;
+	depth_t depth;
+	o2pressure_t setpoint;
+	struct gasmix gasmix;
+	enum divemode_t divemode;
+	struct deco_state ds;
+};
+
+struct waypoint_chain {
+	struct deco_state start;
+	pressure_t surface_pressure;
+	int salinity;
+	int o2consumption, pscr_ratio, bottomsac;	/* the preferences add_segment() depends on */
+	unsigned int last_used;
+	int nr, allocated;
+	struct waypoint_state *states;
+};
+
+struct waypoint_cache {
+	unsigned int clock;
+	struct waypoint_chain chains[WAYPOINT_CHAINS];
+};
+
+struct waypoint_cache *alloc_waypoint_cache(void)
+{
+	struct waypoint_cache *cache = calloc(1, sizeof(*cache));
+	if (!cache)
+		exit(1);
+	return cache;
+}
+
+void free_waypoint_cache(struct waypoint_cache *cache)
+{
+	int i;
+
+	if (!cache)
+		return;
+	for (i = 0; i < WAYPOINT_CHAINS; i++)
+		free(cache->chains[i].states);
+	free(cache);
+}
+
+#define SAME_ARRAY(a, b, field) !memcmp((a)->field, (b)->field, sizeof((a)->field))
+
+/* The gradient factors only enter the ceiling, which tissue_at_end() computes
+ * for VPM-B only, and the regression is reset before it is used. Changing them
+ * doesn't invalidate the states, so they are not compared. */
+static bool same_start(const struct deco_state *a, const struct deco_state *b)
+{
+	return SAME_ARRAY(a, b, tissue_n2_sat) && SAME_ARRAY(a, b, tissue_he_sat) &&
+	       SAME_ARRAY(a, b, tolerated_by_tissue) && SAME_ARRAY(a, b, tissue_inertgas_saturation) &&
+	       SAME_ARRAY(a, b, buehlmann_inertgas_a) && SAME_ARRAY(a, b, buehlmann_inertgas_b) &&
+	       SAME_ARRAY(a, b, max_n2_crushing_pressure) && SAME_ARRAY(a, b, max_he_crushing_pressure) &&
+	       SAME_ARRAY(a, b, crushing_onset_tension) && SAME_ARRAY(a, b, n2_regen_radius) &&
+	       SAME_ARRAY(a, b, he_regen_radius) && a->max_ambient_pressure == b->max_ambient_pressure &&
+	       SAME_ARRAY(a, b, bottom_n2_gradient) && SAME_ARRAY(a, b, bottom_he_gradient) &&
+	       SAME_ARRAY(a, b, initial_n2_gradient) && SAME_ARRAY(a, b, initial_he_gradient) &&
+	       a->first_ceiling_pressure.mbar == b->first_ceiling_pressure.mbar &&
+	       a->max_bottom_ceiling_pressure.mbar == b->max_bottom_ceiling_pressure.mbar &&
+	       a->ci_pointing_to_guiding_tissue == b->ci_pointing_to_guiding_tissue &&
+	       a->gf_low_pressure_this_dive == b->gf_low_pressure_this_dive &&
+	       a->deco_time == b->deco_time && a->icd_warning == b->icd_warning &&
+	       same_deco_model(&a->config, &b->config);
+}
+
+#undef SAME_ARRAY
+
+static struct waypoint_chain *get_waypoint_chain(struct waypoint_cache *cache, const struct deco_state *ds, const struct dive *dive)
+{
+	struct waypoint_chain *chain = NULL;
+	int i;
+
+	if (!cache)
+		return NULL;
+	for (i = 0; i < WAYPOINT_CHAINS; i++) {
+		struct waypoint_chain *c = &cache->chains[i];
+		if (c->last_used && c->surface_pressure.mbar == dive->surface_pressure.mbar &&
+		    c->salinity == dive->salinity && c->o2consumption == prefs.o2consumption &&
+		    c->pscr_ratio == prefs.pscr_ratio && c->bottomsac == prefs.bottomsac && same_start(&c->start, ds)) {
+			chain = c;
+			break;
+		}
+	}
+	if (!chain) {
+		/* replace the least recently used chain */
+		chain = &cache->chains[0];
+		for (i = 1; i < WAYPOINT_CHAINS; i++) {
+			if (cache->chains[i].last_used < chain->last_used)
+				chain = &cache->chains[i];
+		}
+		chain->start = *ds;
+		chain->surface_pressure = dive->surface_pressure;
+		chain->salinity = dive->salinity;
+		chain->o2consumption = prefs.o2consumption;
+		chain->pscr_ratio = prefs.pscr_ratio;
+		chain->bottomsac = prefs.bottomsac;
+		chain->nr = 0;
+	}
+	chain->last_used = ++cache->clock;
+	return chain;
+}
+
+static bool same_waypoint(const struct waypoint_state *state, duration_t time, depth_t depth, o2pressure_t setpoint, struct gasmix gasmix, enum divemode_t divemode)
+{
+	return state->time.seconds == time.seconds && state->depth.mm == depth.mm && state->setpoint.mbar == setpoint.mbar &&
+	       same_gasmix(state->gasmix, gasmix) && state->divemode == divemode;
+}
+
+static void add_waypoint(struct waypoint_chain *chain, duration_t time, depth_t depth, o2pressure_t setpoint, struct gasmix gasmix, enum divemode_t divemode, const struct deco_state *ds)
+{
+	struct waypoint_state *state;
+
+	if (chain->nr >= chain->allocated) {
+		int allocated = (chain->allocated + 8) * 3 / 2;
+		state = realloc(chain->states, allocated * sizeof(struct waypoint_state));
+		if (!state)
+			exit(1);
+		chain->states = state;
+		chain->allocated = allocated;
+	}
+	state = &chain->states[chain->nr++];
+	state->time = time;
+	state->depth = depth;
+	state->setpoint = setpoint;
+	state->gasmix = gasmix;
+	state->divemode = divemode;
+	state->ds = *ds;
 }
 
 /* returns the tissue tolerance at the end of this (partial) dive */
-int tissue_at_end(struct deco_state *ds, struct dive *dive, struct deco_state **cached_datap)
+int tissue_at_end(struct deco_state *ds, struct dive *dive, struct deco_state **cached_datap, struct waypoint_cache *waypoints)
 {
 	struct divecomputer *dc;
 	struct sample *sample, *psample;
@@ -122,6 +257,8 @@ int tissue_at_end(struct deco_state *ds, struct dive *dive, struct deco_state **
 	duration_t t0 = {}, t1 = {};
 	struct gasmix gas;
 	int surface_interval = 0;
+	struct waypoint_chain *chain;
+	int matched = 0;
 
 	if (!dive)
 		return 0;
@@ -135,6 +272,7 @@ int tissue_at_end(struct deco_state *ds, struct dive *dive, struct deco_state **
 	if (!dc->samples)
 		return 0;
 	psample = sample = dc->sample;
+	chain = get_waypoint_chain(waypoints, ds, dive);
 
 	const struct event *evdm = NULL;
 	enum divemode_t divemode = UNDEF_COMP_TYPE;
@@ -151,6 +289,20 @@ int tissue_at_end(struct deco_state *ds, struct dive *dive, struct deco_state **
 		gas = get_gasmix_at_time(dive, dc, t0);
 		if (i > 0)
 			lastdepth = psample->depth;
+		divemode = get_current_divemode(&dive->dc, t0.seconds + 1, &evdm, &divemode);
+
+		if (chain && matched == i) {
+			/* Skip the samples that are the same as in the previous plan */
+			if (i < chain->nr && same_waypoint(&chain->states[i], t1, sample->depth, setpoint, gas, divemode)) {
+				matched++;
+				psample = sample;
+				t0 = t1;
+				continue;
+			}
+			if (matched)
+				restore_deco_state(&chain->states[matched - 1].ds, ds, false);
+			chain->nr = matched;
+		}
 
 		/* The ceiling in the deeper portion of a multilevel dive is sometimes critical for the VPM-B
 		 * Boyle's law compensation.  We should check the ceiling prior to ascending during the bottom
@@ -161,7 +313,7 @@ int tissue_at_end(struct deco_state *ds, struct dive *dive, struct deco_state **
 		 * portion of the dive.
 		 * Remember the value for later.
 		 */
-		if ((decoMode() == VPMB) && (lastdepth.mm > sample->depth.mm)) {
+		if ((ds->config.deco_mode == VPMB) && (lastdepth.mm > sample->depth.mm)) {
 			pressure_t ceiling_pressure;
 			nuclear_regeneration(ds, t0.seconds);
 			vpmb_start_gradient(ds);
@@ -175,11 +327,14 @@ int tissue_at_end(struct deco_state *ds, struct dive *dive, struct deco_state **
 				ds->max_bottom_ceiling_pressure.mbar = ceiling_pressure.mbar;
 		}
 
-		divemode = get_current_divemode(&dive->dc, t0.seconds + 1, &evdm, &divemode);
 		interpolate_transition(ds, dive, t0, t1, lastdepth, sample->depth, gas, setpoint, divemode);
+		if (chain)
+			add_waypoint(chain, t1, sample->depth, setpoint, gas, divemode, ds);
 		psample = sample;
 		t0 = t1;
 	}
+	if (chain && matched == dc->samples)
+		restore_deco_state(&chain->states[matched - 1].ds, ds, false);
 	return surface_interval;
 }
 
@@ -407,18 +562,33 @@ struct divedatapoint *plan_add_segment(struct diveplan *diveplan, int duration,
 	return dp;
 }
 
+/* Tell the planner about the gases it may switch to on the ascent: every used cylinder with a switch depth */
+void plan_add_gases(struct diveplan *diveplan, const struct dive *dive)
+{
+	int i;
+
+	for (i = 0; i < MAX_CYLINDERS; i++) {
+		const cylinder_t *cyl = &dive->cylinder[i];
+		if (cyl->depth.mm && cyl->cylinder_use != NOT_USED) {
+			struct divedatapoint *dp = create_dp(0, cyl->depth.mm, i, 0);
+			dp->next = diveplan->dp;
+			diveplan->dp = dp;
+		}
+	}
+}
+
 struct gaschanges {
 	int depth;
 	int gasidx;
 };
 
 
-static struct gaschanges *analyze_gaslist(struct diveplan *diveplan, int *gaschangenr, int depth, int *asc_cylinder)
+static struct gaschanges *analyze_gaslist(struct diveplan *diveplan, struct dive *dive, int *gaschangenr, int depth, int *asc_cylinder)
 {
 	int nr = 0;
 	struct gaschanges *gaschanges = NULL;
 	struct divedatapoint *dp = diveplan->dp;
-	int best_depth = displayed_dive.cylinder[*asc_cylinder].depth.mm;
+	int best_depth = dive->cylinder[*asc_cylinder].depth.mm;
 	bool total_time_zero = true;
 	while (dp) {
 		if (dp->time == 0 && total_time_zero) {
@@ -453,7 +623,7 @@ static struct gaschanges *analyze_gaslist(struct diveplan *diveplan, int *gascha
 	for (nr = 0; nr < *gaschangenr; nr++) {
 		int idx = gaschanges[nr].gasidx;
 		printf("gaschange nr %d: @ %5.2lfm gasidx %d (%s)\n", nr, gaschanges[nr].depth / 1000.0,
-		       idx, gasname(&displayed_dive.cylinder[idx].gasmix));
+		       idx, gasname(&dive->cylinder[idx].gasmix));
 	}
 #endif
 	return gaschanges;
@@ -534,15 +704,15 @@ int ascent_velocity(int depth, int avg_depth, int bottom_time)
 	}
 }
 
-void track_ascent_gas(int depth, cylinder_t *cylinder, int avg_depth, int bottom_time, bool safety_stop, enum divemode_t divemode)
+void track_ascent_gas(struct dive *dive, int depth, cylinder_t *cylinder, int avg_depth, int bottom_time, bool safety_stop, enum divemode_t divemode)
 {
 	while (depth > 0) {
 		int deltad = ascent_velocity(depth, avg_depth, bottom_time) * TIMESTEP;
 		if (deltad > depth)
 			deltad = depth;
-		update_cylinder_pressure(&displayed_dive, depth, depth - deltad, TIMESTEP, prefs.decosac, cylinder, true, divemode);
+		update_cylinder_pressure(dive, depth, depth - deltad, TIMESTEP, prefs.decosac, cylinder, true, divemode);
 		if (depth <= 5000 && depth >= (5000 - deltad) && safety_stop) {
-			update_cylinder_pressure(&displayed_dive, 5000, 5000, 180, prefs.decosac, cylinder, true, divemode);
+			update_cylinder_pressure(dive, 5000, 5000, 180, prefs.decosac, cylinder, true, divemode);
 			safety_stop = false;
 		}
 		depth -= deltad;
@@ -564,7 +734,7 @@ bool trial_ascent(struct deco_state *ds, int wait_time, int trial_depth, int sto
 		add_segment(ds, depth_to_bar(trial_depth, dive),
 			    gasmix,
 			    wait_time, po2, divemode, prefs.decosac);
-	if (decoMode() == VPMB && (deco_allowed_depth(tissue_tolerance_calc(ds, dive,depth_to_bar(stoplevel, dive)),
+	if (ds->config.deco_mode == VPMB && (deco_allowed_depth(tissue_tolerance_calc(ds, dive,depth_to_bar(stoplevel, dive)),
 						      surface_pressure, dive, 1)
 				   > stoplevel)) {
 		restore_deco_state(trial_cache, ds, false);
@@ -596,10 +766,10 @@ bool trial_ascent(struct deco_state *ds, int wait_time, int trial_depth, int sto
  * Also return true if this cannot be calculated because the cylinder doesn't have
  * size or a starting pressure.
  */
-bool enough_gas(int current_cylinder)
+bool enough_gas(struct dive *dive, int current_cylinder)
 {
 	cylinder_t *cyl;
-	cyl = &displayed_dive.cylinder[current_cylinder];
+	cyl = &dive->cylinder[current_cylinder];
 
 	if (!cyl->start.mbar)
 		return true;
@@ -632,6 +802,11 @@ int wait_until(struct deco_state *ds, struct dive *dive, int clock, int min, int
 	return wait_until(ds, dive, clock, min, leap / 2, stepsize, depth, target_depth, avg_depth, bottom_time, gasmix, po2, surface_pressure, divemode);
 }
 
+static bool plan_cancelled(const struct diveplan *diveplan)
+{
+	return diveplan->cancelled && diveplan->cancelled(diveplan->cancel_data);
+}
+
 // Work out the stops. Return value is if there were any mandatory stops.
 
 
@@ -643,6 +818,18 @@ void printdecotable(struct decostop *table)
 	}
 }
 
+/* Quiet plans only need the CNS and OTU that the notes calculate */
+static void finish_plan_notes(struct diveplan *diveplan, struct dive *dive, bool show_disclaimer, int error)
+{
+	if (!diveplan->quiet) {
+		add_plan_to_notes(diveplan, dive, show_disclaimer, error);
+		return;
+	}
+	dive->cns = 0;
+	dive->maxcns = 0;
+	update_cylinder_related_info(dive);
+}
+
 bool plan(struct deco_state *ds, struct diveplan *diveplan, struct dive *dive, int timestep, struct decostop *decostoptable, struct deco_state **cached_datap, bool is_planner, bool show_disclaimer)
 {
 
@@ -661,8 +848,8 @@ bool plan(struct deco_state *ds, struct diveplan *diveplan, struct dive *dive, i
 	int depth;
 	struct gaschanges *gaschanges = NULL;
 	int gaschangenr;
-	int *decostoplevels;
-	int decostoplevelcount;
+	int decostoplevels[sizeof(decostoplevels_metric) / sizeof(int)];
+	int decostoplevelcount = sizeof(decostoplevels) / sizeof(int);
 	int *stoplevels = NULL;
 	bool stopping = false;
 	bool pendinggaschange = false;
@@ -682,8 +869,10 @@ bool plan(struct deco_state *ds, struct diveplan *diveplan, struct dive *dive, i
 	int decostopcounter = 0;
 	enum divemode_t divemode = dive->dc.divemode;
 
-	set_gf(diveplan->gflow, diveplan->gfhigh);
-	set_vpmb_conservatism(diveplan->vpmb_conservatism);
+	/* Not in_planner(): plans are also computed in worker threads */
+	init_deco_config(&ds->config, is_planner);
+	set_gf(&ds->config, diveplan->gflow, diveplan->gfhigh);
+	set_vpmb_conservatism(&ds->config, diveplan->vpmb_conservatism);
 	if (!diveplan->surface_pressure)
 		diveplan->surface_pressure = SURFACE_PRESSURE;
 	dive->surface_pressure.mbar = diveplan->surface_pressure;
@@ -691,14 +880,12 @@ bool plan(struct deco_state *ds, struct diveplan *diveplan, struct dive *dive, i
 	ds->max_bottom_ceiling_pressure.mbar = ds->first_ceiling_pressure.mbar = 0;
 	create_dive_from_plan(diveplan, dive, is_planner);
 
-	// Do we want deco stop array in metres or feet?
-	if (prefs.units.length == METERS ) {
-		decostoplevels = decostoplevels_metric;
-		decostoplevelcount = sizeof(decostoplevels_metric) / sizeof(int);
-	} else {
-		decostoplevels = decostoplevels_imperial;
-		decostoplevelcount = sizeof(decostoplevels_imperial) / sizeof(int);
-	}
+	// Do we want deco stop array in metres or feet? Work on a copy, plans
+	// for the stop time variations are computed concurrently.
+	if (prefs.units.length == METERS )
+		memcpy(decostoplevels, decostoplevels_metric, sizeof(decostoplevels));
+	else
+		memcpy(decostoplevels, decostoplevels_imperial, sizeof(decostoplevels));
 
 	/* If the user has selected last stop to be at 6m/20', we need to get rid of the 3m/10' stop.
 	 * Otherwise reinstate the last stop 3m/10' stop.
@@ -754,7 +941,7 @@ bool plan(struct deco_state *ds, struct diveplan *diveplan, struct dive *dive, i
 		gaschanges = NULL;
 		gaschangenr = 0;
 	} else {
-		gaschanges = analyze_gaslist(diveplan, &gaschangenr, depth, &best_first_ascend_cylinder);
+		gaschanges = analyze_gaslist(diveplan, dive, &gaschangenr, depth, &best_first_ascend_cylinder);
 	}
 	/* Find the first potential decostopdepth above current depth */
 	for (stopidx = 0; stopidx < decostoplevelcount; stopidx++)
@@ -769,12 +956,12 @@ bool plan(struct deco_state *ds, struct diveplan *diveplan, struct dive *dive, i
 	gi = gaschangenr - 1;
 
 	/* Set tissue tolerance and initial vpmb gradient at start of ascent phase */
-	diveplan->surface_interval = tissue_at_end(ds, dive, cached_datap);
+	diveplan->surface_interval = tissue_at_end(ds, dive, cached_datap, diveplan->waypoint_cache);
 	nuclear_regeneration(ds, clock);
 	vpmb_start_gradient(ds);
-	if (decoMode() == RECREATIONAL) {
+	if (ds->config.deco_mode == RECREATIONAL) {
 		bool safety_stop = prefs.safetystop && max_depth >= 10000;
-		track_ascent_gas(depth, &dive->cylinder[current_cylinder], avg_depth, bottom_time, safety_stop, divemode);
+		track_ascent_gas(dive, depth, &dive->cylinder[current_cylinder], avg_depth, bottom_time, safety_stop, divemode);
 		// How long can we stay at the current depth and still directly ascent to the surface?
 		do {
 			add_segment(ds, depth_to_bar(depth, dive),
@@ -784,7 +971,7 @@ bool plan(struct deco_state *ds, struct diveplan *diveplan, struct dive *dive, i
 			clock += timestep;
 		} while (trial_ascent(ds, 0, depth, 0, avg_depth, bottom_time, dive->cylinder[current_cylinder].gasmix,
 				      po2, diveplan->surface_pressure / 1000.0, dive, divemode) &&
-			 enough_gas(current_cylinder) && clock < 6 * 3600);
+			 enough_gas(dive, current_cylinder) && clock < 6 * 3600);
 
 		// We did stay one DECOTIMESTEP too many.
 		// In the best of all worlds, we would roll back also the last add_segment in terms of caching deco state, but
@@ -818,7 +1005,7 @@ bool plan(struct deco_state *ds, struct diveplan *diveplan, struct dive *dive, i
 		} while (depth > 0);
 		plan_add_segment(diveplan, clock - previous_point_time, 0, current_cylinder, po2, false, divemode);
 		create_dive_from_plan(diveplan, dive, is_planner);
-		add_plan_to_notes(diveplan, dive, show_disclaimer, error);
+		finish_plan_notes(diveplan, dive, show_disclaimer, error);
 		fixup_dc_duration(&dive->dc);
 
 		free(stoplevels);
@@ -837,7 +1024,7 @@ bool plan(struct deco_state *ds, struct diveplan *diveplan, struct dive *dive, i
 	}
 
 	// VPM-B or Buehlmann Deco
-	tissue_at_end(ds, dive, cached_datap);
+	tissue_at_end(ds, dive, cached_datap, diveplan->waypoint_cache);
 	previous_deco_time = 100000000;
 	ds->deco_time = 10000000;
 	cache_deco_state(ds, &bottom_cache);  // Lets us make several iterations
@@ -849,7 +1036,9 @@ bool plan(struct deco_state *ds, struct diveplan *diveplan, struct dive *dive, i
 	//CVA
 	do {
 		decostopcounter = 0;
-		is_final_plan = (decoMode() == BUEHLMANN) || (previous_deco_time - ds->deco_time < 10);  // CVA time converges
+		if (plan_cancelled(diveplan))
+			goto cancelled;
+		is_final_plan = (ds->config.deco_mode == BUEHLMANN) || (previous_deco_time - ds->deco_time < 10);  // CVA time converges
 		if (ds->deco_time != 10000000)
 			vpmb_next_gradient(ds, ds->deco_time, diveplan->surface_pressure / 1000.0);
 
@@ -878,10 +1067,11 @@ bool plan(struct deco_state *ds, struct diveplan *diveplan, struct dive *dive, i
 		else
 			current_cylinder = get_gasidx(dive, gas);
 		if (current_cylinder == -1) {
-			report_error(translate("gettextFromC", "Can't find gas %s"), gasname(gas));
+			if (!diveplan->quiet)
+				report_error(translate("gettextFromC", "Can't find gas %s"), gasname(gas));
 			current_cylinder = 0;
 		}
-		reset_regression();
+		reset_regression(ds);
 		while (1) {
 			/* We will break out when we hit the surface */
 			do {
@@ -905,7 +1095,7 @@ bool plan(struct deco_state *ds, struct diveplan *diveplan, struct dive *dive, i
 				depth -= deltad;
 				/* Print VPM-Gradient as gradient factor, this has to be done from within deco.c */
 				if (decodive)
-					plot_depth = depth;
+					ds->regression.plot_depth = depth;
 			} while (depth > 0 && depth > stoplevels[stopidx]);
 
 			if (depth <= 0)
@@ -953,6 +1143,9 @@ bool plan(struct deco_state *ds, struct diveplan *diveplan, struct dive *dive, i
 			}
 			--stopidx;
 
+			if (plan_cancelled(diveplan))
+				goto cancelled;
+
 			/* Save the current state and try to ascend to the next stopdepth */
 			while (1) {
 				/* Check if ascending to next stop is clear, go back and wait if we hit the ceiling on the way */
@@ -1075,9 +1268,9 @@ bool plan(struct deco_state *ds, struct diveplan *diveplan, struct dive *dive, i
 	decostoptable[decostopcounter].depth = 0;
 
 	plan_add_segment(diveplan, clock - previous_point_time, 0, current_cylinder, po2, false, divemode);
-	if (decoMode() == VPMB) {
-		diveplan->eff_gfhigh = lrint(100.0 * regressionb());
-		diveplan->eff_gflow = lrint(100.0 * (regressiona() * first_stop_depth + regressionb()));
+	if (ds->config.deco_mode == VPMB) {
+		diveplan->eff_gfhigh = lrint(100.0 * regressionb(ds));
+		diveplan->eff_gflow = lrint(100.0 * (regressiona(ds) * first_stop_depth + regressionb(ds)));
 	}
 
 	for (int i = 0; i < MAX_CYLINDERS; i++)
@@ -1090,13 +1283,21 @@ bool plan(struct deco_state *ds, struct diveplan *diveplan, struct dive *dive, i
 		}
 	plan_add_segment(diveplan, prefs.surface_segment, 0, current_cylinder, 0, false, OC);
 	create_dive_from_plan(diveplan, dive, is_planner);
-	add_plan_to_notes(diveplan, dive, show_disclaimer, error);
+	finish_plan_notes(diveplan, dive, show_disclaimer, error);
 	fixup_dc_duration(&dive->dc);
 
 	free(stoplevels);
 	free(gaschanges);
 	free(bottom_cache);
 	return decodive;
+
+cancelled:
+	/* The caller is not interested in the result anymore, but leave a valid stop table */
+	decostoptable[0].depth = 0;
+	free(stoplevels);
+	free(gaschanges);
+	free(bottom_cache);
+	return false;
 }
 
 /*
@@ -23,6 +23,8 @@ extern bool diveplan_empty(struct diveplan *diveplan);
 extern void add_plan_to_notes(struct diveplan *diveplan, struct dive *dive, bool show_disclaimer, int error);
 
 extern void free_dps(struct diveplan *diveplan);
+extern struct waypoint_cache *alloc_waypoint_cache(void);
+extern void free_waypoint_cache(struct waypoint_cache *cache);
 extern struct dive *planned_dive;
 extern char *cache_data;
 extern char *disclaimer;
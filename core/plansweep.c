@@ -0,0 +1,199 @@
+// SPDX-License-Identifier: GPL-2.0
+/* plansweep.c
+ *
+ * plan a grid of dives for runtime tables
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "dive.h"
+#include "deco.h"
+#include "planner.h"
+#include "qthelper.h"
+#include "membuffer.h"
+#include "plansweep.h"
+
+struct sweep_job {
+	const struct plan_sweep *sweep;
+	struct sweep_result *results;
+};
+
+int sweep_size(const struct plan_sweep *sweep)
+{
+	return sweep->nr_depths * sweep->nr_times * sweep->nr_gases * sweep->nr_gfs;
+}
+
+/* The stops, the run time at the surface and the TTS from the finished plan */
+static void get_stops(const struct diveplan *diveplan, struct sweep_result *res)
+{
+	const struct divedatapoint *dp;
+	int lastdepth = 0, lasttime = 0, bottom_time = 0;
+
+	for (dp = diveplan->dp; dp; dp = dp->next) {
+		if (!dp->time)
+			continue; /* the gases, not a segment */
+		if (dp->entered) {
+			bottom_time = dp->time;
+		} else if (dp->depth.mm && dp->depth.mm == lastdepth) {
+			if (res->nr_stops && res->stops[res->nr_stops - 1].depth == lastdepth) {
+				res->stops[res->nr_stops - 1].time += dp->time - lasttime;
+			} else if (res->nr_stops < MAX_SWEEP_STOPS) {
+				res->stops[res->nr_stops].depth = lastdepth;
+				res->stops[res->nr_stops].time = dp->time - lasttime;
+				res->nr_stops++;
+			}
+		} else if (!dp->depth.mm && !res->runtime) {
+			res->runtime = dp->time;
+		}
+		lastdepth = dp->depth.mm;
+		lasttime = dp->time;
+	}
+	res->tts = res->runtime - bottom_time;
+}
+
+/* Set up the dive and the plan the way the planner does for a new plan */
+static void plan_sweep_item(void *data, int i)
+{
+	struct sweep_job *job = data;
+	const struct plan_sweep *sweep = job->sweep;
+	struct sweep_result *res = &job->results[i];
+	const struct sweep_gases *gases;
+	struct dive *dive = alloc_dive();
+	struct diveplan diveplan = { 0 };
+	struct deco_state ds;
+	struct deco_state *cache = NULL;
+	struct decostop stoptable[60];
+	pressure_t decopo2 = { .mbar = prefs.decopo2 };
+	int depth, descent, j;
+
+	res->gf = i % sweep->nr_gfs;
+	i /= sweep->nr_gfs;
+	res->gases = i % sweep->nr_gases;
+	i /= sweep->nr_gases;
+	res->time = i % sweep->nr_times;
+	res->depth = i / sweep->nr_times;
+	gases = &sweep->gases[res->gases];
+	depth = sweep->depths[res->depth];
+
+	dive->salinity = diveplan.salinity = sweep->salinity;
+	dive->surface_pressure.mbar = diveplan.surface_pressure = sweep->surface_pressure;
+	for (j = 0; j < gases->nr; j++) {
+		cylinder_t *cyl = &dive->cylinder[j];
+		cyl->gasmix = gases->gasmix[j];
+		cyl->depth = gases->depth[j].mm ? gases->depth[j] : gas_mod(cyl->gasmix, decopo2, dive, M_OR_FT(3, 10));
+	}
+	diveplan.bottomsac = sweep->bottomsac;
+	diveplan.decosac = sweep->decosac;
+	diveplan.gflow = sweep->gfs[res->gf].gflow;
+	diveplan.gfhigh = sweep->gfs[res->gf].gfhigh;
+	diveplan.vpmb_conservatism = sweep->vpmb_conservatism;
+	diveplan.quiet = true;
+
+	descent = depth / prefs.descrate;
+	plan_add_segment(&diveplan, descent, depth, 0, 0, true, OC);
+	if (sweep->times[res->time] > descent)
+		plan_add_segment(&diveplan, sweep->times[res->time] - descent, depth, 0, 0, true, OC);
+	plan_add_gases(&diveplan, dive);
+
+	memset(&ds, 0, sizeof(ds));
+	res->deco = plan(&ds, &diveplan, dive, DECOTIMESTEP, stoptable, &cache, true, false);
+	get_stops(&diveplan, res);
+	res->cns = dive->maxcns;
+	res->otu = dive->otu;
+	for (j = 0; j < gases->nr; j++)
+		res->gas_used[j] = dive->cylinder[j].gas_used;
+
+	free(cache);
+	free_dps(&diveplan);
+	free_dive(dive);
+}
+
+/* Returns the results of all plans of the grid, see sweep_size(). The caller frees them. */
+struct sweep_result *run_plan_sweep(const struct plan_sweep *sweep)
+{
+	struct sweep_job job = { sweep, NULL };
+	int nr = sweep_size(sweep);
+
+	if (nr <= 0)
+		return NULL;
+	job.results = calloc(nr, sizeof(struct sweep_result));
+	if (!job.results)
+		exit(1);
+	/* The plans are independent, spread them over all cores */
+	run_parallel(nr, plan_sweep_item, &job);
+	return job.results;
+}
+
+static void put_gases(struct membuffer *b, const struct sweep_gases *gases, const char *sep)
+{
+	int j;
+
+	for (j = 0; j < gases->nr; j++)
+		put_format(b, "%s%s", j ? sep : "", gasname(gases->gasmix[j]));
+}
+
+static int max_gases(const struct plan_sweep *sweep)
+{
+	int i, nr = 0;
+
+	for (i = 0; i < sweep->nr_gases; i++) {
+		if (sweep->gases[i].nr > nr)
+			nr = sweep->gases[i].nr;
+	}
+	return nr;
+}
+
+/* One line per plan. Depths in m, times in min:sec and gas use in l, like the planner notes. */
+void save_sweep_csv(struct membuffer *b, const struct plan_sweep *sweep, const struct sweep_result *results)
+{
+	int i, j, nr = sweep_size(sweep), nr_gases = max_gases(sweep);
+
+	put_string(b, "depth,bottom time,gases,gf low,gf high,runtime,tts,cns,otu");
+	for (j = 0; j < nr_gases; j++)
+		put_format(b, ",gas %d used", j + 1);
+	put_string(b, ",stops\n");
+	for (i = 0; i < nr; i++) {
+		const struct sweep_result *res = &results[i];
+		const struct sweep_gf *gf = &sweep->gfs[res->gf];
+		int time = sweep->times[res->time];
+
+		put_format(b, "%.1f,%d:%02d,", sweep->depths[res->depth] / 1000.0, FRACTION(time, 60));
+		put_gases(b, &sweep->gases[res->gases], "+");
+		put_format(b, ",%d,%d,%d:%02d,%d:%02d,%d,%d", gf->gflow, gf->gfhigh,
+			   FRACTION(res->runtime, 60), FRACTION(res->tts, 60), res->cns, res->otu);
+		for (j = 0; j < nr_gases; j++) {
+			if (j < sweep->gases[res->gases].nr)
+				put_format(b, ",%d", (res->gas_used[j].mliter + 500) / 1000);
+			else
+				put_string(b, ",");
+		}
+		put_string(b, ",");
+		for (j = 0; j < res->nr_stops; j++)
+			put_format(b, "%s%.1f/%d:%02d", j ? " " : "", res->stops[j].depth / 1000.0, FRACTION(res->stops[j].time, 60));
+		put_string(b, "\n");
+	}
+}
+
+/* An array with one object per plan, in SI-ish units: mm, seconds and ml */
+void save_sweep_json(struct membuffer *b, const struct plan_sweep *sweep, const struct sweep_result *results)
+{
+	int i, j, nr = sweep_size(sweep);
+
+	put_string(b, "[");
+	for (i = 0; i < nr; i++) {
+		const struct sweep_result *res = &results[i];
+		const struct sweep_gases *gases = &sweep->gases[res->gases];
+
+		put_format(b, "%s\n{\"depth_mm\":%d,\"bottom_time_s\":%d,\"gases\":[", i ? "," : "",
+			   sweep->depths[res->depth], sweep->times[res->time]);
+		for (j = 0; j < gases->nr; j++)
+			put_format(b, "%s{\"o2\":%d,\"he\":%d,\"used_ml\":%d}", j ? "," : "",
+				   get_o2(gases->gasmix[j]), get_he(gases->gasmix[j]), res->gas_used[j].mliter);
+		put_format(b, "],\"gflow\":%d,\"gfhigh\":%d,\"deco\":%s,\"runtime_s\":%d,\"tts_s\":%d,\"cns\":%d,\"otu\":%d,\"stops\":[",
+			   sweep->gfs[res->gf].gflow, sweep->gfs[res->gf].gfhigh, res->deco ? "true" : "false",
+			   res->runtime, res->tts, res->cns, res->otu);
+		for (j = 0; j < res->nr_stops; j++)
+			put_format(b, "%s{\"depth_mm\":%d,\"time_s\":%d}", j ? "," : "", res->stops[j].depth, res->stops[j].time);
+		put_string(b, "]}");
+	}
+	put_string(b, "\n]\n");
+}
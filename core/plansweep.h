@@ -0,0 +1,70 @@
+// SPDX-License-Identifier: GPL-2.0
+#ifndef PLANSWEEP_H
+#define PLANSWEEP_H
+
+#include "dive.h"
+#include "membuffer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Batch planning for runtime tables: every combination of depth, bottom time,
+ * gas set and gradient factors of a sweep is planned like a new plan in the
+ * planner, with the planner settings in prefs (deco model, ascent and descent
+ * rates, last stop, deco pO2, ...). The descent is planned as in drop stone
+ * mode. Run it in the planner app state, like the planner itself.
+ */
+struct sweep_gases {
+	int nr;
+	/* the first one is the bottom gas */
+	struct gasmix gasmix[MAX_CYLINDERS];
+	/* 0 for the MOD at the deco pO2, which is what the planner proposes */
+	depth_t depth[MAX_CYLINDERS];
+};
+
+struct sweep_gf {
+	short gflow, gfhigh;
+};
+
+struct plan_sweep {
+	int nr_depths;
+	const int *depths;		/* mm */
+	int nr_times;
+	const int *times;		/* seconds, run time at the end of the bottom phase */
+	int nr_gases;
+	const struct sweep_gases *gases;
+	int nr_gfs;
+	const struct sweep_gf *gfs;
+	short vpmb_conservatism;
+	int bottomsac, decosac;		/* ml/min */
+	int surface_pressure;		/* mbar */
+	int salinity;
+};
+
+#define MAX_SWEEP_STOPS 60
+
+struct sweep_result {
+	/* indices into the arrays of the sweep */
+	int depth, time, gases, gf;
+	bool deco;			/* are there mandatory stops? */
+	int runtime;			/* seconds, when reaching the surface */
+	int tts;			/* seconds */
+	int cns, otu;
+	volume_t gas_used[MAX_CYLINDERS];
+	int nr_stops;
+	struct decostop stops[MAX_SWEEP_STOPS];	/* deepest first, including gas switches */
+};
+
+/* The results are ordered by depth, then time, gas set and gradient factors */
+extern int sweep_size(const struct plan_sweep *sweep);
+extern struct sweep_result *run_plan_sweep(const struct plan_sweep *sweep);
+extern void save_sweep_csv(struct membuffer *b, const struct plan_sweep *sweep, const struct sweep_result *results);
+extern void save_sweep_json(struct membuffer *b, const struct plan_sweep *sweep, const struct sweep_result *results);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PLANSWEEP_H
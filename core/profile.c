@@ -31,7 +31,8 @@ extern int ascent_velocity(int depth, int avg_depth, int bottom_time);
 struct dive *current_dive = NULL;
 unsigned int dc_number = 0;
 
-static struct plot_data *last_pi_entry_new = NULL;
+/* The plot data of the last create_plot_info_new() call, freed by the next one */
+static struct plot_info last_pi_new;
 void populate_pressure_information(struct dive *, struct divecomputer *, struct plot_info *, int);
 
 #ifdef DEBUG_PI
@@ -49,7 +50,7 @@ static void dump_pi(struct plot_info *pi)
 		printf("    entry[%d]:{cylinderindex:%d sec:%d pressure:{%d,%d}\n"
 		       "                time:%d:%02d temperature:%d depth:%d stopdepth:%d stoptime:%d ndl:%d smoothed:%d po2:%lf phe:%lf pn2:%lf sum-pp %lf}\n",
 		       i, entry->sensor[0], entry->sec,
-		       entry->pressure[0], entry->pressure[1],
+		       get_plot_sensor_pressure(pi, i, 0), get_plot_interpolated_pressure(pi, i, 0),
 		       entry->sec / 60, entry->sec % 60,
 		       entry->temperature, entry->depth, entry->stopdepth, entry->stoptime, entry->ndl, entry->smoothed,
 		       entry->pressures.o2, entry->pressures.he, entry->pressures.n2,
@@ -167,13 +168,15 @@ void remember_event(const char *eventname)
 }
 
 /* UNUSED! */
-static int get_local_sac(struct plot_data *entry1, struct plot_data *entry2, struct dive *dive) __attribute__((unused));
+static int get_local_sac(struct plot_info *pi, int idx1, int idx2, struct dive *dive) __attribute__((unused));
 
 /* Get local sac-rate (in ml/min) between entry1 and entry2 */
-static int get_local_sac(struct plot_data *entry1, struct plot_data *entry2, struct dive *dive)
+static int get_local_sac(struct plot_info *pi, int idx1, int idx2, struct dive *dive)
 {
 	int index = 0;
 	cylinder_t *cyl;
+	struct plot_data *entry1 = pi->entry + idx1;
+	struct plot_data *entry2 = pi->entry + idx2;
 	int duration = entry2->sec - entry1->sec;
 	int depth, airuse;
 	pressure_t a, b;
@@ -181,8 +184,8 @@ static int get_local_sac(struct plot_data *entry1, struct plot_data *entry2, str
 
 	if (duration <= 0)
 		return 0;
-	a.mbar = GET_PRESSURE(entry1, 0);
-	b.mbar = GET_PRESSURE(entry2, 0);
+	a.mbar = get_plot_pressure(pi, idx1, 0);
+	b.mbar = get_plot_pressure(pi, idx2, 0);
 	if (!b.mbar || a.mbar <= b.mbar)
 		return 0;
 
@@ -201,45 +204,55 @@ static int get_local_sac(struct plot_data *entry1, struct plot_data *entry2, str
 #define HALF_INTERVAL 9 * 30
 /*
  * Run the min/max calculations: over a 9 minute interval
- * around the entry point (indices 0, 1, 2 respectively).
+ * around each entry point.
+ *
+ * The window slides forward monotonically, so we keep two deques
+ * of entry indices whose depths are increasing (for the minimum)
+ * and decreasing (for the maximum). The front of each deque is the
+ * first entry with the minimum/maximum depth in the window. Every
+ * entry is added and removed at most once. The window always contains
+ * the entry itself, even if the time stamps should not be sorted.
  */
-static void analyze_plot_info_minmax(struct plot_info *pi, int entry_index)
+static void analyze_plot_info_minmax(struct plot_info *pi)
 {
-	struct plot_data *plot_entry = pi->entry + entry_index;  // fixed
-	struct plot_data *p = plot_entry;  // moves with 'entry'
-	int start = p->sec - HALF_INTERVAL, end = p->sec + HALF_INTERVAL;
-	int min, max;
-
-	/* Go back 'seconds' in time */
-	while (entry_index > 0) {
-		if (p[-1].sec < start)
-			break;
-		entry_index--;
-		p--;
-	}
-
-	// indexes to the min/max entries
-	min = max = entry_index;
-
-	/* Then go forward until we hit an entry past the time */
-	while (entry_index < pi->nr) {
-		int time = p->sec;
-		int depth = p->depth;
-
-		if (time > end)
-			break;
-
-		if (depth < pi->entry[min].depth)
-			min = entry_index;
-		if (depth > pi->entry[max].depth)
-			max = entry_index;
+	struct plot_data *entry = pi->entry;
+	int nr = pi->nr;
+	int *minq, *maxq;
+	int minhead = 0, mintail = 0, maxhead = 0, maxtail = 0;
+	int first = 0, next = 0;	// the window is [first, next)
 
-		p++;
-		entry_index++;
+	if (!nr)
+		return;
+	minq = malloc(nr * sizeof(*minq));
+	maxq = malloc(nr * sizeof(*maxq));
+	if (!minq || !maxq)
+		exit(1);
+
+	for (int i = 0; i < nr; i++) {
+		int start = entry[i].sec - HALF_INTERVAL, end = entry[i].sec + HALF_INTERVAL;
+
+		while (next < nr && (next <= i || entry[next].sec <= end)) {
+			int depth = entry[next].depth;
+			while (mintail > minhead && entry[minq[mintail - 1]].depth > depth)
+				mintail--;
+			minq[mintail++] = next;
+			while (maxtail > maxhead && entry[maxq[maxtail - 1]].depth < depth)
+				maxtail--;
+			maxq[maxtail++] = next;
+			next++;
+		}
+		while (first < i && entry[first].sec < start)
+			first++;
+		while (minq[minhead] < first)
+			minhead++;
+		while (maxq[maxhead] < first)
+			maxhead++;
+
+		entry[i].min = minq[minhead];
+		entry[i].max = maxq[maxhead];
 	}
-
-	plot_entry->min = min;
-	plot_entry->max = max;
+	free(minq);
+	free(maxq);
 }
 
 static velocity_t velocity(int speed)
@@ -304,8 +317,7 @@ struct plot_info *analyze_plot_info(struct plot_info *pi)
 	}
 
 	/* get minmax data */
-	for (i = 0; i < nr; i++)
-		analyze_plot_info_minmax(pi, i);
+	analyze_plot_info_minmax(pi);
 
 	return pi;
 }
@@ -494,23 +506,37 @@ struct plot_info calculate_max_limits_new(struct dive *dive, struct divecomputer
 }
 
 /* copy the previous entry (we know this exists), update time and depth
- * and zero out the sensor pressure (since this is a synthetic entry)
+ * (the sensor pressures of this synthetic entry stay zero)
  * increment the entry pointer and the count of synthetic entries. */
 #define INSERT_ENTRY(_time, _depth, _sac) \
 	*entry = entry[-1];         \
 	entry->sec = _time;         \
 	entry->depth = _depth;      \
 	entry->running_sum = (entry - 1)->running_sum + (_time - (entry - 1)->sec) * (_depth + (entry - 1)->depth) / 2; \
-	memset(entry->pressure, 0, sizeof(entry->pressure)); \
 	entry->sac = _sac;          \
 	entry->ndl = -1;          \
 	entry->bearing = -1;          \
 	entry++;                    \
 	idx++
 
+/* Pressure data is kept for the cylinders of the dive and any cylinder
+ * a pressure sensor of this dive computer reports on. */
+static int plot_cylinders(const struct dive *dive, const struct divecomputer *dc)
+{
+	int nr = nr_cylinders(dive);
+
+	for (int i = 0; i < dc->samples; i++) {
+		const struct sample *sample = dc->sample + i;
+		for (int j = 0; j < MAX_SENSORS; j++) {
+			if (sample->pressure[j].mbar && sample->sensor[j] >= nr && sample->sensor[j] < MAX_CYLINDERS)
+				nr = sample->sensor[j] + 1;
+		}
+	}
+	return nr;
+}
+
 struct plot_data *populate_plot_entries(struct dive *dive, struct divecomputer *dc, struct plot_info *pi)
 {
-	UNUSED(dive);
 	int idx, maxtime, nr, i;
 	int lastdepth, lasttime, lasttemp = 0;
 	struct plot_data *plot_data;
@@ -532,6 +558,11 @@ struct plot_data *populate_plot_entries(struct dive *dive, struct divecomputer *
 	if (!plot_data)
 		return NULL;
 	pi->nr = nr;
+	pi->nr_cylinders = plot_cylinders(dive, dc);
+	pi->pressures = pi->nr_cylinders ? calloc(nr * pi->nr_cylinders, sizeof(struct plot_pressure_data)) : NULL;
+	if (pi->nr_cylinders && !pi->pressures)
+		pi->nr_cylinders = 0;
+	pi->ceilings = pi->percentages = NULL;
 	idx = 2; /* the two extra events at the start */
 
 	lastdepth = 0;
@@ -596,9 +627,9 @@ struct plot_data *populate_plot_entries(struct dive *dive, struct divecomputer *
 			entry->pressures.o2 = sample->setpoint.mbar / 1000.0;
 		}
 		if (sample->pressure[0].mbar)
-			SENSOR_PRESSURE(entry, sample->sensor[0]) = sample->pressure[0].mbar;
+			set_plot_pressure_data(pi, idx, SENSOR_PR, sample->sensor[0], sample->pressure[0].mbar);
 		if (sample->pressure[1].mbar)
-			SENSOR_PRESSURE(entry, sample->sensor[1]) = sample->pressure[1].mbar;
+			set_plot_pressure_data(pi, idx, SENSOR_PR, sample->sensor[1], sample->pressure[1].mbar);
 		if (sample->temperature.mkelvin)
 			entry->temperature = lasttemp = sample->temperature.mkelvin;
 		else
@@ -641,12 +672,31 @@ struct plot_data *populate_plot_entries(struct dive *dive, struct divecomputer *
 
 #undef INSERT_ENTRY
 
+/*
+ * Data of the plot entries needed for the SAC calculation, computed once
+ * for the whole plot, so that the SAC of every entry can be calculated
+ * without rescanning the entries of its window.
+ *
+ * The window of an entry ends at surface intervals and where a cylinder
+ * loses its pressure data. Therefore, in addition to the time limits,
+ * the limits of the surrounding dive and of the surrounding run of
+ * pressure data of each cylinder are stored.
+ */
+struct sac_data {
+	unsigned int *gases;	/* bitmap of the cylinders with pressure data */
+	int64_t *pressuretime;	/* ambient pressure integrated over time from the first entry, in mbar * sec */
+	int *first;		/* first entry at most 30 seconds earlier, without a surface interval in between */
+	int *last;		/* last entry at most 60 seconds later, without a surface interval in between */
+	int *first_pressure;	/* per entry and cylinder: first entry of the run of pressure data */
+	int *last_pressure;	/* per entry and cylinder: last entry of the run of pressure data */
+};
+
 /*
  * Calculate the sac rate between the two plot entries 'first' and 'last'.
  *
  * Everything in between has a cylinder pressure for at least some of the cylinders.
  */
-static int sac_between(struct dive *dive, struct plot_data *first, struct plot_data *last, unsigned int gases)
+static int sac_between(struct dive *dive, struct plot_info *pi, const struct sac_data *sd, int first, int last, unsigned int gases)
 {
 	int i, airuse;
 	double pressuretime;
@@ -656,7 +706,7 @@ static int sac_between(struct dive *dive, struct plot_data *first, struct plot_d
 
 	/* Get airuse for the set of cylinders over the range */
 	airuse = 0;
-	for (i = 0; i < MAX_CYLINDERS; i++) {
+	for (i = 0; i < pi->nr_cylinders; i++) {
 		pressure_t a, b;
 		cylinder_t *cyl;
 		int cyluse;
@@ -664,8 +714,8 @@ static int sac_between(struct dive *dive, struct plot_data *first, struct plot_d
 		if (!(gases & (1u << i)))
 			continue;
 
-		a.mbar = GET_PRESSURE(first, i);
-		b.mbar = GET_PRESSURE(last, i);
+		a.mbar = get_plot_pressure(pi, first, i);
+		b.mbar = get_plot_pressure(pi, last, i);
 		cyl = dive->cylinder + i;
 		cyluse = gas_volume(cyl, a) - gas_volume(cyl, b);
 		if (cyluse > 0)
@@ -674,47 +724,119 @@ static int sac_between(struct dive *dive, struct plot_data *first, struct plot_d
 	if (!airuse)
 		return 0;
 
-	/* Calculate depthpressure integrated over time */
-	pressuretime = 0.0;
-	do {
-		int depth = (first[0].depth + first[1].depth) / 2;
-		int time = first[1].sec - first[0].sec;
-		double atm = depth_to_atm(depth, dive);
-
-		pressuretime += atm * time;
-	} while (++first < last);
-
-	/* Turn "atmseconds" into "atmminutes" */
-	pressuretime /= 60;
+	/* Depthpressure integrated over time, in "atmminutes" */
+	pressuretime = (double)(sd->pressuretime[last] - sd->pressuretime[first]) / SURFACE_PRESSURE / 60;
 
 	/* SAC = mliter per minute */
 	return lrint(airuse / pressuretime);
 }
 
 /* Which of the set of gases have pressure data */
-static unsigned int have_pressures(struct plot_data *entry, unsigned int gases)
+static unsigned int have_pressures(struct plot_info *pi, int idx, unsigned int gases)
 {
 	int i;
 
 	for (i = 0; i < MAX_CYLINDERS; i++) {
 		unsigned int mask = 1 << i;
 		if (gases & mask) {
-			if (!GET_PRESSURE(entry, i))
+			if (!get_plot_pressure(pi, idx, i))
 				gases &= ~mask;
 		}
 	}
 	return gases;
 }
 
+static bool at_surface(const struct plot_info *pi, int idx)
+{
+	return pi->entry[idx].depth < SURFACE_THRESHOLD && pi->entry[idx + 1].depth < SURFACE_THRESHOLD;
+}
+
+/*
+ * The entries are sorted by time, so the limits of the windows are found
+ * with pointers that only move in one direction.
+ */
+static void init_sac_data(struct dive *dive, struct plot_info *pi, struct sac_data *sd)
+{
+	int nr = pi->nr, nr_cylinders = pi->nr_cylinders;
+	int i, cyl, time_limit, surface_limit;
+
+	sd->gases = malloc(nr * sizeof(*sd->gases));
+	sd->pressuretime = malloc(nr * sizeof(*sd->pressuretime));
+	sd->first = malloc(nr * sizeof(*sd->first));
+	sd->last = malloc(nr * sizeof(*sd->last));
+	sd->first_pressure = malloc(nr * nr_cylinders * sizeof(*sd->first_pressure));
+	sd->last_pressure = malloc(nr * nr_cylinders * sizeof(*sd->last_pressure));
+	if (nr && (!sd->gases || !sd->pressuretime || !sd->first || !sd->last))
+		exit(1);
+	if (nr && nr_cylinders && (!sd->first_pressure || !sd->last_pressure))
+		exit(1);
+
+	time_limit = surface_limit = 0;
+	for (i = 0; i < nr; i++) {
+		struct plot_data *entry = pi->entry + i;
+
+		sd->gases[i] = have_pressures(pi, i, ~0u);
+		if (i == 0) {
+			sd->pressuretime[i] = 0;
+		} else {
+			int depth = (entry[-1].depth + entry[0].depth) / 2;
+			int time = entry[0].sec - entry[-1].sec;
+			sd->pressuretime[i] = sd->pressuretime[i - 1] + (int64_t)depth_to_mbar(depth, dive) * time;
+		}
+
+		if (i > 0 && at_surface(pi, i - 1))
+			surface_limit = i;
+		while (pi->entry[time_limit].sec < entry->sec - 30)
+			time_limit++;
+		sd->first[i] = MAX(time_limit, surface_limit);
+
+		for (cyl = 0; cyl < nr_cylinders; cyl++) {
+			unsigned int mask = 1u << cyl;
+			int *first = sd->first_pressure + i * nr_cylinders + cyl;
+			if (i > 0 && (sd->gases[i] & mask) && (sd->gases[i - 1] & mask))
+				*first = first[-nr_cylinders];
+			else
+				*first = i;
+		}
+	}
+
+	time_limit = surface_limit = nr - 1;
+	for (i = nr - 1; i >= 0; i--) {
+		if (i < nr - 1 && at_surface(pi, i))
+			surface_limit = i;
+		while (pi->entry[time_limit].sec > pi->entry[i].sec + 60)
+			time_limit--;
+		sd->last[i] = MIN(time_limit, surface_limit);
+
+		for (cyl = 0; cyl < nr_cylinders; cyl++) {
+			unsigned int mask = 1u << cyl;
+			int *last = sd->last_pressure + i * nr_cylinders + cyl;
+			if (i < nr - 1 && (sd->gases[i] & mask) && (sd->gases[i + 1] & mask))
+				*last = last[nr_cylinders];
+			else
+				*last = i;
+		}
+	}
+}
+
+static void free_sac_data(struct sac_data *sd)
+{
+	free(sd->gases);
+	free(sd->pressuretime);
+	free(sd->first);
+	free(sd->last);
+	free(sd->first_pressure);
+	free(sd->last_pressure);
+}
+
 /*
  * Try to do the momentary sac rate for this entry, averaging over one
  * minute.
  */
-static void fill_sac(struct dive *dive, struct plot_info *pi, int idx, unsigned int gases)
+static void fill_sac(struct dive *dive, struct plot_info *pi, const struct sac_data *sd, int idx, unsigned int gases)
 {
 	struct plot_data *entry = pi->entry + idx;
-	struct plot_data *first, *last;
-	int time;
+	int first, last, cyl;
 
 	if (entry->sac)
 		return;
@@ -723,45 +845,28 @@ static void fill_sac(struct dive *dive, struct plot_info *pi, int idx, unsigned
 	 * We may not have pressure data for all the cylinders,
 	 * but we'll calculate the SAC for the ones we do have.
 	 */
-	gases = have_pressures(entry, gases);
+	gases &= sd->gases[idx];
 	if (!gases)
 		return;
 
 	/*
-	 * Try to go back 30 seconds to get 'first'.
-	 * Stop if the cylinder pressure data set changes.
+	 * Go back 30 seconds to get 'first', then find an entry a minute
+	 * after the first one. Stop at surface intervals and if the
+	 * cylinder pressure data set changes.
 	 */
-	first = entry;
-	time = entry->sec - 30;
-	while (idx > 0) {
-		struct plot_data *prev = first-1;
-
-		if (prev->depth < SURFACE_THRESHOLD && first->depth < SURFACE_THRESHOLD)
-			break;
-		if (prev->sec < time)
-			break;
-		if (have_pressures(prev, gases) != gases)
-			break;
-		idx--;
-		first = prev;
+	first = sd->first[idx];
+	for (cyl = 0; cyl < pi->nr_cylinders; cyl++) {
+		if (gases & (1u << cyl))
+			first = MAX(first, sd->first_pressure[idx * pi->nr_cylinders + cyl]);
 	}
-
-	/* Now find an entry a minute after the first one */
-	last = first;
-	time = first->sec + 60;
-	while (++idx < pi->nr) {
-		struct plot_data *next = last+1;
-		if (next->depth < SURFACE_THRESHOLD && last->depth < SURFACE_THRESHOLD)
-			break;
-		if (next->sec > time)
-			break;
-		if (have_pressures(next, gases) != gases)
-			break;
-		last = next;
+	last = sd->last[first];
+	for (cyl = 0; cyl < pi->nr_cylinders; cyl++) {
+		if (gases & (1u << cyl))
+			last = MIN(last, sd->last_pressure[first * pi->nr_cylinders + cyl]);
 	}
 
 	/* Ok, now calculate the SAC between 'first' and 'last' */
-	entry->sac = sac_between(dive, first, last, gases);
+	entry->sac = sac_between(dive, pi, sd, first, last, gases);
 }
 
 /*
@@ -780,12 +885,14 @@ static unsigned int matching_gases(struct dive *dive, struct gasmix gasmix)
 	return gases;
 }
 
-static void calculate_sac(struct dive *dive, struct divecomputer *dc, struct plot_info *pi)
+void calculate_sac_information(struct dive *dive, struct divecomputer *dc, struct plot_info *pi)
 {
 	struct gasmix gasmix = gasmix_invalid;
 	const struct event *ev = NULL;
 	unsigned int gases = 0;
+	struct sac_data sd;
 
+	init_sac_data(dive, pi, &sd);
 	for (int i = 0; i < pi->nr; i++) {
 		struct plot_data *entry = pi->entry + i;
 		struct gasmix newmix = get_gasmix(dive, dc, entry->sec, &ev, gasmix);
@@ -794,8 +901,9 @@ static void calculate_sac(struct dive *dive, struct divecomputer *dc, struct plo
 			gases = matching_gases(dive, newmix);
 		}
 
-		fill_sac(dive, pi, i, gases);
+		fill_sac(dive, pi, &sd, i, gases);
 	}
+	free_sac_data(&sd);
 }
 
 static void populate_secondary_sensor_data(const struct divecomputer *dc, struct plot_info *pi)
@@ -811,18 +919,19 @@ static void populate_secondary_sensor_data(const struct divecomputer *dc, struct
  */
 static void add_plot_pressure(struct plot_info *pi, int time, int cyl, pressure_t p)
 {
-	struct plot_data *entry;
+	int i;
 	if (pi->nr <= 0) {
 		fprintf(stderr, "add_plot_pressure(): called with pi->nr <= 0\n");
 		return;
 	}
-	for (int i = 0; i < pi->nr; i++) {
-		entry = pi->entry + i;
-
-		if (entry->sec >= time)
+	for (i = 0; i < pi->nr; i++) {
+		if (pi->entry[i].sec >= time)
 			break;
 	}
-	SENSOR_PRESSURE(entry, cyl) = p.mbar;
+	/* No entry that late: use the last one */
+	if (i == pi->nr)
+		i--;
+	set_plot_pressure_data(pi, i, SENSOR_PR, cyl, p.mbar);
 }
 
 static void setup_gas_sensor_pressure(const struct dive *dive, const struct divecomputer *dc, struct plot_info *pi)
@@ -913,6 +1022,74 @@ static void setup_gas_sensor_pressure(const struct dive *dive, const struct dive
 }
 
 #ifndef SUBSURFACE_MOBILE
+/* A stretch at constant depth and gas in the NDL/TTS calculation */
+struct constant_depth {
+	const struct deco_state *ds;
+	const struct dive *dive;
+	int depth;
+	struct gasmix gasmix;
+	int o2pressure;
+	enum divemode_t divemode;
+	double surface_pressure;
+};
+
+/* Does the ceiling after the given number of time steps at constant depth
+ * satisfy the search condition? Works on a copy of the deco state. */
+static bool ceiling_reached(const struct constant_depth *cd, int time_stepsize, int steps, int limit, bool clears)
+{
+	struct deco_state ds = *cd->ds;
+	double pressure = depth_to_bar(cd->depth, cd->dive);
+	int ceiling;
+
+	add_segments(&ds, pressure, cd->gasmix, time_stepsize, steps, cd->o2pressure, cd->divemode);
+	ceiling = deco_allowed_depth(tissue_tolerance_calc(&ds, cd->dive, pressure), cd->surface_pressure, cd->dive, 1);
+	return (ceiling <= limit) == clears;
+}
+
+/*
+ * Smallest number of time steps in [1, max_steps] after which the ceiling
+ * is above limit (clears == false) or at or below it (clears == true), or
+ * max_steps if that doesn't happen before. Gallops from the initial guess
+ * and then bisects, so the cost only grows with the log of the distance
+ * between the guess and the result.
+ */
+static int steps_until_ceiling(const struct constant_depth *cd, int time_stepsize, int guess, int max_steps, int limit, bool clears)
+{
+	int lo = 0, hi = max_steps, step;
+
+	if (guess < 1)
+		guess = 1;
+	if (guess > max_steps)
+		guess = max_steps;
+	if (guess < max_steps && !ceiling_reached(cd, time_stepsize, guess, limit, clears)) {
+		lo = guess;
+		for (step = 1; lo + step < max_steps; step *= 2) {
+			if (ceiling_reached(cd, time_stepsize, lo + step, limit, clears)) {
+				hi = lo + step;
+				break;
+			}
+			lo += step;
+		}
+	} else {
+		hi = guess;
+		for (step = 1; hi - step > 0; step *= 2) {
+			if (!ceiling_reached(cd, time_stepsize, hi - step, limit, clears)) {
+				lo = hi - step;
+				break;
+			}
+			hi -= step;
+		}
+	}
+	while (hi - lo > 1) {
+		int mid = lo + (hi - lo) / 2;
+		if (ceiling_reached(cd, time_stepsize, mid, limit, clears))
+			hi = mid;
+		else
+			lo = mid;
+	}
+	return hi;
+}
+
 /* calculate DECO STOP / TTS / NDL */
 static void calculate_ndl_tts(struct deco_state *ds, const struct dive *dive, struct plot_data *entry, struct gasmix gasmix, double surface_pressure,enum divemode_t divemode)
 {
@@ -928,6 +1105,8 @@ static void calculate_ndl_tts(struct deco_state *ds, const struct dive *dive, st
 					 tissue_tolerance_calc(ds, dive, depth_to_bar(entry->depth, dive)),
 					 surface_pressure, dive, 1), deco_stepsize);
 	int ascent_depth = entry->depth;
+	struct constant_depth cd = { ds, dive, entry->depth, gasmix, entry->o2pressure.mbar, divemode, surface_pressure };
+	int steps, max_steps;
 	/* at what time should we give up and say that we got enuff NDL? */
 	/* If iterating through a dive, entry->tts_calc needs to be reset */
 	entry->tts_calc = 0;
@@ -940,14 +1119,15 @@ static void calculate_ndl_tts(struct deco_state *ds, const struct dive *dive, st
 			return;
 		}
 		/* stop if the ndl is above max_ndl seconds, and call it plenty of time */
-		while (entry->ndl_calc < MAX_PROFILE_DECO &&
-		       deco_allowed_depth(tissue_tolerance_calc(ds, dive, depth_to_bar(entry->depth, dive)),
-					  surface_pressure, dive, 1) <= 0
-		       ) {
-			entry->ndl_calc += time_stepsize;
-			add_segment(ds, depth_to_bar(entry->depth, dive),
-				    gasmix, time_stepsize, entry->o2pressure.mbar, divemode, prefs.bottomsac);
-		}
+		if (entry->ndl_calc >= MAX_PROFILE_DECO)
+			return;
+		/* Solve for the time the first tissue reaches its limit and check
+		 * the result against the real ceiling. */
+		max_steps = DIV_UP(MAX_PROFILE_DECO - entry->ndl_calc, time_stepsize);
+		steps = periods_to_surfacing_limit(ds, depth_to_bar(entry->depth, dive), surface_pressure,
+						   gasmix, time_stepsize, entry->o2pressure.mbar, divemode);
+		steps = steps_until_ceiling(&cd, time_stepsize, steps, max_steps, 0, false);
+		entry->ndl_calc += steps * time_stepsize;
 		/* we don't need to calculate anything else */
 		return;
 	}
@@ -971,27 +1151,45 @@ static void calculate_ndl_tts(struct deco_state *ds, const struct dive *dive, st
 
 	/* And how long is the total TTS */
 	while (next_stop >= 0) {
+		/* Find how long we have to stay at this stop, but give up
+		 * once the TTS passes MAX_PROFILE_DECO */
+		max_steps = (MAX_PROFILE_DECO - entry->tts_calc) / time_stepsize + 1;
+		if (max_steps < 1)
+			max_steps = 1;
+		cd.depth = ascent_depth;
+		steps = steps_until_ceiling(&cd, time_stepsize, 1, max_steps, next_stop, true);
+
 		/* save the time for the first stop to show in the graph */
 		if (ascent_depth == entry->stopdepth_calc)
-			entry->stoptime_calc += time_stepsize;
+			entry->stoptime_calc += steps * time_stepsize;
 
-		entry->tts_calc += time_stepsize;
+		entry->tts_calc += steps * time_stepsize;
 		if (entry->tts_calc > MAX_PROFILE_DECO)
 			break;
-		add_segment(ds, depth_to_bar(ascent_depth, dive),
-			    gasmix, time_stepsize, entry->o2pressure.mbar, divemode, prefs.decosac);
-
-		if (deco_allowed_depth(tissue_tolerance_calc(ds, dive, depth_to_bar(ascent_depth,dive)), surface_pressure, dive, 1) <= next_stop) {
-			/* move to the next stop and add the travel between stops */
-			for (; ascent_depth > next_stop; ascent_depth -= ascent_s_per_deco_step * ascent_velocity(ascent_depth, entry->running_sum / entry->sec, 0), entry->tts_calc += ascent_s_per_deco_step)
-				add_segment(ds, depth_to_bar(ascent_depth, dive),
-					    gasmix, ascent_s_per_deco_step, entry->o2pressure.mbar, divemode, prefs.decosac);
-			ascent_depth = next_stop;
-			next_stop -= deco_stepsize;
-		}
+		add_segments(ds, depth_to_bar(ascent_depth, dive),
+			     gasmix, time_stepsize, steps, entry->o2pressure.mbar, divemode);
+		tissue_tolerance_calc(ds, dive, depth_to_bar(ascent_depth, dive));
+
+		/* move to the next stop and add the travel between stops */
+		for (; ascent_depth > next_stop; ascent_depth -= ascent_s_per_deco_step * ascent_velocity(ascent_depth, entry->running_sum / entry->sec, 0), entry->tts_calc += ascent_s_per_deco_step)
+			add_segment(ds, depth_to_bar(ascent_depth, dive),
+				    gasmix, ascent_s_per_deco_step, entry->o2pressure.mbar, divemode, prefs.decosac);
+		ascent_depth = next_stop;
+		next_stop -= deco_stepsize;
 	}
 }
 
+/* Set up the model parameters for the deco calculation of a profile.
+ * While planning, show the ceiling with the parameters of the plan.
+ */
+void init_profile_deco_config(struct deco_config *config, const struct deco_state *planner_ds)
+{
+	if (in_planner() && planner_ds)
+		*config = planner_ds->config;
+	else
+		init_deco_config(config, in_planner());
+}
+
 /* Let's try to do some deco calculations.
  */
 void calculate_deco_information(struct deco_state *ds, const struct deco_state *planner_ds, const struct dive *dive, const struct divecomputer *dc, struct plot_info *pi, bool print_mode)
@@ -1001,24 +1199,31 @@ void calculate_deco_information(struct deco_state *ds, const struct deco_state *
 	bool first_iteration = true;
 	int prev_deco_time = 10000000, time_deep_ceiling = 0;
 
-	if (!in_planner()) {
+	bool planning = ds->config.in_planner;
+	enum deco_mode deco_mode = ds->config.deco_mode;
+
+	if (!planning) {
 		ds->deco_time = 0;
 	} else {
 		ds->deco_time = planner_ds->deco_time;
 		ds->first_ceiling_pressure = planner_ds->first_ceiling_pressure;
 	}
 	struct deco_state *cache_data_initial = NULL;
-	lock_planner();
 	/* For VPM-B outside the planner, cache the initial deco state for CVA iterations */
-	if (decoMode() == VPMB) {
+	if (deco_mode == VPMB) {
 		cache_deco_state(ds, &cache_data_initial);
 	}
+	/* The per-tissue series: the ceilings are only shown when all tissues are calculated */
+	free(pi->ceilings);
+	free(pi->percentages);
+	pi->ceilings = prefs.calcalltissues ? calloc(pi->nr * 16, sizeof(int)) : NULL;
+	pi->percentages = calloc(pi->nr * 16, sizeof(int));
 	/* For VPM-B outside the planner, iterate until deco time converges (usually one or two iterations after the initial)
 	 * Set maximum number of iterations to 10 just in case */
 
 	while ((abs(prev_deco_time - ds->deco_time) >= 30) && (count_iteration < 10)) {
 		int last_ndl_tts_calc_time = 0, first_ceiling = 0, current_ceiling, last_ceiling = 0, final_tts = 0 , time_clear_ceiling = 0;
-		if (decoMode() == VPMB)
+		if (deco_mode == VPMB)
 			ds->first_ceiling_pressure.mbar = depth_to_mbar(first_ceiling, dive);
 		struct gasmix gasmix = gasmix_invalid;
 		const struct event *ev = NULL, *evd = NULL;
@@ -1053,11 +1258,11 @@ void calculate_deco_information(struct deco_state *ds, const struct deco_state *
 				entry->ceiling = (entry - 1)->ceiling;
 			} else {
 				/* Keep updating the VPM-B gradients until the start of the ascent phase of the dive. */
-				if (decoMode() == VPMB && last_ceiling >= first_ceiling && first_iteration == true) {
+				if (deco_mode == VPMB && last_ceiling >= first_ceiling && first_iteration == true) {
 					nuclear_regeneration(ds, t1);
 					vpmb_start_gradient(ds);
 					/* For CVA iterations, calculate next gradient */
-					if (!first_iteration || in_planner())
+					if (!first_iteration || planning)
 						vpmb_next_gradient(ds, ds->deco_time, surface_pressure / 1000.0);
 				}
 				entry->ceiling = deco_allowed_depth(tissue_tolerance_calc(ds, dive, depth_to_bar(entry->depth, dive)), surface_pressure, dive, !prefs.calcceiling3m);
@@ -1067,7 +1272,7 @@ void calculate_deco_information(struct deco_state *ds, const struct deco_state *
 					current_ceiling = entry->ceiling;
 				last_ceiling = current_ceiling;
 				/* If using VPM-B, take first_ceiling_pressure as the deepest ceiling */
-				if (decoMode() == VPMB) {
+				if (deco_mode == VPMB) {
 					if  (current_ceiling >= first_ceiling ||
 					     (time_deep_ceiling == t0 && entry->depth == (entry - 1)->depth)) {
 						time_deep_ceiling = t1;
@@ -1079,7 +1284,7 @@ void calculate_deco_information(struct deco_state *ds, const struct deco_state *
 							/* For CVA calculations, deco time = dive time remaining is a good guess,
 							   but we want to over-estimate deco_time for the first iteration so it
 							   converges correctly, so add 30min*/
-							if (!in_planner())
+							if (!planning)
 								ds->deco_time = pi->maxtime - t1 + 1800;
 							vpmb_next_gradient(ds, ds->deco_time, surface_pressure / 1000.0);
 						}
@@ -1092,11 +1297,14 @@ void calculate_deco_information(struct deco_state *ds, const struct deco_state *
 				}
 			}
 			entry->surface_gf = 0.0;
+			int *ceilings = pi->ceilings ? pi->ceilings + i * 16 : NULL;
+			int *percentages = pi->percentages + i * 16;
 			for (j = 0; j < 16; j++) {
 				double m_value = ds->buehlmann_inertgas_a[j] + entry->ambpressure / ds->buehlmann_inertgas_b[j];
 				double surface_m_value = ds->buehlmann_inertgas_a[j] + surface_pressure / ds->buehlmann_inertgas_b[j];
-				entry->ceilings[j] = deco_allowed_depth(ds->tolerated_by_tissue[j], surface_pressure, dive, 1);
-				entry->percentages[j] = ds->tissue_inertgas_saturation[j] < entry->ambpressure ?
+				if (ceilings)
+					ceilings[j] = deco_allowed_depth(ds->tolerated_by_tissue[j], surface_pressure, dive, 1);
+				percentages[j] = ds->tissue_inertgas_saturation[j] < entry->ambpressure ?
 					lrint(ds->tissue_inertgas_saturation[j] / entry->ambpressure * AMB_PERCENTAGE) :
 					lrint(AMB_PERCENTAGE + (ds->tissue_inertgas_saturation[j] - entry->ambpressure) / (m_value - entry->ambpressure) * (100.0 - AMB_PERCENTAGE));
 				double surface_gf = 100.0 * (ds->tissue_inertgas_saturation[j] - surface_pressure) / (surface_m_value - surface_pressure);
@@ -1108,8 +1316,8 @@ void calculate_deco_information(struct deco_state *ds, const struct deco_state *
 			* We don't for print-mode because this info doesn't show up there
 			* If the ceiling hasn't cleared by the last data point, we need tts for VPM-B CVA calculation
 			* It is not necessary to do these calculation on the first VPMB iteration, except for the last data point */
-			if ((prefs.calcndltts && !print_mode && (decoMode() != VPMB || in_planner() || !first_iteration)) ||
-			    (decoMode() == VPMB && !in_planner() && i == pi->nr - 1)) {
+			if ((prefs.calcndltts && !print_mode && (deco_mode != VPMB || planning || !first_iteration)) ||
+			    (deco_mode == VPMB && !planning && i == pi->nr - 1)) {
 				/* only calculate ndl/tts on every 30 seconds */
 				if ((entry->sec - last_ndl_tts_calc_time) < 30 && i != pi->nr - 1) {
 					struct plot_data *prev_entry = (entry - 1);
@@ -1122,17 +1330,15 @@ void calculate_deco_information(struct deco_state *ds, const struct deco_state *
 				last_ndl_tts_calc_time = entry->sec;
 
 				/* We are going to mess up deco state, so store it for later restore */
-				struct deco_state *cache_data = NULL;
-				cache_deco_state(ds, &cache_data);
+				struct deco_state saved_state = *ds;
 				calculate_ndl_tts(ds, dive, entry, gasmix, surface_pressure, current_divemode);
-				if (decoMode() == VPMB && !in_planner() && i == pi->nr - 1)
+				if (deco_mode == VPMB && !planning && i == pi->nr - 1)
 					final_tts = entry->tts_calc;
 				/* Restore "real" deco state for next real time step */
-				restore_deco_state(cache_data, ds, decoMode() == VPMB);
-				free(cache_data);
+				restore_deco_state(&saved_state, ds, deco_mode == VPMB);
 			}
 		}
-		if (decoMode() == VPMB && !in_planner()) {
+		if (deco_mode == VPMB && !planning) {
 			int this_deco_time;
 			prev_deco_time = ds->deco_time;
 			// Do we need to update deco_time?
@@ -1163,7 +1369,6 @@ void calculate_deco_information(struct deco_state *ds, const struct deco_state *
 #if DECO_CALC_DEBUG & 1
 	dump_tissues(ds);
 #endif
-	unlock_planner();
 }
 #endif
 
@@ -1310,8 +1515,8 @@ static void debug_print_profiledata(struct plot_info *pi)
 		fprintf(f1, "id t1 gas gasint t2 t3 dil dilint t4 t5 setpoint sensor1 sensor2 sensor3 t6 po2 fo2\n");
 		for (i = 0; i < pi->nr; i++) {
 			entry = pi->entry + i;
-			fprintf(f1, "%d gas=%8d %8d ; dil=%8d %8d ; o2_sp= %d %d %d %d PO2= %f\n", i, SENSOR_PRESSURE(entry),
-				INTERPOLATED_PRESSURE(entry), O2CYLINDER_PRESSURE(entry), INTERPOLATED_O2CYLINDER_PRESSURE(entry),
+			fprintf(f1, "%d gas=%8d %8d ; dil=%8d %8d ; o2_sp= %d %d %d %d PO2= %f\n", i, get_plot_sensor_pressure(pi, i, 0),
+				get_plot_interpolated_pressure(pi, i, 0), O2CYLINDER_PRESSURE(entry), INTERPOLATED_O2CYLINDER_PRESSURE(entry),
 				entry->o2pressure.mbar, entry->o2sensor[0].mbar, entry->o2sensor[1].mbar, entry->o2sensor[2].mbar, entry->pressures.o2);
 		}
 		fclose(f1);
@@ -1331,12 +1536,13 @@ void create_plot_info_new(struct dive *dive, struct divecomputer *dc, struct plo
 	int o2, he, o2max;
 #ifndef SUBSURFACE_MOBILE
 	struct deco_state plot_deco_state;
+	init_profile_deco_config(&plot_deco_state.config, planner_ds);
 	init_decompression(&plot_deco_state, dive);
 #else
 	UNUSED(planner_ds);
 #endif
 	/* Create the new plot data */
-	free((void *)last_pi_entry_new);
+	free_plot_info_data(&last_pi_new);
 
 	get_dive_gas(dive, &o2, &he, &o2max);
 	if (dc->divemode == FREEDIVE){
@@ -1350,16 +1556,16 @@ void create_plot_info_new(struct dive *dive, struct divecomputer *dc, struct plo
 			pi->dive_type = AIR;
 	}
 
-	last_pi_entry_new = populate_plot_entries(dive, dc, pi);
+	populate_plot_entries(dive, dc, pi);
 
 	check_setpoint_events(dive, dc, pi);     /* Populate setpoints */
 	setup_gas_sensor_pressure(dive, dc, pi); /* Try to populate our gas pressure knowledge */
 	if (!fast) {
-		for (int cyl = 0; cyl < MAX_CYLINDERS; cyl++)
+		for (int cyl = 0; cyl < pi->nr_cylinders; cyl++)
 			populate_pressure_information(dive, dc, pi, cyl);
 	}
 	fill_o2_values(dive, dc, pi);			 /* .. and insert the O2 sensor data having 0 values. */
-	calculate_sac(dive, dc, pi);			 /* Calculate sac */
+	calculate_sac_information(dive, dc, pi);	 /* Calculate sac */
 #ifndef SUBSURFACE_MOBILE
 	calculate_deco_information(&plot_deco_state, planner_ds, dive, dc, pi, false); /* and ceiling information, using gradient factor values in Preferences) */
 #endif
@@ -1371,6 +1577,43 @@ void create_plot_info_new(struct dive *dive, struct divecomputer *dc, struct plo
 
 	pi->meandepth = dive->dc.meandepth.mm;
 	analyze_plot_info(pi);
+	last_pi_new = *pi;
+}
+
+void free_plot_info_data(struct plot_info *pi)
+{
+	free(pi->entry);
+	free(pi->pressures);
+	free(pi->ceilings);
+	free(pi->percentages);
+	pi->entry = NULL;
+	pi->pressures = NULL;
+	pi->ceilings = pi->percentages = NULL;
+}
+
+/* Deep copy of the plot data, for users that outlive the next create_plot_info_new() */
+void copy_plot_info_data(struct plot_info *dest, const struct plot_info *src)
+{
+	*dest = *src;
+	dest->entry = NULL;
+	dest->pressures = NULL;
+	dest->ceilings = dest->percentages = NULL;
+	if (src->entry) {
+		dest->entry = malloc(src->nr * sizeof(struct plot_data));
+		memcpy(dest->entry, src->entry, src->nr * sizeof(struct plot_data));
+	}
+	if (src->pressures) {
+		dest->pressures = malloc(src->nr * src->nr_cylinders * sizeof(struct plot_pressure_data));
+		memcpy(dest->pressures, src->pressures, src->nr * src->nr_cylinders * sizeof(struct plot_pressure_data));
+	}
+	if (src->ceilings) {
+		dest->ceilings = malloc(src->nr * 16 * sizeof(int));
+		memcpy(dest->ceilings, src->ceilings, src->nr * 16 * sizeof(int));
+	}
+	if (src->percentages) {
+		dest->percentages = malloc(src->nr * 16 * sizeof(int));
+		memcpy(dest->percentages, src->percentages, src->nr * 16 * sizeof(int));
+	}
 }
 
 struct divecomputer *select_dc(struct dive *dive)
@@ -1385,8 +1628,9 @@ struct divecomputer *select_dc(struct dive *dive)
 	return get_dive_dc(dive, i);
 }
 
-static void plot_string(struct plot_info *pi, struct plot_data *entry, struct membuffer *b)
+static void plot_string(struct plot_info *pi, int idx, struct membuffer *b)
 {
+	struct plot_data *entry = pi->entry + idx;
 	int pressurevalue, mod, ead, end, eadd;
 	const char *depth_unit, *pressure_unit, *temp_unit, *vertical_speed_unit;
 	double depthvalue, tempvalue, speedvalue, sacvalue;
@@ -1395,8 +1639,8 @@ static void plot_string(struct plot_info *pi, struct plot_data *entry, struct me
 
 	depthvalue = get_depth_units(entry->depth, NULL, &depth_unit);
 	put_format_loc(b, translate("gettextFromC", "@: %d:%02d\nD: %.1f%s\n"), FRACTION(entry->sec, 60), depthvalue, depth_unit);
-	for (cyl = 0; cyl < MAX_CYLINDERS; cyl++) {
-		int mbar = GET_PRESSURE(entry, cyl);
+	for (cyl = 0; cyl < pi->nr_cylinders; cyl++) {
+		int mbar = get_plot_pressure(pi, idx, cyl);
 		if (!mbar)
 			continue;
 		struct gasmix mix = displayed_dive.cylinder[cyl].gasmix;
@@ -1512,8 +1756,9 @@ static void plot_string(struct plot_info *pi, struct plot_data *entry, struct me
 			if (prefs.calcalltissues) {
 				int k;
 				for (k = 0; k < 16; k++) {
-					if (entry->ceilings[k]) {
-						depthvalue = get_depth_units(entry->ceilings[k], NULL, &depth_unit);
+					int ceiling = get_plot_tissue_ceiling(pi, idx, k);
+					if (ceiling) {
+						depthvalue = get_depth_units(ceiling, NULL, &depth_unit);
 						put_format_loc(b, translate("gettextFromC", "Tissue %.0fmin: %.1f%s\n"), buehlmann_N2_t_halflife[k], depthvalue, depth_unit);
 					}
 				}
@@ -1546,14 +1791,15 @@ struct plot_data *get_plot_details_new(struct plot_info *pi, int time, struct me
 			break;
 	}
 	if (entry)
-		plot_string(pi, entry, mb);
+		plot_string(pi, entry - pi->entry, mb);
 	return entry;
 }
 
 /* Compare two plot_data entries and writes the results into a string */
-void compare_samples(struct plot_data *e1, struct plot_data *e2, char *buf, int bufsize, int sum)
+void compare_samples(struct plot_info *pi, int idx1, int idx2, char *buf, int bufsize, int sum)
 {
 	struct plot_data *start, *stop, *data;
+	int start_idx, stop_idx;
 	const char *depth_unit, *pressure_unit, *vertical_speed_unit;
 	char *buf2 = malloc(bufsize);
 	int avg_speed, max_asc_speed, max_desc_speed;
@@ -1566,21 +1812,23 @@ void compare_samples(struct plot_data *e1, struct plot_data *e2, char *buf, int
 
 	if (bufsize > 0)
 		buf[0] = '\0';
-	if (e1 == NULL || e2 == NULL) {
+	if (idx1 < 0 || idx2 < 0 || idx1 >= pi->nr || idx2 >= pi->nr) {
 		free(buf2);
 		return;
 	}
 
-	if (e1->sec < e2->sec) {
-		start = e1;
-		stop = e2;
-	} else if (e1->sec > e2->sec) {
-		start = e2;
-		stop = e1;
+	if (pi->entry[idx1].sec < pi->entry[idx2].sec) {
+		start_idx = idx1;
+		stop_idx = idx2;
+	} else if (pi->entry[idx1].sec > pi->entry[idx2].sec) {
+		start_idx = idx2;
+		stop_idx = idx1;
 	} else {
 		free(buf2);
 		return;
 	}
+	start = pi->entry + start_idx;
+	stop = pi->entry + stop_idx;
 	count = 0;
 	avg_speed = 0;
 	max_asc_speed = 0;
@@ -1594,11 +1842,14 @@ void compare_samples(struct plot_data *e1, struct plot_data *e2, char *buf, int
 	bar_used = 0;
 
 	last_sec = start->sec;
-	last_pressure = GET_PRESSURE(start, 0);
+	last_pressure = get_plot_pressure(pi, start_idx, 0);
 
 	data = start;
 	while (data != stop) {
+		int pressure;
+
 		data = start + count;
+		pressure = get_plot_pressure(pi, start_idx + count, 0);
 		if (sum)
 			avg_speed += abs(data->speed) * (data->sec - last_sec);
 		else
@@ -1615,12 +1866,12 @@ void compare_samples(struct plot_data *e1, struct plot_data *e2, char *buf, int
 		if (data->depth > max_depth)
 			max_depth = data->depth;
 		/* Try to detect gas changes - this hack might work for some side mount scenarios? */
-		if (GET_PRESSURE(data, 0) < last_pressure + 2000)
-			bar_used += last_pressure - GET_PRESSURE(data, 0);
+		if (pressure < last_pressure + 2000)
+			bar_used += last_pressure - pressure;
 
 		count += 1;
 		last_sec = data->sec;
-		last_pressure = GET_PRESSURE(data, 0);
+		last_pressure = pressure;
 	}
 	avg_depth /= stop->sec - start->sec;
 	avg_speed /= stop->sec - start->sec;
@@ -1667,15 +1918,15 @@ void compare_samples(struct plot_data *e1, struct plot_data *e2, char *buf, int
 			double volume_value;
 			int volume_precision;
 			const char *volume_unit;
-			struct plot_data *first = start;
-			struct plot_data *last = stop;
-			while (first < stop && GET_PRESSURE(first, 0) == 0)
+			int first = start_idx;
+			int last = stop_idx;
+			while (first < stop_idx && get_plot_pressure(pi, first, 0) == 0)
 				first++;
-			while (last > first && GET_PRESSURE(last, 0) == 0)
+			while (last > first && get_plot_pressure(pi, last, 0) == 0)
 				last--;
 
-			pressure_t first_pressure = { GET_PRESSURE(first, 0) };
-			pressure_t stop_pressure = { GET_PRESSURE(last, 0) };
+			pressure_t first_pressure = { get_plot_pressure(pi, first, 0) };
+			pressure_t stop_pressure = { get_plot_pressure(pi, last, 0) };
 			int volume_used = gas_volume(cyl, first_pressure) - gas_volume(cyl, stop_pressure);
 
 			/* Mean pressure in ATM */
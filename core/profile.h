@@ -3,6 +3,7 @@
 #define PROFILE_H
 
 #include "dive.h"
+#include "display.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -22,17 +23,10 @@ struct plot_info;
 struct plot_data {
 	unsigned int in_deco : 1;
 	int sec;
-	/*
-	 * pressure[x][0] is sensor pressure for cylinder x
-	 * pressure[x][1] is interpolated pressure
-	 */
-	int pressure[MAX_CYLINDERS][2];
 	int temperature;
 	/* Depth info */
 	int depth;
 	int ceiling;
-	int ceilings[16];
-	int percentages[16];
 	int ndl;
 	int tts;
 	int rbt;
@@ -68,16 +62,28 @@ struct plot_data {
 	bool icd_warning;
 };
 
+enum plot_pressure {
+	SENSOR_PR = 0,
+	INTERPOLATED_PR = 1,
+	NUM_PLOT_PRESSURES = 2
+};
+
+struct plot_pressure_data {
+	int data[NUM_PLOT_PRESSURES];
+};
+
 struct ev_select {
 	char *ev_name;
 	bool plot_ev;
 };
 
 struct plot_info calculate_max_limits_new(struct dive *dive, struct divecomputer *given_dc);
-void compare_samples(struct plot_data *e1, struct plot_data *e2, char *buf, int bufsize, int sum);
+void compare_samples(struct plot_info *pi, int idx1, int idx2, char *buf, int bufsize, int sum);
 struct plot_data *populate_plot_entries(struct dive *dive, struct divecomputer *dc, struct plot_info *pi);
 struct plot_info *analyze_plot_info(struct plot_info *pi);
+void calculate_sac_information(struct dive *dive, struct divecomputer *dc, struct plot_info *pi);
 void create_plot_info_new(struct dive *dive, struct divecomputer *dc, struct plot_info *pi, bool fast, struct deco_state *planner_ds);
+void init_profile_deco_config(struct deco_config *config, const struct deco_state *planner_ds);
 void calculate_deco_information(struct deco_state *ds, const struct deco_state *planner_de, const struct dive *dive, const struct divecomputer *dc, struct plot_info *pi, bool print_mode);
 struct plot_data *get_plot_details_new(struct plot_info *pi, int time, struct membuffer *);
 
@@ -96,13 +102,53 @@ int get_maxtime(struct plot_info *pi);
  * partial pressure graphs */
 int get_maxdepth(struct plot_info *pi);
 
-#define SENSOR_PR 0
-#define INTERPOLATED_PR 1
-#define SENSOR_PRESSURE(_entry,_idx) (_entry)->pressure[_idx][SENSOR_PR]
-#define INTERPOLATED_PRESSURE(_entry,_idx) (_entry)->pressure[_idx][INTERPOLATED_PR]
-#define GET_PRESSURE(_entry,_idx) (SENSOR_PRESSURE(_entry,_idx) ? SENSOR_PRESSURE(_entry,_idx) : INTERPOLATED_PRESSURE(_entry,_idx))
 #define SAC_WINDOW 45 /* sliding window in seconds for current SAC calculation */
 
+void free_plot_info_data(struct plot_info *pi);
+void copy_plot_info_data(struct plot_info *dest, const struct plot_info *src);
+
+/* Cylinders the dive doesn't have read as zero pressure */
+static inline int get_plot_pressure_data(const struct plot_info *pi, int idx, enum plot_pressure sensor, int cylinder)
+{
+	if (cylinder < 0 || cylinder >= pi->nr_cylinders)
+		return 0;
+	return pi->pressures[cylinder + idx * pi->nr_cylinders].data[sensor];
+}
+
+static inline void set_plot_pressure_data(struct plot_info *pi, int idx, enum plot_pressure sensor, int cylinder, int value)
+{
+	if (cylinder < 0 || cylinder >= pi->nr_cylinders)
+		return;
+	pi->pressures[cylinder + idx * pi->nr_cylinders].data[sensor] = value;
+}
+
+static inline int get_plot_sensor_pressure(const struct plot_info *pi, int idx, int cylinder)
+{
+	return get_plot_pressure_data(pi, idx, SENSOR_PR, cylinder);
+}
+
+static inline int get_plot_interpolated_pressure(const struct plot_info *pi, int idx, int cylinder)
+{
+	return get_plot_pressure_data(pi, idx, INTERPOLATED_PR, cylinder);
+}
+
+static inline int get_plot_pressure(const struct plot_info *pi, int idx, int cylinder)
+{
+	int res = get_plot_sensor_pressure(pi, idx, cylinder);
+	return res ? res : get_plot_interpolated_pressure(pi, idx, cylinder);
+}
+
+/* Per-tissue data reads as zero if the deco information wasn't calculated */
+static inline int get_plot_tissue_ceiling(const struct plot_info *pi, int idx, int tissue)
+{
+	return pi->ceilings ? pi->ceilings[tissue + idx * 16] : 0;
+}
+
+static inline int get_plot_tissue_percentage(const struct plot_info *pi, int idx, int tissue)
+{
+	return pi->percentages ? pi->percentages[tissue + idx * 16] : 0;
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -10,6 +10,7 @@
 #include "subsurfacesysinfo.h"
 #include "version.h"
 #include "divecomputer.h"
+#include "diveinfocache.h"
 #include "time.h"
 #include "gettextfromc.h"
 #include "metadata.h"
@@ -17,6 +18,7 @@
 #include "exif.h"
 #include "file.h"
 #include "imagedownloader.h"
+#include "thumbnailstore.h"
 #include <QFile>
 #include <QRegExp>
 #include <QDir>
@@ -27,6 +29,7 @@
 #include <QDateTime>
 #include <QImageReader>
 #include <QtConcurrent>
+#include <QThread>
 #include <QFont>
 #include <QApplication>
 #include <QTextDocument>
@@ -383,13 +386,13 @@ QVector<QPair<QString, int>> selectedDivesGasUsed()
 	for_each_dive (i, d) {
 		if (!d->selected)
 			continue;
-		volume_t diveGases[MAX_CYLINDERS] = {};
-		get_gas_used(d, diveGases);
-		for (j = 0; j < MAX_CYLINDERS; j++)
-			if (diveGases[j].mliter) {
+		for (j = 0; j < MAX_CYLINDERS; j++) {
+			volume_t used = DiveInfoCache::instance()->gasUsed(d, j);
+			if (used.mliter) {
 				QString gasName = gasname(d->cylinder[j].gasmix);
-				gasUsed[gasName] += diveGases[j].mliter;
+				gasUsed[gasName] += used.mliter;
 			}
+		}
 	}
 	QVector<QPair<QString, int>> gasUsedOrdered;
 	gasUsedOrdered.reserve(gasUsed.size());
@@ -969,27 +972,12 @@ static const QString hashfile_name()
 	return QString(system_default_directory()).append("/hashes");
 }
 
-static QString thumbnailDir()
-{
-	return QString(system_default_directory()) + "/thumbnails/";
-}
-
-// Calculate thumbnail filename by hashing name of file.
-QString thumbnailFileName(const QString &filename)
-{
-	if (filename.isEmpty())
-		return QString();
-	QCryptographicHash hash(QCryptographicHash::Sha1);
-	hash.addData(filename.toUtf8());
-	return thumbnailDir() + hash.result().toHex();
-}
-
 extern "C" char *hashfile_name_string()
 {
 	return copy_qstring(hashfile_name());
 }
 
-// During a transition period, convert old thumbnail-hashes to individual files
+// During a transition period, convert old thumbnail-hashes to the thumbnail store
 // TODO: remove this code in due course
 static void convertThumbnails(const QHash <QString, QImage> &thumbnails)
 {
@@ -1006,21 +994,18 @@ static void convertThumbnails(const QHash <QString, QImage> &thumbnails)
 		if (thumbnail.isNull())
 			continue;
 
-		// This is duplicate code (see qt-models/divepicturemodel.cpp)
+		// This is duplicate code (see core/imagedownloader.cpp)
 		// Not a problem, since this routine will be removed in due course.
-		QString filename = thumbnailFileName(name);
-		if (filename.isEmpty())
+		if (name.isEmpty())
 			continue;
 
-		QSaveFile file(filename);
-		if (!file.open(QIODevice::WriteOnly))
-			return;
-		QDataStream stream(&file);
+		QByteArray data;
+		QDataStream stream(&data, QIODevice::WriteOnly);
 
 		quint32 type = MEDIATYPE_PICTURE;
 		stream << type;
 		stream << thumbnail;
-		file.commit();
+		ThumbnailStore::instance()->put(name, data);
 
 		progress.setValue(++count);
 		if (progress.wasCanceled())
@@ -1088,9 +1073,6 @@ void read_hashes()
 	}
 	QMutexLocker locker(&hashOfMutex);
 	localFilenameOf.remove("");
-
-	// Make sure that the thumbnail directory exists
-	QDir().mkpath(thumbnailDir());
 }
 
 void write_hashes()
@@ -1108,6 +1090,7 @@ void write_hashes()
 	} else {
 		qWarning() << "Cannot open hashfile for writing: " << hashfile.fileName();
 	}
+	write_metadata_cache();
 }
 
 void learnPictureFilename(const QString &originalName, const QString &localName)
@@ -1574,31 +1557,6 @@ char *intdup(int index)
 	return strdup(tmpbuf);
 }
 
-QHash<int, double> factor_cache;
-
-QReadWriteLock factorCacheLock;
-extern "C" double cache_value(int tissue, int timestep, enum inertgas inertgas)
-{
-	double value;
-	int key = (timestep << 5) + (tissue << 1);
-	if (inertgas == HE)
-		++key;
-	factorCacheLock.lockForRead();
-	value = factor_cache.value(key);
-	factorCacheLock.unlock();
-	return value;
-}
-
-extern "C" void cache_insert(int tissue, int timestep, enum inertgas inertgas, double value)
-{
-	int key = (timestep << 5) + (tissue << 1);
-	if (inertgas == HE)
-		++key;
-	factorCacheLock.lockForWrite();
-	factor_cache.insert(key, value);
-	factorCacheLock.unlock();
-}
-
 extern "C" void print_qt_versions()
 {
 	printf("%s\n", qPrintable(QStringLiteral("built with Qt Version %1, runtime from Qt Version %2").arg(QT_VERSION_STR).arg(qVersion())));
@@ -1616,6 +1574,45 @@ extern "C" void unlock_planner()
 	planLock.unlock();
 }
 
+QMutex decoCacheLock;
+
+extern "C" void lock_deco_cache()
+{
+	decoCacheLock.lock();
+}
+
+extern "C" void unlock_deco_cache()
+{
+	decoCacheLock.unlock();
+}
+
+QMutex diveTimeIndexLock;
+
+extern "C" void lock_dive_time_index()
+{
+	diveTimeIndexLock.lock();
+}
+
+extern "C" void unlock_dive_time_index()
+{
+	diveTimeIndexLock.unlock();
+}
+
+extern "C" int ideal_thread_count()
+{
+	return QThread::idealThreadCount();
+}
+
+// Call fn(data, i) for i = 0..n-1 on the global thread pool and wait until all calls returned.
+// The calls may run in any order and concurrently, so fn must only touch data belonging to item i.
+extern "C" void run_parallel(int n, void (*fn)(void *data, int i), void *data)
+{
+	QVector<int> items(n);
+	for (int i = 0; i < n; i++)
+		items[i] = i;
+	QtConcurrent::blockingMap(items, [fn, data](int &i) { fn(data, i); });
+}
+
 char *copy_qstring(const QString &s)
 {
 	return strdup(qPrintable(s));
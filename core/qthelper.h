@@ -8,11 +8,7 @@
 #include "dive.h"
 #include "divelist.h"
 
-// 1) Types
-
-enum inertgas {N2, HE};
-
-// 2) Functions visible only to C++ parts
+// 1) Functions visible only to C++ parts
 
 #ifdef __cplusplus
 
@@ -30,7 +26,6 @@ QString get_divepoint_gas_string(struct dive *d, const divedatapoint& dp);
 QString get_taglist_string(struct tag_entry *tag_list);
 void read_hashes();
 void write_hashes();
-QString thumbnailFileName(const QString &filename);
 void learnPictureFilename(const QString &originalName, const QString &localName);
 QString localFilePath(const QString &originalFilename);
 weight_t string_to_weight(const char *str);
@@ -135,7 +130,7 @@ struct QOverload {
 
 #endif
 
-// 3) Functions visible to C and C++
+// 2) Functions visible to C and C++
 
 #ifdef __cplusplus
 extern "C" {
@@ -158,11 +153,15 @@ const char *subsurface_user_agent();
 enum deco_mode decoMode();
 int parse_seabear_header(const char *filename, char **params, int pnr);
 char *get_current_date();
-double cache_value(int tissue, int timestep, enum inertgas gas);
-void cache_insert(int tissue, int timestep, enum inertgas gas, double value);
 void print_qt_versions();
 void lock_planner();
 void unlock_planner();
+void lock_deco_cache();
+void unlock_deco_cache();
+void lock_dive_time_index();
+void unlock_dive_time_index();
+int ideal_thread_count();
+void run_parallel(int n, void (*fn)(void *data, int i), void *data);
 xsltStylesheetPtr get_stylesheet(const char *name);
 
 #ifdef __cplusplus
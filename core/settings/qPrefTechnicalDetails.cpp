@@ -82,7 +82,6 @@ void qPrefTechnicalDetails::disk_gfhigh(bool doSync)
 			qPrefPrivate::propSetValue(keyFromGroupAndName(group, "gfhigh"), prefs.gfhigh, default_prefs.gfhigh);
 	} else {
 		prefs.gfhigh = qPrefPrivate::propValue(keyFromGroupAndName(group, "gfhigh"), default_prefs.gfhigh).toInt();
-		set_gf(-1, prefs.gfhigh);
 	}
 }
 
@@ -102,7 +101,6 @@ void qPrefTechnicalDetails::disk_gflow(bool doSync)
 			qPrefPrivate::propSetValue(keyFromGroupAndName(group, "gflow"), prefs.gflow, default_prefs.gflow);
 	} else {
 		prefs.gflow = qPrefPrivate::propValue(keyFromGroupAndName(group, "gflow"), default_prefs.gflow).toInt();
-		set_gf(prefs.gflow, -1);
 	}
 }
 
@@ -152,7 +150,6 @@ void qPrefTechnicalDetails::disk_vpmb_conservatism(bool doSync)
 			qPrefPrivate::propSetValue(keyFromGroupAndName(group, "vpmb_conservatism"), prefs.vpmb_conservatism, default_prefs.vpmb_conservatism);
 	} else {
 		prefs.vpmb_conservatism = qPrefPrivate::propValue(keyFromGroupAndName(group, "vpmb_conservatism"), default_prefs.vpmb_conservatism).toInt();
-		set_vpmb_conservatism(prefs.vpmb_conservatism);
 	}
 }
 
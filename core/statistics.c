@@ -359,12 +359,12 @@ bool is_cylinder_prot(const struct dive *dive, int idx)
 	return false;
 }
 
-void get_gas_used(struct dive *dive, volume_t gases[MAX_CYLINDERS])
+void get_gas_used(const struct dive *dive, volume_t gases[MAX_CYLINDERS])
 {
 	int idx;
 
 	for (idx = 0; idx < MAX_CYLINDERS; idx++) {
-		cylinder_t *cyl = &dive->cylinder[idx];
+		const cylinder_t *cyl = &dive->cylinder[idx];
 		pressure_t start, end;
 
 		start = cyl->start.mbar ? cyl->start : cyl->sample_start;
@@ -23,45 +23,60 @@
 	}
 
 /* get the index where we want to insert an object so that everything stays
- * ordered according to a comparison function() */
+ * ordered according to a comparison function(). The table must be sorted
+ * accordingly. Objects are inserted after objects that compare equal. */
 #define MAKE_GET_INSERTION_INDEX(table_type, item_type, array_name, fun)		\
 	int table_type##_get_insertion_index(struct table_type *table, item_type item)	\
 	{										\
-		/* we might want to use binary search here */				\
-		for (int i = 0; i < table->nr; i++) {					\
-			if (fun(item, table->array_name[i]))				\
-				return i;						\
+		int lo = 0, hi = table->nr;						\
+		while (lo < hi) {							\
+			int mid = lo + (hi - lo) / 2;					\
+			if (fun(item, table->array_name[mid]))				\
+				hi = mid;						\
+			else								\
+				lo = mid + 1;						\
 		}									\
-		return table->nr;							\
+		return lo;								\
 	}
 
 /* add object at the given index to a table. */
 #define MAKE_ADD_TO(table_type, item_type, array_name)					\
 	void add_to_##table_type(struct table_type *table, int idx, item_type item)	\
 	{										\
-		int i;									\
 		grow_##table_type(table);						\
+		memmove(table->array_name + idx + 1, table->array_name + idx,		\
+			(table->nr - idx) * sizeof(item_type));				\
+		table->array_name[idx] = item;						\
 		table->nr++;								\
-											\
-		for (i = idx; i < table->nr; i++) {					\
-			item_type tmp = table->array_name[i];				\
-			table->array_name[i] = item;					\
-			item = tmp;							\
-		}									\
 	}
 
-#define MAKE_REMOVE_FROM(table_type, array_name)				\
-	void remove_from_##table_type(struct table_type *table, int idx)	\
-	{									\
-		int i;								\
-		for (i = idx; i < table->nr - 1; i++)				\
-			table->array_name[i] = table->array_name[i + 1];	\
-		table->array_name[--table->nr] = NULL;				\
+#define MAKE_REMOVE_FROM(table_type, array_name)					\
+	void remove_from_##table_type(struct table_type *table, int idx)		\
+	{										\
+		memmove(table->array_name + idx, table->array_name + idx + 1,		\
+			(table->nr - idx - 1) * sizeof(table->array_name[0]));		\
+		table->array_name[--table->nr] = NULL;					\
 	}
 
-#define MAKE_GET_IDX(table_type, item_type, array_name)						\
+/* find an object in a table that is sorted according to the comparison
+ * function(). The objects that compare equal are searched one by one.
+ * Since the order of some tables depends on data that may change, fall
+ * back to a linear search if that doesn't find the object. */
+#define MAKE_GET_IDX(table_type, item_type, array_name, fun)					\
 	int get_idx_in_##table_type(const struct table_type *table, const item_type item)	\
 	{											\
+		int lo = 0, hi = table->nr;							\
+		while (lo < hi) {								\
+			int mid = lo + (hi - lo) / 2;						\
+			if (fun(table->array_name[mid], item))					\
+				lo = mid + 1;							\
+			else									\
+				hi = mid;							\
+		}										\
+		for (; lo < table->nr && !fun(item, table->array_name[lo]); ++lo) {		\
+			if (table->array_name[lo] == item)					\
+				return lo;							\
+		}										\
 		for (int i = 0; i < table->nr; ++i) {						\
 			if (table->array_name[i] == item)					\
 				return i;							\
@@ -69,6 +84,30 @@
 		return -1;									\
 	}
 
+/* add a batch of objects, sorted according to the comparison function(), to a
+ * table that is sorted the same way. Equivalent to adding them one by one at
+ * their insertion index, but merges both in a single pass from the back. */
+#define MAKE_ADD_SORTED(table_type, item_type, array_name, fun)					\
+	void add_sorted_to_##table_type(struct table_type *table, item_type *items, int nr)	\
+	{											\
+		int i = table->nr - 1, j = nr - 1, k = table->nr + nr - 1;			\
+												\
+		if (table->nr + nr > table->allocated) {					\
+			table->allocated = (table->nr + nr + 32) * 3 / 2;			\
+			table->array_name = realloc(table->array_name,				\
+						    table->allocated * sizeof(item_type));	\
+			if (!table->array_name)							\
+				exit(1);							\
+		}										\
+		while (j >= 0) {								\
+			if (i >= 0 && fun(items[j], table->array_name[i]))			\
+				table->array_name[k--] = table->array_name[i--];		\
+			else									\
+				table->array_name[k--] = items[j--];				\
+		}										\
+		table->nr += nr;								\
+	}
+
 #define MAKE_SORT(table_type, item_type, array_name, fun)					\
 	static int sortfn_##table_type(const void *_a, const void *_b)				\
 	{											\
@@ -0,0 +1,316 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "thumbnailstore.h"
+#include "core/pref.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QDataStream>
+#include <QDateTime>
+#include <QSaveFile>
+#include <QCryptographicHash>
+#include <QDebug>
+#include <algorithm>
+
+// Both files start with the same header. The generation changes when the files are
+// rewritten, so that an index is never used with the data file of another generation.
+//	uint32	magic
+//	uint32	version
+//	uint64	generation
+// The data file continues with the thumbnails, the index with one entry per stored thumbnail:
+//	20 bytes	SHA-1 of the picture filename
+//	int64		offset of the thumbnail in the data file
+//	uint32		size of the thumbnail
+//	int64		creation time, msecs since epoch
+// Later entries of the index replace earlier ones of the same picture.
+static const quint32 storeMagic = 0x53544842;
+static const quint32 storeVersion = 1;
+static const qint64 headerSize = 16;
+static const qint64 indexEntrySize = 40;
+// Don't bother compacting for less than this amount of replaced thumbnails
+static const qint64 minGarbage = 4 * 1024 * 1024;
+
+static void writeHeader(QDataStream &stream, quint64 generation)
+{
+	stream << storeMagic << storeVersion << generation;
+}
+
+static bool readHeader(QDataStream &stream, quint64 &generation)
+{
+	quint32 magic, version;
+	stream >> magic >> version >> generation;
+	return stream.status() == QDataStream::Ok && magic == storeMagic && version == storeVersion;
+}
+
+static QByteArray keyOf(const QString &filename)
+{
+	return QCryptographicHash::hash(filename.toUtf8(), QCryptographicHash::Sha1);
+}
+
+ThumbnailStore *ThumbnailStore::instance()
+{
+	static ThumbnailStore self(system_default_directory());
+	return &self;
+}
+
+ThumbnailStore::ThumbnailStore(const QString &dir) : dir(dir),
+	opened(false),
+	dataFile(dir + "/thumbnails.dat"),
+	indexFile(dir + "/thumbnails.idx"),
+	generation(0),
+	live(0),
+	map(nullptr),
+	mapSize(0)
+{
+}
+
+ThumbnailStore::~ThumbnailStore()
+{
+	close();
+}
+
+// Open the files on first use. Call with the lock held.
+void ThumbnailStore::open()
+{
+	if (opened)
+		return;
+	opened = true;
+	QDir().mkpath(dir);
+	load();
+	migrate();
+	if (dataFile.size() - headerSize - live > std::max(live, minGarbage))
+		compactLocked();
+}
+
+void ThumbnailStore::load()
+{
+	if (!readIndex()) {
+		// Start over with empty files
+		index.clear();
+		live = 0;
+		generation = QDateTime::currentMSecsSinceEpoch();
+		QSaveFile newData(dataFile.fileName()), newIndex(indexFile.fileName());
+		if (newData.open(QIODevice::WriteOnly) && newIndex.open(QIODevice::WriteOnly)) {
+			QDataStream dataStream(&newData), indexStream(&newIndex);
+			writeHeader(dataStream, generation);
+			writeHeader(indexStream, generation);
+			newData.commit();
+			newIndex.commit();
+		}
+	}
+	if (!dataFile.open(QIODevice::ReadWrite) || !indexFile.open(QIODevice::WriteOnly | QIODevice::Append)) {
+		qWarning() << "Cannot open thumbnail store" << dataFile.fileName();
+		close();
+	}
+}
+
+void ThumbnailStore::close()
+{
+	if (map)
+		dataFile.unmap(map);
+	map = nullptr;
+	mapSize = 0;
+	dataFile.close();
+	indexFile.close();
+	index.clear();
+	live = 0;
+}
+
+bool ThumbnailStore::readIndex()
+{
+	if (!dataFile.open(QIODevice::ReadOnly))
+		return false;
+	if (!indexFile.open(QIODevice::ReadOnly)) {
+		dataFile.close();
+		return false;
+	}
+	QDataStream dataStream(&dataFile), indexStream(&indexFile);
+	quint64 dataGeneration, indexGeneration;
+	bool ok = readHeader(dataStream, dataGeneration) && readHeader(indexStream, indexGeneration) &&
+		  dataGeneration == indexGeneration;
+	qint64 size = dataFile.size();
+	qint64 end = headerSize;
+	dataFile.close();
+	if (!ok) {
+		indexFile.close();
+		return false;
+	}
+
+	index.reserve((indexFile.size() - headerSize) / indexEntrySize);
+	for (;;) {
+		char key[20];
+		Entry entry;
+		if (indexStream.readRawData(key, sizeof(key)) != sizeof(key))
+			break;
+		indexStream >> entry.offset >> entry.size >> entry.created;
+		if (indexStream.status() != QDataStream::Ok)
+			break;
+		end += indexEntrySize;
+		// The thumbnail may not have been written completely
+		if (entry.offset < headerSize || entry.offset + entry.size > size)
+			continue;
+		QByteArray k(key, sizeof(key));
+		auto it = index.find(k);
+		if (it != index.end())
+			live -= it->size;
+		index.insert(k, entry);
+		live += entry.size;
+	}
+	// Drop a partially written entry, so that new entries are appended at the right place
+	bool truncated = indexFile.size() != end;
+	indexFile.close();
+	if (truncated)
+		indexFile.resize(end);
+	generation = dataGeneration;
+	return true;
+}
+
+bool ThumbnailStore::append(const QByteArray &key, const QByteArray &data, qint64 created)
+{
+	if (!dataFile.isOpen())
+		return false;
+	Entry entry { dataFile.size(), (quint32)data.size(), created };
+	if (!dataFile.seek(entry.offset) || dataFile.write(data) != data.size() || !dataFile.flush())
+		return false;
+
+	QDataStream stream(&indexFile);
+	stream.writeRawData(key.constData(), key.size());
+	stream << entry.offset << entry.size << entry.created;
+	if (stream.status() != QDataStream::Ok || !indexFile.flush())
+		return false;
+
+	auto it = index.find(key);
+	if (it != index.end())
+		live -= it->size;
+	index.insert(key, entry);
+	live += entry.size;
+	return true;
+}
+
+ThumbnailStore::Thumbnail ThumbnailStore::getEntry(const QByteArray &key)
+{
+	auto it = index.constFind(key);
+	if (it == index.cend())
+		return { QByteArray(), 0 };
+	const Entry &entry = *it;
+
+	// Thumbnails were appended since the file was mapped
+	if (entry.offset + entry.size > mapSize) {
+		if (map)
+			dataFile.unmap(map);
+		mapSize = dataFile.size();
+		map = dataFile.map(0, mapSize);
+		if (!map)
+			mapSize = 0;
+	}
+	if (map)
+		return { QByteArray((const char *)map + entry.offset, entry.size), entry.created };
+
+	// Mapping failed, read the thumbnail from the file instead
+	QByteArray data;
+	if (dataFile.seek(entry.offset))
+		data = dataFile.read(entry.size);
+	return { data, entry.created };
+}
+
+ThumbnailStore::Thumbnail ThumbnailStore::get(const QString &filename)
+{
+	QByteArray key = keyOf(filename);
+	QMutexLocker l(&lock);
+	open();
+	return getEntry(key);
+}
+
+QVector<ThumbnailStore::Thumbnail> ThumbnailStore::get(const QVector<QString> &filenames)
+{
+	QVector<QByteArray> keys;
+	keys.reserve(filenames.size());
+	for (const QString &filename: filenames)
+		keys.append(keyOf(filename));
+
+	QVector<Thumbnail> res;
+	res.reserve(filenames.size());
+	QMutexLocker l(&lock);
+	open();
+	for (const QByteArray &key: keys)
+		res.append(getEntry(key));
+	return res;
+}
+
+void ThumbnailStore::put(const QString &filename, const QByteArray &data)
+{
+	QByteArray key = keyOf(filename);
+	QMutexLocker l(&lock);
+	open();
+	append(key, data, QDateTime::currentMSecsSinceEpoch());
+}
+
+void ThumbnailStore::compact()
+{
+	QMutexLocker l(&lock);
+	open();
+	compactLocked();
+}
+
+// Write the thumbnails of the index to new files, dropping the replaced thumbnails
+void ThumbnailStore::compactLocked()
+{
+	if (!dataFile.isOpen())
+		return;
+	QSaveFile newData(dataFile.fileName()), newIndex(indexFile.fileName());
+	if (!newData.open(QIODevice::WriteOnly) || !newIndex.open(QIODevice::WriteOnly))
+		return;
+	quint64 newGeneration = std::max((quint64)QDateTime::currentMSecsSinceEpoch(), generation + 1);
+	QDataStream dataStream(&newData), indexStream(&newIndex);
+	writeHeader(dataStream, newGeneration);
+	writeHeader(indexStream, newGeneration);
+	qint64 offset = headerSize;
+	for (auto it = index.cbegin(); it != index.cend(); ++it) {
+		Thumbnail thumbnail = getEntry(it.key());
+		if (thumbnail.data.size() != (int)it->size)
+			continue;
+		dataStream.writeRawData(thumbnail.data.constData(), thumbnail.data.size());
+		indexStream.writeRawData(it.key().constData(), it.key().size());
+		indexStream << offset << it->size << it->created;
+		offset += it->size;
+	}
+
+	// The old files must be closed before they can be replaced. If only the data file
+	// is replaced, the generations don't match and the store starts over.
+	close();
+	if (newData.commit())
+		newIndex.commit();
+	load();
+}
+
+// Import the thumbnails of older versions, which were stored in one file per picture,
+// named by the SHA-1 of the picture filename. The directory is removed afterwards.
+void ThumbnailStore::migrate()
+{
+	QDir oldDir(dir + "/thumbnails");
+	if (!oldDir.exists())
+		return;
+	for (const QFileInfo &info: oldDir.entryInfoList(QDir::Files)) {
+		QByteArray key = QByteArray::fromHex(info.fileName().toLatin1());
+		QFile file(info.filePath());
+		// Thumbnails that are already in the store were imported by an interrupted migration
+		if (key.size() != 20 || index.contains(key) || !file.open(QIODevice::ReadOnly))
+			continue;
+		if (!append(key, file.readAll(), info.lastModified().toMSecsSinceEpoch()))
+			return;		// keep the old thumbnails, we'll try again next time
+	}
+	oldDir.removeRecursively();
+}
+
+qint64 ThumbnailStore::dataSize()
+{
+	QMutexLocker l(&lock);
+	open();
+	return dataFile.size();
+}
+
+qint64 ThumbnailStore::liveSize()
+{
+	QMutexLocker l(&lock);
+	open();
+	return live;
+}
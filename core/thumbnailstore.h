@@ -0,0 +1,69 @@
+// SPDX-License-Identifier: GPL-2.0
+#ifndef THUMBNAILSTORE_H
+#define THUMBNAILSTORE_H
+
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+#include <QHash>
+#include <QFile>
+#include <QMutex>
+
+// The thumbnails of all pictures, packed into one data file, to which new thumbnails
+// are appended, and an index file, which maps the SHA-1 of the picture filename to the
+// position of the thumbnail in the data file. The data file is memory-mapped for reading.
+// Replaced thumbnails stay in the data file until the store is compacted, which happens
+// automatically when the store is opened and mostly consists of replaced thumbnails.
+// The store doesn't care about the format of the thumbnails, see Thumbnailer for that.
+// All functions are thread safe.
+class ThumbnailStore {
+public:
+	struct Thumbnail {
+		QByteArray data;	// empty if there is no thumbnail
+		qint64 created;		// msecs since epoch
+	};
+
+	// The store in the Subsurface directory
+	static ThumbnailStore *instance();
+	// A store in the given directory. Files are only opened on first use.
+	ThumbnailStore(const QString &dir);
+	~ThumbnailStore();
+
+	Thumbnail get(const QString &filename);
+	QVector<Thumbnail> get(const QVector<QString> &filenames);
+	void put(const QString &filename, const QByteArray &data);
+	void compact();
+
+	// Size of the data file and of the thumbnails in it, for testing
+	qint64 dataSize();
+	qint64 liveSize();
+
+private:
+	struct Entry {
+		qint64 offset;
+		quint32 size;
+		qint64 created;
+	};
+
+	void open();
+	void load();
+	void close();
+	bool readIndex();
+	void migrate();
+	bool append(const QByteArray &key, const QByteArray &data, qint64 created);
+	Thumbnail getEntry(const QByteArray &key);
+	void compactLocked();
+
+	QString dir;
+	QMutex lock;
+	bool opened;
+	QFile dataFile;
+	QFile indexFile;
+	quint64 generation;
+	QHash<QByteArray, Entry> index;
+	qint64 live;			// bytes of the thumbnails in the index
+	uchar *map;
+	qint64 mapSize;
+};
+
+#endif
@@ -173,8 +173,9 @@ void uemis_set_divelocation(int divespot, char *text, double longitude, double l
 		if (hp->divespot == divespot) {
 			struct dive_site *ds = hp->dive_site;
 			if (ds) {
-				ds->name = strdup(text);
-				ds->location = create_location(latitude, longitude);
+				set_dive_site_name(ds, text);
+				location_t location = create_location(latitude, longitude);
+				set_dive_site_location(ds, &location);
 			}
 		}
 		hp = hp->next;
@@ -11,6 +11,7 @@
 #include "qt-models/filtermodels.h"
 
 #include <array>
+#include <algorithm>
 
 namespace Command {
 
@@ -77,7 +78,7 @@ dive *DiveListBase::addDive(DiveToAdd &d)
 	res->hidden_by_filter = !show;
 
 	int idx = dive_table_get_insertion_index(&dive_table, res);
-	add_to_dive_table(&dive_table, idx, res);	// Return ownership to backend
+	add_single_dive(idx, res);		// Return ownership to backend
 	invalidate_dive_cache(res);		// Ensure that dive is written in git_save()
 
 	// If the dive to be removed is selected, we will inform the frontend
@@ -560,11 +561,12 @@ ShiftTime::ShiftTime(const QVector<dive *> &changedDives, int amount)
 void ShiftTime::redoit()
 {
 	for (dive *d: diveList)
-		d->when += timeChanged;
+		set_dive_time(d, d->when + timeChanged);
 
 	// Changing times may have unsorted the dive table
 	sort_dive_table(&dive_table);
 	sort_trip_table(&trip_table);
+	invalidate_dive_time_index();
 
 	// Send signals per trip (see comments in DiveListNotifier.h) and sort tables.
 	processByTrip(diveList, [&](dive_trip *trip, const QVector<dive *> &divesInTrip) {
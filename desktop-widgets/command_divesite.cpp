@@ -167,7 +167,9 @@ bool EditDiveSiteName::workToBeDone()
 
 void EditDiveSiteName::redo()
 {
-	swap(ds->name, value);
+	QString s = ds->name;
+	set_dive_site_name(ds, value.toUtf8().constData());
+	value = s;
 	emit diveListNotifier.diveSiteChanged(ds, LocationInformationModel::NAME); // Inform frontend of changed dive site.
 }
 
@@ -265,7 +267,9 @@ bool EditDiveSiteLocation::workToBeDone()
 
 void EditDiveSiteLocation::redo()
 {
-	std::swap(value, ds->location);
+	location_t old = ds->location;
+	set_dive_site_location(ds, &value);
+	value = old;
 	emit diveListNotifier.diveSiteChanged(ds, LocationInformationModel::LOCATION); // Inform frontend of changed dive site.
 }
 
@@ -19,11 +19,14 @@
 #include <QStandardPaths>
 #include <QMessageBox>
 #include <QHeaderView>
+#include <QProgressDialog>
+#include <QEventLoop>
 #include "core/qthelper.h"
 #include "desktop-widgets/command.h"
 #include "desktop-widgets/divelistview.h"
 #include "qt-models/divepicturemodel.h"
 #include "core/metrics.h"
+#include "core/mediascanner.h"
 #include "desktop-widgets/simplewidgets.h"
 
 DiveListView::DiveListView(QWidget *parent) : QTreeView(parent), mouseClickSelection(false),
@@ -996,8 +999,28 @@ void DiveListView::matchImagesToDives(QStringList fileNames)
 		return;
 	updateLastImageTimeOffset(shiftDialog.amount());
 
-	for (const QString &fileName: fileNames)
-		create_picture(qPrintable(fileName), shiftDialog.amount(), shiftDialog.matchAll());
+	// Read the metadata in the background, but match the files to the dives here,
+	// since that changes the dives. The dialog is modal, so the selection stays put.
+	int shift = shiftDialog.amount();
+	bool matchAll = shiftDialog.matchAll();
+	QProgressDialog progress(tr("Reading media files..."), tr("Cancel"), 0, fileNames.size(), this);
+	progress.setWindowModality(Qt::WindowModal);
+	progress.setMinimumDuration(500);
+	MediaScanner scanner;
+	QEventLoop loop;
+	int done = 0;
+	// The progress dialog as context makes the batches arrive in the UI thread
+	connect(&scanner, &MediaScanner::scanned, &progress, [&](int, const QVector<MediaMetadata> &batch) {
+		for (const MediaMetadata &item: batch)
+			create_picture_with_metadata(qPrintable(item.filename), &item.data, shift, matchAll);
+		done += batch.size();
+		progress.setValue(done);
+	});
+	connect(&scanner, &MediaScanner::finished, &loop, &QEventLoop::quit);
+	connect(&progress, &QProgressDialog::canceled, &scanner, &MediaScanner::cancel);
+	scanner.scan(fileNames);
+	loop.exec();
+	write_metadata_cache();
 
 	mark_divelist_changed(true);
 	copy_dive(current_dive, &displayed_dive);
@@ -17,6 +17,7 @@
 #include "profile-widget/profilewidget2.h"
 #include "core/save-profiledata.h"
 #include "core/divesite.h"
+#include "core/diveinfocache.h"
 
 // Retrieves the current unit settings defined in the Subsurface preferences.
 #define GET_UNIT(name, field, f, t)           \
@@ -361,7 +362,6 @@ void DiveLogExportDialog::export_TeX(const char *filename, const bool selected_o
 		int i;
 		int qty_cyl;
 		int qty_weight;
-		double total_weight;
 
 		if (need_pagebreak) {
 			if (plain)
@@ -394,14 +394,7 @@ void DiveLogExportDialog::export_TeX(const char *filename, const bool selected_o
 		dive->maxdepth.mm ? put_format(&buf, "\\def\\%smaximumdepth{%.1f\\%sdepthunit}\n", ssrf, get_depth_units(dive->maxdepth.mm, NULL, &unit), ssrf) : put_format(&buf, "\\def\\%smaximumdepth{}\n", ssrf);
 		dive->meandepth.mm ? put_format(&buf, "\\def\\%smeandepth{%.1f\\%sdepthunit}\n", ssrf, get_depth_units(dive->meandepth.mm, NULL, &unit), ssrf) : put_format(&buf, "\\def\\%smeandepth{}\n", ssrf);
 
-		struct tag_entry *tag = dive->tag_list;
-		QString tags;
-		if (tag) {
-			tags = tag->tag->name;
-			while ((tag = tag->next))
-				tags += QString(", ") + QString(tag->tag->name);
-		}
-		put_format(&buf, "\\def\\%stype{%s}\n", ssrf, qPrintable(tags));
+		put_format(&buf, "\\def\\%stype{%s}\n", ssrf, qPrintable(DiveInfoCache::instance()->tags(dive)));
 		put_format(&buf, "\\def\\%sviz{%s}\n", ssrf, qPrintable(viz));
 		put_format(&buf, "\\def\\%srating{%s}\n", ssrf, qPrintable(rating));
 		put_format(&buf, "\\def\\%splot{\\includegraphics[width=9cm,height=4cm]{profile%d}}\n", ssrf, dive->number);
@@ -445,20 +438,18 @@ void DiveLogExportDialog::export_TeX(const char *filename, const bool selected_o
 		//Code block prints all weights listed in dive.
 		put_format(&buf, "\n%% Weighting information:\n");
 		qty_weight = 0;
-		total_weight = 0;
 		for (i = 0; i < MAX_WEIGHTSYSTEMS; i++){
 			if (dive->weightsystem[i].weight.grams){
 				put_format(&buf, "\\def\\%sweight%ctype{%s}\n", ssrf, 'a' + i, dive->weightsystem[i].description);
 				put_format(&buf, "\\def\\%sweight%camt{%.3f\\%sweightunit}\n", ssrf, 'a' + i, get_weight_units(dive->weightsystem[i].weight.grams, NULL, &unit), ssrf);
 				qty_weight += 1;
-				total_weight += get_weight_units(dive->weightsystem[i].weight.grams, NULL, &unit);
 			} else {
 				put_format(&buf, "\\def\\%sweight%ctype{}\n", ssrf, 'a' + i);
 				put_format(&buf, "\\def\\%sweight%camt{}\n", ssrf, 'a' + i);
 			}
 		}
 		put_format(&buf, "\\def\\%sqtyweights{%d}\n", ssrf, qty_weight);
-		put_format(&buf, "\\def\\%stotalweight{%.2f\\%sweightunit}\n", ssrf, total_weight, ssrf);
+		put_format(&buf, "\\def\\%stotalweight{%.2f\\%sweightunit}\n", ssrf, get_weight_units(DiveInfoCache::instance()->totalWeight(dive), NULL, &unit), ssrf);
 		unit = "";
 
 		// Legacy fields
@@ -288,6 +288,8 @@ void ShiftImageTimesDialog::buttonClicked(QAbstractButton *button)
 		if (ui.backwards->isChecked())
 			m_amount *= -1;
 	}
+	// The dialog is closed, no need to read the rest of the files
+	scanner.cancel();
 }
 
 void ShiftImageTimesDialog::syncCameraClicked()
@@ -345,11 +347,21 @@ ShiftImageTimesDialog::ShiftImageTimesDialog(QWidget *parent, QStringList fileNa
 	connect(ui.matchAllImages, SIGNAL(toggled(bool)), this, SLOT(matchAllImagesToggled(bool)));
 	dcImageEpoch = (time_t)0;
 
-	// Get times of all files. 0 means that the time couldn't be determined.
+	// Get times of all files in the background. 0 means that the time couldn't be determined.
 	int numFiles = fileNames.size();
 	timestamps.resize(numFiles);
-	for (int i = 0; i < numFiles; ++i)
-		timestamps[i] = picture_get_timestamp(qPrintable(fileNames[i]));
+	scanned.resize(numFiles);
+	connect(&scanner, &MediaScanner::scanned, this, &ShiftImageTimesDialog::mediaScanned);
+	scanner.scan(fileNames);
+	updateInvalid();
+}
+
+void ShiftImageTimesDialog::mediaScanned(int first, const QVector<MediaMetadata> &batch)
+{
+	for (int i = 0; i < batch.size(); ++i) {
+		timestamps[first + i] = batch[i].data.timestamp;
+		scanned.setBit(first + i);
+	}
 	updateInvalid();
 }
 
@@ -386,7 +398,7 @@ void ShiftImageTimesDialog::updateInvalid()
 
 	int numFiles = fileNames.size();
 	for (int i = 0; i < numFiles; ++i) {
-		if (picture_check_valid_time(timestamps[i], m_amount))
+		if (!scanned.testBit(i) || picture_check_valid_time(timestamps[i], m_amount))
 			continue;
 
 		// We've found an invalid image
@@ -11,6 +11,7 @@ class FilterModelBase;
 #include <QGroupBox>
 #include <QDialog>
 #include <QTextEdit>
+#include <QBitArray>
 #include <stdint.h>
 
 #include "ui_renumber.h"
@@ -22,6 +23,7 @@ class FilterModelBase;
 #include "ui_listfilter.h"
 #include "core/exif.h"
 #include "core/dive.h"
+#include "core/mediascanner.h"
 
 
 class MinMaxAvgWidget : public QWidget {
@@ -114,10 +116,13 @@ slots:
 	void timeEditChanged();
 	void updateInvalid();
 	void matchAllImagesToggled(bool);
+	void mediaScanned(int first, const QVector<MediaMetadata> &batch);
 
 private:
 	QStringList fileNames;
 	QVector<timestamp_t> timestamps;
+	QBitArray scanned;
+	MediaScanner scanner;
 	Ui::ShiftImageTimesDialog ui;
 	time_t m_amount;
 	time_t dcImageEpoch;
@@ -11,6 +11,7 @@
 #include "qt-models/weightmodel.h"
 
 #include "core/divelist.h"
+#include "core/diveinfocache.h"
 #include "core/subsurface-string.h"
 
 #include <QSettings>
@@ -202,6 +203,8 @@ void TabDiveEquipment::acceptChanges()
 						mydive->cylinder[i].gasmix = displayed_dive.cylinder[i].gasmix;
 						mydive->cylinder[i].cylinder_use = displayed_dive.cylinder[i].cylinder_use;
 						mydive->cylinder[i].depth = displayed_dive.cylinder[i].depth;
+						invalidate_dive_cache(mydive);	// the gases change the tissues of this and the later dives
+						diveinfo_invalidate(mydive);	// and the gases and cylinders shown in the dive list
 					}
 				}
 			}
@@ -225,6 +228,8 @@ void TabDiveEquipment::acceptChanges()
 			tdc = tdc->next;
 			sdc = sdc->next;
 		}
+		invalidate_dive_cache(cd);
+		diveinfo_invalidate(cd);
 		do_replot = true;
 	}
 
@@ -235,6 +240,7 @@ void TabDiveEquipment::acceptChanges()
 				if (mydive != cd && (same_string(mydive->weightsystem[i].description, cd->weightsystem[i].description))) {
 					mydive->weightsystem[i] = displayed_dive.weightsystem[i];
 					mydive->weightsystem[i].description = copy_string(displayed_dive.weightsystem[i].description);
+					diveinfo_invalidate(mydive);	// the total weight shown in the dive list
 				}
 			}
 		);
@@ -242,6 +248,7 @@ void TabDiveEquipment::acceptChanges()
 			cd->weightsystem[i] = displayed_dive.weightsystem[i];
 			cd->weightsystem[i].description = copy_string(displayed_dive.weightsystem[i].description);
 		}
+		diveinfo_invalidate(cd);
 	}
 
 	if (do_replot)
@@ -3,6 +3,7 @@
 #include <QClipboard>
 #include <QDebug>
 #include <QVector>
+#include <QSet>
 
 #include "qmlmapwidgethelper.h"
 #include "core/divesite.h"
@@ -142,17 +143,44 @@ void MapWidgetHelper::reloadMapLocations()
 	m_mapLocationModel->addList(locationList);
 }
 
+#ifndef SUBSURFACE_MOBILE
+static void addDiveSite(struct dive_site *ds, void *data)
+{
+	static_cast<QSet<struct dive_site *> *>(data)->insert(ds);
+}
+
+// The dive sites in a square around a coordinate
+static QSet<struct dive_site *> diveSitesAround(const QGeoCoordinate &coord, qreal radius)
+{
+	QSet<struct dive_site *> res;
+	radius *= 1.01; // the corners are computed on a different model of the earth
+	QGeoCoordinate north = coord.atDistanceAndAzimuth(radius, 0.0);
+	QGeoCoordinate east = coord.atDistanceAndAzimuth(radius, 90.0);
+	QGeoCoordinate south = coord.atDistanceAndAzimuth(radius, 180.0);
+	QGeoCoordinate west = coord.atDistanceAndAzimuth(radius, 270.0);
+	location_t sw = create_location(south.latitude(), west.longitude());
+	location_t ne = create_location(north.latitude(), east.longitude());
+	for_each_dive_site_in_rectangle(&sw, &ne, &dive_site_table, addDiveSite, &res);
+	return res;
+}
+#endif
+
 void MapWidgetHelper::selectedLocationChanged(MapLocation *location)
 {
 	int idx;
 	struct dive *dive;
 	m_selectedDiveIds.clear();
 	QGeoCoordinate locationCoord = location->coordinate();
+#ifndef SUBSURFACE_MOBILE
+	QSet<struct dive_site *> nearSites = diveSitesAround(locationCoord, m_smallCircleRadius);
+#endif
 	for_each_dive (idx, dive) {
 		struct dive_site *ds = get_dive_site_for_dive(dive);
 		if (!dive_site_has_gps_location(ds))
 			continue;
 #ifndef SUBSURFACE_MOBILE
+		if (!nearSites.contains(ds))
+			continue;
 		const qreal latitude = ds->location.lat.udeg * 0.000001;
 		const qreal longitude = ds->location.lon.udeg * 0.000001;
 		QGeoCoordinate dsCoord(latitude, longitude);
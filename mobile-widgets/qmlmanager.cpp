@@ -26,6 +26,7 @@
 #include "qt-models/messagehandlermodel.h"
 #include "core/divelist.h"
 #include "core/device.h"
+#include "core/fulltext.h"
 #include "core/file.h"
 #include "core/qthelper.h"
 #include "core/qt-gui.h"
@@ -777,7 +778,7 @@ static void setupDivesite(struct dive *d, struct dive_site *ds, double lat, doub
 {
 	location_t location = create_location(lat, lon);
 	if (ds) {
-		ds->location = location;
+		set_dive_site_location(ds, &location);
 	} else {
 		unregister_dive_from_dive_site(d);
 		add_dive_to_dive_site(d, create_dive_site_with_gps(locationtext, &location, &dive_site_table));
@@ -881,7 +882,8 @@ parsed:
 			// add a hundred years.
 			if (newDate.addYears(100) < QDateTime::currentDateTime().addYears(1))
 				newDate = newDate.addYears(100);
-			d->dc.when = d->when = newDate.toMSecsSinceEpoch() / 1000;
+			set_dive_time(d, newDate.toMSecsSinceEpoch() / 1000);
+			d->dc.when = d->when;
 			return true;
 		}
 		appendTextToLog("none of our parsing attempts worked for the date string");
@@ -1142,6 +1144,7 @@ void QMLManager::commitChanges(QString diveId, QString date, QString location, Q
 		// this one dive moves to a different spot in the dive list
 		sort_dive_table(&dive_table);
 		sort_trip_table(&trip_table);
+		invalidate_dive_time_index();
 		int newIdx = get_idx_by_uniq_id(d->id);
 		if (newIdx != oldIdx) {
 			DiveListModel::instance()->removeDive(modelIdx);
@@ -1297,6 +1300,7 @@ bool QMLManager::undoDelete(int id)
 		add_dive_to_trip(deletedDive, trip);
 	}
 	record_dive(deletedDive);
+	fulltext_register(deletedDive);
 	QList<dive *>diveAsList;
 	diveAsList << deletedDive;
 	DiveListModel::instance()->addDive(diveAsList);
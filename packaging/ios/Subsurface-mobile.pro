@@ -14,6 +14,8 @@ SOURCES += ../../subsurface-mobile-main.cpp \
 	../../core/devicedetails.cpp \
 	../../core/gpslocation.cpp \
 	../../core/imagedownloader.cpp \
+	../../core/mediascanner.cpp \
+	../../core/thumbnailstore.cpp \
 	../../core/downloadfromdcthread.cpp \
 	../../core/qtserialbluetooth.cpp \
 	../../core/plannernotes.c \
@@ -23,11 +25,13 @@ SOURCES += ../../subsurface-mobile-main.cpp \
 	../../core/color.cpp \
 	../../core/configuredivecomputer.cpp \
 	../../core/divecomputer.cpp \
+	../../core/diveinfocache.cpp \
 	../../core/divelogexportlogic.cpp \
 	../../core/divesitehelpers.cpp \
 	../../core/errorhelper.c \
 	../../core/exif.cpp \
 	../../core/format.cpp \
+	../../core/fulltext.cpp \
 	../../core/gettextfromc.cpp \
 	../../core/metrics.cpp \
 	../../core/qt-init.cpp \
@@ -61,10 +65,13 @@ SOURCES += ../../subsurface-mobile-main.cpp \
 	../../core/datatrak.c \
 	../../core/ostctools.c \
 	../../core/planner.c \
+	../../core/plansweep.c \
 	../../core/save-xml.c \
 	../../core/cochran.c \
+	../../core/deco-kernel.c \
 	../../core/deco.c \
 	../../core/divesite.c \
+	../../core/hash-index.c \
 	../../core/equipment.c \
 	../../core/membuffer.c \
 	../../core/sha1.c \
@@ -151,6 +158,8 @@ HEADERS += \
 	../../core/git-access.h \
 	../../core/gpslocation.h \
 	../../core/imagedownloader.h \
+	../../core/mediascanner.h \
+	../../core/thumbnailstore.h \
 	../../core/pref.h \
 	../../core/profile.h \
 	../../core/qthelper.h \
@@ -159,7 +168,9 @@ HEADERS += \
 	../../core/units.h \
 	../../core/version.h \
 	../../core/planner.h \
+	../../core/plansweep.h \
 	../../core/divesite.h \
+	../../core/hash-index.h \
 	../../core/checkcloudconnection.h \
 	../../core/cochran.h \
 	../../core/color.h \
@@ -168,11 +179,13 @@ HEADERS += \
 	../../core/deco.h \
 	../../core/display.h \
 	../../core/divecomputer.h \
+	../../core/diveinfocache.h \
 	../../core/divelist.h \
 	../../core/divelogexportlogic.h \
 	../../core/divesitehelpers.h \
 	../../core/exif.h \
 	../../core/file.h \
+	../../core/fulltext.h \
 	../../core/gaspressures.h \
 	../../core/gettext.h \
 	../../core/gettextfromc.h \
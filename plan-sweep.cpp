@@ -0,0 +1,154 @@
+// SPDX-License-Identifier: GPL-2.0
+/* Print runtime tables for a grid of planned dives */
+
+#include <QString>
+#include <QStringList>
+#include <QCommandLineParser>
+#include <QApplication>
+#include <QVector>
+
+#include "core/qt-gui.h"
+#include "core/qthelper.h"
+#include "core/planner.h"
+#include "core/plansweep.h"
+#include "core/membuffer.h"
+#include "core/subsurfacestartup.h"
+#include <stdio.h>
+
+static void fail(const QString &message)
+{
+	fprintf(stderr, "%s\n", qPrintable(message));
+	exit(1);
+}
+
+// a comma separated list of numbers, scaled to the units used by the planner
+static QVector<int> numbers(const QString &list, double factor, const char *what)
+{
+	QVector<int> res;
+	for (const QString &s: list.split(',', QString::SkipEmptyParts)) {
+		bool ok;
+		double value = s.toDouble(&ok);
+		if (!ok || value <= 0.0)
+			fail(QString("invalid %1: %2").arg(what, s));
+		res.append(lrint(value * factor));
+	}
+	if (res.isEmpty())
+		fail(QString("no %1 given").arg(what));
+	return res;
+}
+
+int main(int argc, char **argv)
+{
+	QApplication *application = new QApplication(argc, argv);
+	copy_prefs(&default_prefs, &prefs);
+	init_qt_late();		// this also reads the planner settings of the user
+	setCurrentAppState("PlanDive");
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Plan every combination of the given depths, bottom times, gases and gradient factors "
+					 "with the planner settings of Subsurface and write a table of the results.");
+	parser.addHelpOption();
+	QCommandLineOption depthsOption("depths", "Comma separated bottom depths in m", "depths");
+	parser.addOption(depthsOption);
+	QCommandLineOption timesOption("times", "Comma separated run times at the end of the bottom phase in min, including the descent", "times");
+	parser.addOption(timesOption);
+	QCommandLineOption gasesOption("gases", "Comma separated gases of one gas set, the bottom gas first, e.g. 21/35,50,100; "
+						"give the option once per gas set. The switch depths are the MODs at the deco pO2", "gases");
+	parser.addOption(gasesOption);
+	QCommandLineOption gfOption("gf", "Comma separated gradient factors, e.g. 30/70,50/80", "gflow/gfhigh");
+	parser.addOption(gfOption);
+	QCommandLineOption modelOption("model", "Deco model: buehlmann, vpmb or recreational (default: as in the planner)", "model");
+	parser.addOption(modelOption);
+	QCommandLineOption conservatismOption("conservatism", "VPM-B conservatism (default: as in the planner)", "level");
+	parser.addOption(conservatismOption);
+	QCommandLineOption bottomSacOption("bottomsac", "Bottom SAC in l/min (default: as in the planner)", "sac");
+	parser.addOption(bottomSacOption);
+	QCommandLineOption decoSacOption("decosac", "Deco SAC in l/min (default: as in the planner)", "sac");
+	parser.addOption(decoSacOption);
+	QCommandLineOption freshWaterOption("fresh", "Fresh water instead of salt water");
+	parser.addOption(freshWaterOption);
+	QCommandLineOption jsonOption("json", "Write JSON instead of CSV");
+	parser.addOption(jsonOption);
+	QCommandLineOption outputOption(QStringList() << "o" << "output", "Write the table to <file> instead of standard output", "file");
+	parser.addOption(outputOption);
+
+	parser.process(*application);
+
+	// all depths and stops in metric units
+	prefs.unit_system = METRIC;
+	prefs.units.length = units::METERS;
+
+	QString model = parser.value(modelOption);
+	if (model == "buehlmann")
+		prefs.planner_deco_mode = BUEHLMANN;
+	else if (model == "vpmb")
+		prefs.planner_deco_mode = VPMB;
+	else if (model == "recreational")
+		prefs.planner_deco_mode = RECREATIONAL;
+	else if (!model.isEmpty())
+		fail(QString("unknown deco model: %1").arg(model));
+
+	QVector<int> depths = numbers(parser.value(depthsOption), 1000.0, "depths");
+	QVector<int> times = numbers(parser.value(timesOption), 60.0, "times");
+
+	QVector<sweep_gases> gases;
+	for (const QString &set: parser.values(gasesOption)) {
+		sweep_gases g = {};
+		for (const QString &s: set.split(',', QString::SkipEmptyParts)) {
+			if (g.nr >= MAX_CYLINDERS)
+				fail(QString("too many gases: %1").arg(set));
+			if (!validate_gas(qPrintable(s), &g.gasmix[g.nr]))
+				fail(QString("invalid gas: %1").arg(s));
+			g.nr++;
+		}
+		if (g.nr)
+			gases.append(g);
+	}
+	if (gases.isEmpty())
+		fail("no gases given");
+
+	QVector<sweep_gf> gfs;
+	for (const QString &s: parser.value(gfOption).split(',', QString::SkipEmptyParts)) {
+		QStringList lowHigh = s.split('/');
+		bool okLow = false, okHigh = false;
+		if (lowHigh.size() == 2)
+			gfs.append({ (short)lowHigh[0].toInt(&okLow), (short)lowHigh[1].toInt(&okHigh) });
+		if (!okLow || !okHigh)
+			fail(QString("invalid gradient factors: %1").arg(s));
+	}
+	if (gfs.isEmpty())
+		gfs.append({ (short)prefs.gflow, (short)prefs.gfhigh });
+
+	plan_sweep sweep = {};
+	sweep.nr_depths = depths.size();
+	sweep.depths = depths.constData();
+	sweep.nr_times = times.size();
+	sweep.times = times.constData();
+	sweep.nr_gases = gases.size();
+	sweep.gases = gases.constData();
+	sweep.nr_gfs = gfs.size();
+	sweep.gfs = gfs.constData();
+	sweep.vpmb_conservatism = parser.isSet(conservatismOption) ? parser.value(conservatismOption).toInt() : prefs.vpmb_conservatism;
+	sweep.bottomsac = parser.isSet(bottomSacOption) ? lrint(parser.value(bottomSacOption).toDouble() * 1000) : prefs.bottomsac;
+	sweep.decosac = parser.isSet(decoSacOption) ? lrint(parser.value(decoSacOption).toDouble() * 1000) : prefs.decosac;
+	sweep.surface_pressure = SURFACE_PRESSURE;
+	sweep.salinity = parser.isSet(freshWaterOption) ? FRESHWATER_SALINITY : SEAWATER_SALINITY;
+
+	struct sweep_result *results = run_plan_sweep(&sweep);
+	struct membuffer buf = { 0 };
+	if (parser.isSet(jsonOption))
+		save_sweep_json(&buf, &sweep, results);
+	else
+		save_sweep_csv(&buf, &sweep, results);
+	free(results);
+
+	FILE *f = stdout;
+	QString output = parser.value(outputOption);
+	if (!output.isEmpty() && !(f = subsurface_fopen(qPrintable(output), "w")))
+		fail(QString("can't write %1").arg(output));
+	flush_buffer(&buf, f);
+	free_buffer(&buf);
+	if (f != stdout)
+		fclose(f);
+	exit(0);
+}
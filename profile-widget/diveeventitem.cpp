@@ -259,13 +259,14 @@ bool DiveEventItem::shouldBeHidden()
 
 int DiveEventItem::depthAtTime(int time)
 {
-	QModelIndexList result = dataModel->match(dataModel->index(0, DivePlotDataModel::TIME), Qt::DisplayRole, time);
-	if (result.isEmpty()) {
-		Q_ASSERT("can't find a spot in the dataModel");
-		hide();
-		return DEPTH_NOT_FOUND;
+	PlotDataColumn times = dataModel->column(DivePlotDataModel::TIME);
+	for (int i = 0, count = times.size(); i < count; i++) {
+		if (times[i] == time)
+			return dataModel->column(DivePlotDataModel::DEPTH)[i];
 	}
-	return dataModel->data(dataModel->index(result.first().row(), DivePlotDataModel::DEPTH)).toInt();
+	Q_ASSERT("can't find a spot in the dataModel");
+	hide();
+	return DEPTH_NOT_FOUND;
 }
 
 void DiveEventItem::recalculatePos(bool instant)
@@ -273,12 +274,6 @@ void DiveEventItem::recalculatePos(bool instant)
 	if (!vAxis || !hAxis || !internalEvent || !dataModel)
 		return;
 
-	QModelIndexList result = dataModel->match(dataModel->index(0, DivePlotDataModel::TIME), Qt::DisplayRole, internalEvent->time.seconds);
-	if (result.isEmpty()) {
-		Q_ASSERT("can't find a spot in the dataModel");
-		hide();
-		return;
-	}
 	int depth = depthAtTime(internalEvent->time.seconds);
 	if (depth == DEPTH_NOT_FOUND)
 		return;
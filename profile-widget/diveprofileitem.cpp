@@ -14,7 +14,11 @@
 #include "libdivecomputer/parser.h"
 #include "profile-widget/profilewidget2.h"
 
-AbstractProfilePolygonItem::AbstractProfilePolygonItem() : QObject(), QGraphicsPolygonItem(), hAxis(NULL), vAxis(NULL), dataModel(NULL), hDataColumn(-1), vDataColumn(-1)
+#include <QPaintDevice>
+#include <algorithm>
+#include <cmath>
+
+AbstractProfilePolygonItem::AbstractProfilePolygonItem() : QObject(), QGraphicsPolygonItem(), hAxis(NULL), vAxis(NULL), dataModel(NULL), hDataColumn(-1), vDataColumn(-1), lodBucketWidth(-1.0)
 {
 	setCacheMode(DeviceCoordinateCache);
 #ifndef SUBSURFACE_MOBILE
@@ -31,6 +35,73 @@ void AbstractProfilePolygonItem::setVisible(bool visible)
 	QGraphicsPolygonItem::setVisible(visible);
 }
 
+void AbstractProfilePolygonItem::setPolygon(const QPolygonF &polygon)
+{
+	lod.clear();
+	lodBucketWidth = -1.0;
+	QGraphicsPolygonItem::setPolygon(polygon);
+}
+
+// The width of a pixel of the paint device in item coordinates, or 0 if unknown
+qreal AbstractProfilePolygonItem::pixelWidth(const QPainter *painter)
+{
+	qreal scale = fabs(painter->combinedTransform().m11());
+	if (painter->device())
+		scale *= painter->device()->devicePixelRatio();
+	return scale > 0.0 ? 1.0 / scale : 0.0;
+}
+
+// Keep the first and the last point of the polygon and the lowest and highest point of each
+// run of consecutive points in the same bucket, in their original order. The points don't have
+// to be sorted, so that closed polygons going back in time are decimated, too.
+QPolygonF AbstractProfilePolygonItem::decimate(const QPolygonF &poly, qreal bucketWidth)
+{
+	if (bucketWidth <= 0.0 || poly.count() <= 2)
+		return poly;
+
+	QPolygonF res;
+	res.reserve(poly.count());
+	int count = poly.count();
+	for (int from = 0; from < count;) {
+		qreal bucket = floor(poly[from].x() / bucketWidth);
+		int min = from, max = from, to = from + 1;
+		for (; to < count && floor(poly[to].x() / bucketWidth) == bucket; to++) {
+			if (poly[to].y() < poly[min].y())
+				min = to;
+			if (poly[to].y() > poly[max].y())
+				max = to;
+		}
+		if (from == 0 && min != 0 && max != 0)
+			res.append(poly[0]);
+		res.append(poly[std::min(min, max)]);
+		if (min != max)
+			res.append(poly[std::max(min, max)]);
+		if (to == count && std::max(min, max) != count - 1)
+			res.append(poly[count - 1]);
+		from = to;
+	}
+	return res;
+}
+
+const QPolygonF &AbstractProfilePolygonItem::lodPolygon(const QPainter *painter)
+{
+	qreal width = pixelWidth(painter);
+	if (width != lodBucketWidth) {
+		lod = decimate(polygon(), width);
+		lodBucketWidth = width;
+	}
+	return lod;
+}
+
+void AbstractProfilePolygonItem::paintLodPolygon(QPainter *painter)
+{
+	painter->save();
+	painter->setPen(pen());
+	painter->setBrush(brush());
+	painter->drawPolygon(lodPolygon(painter), fillRule());
+	painter->restore();
+}
+
 void AbstractProfilePolygonItem::setHorizontalAxis(DiveCartesianAxis *horizontal)
 {
 	hAxis = horizontal;
@@ -98,9 +169,11 @@ void AbstractProfilePolygonItem::modelDataChanged(const QModelIndex&, const QMod
 	// is an array of QPointF's, so we basically get the point from the model, convert
 	// to our coordinates, store. no painting is done here.
 	QPolygonF poly;
-	for (int i = 0, modelDataCount = dataModel->rowCount(); i < modelDataCount; i++) {
-		qreal horizontalValue = dataModel->index(i, hDataColumn).data().toReal();
-		qreal verticalValue = dataModel->index(i, vDataColumn).data().toReal();
+	PlotDataColumn hData = dataModel->column(hDataColumn);
+	PlotDataColumn vData = dataModel->column(vDataColumn);
+	for (int i = 0, modelDataCount = hData.size(); i < modelDataCount; i++) {
+		qreal horizontalValue = hData[i];
+		qreal verticalValue = vData[i];
 		QPointF point(hAxis->posAtValue(horizontalValue), vAxis->posAtValue(verticalValue));
 		poly.append(point);
 	}
@@ -121,7 +194,7 @@ void DiveProfileItem::settingsToggled(bool)
 	settingsChanged();
 }
 
-void DiveProfileItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+void DiveProfileItem::paint(QPainter *painter, const QStyleOptionGraphicsItem*, QWidget*)
 {
 	if (polygon().isEmpty())
 		return;
@@ -130,7 +203,7 @@ void DiveProfileItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *o
 	// This paints the Polygon + Background. I'm setting the pen to QPen() so we don't get a black line here,
 	// after all we need to plot the correct velocities colors later.
 	setPen(Qt::NoPen);
-	QGraphicsPolygonItem::paint(painter, option, widget);
+	paintLodPolygon(painter);
 
 	// Here we actually paint the boundaries of the Polygon using the colors that the model provides.
 	// Those are the speed colors of the dives.
@@ -138,13 +211,20 @@ void DiveProfileItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *o
 	pen.setCosmetic(true);
 	pen.setWidth(2);
 	QPolygonF poly = polygon();
-	// This paints the colors of the velocities.
-	for (int i = 1, count = dataModel->rowCount(); i < count; i++) {
-		QModelIndex colorIndex = dataModel->index(i, DivePlotDataModel::COLOR);
-		pen.setBrush(QBrush(colorIndex.data(Qt::BackgroundRole).value<QColor>()));
+	const plot_info &pInfo = dataModel->data();
+	qreal width = pixelWidth(painter);
+	// This paints the colors of the velocities. The segment ending at entry i gets the color of
+	// the velocity at i, segments of the same color are drawn as one decimated polyline.
+	int count = std::min(pInfo.nr, poly.count());
+	for (int from = 0; from < count - 1;) {
+		velocity_t velocity = pInfo.entry[from + 1].velocity;
+		int to = from + 1;
+		while (to < count - 1 && pInfo.entry[to + 1].velocity == velocity)
+			to++;
+		pen.setBrush(QBrush(getColor((color_index_t)(VELOCITY_COLORS_START_IDX + velocity))));
 		painter->setPen(pen);
-		if (i < poly.count())
-			painter->drawLine(poly[i - 1], poly[i]);
+		painter->drawPolyline(decimate(poly.mid(from, to - from + 1), width));
+		from = to;
 	}
 	painter->restore();
 }
@@ -152,10 +232,11 @@ void DiveProfileItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *o
 int DiveProfileItem::maxCeiling(int row)
 {
 	int max = -1;
-	plot_data *entry = dataModel->data().entry + row;
+	const plot_info &pInfo = dataModel->data();
 	for (int tissue = 0; tissue < 16; tissue++) {
-		if (max < entry->ceilings[tissue])
-			max = entry->ceilings[tissue];
+		int ceiling = get_plot_tissue_ceiling(&pInfo, row, tissue);
+		if (max < ceiling)
+			max = ceiling;
 	}
 	return max;
 }
@@ -286,11 +367,13 @@ void DiveHeartrateItem::modelDataChanged(const QModelIndex &topLeft, const QMode
 	texts.clear();
 	// Ignore empty values. a heart rate of 0 would be a bad sign.
 	QPolygonF poly;
-	for (int i = 0, modelDataCount = dataModel->rowCount(); i < modelDataCount; i++) {
-		int hr = dataModel->index(i, vDataColumn).data().toInt();
+	PlotDataColumn hData = dataModel->column(hDataColumn);
+	PlotDataColumn vData = dataModel->column(vDataColumn);
+	for (int i = 0, modelDataCount = hData.size(); i < modelDataCount; i++) {
+		int hr = vData[i];
 		if (!hr)
 			continue;
-		sec = dataModel->index(i, hDataColumn).data().toInt();
+		sec = hData[i];
 		QPointF point(hAxis->posAtValue(sec), vAxis->posAtValue(hr));
 		poly.append(point);
 		if (hr == hist[2].hr)
@@ -342,7 +425,7 @@ void DiveHeartrateItem::paint(QPainter *painter, const QStyleOptionGraphicsItem*
 		return;
 	painter->save();
 	painter->setPen(pen());
-	painter->drawPolyline(polygon());
+	painter->drawPolyline(lodPolygon(painter));
 	painter->restore();
 }
 
@@ -363,8 +446,9 @@ void DivePercentageItem::modelDataChanged(const QModelIndex &topLeft, const QMod
 
 	// Ignore empty values. a heart rate of 0 would be a bad sign.
 	QPolygonF poly;
-	for (int i = 0, modelDataCount = dataModel->rowCount(); i < modelDataCount; i++) {
-		sec = dataModel->index(i, hDataColumn).data().toInt();
+	PlotDataColumn hData = dataModel->column(hDataColumn);
+	for (int i = 0, modelDataCount = hData.size(); i < modelDataCount; i++) {
+		sec = hData[i];
 		QPointF point(hAxis->posAtValue(sec), vAxis->posAtValue(64 - 4 * tissueIndex));
 		poly.append(point);
 	}
@@ -407,12 +491,14 @@ void DivePercentageItem::paint(QPainter *painter, const QStyleOptionGraphicsItem
 	mypen.setCapStyle(Qt::FlatCap);
 	mypen.setCosmetic(false);
 	QPolygonF poly = polygon();
-	for (int i = 1, modelDataCount = dataModel->rowCount(); i < modelDataCount; i++) {
+	PlotDataColumn vData = dataModel->column(vDataColumn);
+	PlotDataColumn timeData = dataModel->column(DivePlotDataModel::TIME);
+	for (int i = 1, modelDataCount = vData.size(); i < modelDataCount; i++) {
 		if (i < poly.count()) {
-			double value = dataModel->index(i, vDataColumn).data().toDouble();
+			double value = vData[i];
 			struct gasmix gasmix = gasmix_air;
 			const struct event *ev = NULL;
-			int sec = dataModel->index(i, DivePlotDataModel::TIME).data().toInt();
+			int sec = timeData[i];
 			gasmix = get_gasmix(&displayed_dive, displayed_dc, sec, &ev, gasmix);
 			int inert = 1000 - get_o2(gasmix);
 			mypen.setBrush(QBrush(ColorScale(value, inert)));
@@ -443,11 +529,13 @@ void DiveAmbPressureItem::modelDataChanged(const QModelIndex &topLeft, const QMo
 
 	// Ignore empty values. a heart rate of 0 would be a bad sign.
 	QPolygonF poly;
-	for (int i = 0, modelDataCount = dataModel->rowCount(); i < modelDataCount; i++) {
-		int hr = dataModel->index(i, vDataColumn).data().toInt();
+	PlotDataColumn hData = dataModel->column(hDataColumn);
+	PlotDataColumn vData = dataModel->column(vDataColumn);
+	for (int i = 0, modelDataCount = hData.size(); i < modelDataCount; i++) {
+		int hr = vData[i];
 		if (!hr)
 			continue;
-		sec = dataModel->index(i, hDataColumn).data().toInt();
+		sec = hData[i];
 		QPointF point(hAxis->posAtValue(sec), vAxis->posAtValue(hr));
 		poly.append(point);
 	}
@@ -463,7 +551,7 @@ void DiveAmbPressureItem::paint(QPainter *painter, const QStyleOptionGraphicsIte
 		return;
 	painter->save();
 	painter->setPen(pen());
-	painter->drawPolyline(polygon());
+	painter->drawPolyline(lodPolygon(painter));
 	painter->restore();
 	connect(qPrefTechnicalDetails::instance(), &qPrefTechnicalDetails::percentagegraphChanged, this, &DiveAmbPressureItem::setVisible);
 }
@@ -488,11 +576,13 @@ void DiveGFLineItem::modelDataChanged(const QModelIndex &topLeft, const QModelIn
 
 	// Ignore empty values. a heart rate of 0 would be a bad sign.
 	QPolygonF poly;
-	for (int i = 0, modelDataCount = dataModel->rowCount(); i < modelDataCount; i++) {
-		int hr = dataModel->index(i, vDataColumn).data().toInt();
+	PlotDataColumn hData = dataModel->column(hDataColumn);
+	PlotDataColumn vData = dataModel->column(vDataColumn);
+	for (int i = 0, modelDataCount = hData.size(); i < modelDataCount; i++) {
+		int hr = vData[i];
 		if (!hr)
 			continue;
-		sec = dataModel->index(i, hDataColumn).data().toInt();
+		sec = hData[i];
 		QPointF point(hAxis->posAtValue(sec), vAxis->posAtValue(hr));
 		poly.append(point);
 	}
@@ -508,7 +598,7 @@ void DiveGFLineItem::paint(QPainter *painter, const QStyleOptionGraphicsItem*, Q
 		return;
 	painter->save();
 	painter->setPen(pen());
-	painter->drawPolyline(polygon());
+	painter->drawPolyline(lodPolygon(painter));
 	painter->restore();
 	connect(qPrefTechnicalDetails::instance(), &qPrefTechnicalDetails::percentagegraphChanged, this, &DiveAmbPressureItem::setVisible);
 }
@@ -533,12 +623,14 @@ void DiveTemperatureItem::modelDataChanged(const QModelIndex &topLeft, const QMo
 	texts.clear();
 	// Ignore empty values. things do not look good with '0' as temperature in kelvin...
 	QPolygonF poly;
-	for (int i = 0, modelDataCount = dataModel->rowCount(); i < modelDataCount; i++) {
-		int mkelvin = dataModel->index(i, vDataColumn).data().toInt();
+	PlotDataColumn hData = dataModel->column(hDataColumn);
+	PlotDataColumn vData = dataModel->column(vDataColumn);
+	for (int i = 0, modelDataCount = hData.size(); i < modelDataCount; i++) {
+		int mkelvin = vData[i];
 		if (!mkelvin)
 			continue;
 		last_valid_temp = mkelvin;
-		sec = dataModel->index(i, hDataColumn).data().toInt();
+		sec = hData[i];
 		QPointF point(hAxis->posAtValue(sec), vAxis->posAtValue(mkelvin));
 		poly.append(point);
 
@@ -588,7 +680,7 @@ void DiveTemperatureItem::paint(QPainter *painter, const QStyleOptionGraphicsIte
 		return;
 	painter->save();
 	painter->setPen(pen());
-	painter->drawPolyline(polygon());
+	painter->drawPolyline(lodPolygon(painter));
 	painter->restore();
 }
 
@@ -633,7 +725,7 @@ void DiveMeanDepthItem::paint(QPainter *painter, const QStyleOptionGraphicsItem*
 		return;
 	painter->save();
 	painter->setPen(pen());
-	painter->drawPolyline(polygon());
+	painter->drawPolyline(lodPolygon(painter));
 	painter->restore();
 	connect(qPrefTechnicalDetails::instance(), &qPrefTechnicalDetails::show_average_depthChanged, this, &DiveAmbPressureItem::setVisible);
 }
@@ -665,11 +757,12 @@ void DiveGasPressureItem::modelDataChanged(const QModelIndex &topLeft, const QMo
 	QPolygonF boundingPoly;
 	polygons.clear();
 
+	const plot_info &pInfo = dataModel->data();
 	for (int i = 0, count = dataModel->rowCount(); i < count; i++) {
-		struct plot_data *entry = dataModel->data().entry + i;
+		struct plot_data *entry = pInfo.entry + i;
 
-		for (int cyl = 0; cyl < MAX_CYLINDERS; cyl++) {
-			int mbar = GET_PRESSURE(entry, cyl);
+		for (int cyl = 0; cyl < pInfo.nr_cylinders; cyl++) {
+			int mbar = get_plot_pressure(&pInfo, i, cyl);
 			int time = entry->sec;
 
 			if (!mbar)
@@ -726,10 +819,10 @@ void DiveGasPressureItem::modelDataChanged(const QModelIndex &topLeft, const QMo
 	double axisLog = log10(log10(axisRange));
 
 	for (int i = 0, count = dataModel->rowCount(); i < count; i++) {
-		struct plot_data *entry = dataModel->data().entry + i;
+		struct plot_data *entry = pInfo.entry + i;
 
-		for (int cyl = 0; cyl < MAX_CYLINDERS; cyl++) {
-			int mbar = GET_PRESSURE(entry, cyl);
+		for (int cyl = 0; cyl < pInfo.nr_cylinders; cyl++) {
+			int mbar = get_plot_pressure(&pInfo, i, cyl);
 
 			if (!mbar)
 				continue;
@@ -853,11 +946,11 @@ void DiveCalculatedCeiling::modelDataChanged(const QModelIndex &topLeft, const Q
 	setBrush(pat);
 }
 
-void DiveCalculatedCeiling::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+void DiveCalculatedCeiling::paint(QPainter *painter, const QStyleOptionGraphicsItem*, QWidget*)
 {
 	if (polygon().isEmpty())
 		return;
-	QGraphicsPolygonItem::paint(painter, option, widget);
+	paintLodPolygon(painter);
 }
 
 DiveCalculatedTissue::DiveCalculatedTissue(ProfileWidget2 *widget) : DiveCalculatedCeiling(widget)
@@ -929,11 +1022,11 @@ void DiveCalculatedCeiling::settingsChanged()
 	is3mIncrement = prefs.calcceiling3m;
 }
 
-void DiveReportedCeiling::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+void DiveReportedCeiling::paint(QPainter *painter, const QStyleOptionGraphicsItem*, QWidget*)
 {
 	if (polygon().isEmpty())
 		return;
-	QGraphicsPolygonItem::paint(painter, option, widget);
+	paintLodPolygon(painter);
 }
 
 void PartialPressureGasItem::modelDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
@@ -953,9 +1046,11 @@ void PartialPressureGasItem::modelDataChanged(const QModelIndex &topLeft, const
 	if (thresholdPtrMin)
 		threshold_min = *thresholdPtrMin;
 	bool inAlertFragment = false;
-	for (int i = 0; i < dataModel->rowCount(); i++, entry++) {
-		double value = dataModel->index(i, vDataColumn).data().toDouble();
-		int time = dataModel->index(i, hDataColumn).data().toInt();
+	PlotDataColumn hData = dataModel->column(hDataColumn);
+	PlotDataColumn vData = dataModel->column(vDataColumn);
+	for (int i = 0; i < hData.size(); i++, entry++) {
+		double value = vData[i];
+		int time = hData[i];
 		QPointF point(hAxis->posAtValue(time), vAxis->posAtValue(value));
 		poly.push_back(point);
 		if (thresholdPtrMax && value >= threshold_max) {
@@ -991,7 +1086,7 @@ void PartialPressureGasItem::paint(QPainter *painter, const QStyleOptionGraphics
 	const qreal pWidth = 0.0;
 	painter->save();
 	painter->setPen(QPen(normalColor, pWidth));
-	painter->drawPolyline(polygon());
+	painter->drawPolyline(lodPolygon(painter));
 
 	QPolygonF poly;
 	painter->setPen(QPen(alertColor, pWidth));
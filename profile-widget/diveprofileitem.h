@@ -42,6 +42,8 @@ public:
 	void setHorizontalDataColumn(int column);
 	void setVerticalDataColumn(int column);
 	virtual void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget = 0) = 0;
+	// Hides QGraphicsPolygonItem::setPolygon() to invalidate the decimated polygon
+	void setPolygon(const QPolygonF &polygon);
 public
 slots:
 	virtual void settingsChanged();
@@ -59,12 +61,27 @@ protected:
 	 */
 	bool shouldCalculateStuff(const QModelIndex &topLeft, const QModelIndex &bottomRight);
 
+	/* Long dives have far more plot entries than there are pixels on screen. Therefore the
+	 * items draw the polygon decimated to the resolution of the painter: of the points falling
+	 * into the same pixel column only the lowest and the highest are kept. The decimated
+	 * polygon is recalculated when the polygon or the zoom level changes, zooming in refines
+	 * it from the full-resolution polygon.
+	 */
+	const QPolygonF &lodPolygon(const QPainter *painter);
+	void paintLodPolygon(QPainter *painter);	// filled with the brush of the item
+	static qreal pixelWidth(const QPainter *painter);
+	static QPolygonF decimate(const QPolygonF &poly, qreal bucketWidth);
+
 	DiveCartesianAxis *hAxis;
 	DiveCartesianAxis *vAxis;
 	DivePlotDataModel *dataModel;
 	int hDataColumn;
 	int vDataColumn;
 	QList<DiveTextItem *> texts;
+
+private:
+	QPolygonF lod;
+	qreal lodBucketWidth;
 };
 
 class DiveProfileItem : public AbstractProfilePolygonItem {
@@ -265,8 +265,9 @@ void ToolTipItem::refresh(const QPointF &pos)
 		painter.drawLine(0, lrint(60 - AMB_PERCENTAGE * (entry->pressures.n2 + entry->pressures.he) / entry->ambpressure / 2),
 				16, lrint(60 - AMB_PERCENTAGE * (entry->pressures.n2 + entry->pressures.he) / entry->ambpressure /2));
 		painter.setPen(QColor(0, 0, 0, 127));
+		int idx = entry - pInfo.entry;
 		for (int i=0; i<16; i++) {
-			painter.drawLine(i, 60, i, 60 - entry->percentages[i] / 2);
+			painter.drawLine(i, 60, i, 60 - get_plot_tissue_percentage(&pInfo, idx, i) / 2);
 		}
 		entryToolTip.second->setText(QString::fromUtf8(mb.buffer, mb.len));
 	}
@@ -19,6 +19,7 @@
 #include "qt-models/models.h"
 #include "qt-models/divepicturemodel.h"
 #include "core/divelist.h"
+#include "core/diveinfocache.h"
 #ifndef SUBSURFACE_MOBILE
 #include "desktop-widgets/diveplanner.h"
 #include "desktop-widgets/simplewidgets.h"
@@ -1647,6 +1648,7 @@ void ProfileWidget2::removeEvent()
 				  QMessageBox::Ok | QMessageBox::Cancel) == QMessageBox::Ok) {
 		remove_event(event);
 		invalidate_dive_cache(current_dive);
+		diveinfo_invalidate(current_dive);	// it may have been a gas switch
 		mark_divelist_changed(true);
 		replot();
 	}
@@ -1739,6 +1741,7 @@ void ProfileWidget2::changeGas()
 	// this means we potentially have a new tank that is being used and needs to be shown
 	fixup_dive(&displayed_dive);
 	invalidate_dive_cache(current_dive);
+	diveinfo_invalidate(current_dive);
 
 	// FIXME - this no longer gets written to the dive list - so we need to enableEdition() here
 
@@ -8,7 +8,6 @@
 #include "profile-widget/divecartesianaxis.h"
 #include "core/display.h"
 
-struct plot_data;
 class RulerItem2;
 
 class RulerNodeItem2 : public QObject, public QGraphicsEllipseItem {
@@ -25,7 +24,7 @@ protected:
 	void mouseMoveEvent(QGraphicsSceneMouseEvent *event) override;
 private:
 	struct plot_info pInfo;
-	struct plot_data *entry;
+	int idx;
 	RulerItem2 *ruler;
 	DiveCartesianAxis *timeAxis;
 	DiveCartesianAxis *depthAxis;
@@ -1,6 +1,8 @@
 // SPDX-License-Identifier: GPL-2.0
 #include "qt-models/divelistmodel.h"
 #include "core/qthelper.h"
+#include "core/fulltext.h"
+#include "core/diveinfocache.h"
 #include "core/settings/qPrefGeneral.h"
 #include <QDateTime>
 
@@ -15,16 +17,26 @@ void DiveListSortModel::updateFilterState()
 		resetFilter();
 		return;
 	}
-	// store this in local variables to avoid having to call these methods over and over
+	// The words of the filter string are looked up in the full text index. Only the
+	// dives found there have to be compared case sensitively, if so desired.
 	bool includeNotes = qPrefGeneral::filterFullTextNotes();
-	Qt::CaseSensitivity cs = qPrefGeneral::filterCaseSensitive() ? Qt::CaseSensitive : Qt::CaseInsensitive;
+	bool caseSensitive = qPrefGeneral::filterCaseSensitive();
+	// Like the full text of DiveObjectHelper, the query doesn't include the dive mode.
+	unsigned fields = FULLTEXT_ALL & ~FULLTEXT_MODE;
+	if (!includeNotes)
+		fields &= ~FULLTEXT_NOTES;
+	FullTextQuery query(filterString, fields);
 
 	// get the underlying model and re-calculate the filter value for each dive
 	DiveListModel *mySourceModel = qobject_cast<DiveListModel *>(sourceModel());
 	for (int i = 0; i < mySourceModel->rowCount(); i++) {
 		DiveObjectHelper *d = mySourceModel->at(i);
-		QString fullText = includeNotes? d->fullText() : d->fullTextNoNotes();
-		d->getDive()->hidden_by_filter = !fullText.contains(filterString, cs);
+		bool show = query.matches(d->getDive());
+		if (show && caseSensitive) {
+			QString fullText = includeNotes ? d->fullText() : d->fullTextNoNotes();
+			show = fullText.contains(filterString, Qt::CaseSensitive);
+		}
+		d->getDive()->hidden_by_filter = !show;
 	}
 }
 
@@ -193,6 +205,9 @@ void DiveListModel::removeDiveById(int id)
 
 void DiveListModel::updateDive(int i, dive *d)
 {
+	// The mobile edits don't go through the DiveListNotifier
+	fulltext_register(d);
+	diveinfo_invalidate(d);
 	DiveObjectHelper *newDive = new DiveObjectHelper(d);
 	// we need to make sure that QML knows that this dive has changed -
 	// the only reliable way I've found is to remove and re-insert it
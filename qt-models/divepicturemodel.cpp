@@ -41,8 +41,13 @@ void DivePictureModel::updateZoom()
 void DivePictureModel::updateThumbnails()
 {
 	updateZoom();
-	for (PictureEntry &entry: pictures)
-		entry.image = Thumbnailer::instance()->fetchThumbnail(entry.filename, false);
+	QVector<QString> filenames;
+	filenames.reserve(pictures.size());
+	for (const PictureEntry &entry: pictures)
+		filenames.append(entry.filename);
+	QVector<QImage> thumbnails = Thumbnailer::instance()->fetchThumbnails(filenames);
+	for (int i = 0; i < pictures.size(); ++i)
+		pictures[i].image = thumbnails[i];
 }
 
 void DivePictureModel::updateDivePictures()
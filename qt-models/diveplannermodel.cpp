@@ -9,9 +9,11 @@
 #include "core/settings/qPrefDivePlanner.h"
 #include "desktop-widgets/command.h"
 #include "core/gettextfromc.h"
+#include "core/divelist.h"
 #include <QApplication>
 #include <QTextDocument>
 #include <QtConcurrent>
+#include <algorithm>
 
 #define VARIATIONS_IN_BACKGROUND 1
 
@@ -210,12 +212,6 @@ void DivePlannerPointsModel::addCylinder_clicked()
 void DivePlannerPointsModel::setPlanMode(Mode m)
 {
 	mode = m;
-	// the planner may reset our GF settings that are used to show deco
-	// reset them to what's in the preferences
-	if (m != PLAN) {
-		set_gf(prefs.gflow, prefs.gfhigh);
-		set_vpmb_conservatism(prefs.vpmb_conservatism);
-	}
 }
 
 bool DivePlannerPointsModel::isPlanner()
@@ -411,6 +407,8 @@ DivePlannerPointsModel::DivePlannerPointsModel(QObject *parent) : QAbstractTable
 	recalc(false)
 {
 	memset(&diveplan, 0, sizeof(diveplan));
+	diveplan.waypoint_cache = alloc_waypoint_cache();
+	init_deco_config(&final_deco_state.config, true);
 	startTime.setTimeSpec(Qt::UTC);
 }
 
@@ -888,20 +886,7 @@ void DivePlannerPointsModel::createTemporaryPlan()
 
 	// what does the cache do???
 	struct deco_state *cache = NULL;
-	struct divedatapoint *dp = NULL;
-	for (int i = 0; i < MAX_CYLINDERS; i++) {
-		cylinder_t *cyl = &displayed_dive.cylinder[i];
-		if (cyl->depth.mm && cyl->cylinder_use != NOT_USED) {
-			dp = create_dp(0, cyl->depth.mm, i, 0);
-			if (diveplan.dp) {
-				dp->next = diveplan.dp;
-				diveplan.dp = dp;
-			} else {
-				dp->next = NULL;
-				diveplan.dp = dp;
-			}
-		}
-	}
+	plan_add_gases(&diveplan, &displayed_dive);
 #if DEBUG_PLAN
 	dump_plan(&diveplan);
 #endif
@@ -917,9 +902,9 @@ void DivePlannerPointsModel::createTemporaryPlan()
 		cloneDiveplan(&diveplan, plan_copy);
 		unlock_planner();
 #ifdef VARIATIONS_IN_BACKGROUND
-		QtConcurrent::run(this, &DivePlannerPointsModel::computeVariations, plan_copy, &plan_deco_state);
+		computeVariations(plan_copy, &plan_deco_state, false);
 #else
-		computeVariations(plan_copy, &plan_deco_state);
+		computeVariations(plan_copy, &plan_deco_state, true);
 #endif
 		final_deco_state = plan_deco_state;
 		emit calculatedPlanNotes();
@@ -969,7 +954,7 @@ struct divedatapoint * DivePlannerPointsModel::cloneDiveplan(struct diveplan *pl
 	return last_segment;
 }
 
-int DivePlannerPointsModel::analyzeVariations(struct decostop *min, struct decostop *mid, struct decostop *max, const char *unit)
+int DivePlannerPointsModel::analyzeVariations(const struct decostop *min, const struct decostop *mid, const struct decostop *max, const char *unit)
 {
 	int minsum = 0;
 	int midsum = 0;
@@ -1002,99 +987,145 @@ int DivePlannerPointsModel::analyzeVariations(struct decostop *min, struct decos
 	return (leftsum + rightsum) / 2;
 }
 
-void DivePlannerPointsModel::computeVariations(struct diveplan *original_plan, struct deco_state *previos_ds)
+enum {
+	VARIATION_ORIGINAL,
+	VARIATION_DEEPER,
+	VARIATION_SHALLOWER,
+	VARIATION_LONGER,
+	VARIATION_SHORTER,
+	VARIATION_COUNT
+};
+
+// The plans of the stop time variations are independent of each other and are
+// computed concurrently on the global thread pool, each one on its own copy of
+// the plan, the dive and the deco state. A run is given up as soon as a newer
+// one has been started.
+struct DivePlannerPointsModel::VariationsRun {
+	DivePlannerPointsModel *model;
+	int instance;
+	bool publishWhenDone;
+	QAtomicInt remaining;
+	QString depth_units, time_units;
+	struct {
+		struct diveplan plan = {};
+		struct dive *dive = NULL;
+		struct deco_state ds;
+		struct decostop stoptable[60];
+	} variations[VARIATION_COUNT];
+
+	~VariationsRun()
+	{
+		for (auto &v: variations) {
+			free_dps(&v.plan);
+			free_dive(v.dive);
+		}
+	}
+	bool cancelled() const
+	{
+		return instance != model->instanceCounter.loadAcquire();
+	}
+	static bool cancelledCallback(void *data)
+	{
+		return static_cast<const VariationsRun *>(data)->cancelled();
+	}
+};
+
+void DivePlannerPointsModel::computeVariation(QSharedPointer<VariationsRun> run, int which)
 {
+	struct deco_state *cache = NULL;
+	auto &v = run->variations[which];
 
-//	bool oldRecalc = setRecalc(false);
-	struct dive *dive = alloc_dive();
-	copy_dive(&displayed_dive, dive);
-	struct decostop original[60], deeper[60], shallower[60], shorter[60], longer[60];
-	struct deco_state *cache = NULL, *save = NULL;
-	struct diveplan plan_copy;
-	struct divedatapoint *last_segment;
-	struct deco_state ds = *previos_ds;
+	if (!run->cancelled())
+		plan(&v.ds, &v.plan, v.dive, 1, v.stoptable, &cache, true, false);
+	free(cache);
+	// Whoever finishes last publishes the result of the run
+	if (!run->remaining.deref() && run->publishWhenDone)
+		run->model->publishVariations(*run);
+}
 
-	if (!original_plan)
+void DivePlannerPointsModel::publishVariations(const VariationsRun &run)
+{
+	if (run.cancelled())
 		return;
 
+	auto table = [&run](int which) { return run.variations[which].stoptable; };
+	char buf[200];
+	sprintf(buf, ", %s: + %d:%02d /%s + %d:%02d /min", qPrintable(tr("Stop times")),
+		FRACTION(analyzeVariations(table(VARIATION_SHALLOWER), table(VARIATION_ORIGINAL), table(VARIATION_DEEPER), qPrintable(run.depth_units)), 60), qPrintable(run.depth_units),
+		FRACTION(analyzeVariations(table(VARIATION_SHORTER), table(VARIATION_ORIGINAL), table(VARIATION_LONGER), qPrintable(run.time_units)), 60));
+
+	emit variationsComputed(QString(buf));
+#ifdef DEBUG_STOPVAR
+	printf("\n\n");
+#endif
+}
+
+void DivePlannerPointsModel::computeVariations(struct diveplan *original_plan, const struct deco_state *previous_ds, bool wait)
+{
+	if (!original_plan)
+		return;
 
 	if (in_planner() && prefs.display_variations && decoMode() != RECREATIONAL) {
-		int my_instance = ++instanceCounter;
-		cache_deco_state(&ds, &save);
+		QSharedPointer<VariationsRun> run(new VariationsRun);
+		run->model = this;
+		run->instance = instanceCounter.fetchAndAddOrdered(1) + 1;
+		run->publishWhenDone = !wait;
+		run->remaining.storeRelease(VARIATION_COUNT);
 
 		duration_t delta_time = { .seconds = 60 };
-		QString time_units = tr("min");
+		run->time_units = tr("min");
 		depth_t delta_depth;
-		QString depth_units;
 
 		if (prefs.units.length == units::METERS) {
 			delta_depth.mm = 1000; // 1m
-			depth_units = tr("m");
+			run->depth_units = tr("m");
 		} else {
 			delta_depth.mm = feet_to_mm(1.0); // 1ft
-			depth_units = tr("ft");
+			run->depth_units = tr("ft");
 		}
 
-		last_segment = cloneDiveplan(original_plan, &plan_copy);
-		if (!last_segment)
-			goto finish;
-		if (my_instance != instanceCounter)
-			goto finish;
-		plan(&ds, &plan_copy, dive, 1, original, &cache, true, false);
-		free_dps(&plan_copy);
-		restore_deco_state(save, &ds, false);
-
-		last_segment = cloneDiveplan(original_plan, &plan_copy);
-		last_segment->depth.mm += delta_depth.mm;
-		last_segment->next->depth.mm += delta_depth.mm;
-		if (my_instance != instanceCounter)
-			goto finish;
-		plan(&ds, &plan_copy, dive, 1, deeper, &cache, true, false);
-		free_dps(&plan_copy);
-		restore_deco_state(save, &ds, false);
-
-		last_segment = cloneDiveplan(original_plan, &plan_copy);
-		last_segment->depth.mm -= delta_depth.mm;
-		last_segment->next->depth.mm -= delta_depth.mm;
-		if (my_instance != instanceCounter)
-			goto finish;
-		plan(&ds, &plan_copy, dive, 1, shallower, &cache, true, false);
-		free_dps(&plan_copy);
-		restore_deco_state(save, &ds, false);
-
-		last_segment = cloneDiveplan(original_plan, &plan_copy);
-		last_segment->next->time += delta_time.seconds;
-		if (my_instance != instanceCounter)
-			goto finish;
-		plan(&ds, &plan_copy, dive, 1, longer, &cache, true, false);
-		free_dps(&plan_copy);
-		restore_deco_state(save, &ds, false);
-
-		last_segment = cloneDiveplan(original_plan, &plan_copy);
-		last_segment->next->time -= delta_time.seconds;
-		if (my_instance != instanceCounter)
-			goto finish;
-		plan(&ds, &plan_copy, dive, 1, shorter, &cache, true, false);
-		free_dps(&plan_copy);
-		restore_deco_state(save, &ds, false);
-
-		char buf[200];
-		sprintf(buf, ", %s: + %d:%02d /%s + %d:%02d /min", qPrintable(tr("Stop times")),
-			FRACTION(analyzeVariations(shallower, original, deeper, qPrintable(depth_units)), 60), qPrintable(depth_units),
-			FRACTION(analyzeVariations(shorter, original, longer, qPrintable(time_units)), 60));
-
-		emit variationsComputed(QString(buf));
-#ifdef DEBUG_STOPVAR
-		printf("\n\n");
-#endif
+		for (int i = 0; i < VARIATION_COUNT; i++) {
+			auto &v = run->variations[i];
+			struct divedatapoint *last_segment = cloneDiveplan(original_plan, &v.plan);
+			v.dive = alloc_dive();
+			copy_dive(&displayed_dive, v.dive);
+			v.ds = *previous_ds;
+			v.plan.cancelled = &VariationsRun::cancelledCallback;
+			v.plan.cancel_data = run.data();
+			v.plan.waypoint_cache = NULL;
+			v.plan.quiet = true;
+			if (!last_segment)
+				goto finish;
+			switch (i) {
+			case VARIATION_DEEPER:
+				last_segment->depth.mm += delta_depth.mm;
+				last_segment->next->depth.mm += delta_depth.mm;
+				break;
+			case VARIATION_SHALLOWER:
+				last_segment->depth.mm -= delta_depth.mm;
+				last_segment->next->depth.mm -= delta_depth.mm;
+				break;
+			case VARIATION_LONGER:
+				last_segment->next->time += delta_time.seconds;
+				break;
+			case VARIATION_SHORTER:
+				last_segment->next->time -= delta_time.seconds;
+				break;
+			}
+		}
+
+		QVector<QFuture<void>> futures;
+		for (int i = 0; i < VARIATION_COUNT; i++)
+			futures.append(QtConcurrent::run(&DivePlannerPointsModel::computeVariation, run, i));
+		if (wait) {
+			for (QFuture<void> &future: futures)
+				future.waitForFinished();
+			publishVariations(*run);
+		}
 	}
 finish:
 	free_dps(original_plan);
 	free(original_plan);
-	free(save);
-	free(cache);
-	free(dive);
-//	setRecalc(oldRecalc);
 }
 
 void DivePlannerPointsModel::createPlan(bool replanCopy)
@@ -1114,7 +1145,7 @@ void DivePlannerPointsModel::createPlan(bool replanCopy)
 	lock_planner();
 	cloneDiveplan(&diveplan, plan_copy);
 	unlock_planner();
-	computeVariations(plan_copy, &ds_after_previous_dives);
+	computeVariations(plan_copy, &ds_after_previous_dives, true);
 
 	free(cache);
 
@@ -1153,7 +1184,7 @@ void DivePlannerPointsModel::createPlan(bool replanCopy)
 	} else {
 		// we were planning an old dive and rewrite the plan
 		mark_divelist_changed(true);
-		copy_dive(&displayed_dive, current_dive);
+		replace_dive_contents(current_dive, &displayed_dive);
 	}
 
 	// Remove and clean the diveplan, so we don't delete
@@ -4,6 +4,8 @@
 
 #include <QAbstractTableModel>
 #include <QDateTime>
+#include <QAtomicInt>
+#include <QSharedPointer>
 
 #include "core/dive.h"
 
@@ -116,13 +118,16 @@ private:
 	void createPlan(bool replanCopy);
 	struct diveplan diveplan;
 	struct divedatapoint *cloneDiveplan(struct diveplan *plan_src, struct diveplan *plan_copy);
-	void computeVariations(struct diveplan *diveplan, struct deco_state *ds);
-	int analyzeVariations(struct decostop *min, struct decostop *mid, struct decostop *max, const char *unit);
+	struct VariationsRun;
+	void computeVariations(struct diveplan *diveplan, const struct deco_state *ds, bool wait);
+	static void computeVariation(QSharedPointer<VariationsRun> run, int which);
+	void publishVariations(const VariationsRun &run);
+	int analyzeVariations(const struct decostop *min, const struct decostop *mid, const struct decostop *max, const char *unit);
 	Mode mode;
 	bool recalc;
 	QVector<divedatapoint> divepoints;
 	QDateTime startTime;
-	int instanceCounter = 0;
+	QAtomicInt instanceCounter;
 	struct deco_state ds_after_previous_dives;
 };
 
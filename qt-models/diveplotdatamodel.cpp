@@ -5,6 +5,91 @@
 #include "core/divelist.h"
 #include "core/color.h"
 
+#define PLOT_DATA_GETTER(EXPR) \
+	[](const plot_info &pi, int row, int tissue) -> double { return EXPR; }
+
+// Resolve the column once, so that reading a value is a single indirect call
+PlotDataColumn::PlotDataColumn(const plot_info &pInfo, int column) : pInfo(pInfo), tissue(0)
+{
+	switch (column) {
+	case DivePlotDataModel::DEPTH:
+		get = PLOT_DATA_GETTER(pi.entry[row].depth);
+		break;
+	case DivePlotDataModel::TIME:
+		get = PLOT_DATA_GETTER(pi.entry[row].sec);
+		break;
+	case DivePlotDataModel::PRESSURE:
+	case DivePlotDataModel::SENSOR_PRESSURE:
+		get = PLOT_DATA_GETTER(get_plot_sensor_pressure(&pi, row, 0));
+		break;
+	case DivePlotDataModel::INTERPOLATED_PRESSURE:
+		get = PLOT_DATA_GETTER(get_plot_interpolated_pressure(&pi, row, 0));
+		break;
+	case DivePlotDataModel::TEMPERATURE:
+		get = PLOT_DATA_GETTER(pi.entry[row].temperature);
+		break;
+	case DivePlotDataModel::COLOR:
+		get = PLOT_DATA_GETTER(pi.entry[row].velocity);
+		break;
+	case DivePlotDataModel::CEILING:
+		get = PLOT_DATA_GETTER(pi.entry[row].ceiling);
+		break;
+	case DivePlotDataModel::SAC:
+		get = PLOT_DATA_GETTER(pi.entry[row].sac);
+		break;
+	case DivePlotDataModel::PN2:
+		get = PLOT_DATA_GETTER(pi.entry[row].pressures.n2);
+		break;
+	case DivePlotDataModel::PHE:
+		get = PLOT_DATA_GETTER(pi.entry[row].pressures.he);
+		break;
+	case DivePlotDataModel::PO2:
+		get = PLOT_DATA_GETTER(pi.entry[row].pressures.o2);
+		break;
+	case DivePlotDataModel::O2SETPOINT:
+		get = PLOT_DATA_GETTER(pi.entry[row].o2setpoint.mbar / 1000.0);
+		break;
+	case DivePlotDataModel::CCRSENSOR1:
+		get = PLOT_DATA_GETTER(pi.entry[row].o2sensor[0].mbar / 1000.0);
+		break;
+	case DivePlotDataModel::CCRSENSOR2:
+		get = PLOT_DATA_GETTER(pi.entry[row].o2sensor[1].mbar / 1000.0);
+		break;
+	case DivePlotDataModel::CCRSENSOR3:
+		get = PLOT_DATA_GETTER(pi.entry[row].o2sensor[2].mbar / 1000.0);
+		break;
+	case DivePlotDataModel::SCR_OC_PO2:
+		get = PLOT_DATA_GETTER(pi.entry[row].scr_OC_pO2.mbar / 1000.0);
+		break;
+	case DivePlotDataModel::HEARTBEAT:
+		get = PLOT_DATA_GETTER(pi.entry[row].heartbeat);
+		break;
+	case DivePlotDataModel::AMBPRESSURE:
+		get = PLOT_DATA_GETTER(AMB_PERCENTAGE);
+		break;
+	case DivePlotDataModel::GFLINE:
+		get = PLOT_DATA_GETTER(pi.entry[row].gfline);
+		break;
+	case DivePlotDataModel::INSTANT_MEANDEPTH:
+		get = PLOT_DATA_GETTER(pi.entry[row].running_sum);
+		break;
+	default:
+		if (column >= DivePlotDataModel::TISSUE_1 && column <= DivePlotDataModel::TISSUE_16) {
+			tissue = column - DivePlotDataModel::TISSUE_1;
+			get = PLOT_DATA_GETTER(get_plot_tissue_ceiling(&pi, row, tissue));
+		} else if (column >= DivePlotDataModel::PERCENTAGE_1 && column <= DivePlotDataModel::PERCENTAGE_16) {
+			tissue = column - DivePlotDataModel::PERCENTAGE_1;
+			get = PLOT_DATA_GETTER(get_plot_tissue_percentage(&pi, row, tissue));
+		} else {
+			// USERENTERED and invalid columns
+			get = PLOT_DATA_GETTER(0.0);
+		}
+		break;
+	}
+}
+
+#undef PLOT_DATA_GETTER
+
 DivePlotDataModel::DivePlotDataModel(QObject *parent) :
 	QAbstractTableModel(parent),
 	diveId(0),
@@ -24,7 +109,8 @@ QVariant DivePlotDataModel::data(const QModelIndex &index, int role) const
 	if ((!index.isValid()) || (index.row() >= pInfo.nr) || pInfo.entry == 0)
 		return QVariant();
 
-	plot_data item = pInfo.entry[index.row()];
+	int row = index.row();
+	const plot_data &item = pInfo.entry[row];
 	if (role == Qt::DisplayRole) {
 		switch (index.column()) {
 		case DEPTH:
@@ -32,7 +118,7 @@ QVariant DivePlotDataModel::data(const QModelIndex &index, int role) const
 		case TIME:
 			return item.sec;
 		case PRESSURE:
-			return item.pressure[0][0];
+			return get_plot_sensor_pressure(&pInfo, row, 0);
 		case TEMPERATURE:
 			return item.temperature;
 		case COLOR:
@@ -40,9 +126,9 @@ QVariant DivePlotDataModel::data(const QModelIndex &index, int role) const
 		case USERENTERED:
 			return false;
 		case SENSOR_PRESSURE:
-			return item.pressure[0][0];
+			return get_plot_sensor_pressure(&pInfo, row, 0);
 		case INTERPOLATED_PRESSURE:
-			return item.pressure[0][1];
+			return get_plot_interpolated_pressure(&pInfo, row, 0);
 		case CEILING:
 			return item.ceiling;
 		case SAC:
@@ -75,11 +161,11 @@ QVariant DivePlotDataModel::data(const QModelIndex &index, int role) const
 	}
 
 	if (role == Qt::DisplayRole && index.column() >= TISSUE_1 && index.column() <= TISSUE_16) {
-		return item.ceilings[index.column() - TISSUE_1];
+		return get_plot_tissue_ceiling(&pInfo, row, index.column() - TISSUE_1);
 	}
 
 	if (role == Qt::DisplayRole && index.column() >= PERCENTAGE_1 && index.column() <= PERCENTAGE_16) {
-		return item.percentages[index.column() - PERCENTAGE_1];
+		return get_plot_tissue_percentage(&pInfo, row, index.column() - PERCENTAGE_1);
 	}
 
 	if (role == Qt::BackgroundRole) {
@@ -96,6 +182,11 @@ const plot_info &DivePlotDataModel::data() const
 	return pInfo;
 }
 
+PlotDataColumn DivePlotDataModel::column(int column) const
+{
+	return PlotDataColumn(pInfo, column);
+}
+
 int DivePlotDataModel::rowCount(const QModelIndex&) const
 {
 	return pInfo.nr;
@@ -167,8 +258,7 @@ void DivePlotDataModel::clear()
 	if (rowCount() != 0) {
 		beginRemoveRows(QModelIndex(), 0, rowCount() - 1);
 		pInfo.nr = 0;
-		free(pInfo.entry);
-		pInfo.entry = 0;
+		free_plot_info_data(&pInfo);
 		diveId = -1;
 		dcNr = -1;
 		endRemoveRows();
@@ -181,10 +271,8 @@ void DivePlotDataModel::setDive(dive *d, const plot_info &info)
 	Q_ASSERT(d != NULL);
 	diveId = d->id;
 	dcNr = dc_number;
-	free(pInfo.entry);
-	pInfo = info;
-	pInfo.entry = (struct plot_data *)malloc(sizeof(struct plot_data) * pInfo.nr);
-	memcpy(pInfo.entry, info.entry, sizeof(plot_data) * pInfo.nr);
+	free_plot_info_data(&pInfo);
+	copy_plot_info_data(&pInfo, &info);
 	beginInsertRows(QModelIndex(), 0, pInfo.nr - 1);
 	endInsertRows();
 }
@@ -218,6 +306,7 @@ void DivePlotDataModel::emitDataChanged()
 void DivePlotDataModel::calculateDecompression()
 {
 	struct divecomputer *dc = select_dc(&displayed_dive);
+	init_profile_deco_config(&plot_deco_state.config, &DivePlannerPointsModel::instance()->final_deco_state);
 	init_decompression(&plot_deco_state, &displayed_dive);
 	calculate_deco_information(&plot_deco_state, &(DivePlannerPointsModel::instance()->final_deco_state), &displayed_dive, dc, &pInfo, false);
 	dataChanged(index(0, CEILING), index(pInfo.nr - 1, TISSUE_16));
@@ -11,6 +11,31 @@ struct dive;
 struct plot_data;
 struct plot_info;
 
+// Typed read access to one column of the plot data, as used by the profile items.
+// Unlike the model's data(), this doesn't create a QVariant for every value.
+// The column is only valid as long as the plot data of the model doesn't change.
+class PlotDataColumn {
+public:
+	PlotDataColumn(const plot_info &pInfo, int column);
+	int size() const;
+	double operator[](int row) const;
+private:
+	typedef double (*Getter)(const plot_info &pInfo, int row, int tissue);
+	const plot_info &pInfo;
+	Getter get;
+	int tissue;
+};
+
+inline int PlotDataColumn::size() const
+{
+	return pInfo.nr;
+}
+
+inline double PlotDataColumn::operator[](int row) const
+{
+	return get(pInfo, row, tissue);
+}
+
 class DivePlotDataModel : public QAbstractTableModel {
 	Q_OBJECT
 public:
@@ -79,6 +104,7 @@ public:
 	void clear();
 	void setDive(struct dive *d, const plot_info &pInfo);
 	const plot_info &data() const;
+	PlotDataColumn column(int column) const;
 	unsigned int dcShown() const;
 	double pheMax();
 	double pn2Max();
@@ -1,9 +1,9 @@
 // SPDX-License-Identifier: GPL-2.0
 #include "qt-models/divetripmodel.h"
-#include "qt-models/filtermodels.h"
 #include "core/gettextfromc.h"
 #include "core/metrics.h"
 #include "core/divelist.h"
+#include "core/diveinfocache.h"
 #include "core/qthelper.h"
 #include "core/subsurface-string.h"
 #include <QIcon>
@@ -13,13 +13,6 @@
 
 // 1) Base functions
 
-static int nitrox_sort_value(const struct dive *dive)
-{
-	int o2, he, o2max;
-	get_dive_gas(dive, &o2, &he, &o2max);
-	return he * 1000 + o2;
-}
-
 static QVariant dive_table_alignment(int column)
 {
 	switch (column) {
@@ -122,7 +115,7 @@ static QString displaySac(const struct dive *d, bool units)
 
 static QString displayWeight(const struct dive *d, bool units)
 {
-	QString s = weight_string(total_weight(d));
+	QString s = weight_string(DiveInfoCache::instance()->totalWeight(d));
 	if (!units)
 		return s;
 	else if (get_units()->weight == units::KG)
@@ -164,7 +157,7 @@ QVariant DiveTripModelBase::diveData(const struct dive *d, int column, int role)
 			else
 				return d->maxcns;
 		case TAGS:
-			return get_taglist_string(d->tag_list);
+			return DiveInfoCache::instance()->tags(d);
 		case PHOTOS:
 			break;
 		case COUNTRY:
@@ -172,12 +165,9 @@ QVariant DiveTripModelBase::diveData(const struct dive *d, int column, int role)
 		case BUDDIES:
 			return QString(d->buddy);
 		case LOCATION:
-			return QString(get_dive_location(d));
+			return DiveInfoCache::instance()->location(d);
 		case GAS:
-			char *gas_string = get_dive_gas_string(d);
-			QString ret(gas_string);
-			free(gas_string);
-			return ret;
+			return DiveInfoCache::instance()->gasString(d);
 		}
 		break;
 	case Qt::DecorationRole:
@@ -370,6 +360,9 @@ void DiveTripModelBase::resetModel(DiveTripModelBase::Layout layout)
 
 DiveTripModelBase::DiveTripModelBase(QObject *parent) : QAbstractItemModel(parent)
 {
+	// Connect the cache to the DiveListNotifier before the derived models connect,
+	// so that it is invalidated before the models are updated
+	DiveInfoCache::instance();
 }
 
 int DiveTripModelBase::columnCount(const QModelIndex&) const
@@ -876,12 +869,7 @@ void DiveTripModelTree::divesDeleted(dive_trip *trip, bool deleteTrip, const QVe
 
 void DiveTripModelTree::divesChanged(dive_trip *trip, const QVector<dive *> &dives)
 {
-	// Update filter flags. TODO: The filter should update the flag by itself when
-	// recieving the signals below.
-	bool diveChanged = false;
-	for (dive *d: dives)
-		diveChanged |= MultiFilterSortModel::instance()->updateDive(d);
-
+	// The filter has already updated the filter flags of the dives.
 	if (!trip) {
 		// This is outside of a trip. Process top-level items range-wise.
 
@@ -917,9 +905,8 @@ void DiveTripModelTree::divesChanged(dive_trip *trip, const QVector<dive *> &div
 		// If necessary, move the trip
 		topLevelChanged(idx);
 
-		// If a dive changed, re-render the trip in the list [or actually make it (in)visible].
-		if (diveChanged)
-			dataChanged(createIndex(idx, 0, noParent), createIndex(idx, 0, noParent));
+		// Re-render the trip in the list [or actually make it (in)visible].
+		dataChanged(createIndex(idx, 0, noParent), createIndex(idx, 0, noParent));
 	}
 }
 
@@ -1069,13 +1056,35 @@ void DiveTripModelTree::currentDiveChanged()
 	}
 }
 
-void DiveTripModelTree::filterFinished()
+void DiveTripModelTree::filterFinished(const QSet<dive *> &dives)
 {
-	// If the filter finished, update all trip items to show the correct number of displayed dives
-	// in each trip. Without doing this, only trip headers of expanded trips were updated.
+	if (dives.isEmpty())
+		return;
+
+	// Signal the changed top-level dives range-wise.
+	processRanges(items,
+		      [&](const Item &e) { return e.getDive() && dives.contains(e.getDive()) ? 1 : 0; }, // Condition
+		      [&](const std::vector<Item> &, int from, int to) -> int { // Action
+			dataChanged(createIndex(from, 0, noParent), createIndex(to - 1, COLUMNS - 1, noParent));
+			return 0; // No items added or deleted
+		      });
+
+	// Signal the changed dives in trips and update the trip items to show the correct number
+	// of displayed dives. Without doing this, only trip headers of expanded trips were updated.
+	// The trips are updated after their dives, because they are shown if any of their dives is.
 	for (int idx = 0; idx < (int)items.size(); ++idx) {
-		QModelIndex tripIndex = createIndex(idx, 0, noParent);
-		dataChanged(tripIndex, tripIndex);
+		if (items[idx].getDive())
+			continue;
+		bool tripChanged = false;
+		processRanges(items[idx].dives,
+			      [&](dive *d) { return dives.contains(d) ? 1 : 0; }, // Condition
+			      [&](const std::vector<dive *> &, int from, int to) -> int { // Action
+				dataChanged(createIndex(from, 0, idx), createIndex(to - 1, COLUMNS - 1, idx));
+				tripChanged = true;
+				return 0; // No items added or deleted
+			      });
+		if (tripChanged)
+			dataChanged(createIndex(idx, 0, noParent), createIndex(idx, 0, noParent));
 	}
 }
 
@@ -1171,11 +1180,7 @@ void DiveTripModelList::divesDeleted(dive_trip *trip, bool deleteTrip, const QVe
 
 void DiveTripModelList::divesChanged(dive_trip *trip, const QVector<dive *> &dives)
 {
-	// Update filter flags. TODO: The filter should update the flag by itself when
-	// recieving the signals below.
-	for (dive *d: dives)
-		MultiFilterSortModel::instance()->updateDive(d);
-
+	// The filter has already updated the filter flags of the dives.
 	// Since we know that the dive list is sorted, we will only ever search for the first element
 	// in dives as this must be the first that we encounter. Once we find a range, increase the
 	// index accordingly.
@@ -1237,9 +1242,18 @@ void DiveTripModelList::currentDiveChanged()
 	emit newCurrentDive(createIndex(it - items.begin(), 0));
 }
 
-void DiveTripModelList::filterFinished()
+void DiveTripModelList::filterFinished(const QSet<dive *> &dives)
 {
-	// In list mode, we don't have to change anything after filter finished.
+	if (dives.isEmpty())
+		return;
+
+	// Signal the changed dives range-wise.
+	processRanges(items,
+		      [&](dive *d) { return dives.contains(d) ? 1 : 0; }, // Condition
+		      [&](const std::vector<dive *> &, int from, int to) -> int { // Action
+			dataChanged(createIndex(from, 0, noParent), createIndex(to - 1, COLUMNS - 1, noParent));
+			return 0; // No items added or deleted
+		      });
 }
 
 
@@ -1261,6 +1275,15 @@ static int strCmp(const char *s1, const char *s2)
 	return QString::localeAwareCompare(QString(s1), QString(s2)); // TODO: avoid copy
 }
 
+static int strCmp(const QString &s1, const QString &s2)
+{
+	if (s1.isNull())
+		return s2.isNull() ? 0 : -1;
+	if (s2.isNull())
+		return 1;
+	return QString::localeAwareCompare(s1, s2);
+}
+
 bool DiveTripModelList::lessThan(const QModelIndex &i1, const QModelIndex &i2) const
 {
 	// We assume that i1.column() == i2.column().
@@ -1286,27 +1309,21 @@ bool DiveTripModelList::lessThan(const QModelIndex &i1, const QModelIndex &i2) c
 	case TEMPERATURE:
 		return lessThanHelper(d1->watertemp.mkelvin - d2->watertemp.mkelvin, row_diff);
 	case TOTALWEIGHT:
-		return lessThanHelper(total_weight(d1) - total_weight(d2), row_diff);
+		return lessThanHelper(DiveInfoCache::instance()->totalWeight(d1) - DiveInfoCache::instance()->totalWeight(d2), row_diff);
 	case SUIT:
 		return lessThanHelper(strCmp(d1->suit, d2->suit), row_diff);
 	case CYLINDER:
 		return lessThanHelper(strCmp(d1->cylinder[0].type.description, d2->cylinder[0].type.description), row_diff);
 	case GAS:
-		return lessThanHelper(nitrox_sort_value(d1) - nitrox_sort_value(d2), row_diff);
+		return lessThanHelper(DiveInfoCache::instance()->gasSortValue(d1) - DiveInfoCache::instance()->gasSortValue(d2), row_diff);
 	case SAC:
 		return lessThanHelper(d1->sac - d2->sac, row_diff);
 	case OTU:
 		return lessThanHelper(d1->otu - d2->otu, row_diff);
 	case MAXCNS:
 		return lessThanHelper(d1->maxcns - d2->maxcns, row_diff);
-	case TAGS: {
-		char *s1 = taglist_get_tagstring(d1->tag_list);
-		char *s2 = taglist_get_tagstring(d2->tag_list);
-		int diff = strCmp(s1, s2);
-		free(s1);
-		free(s2);
-		return lessThanHelper(diff, row_diff);
-	}
+	case TAGS:
+		return lessThanHelper(strCmp(DiveInfoCache::instance()->tags(d1), DiveInfoCache::instance()->tags(d2)), row_diff);
 	case PHOTOS:
 		return lessThanHelper(countPhotos(d1) - countPhotos(d2), row_diff);
 	case COUNTRY:
@@ -1314,6 +1331,6 @@ bool DiveTripModelList::lessThan(const QModelIndex &i1, const QModelIndex &i2) c
 	case BUDDIES:
 		return lessThanHelper(strCmp(d1->buddy, d2->buddy), row_diff);
 	case LOCATION:
-		return lessThanHelper(strCmp(get_dive_location(d1), get_dive_location(d2)), row_diff);
+		return lessThanHelper(strCmp(DiveInfoCache::instance()->location(d1), DiveInfoCache::instance()->location(d2)), row_diff);
 	}
 }
@@ -5,6 +5,7 @@
 #include "core/dive.h"
 #include "core/subsurface-qt/DiveListNotifier.h"
 #include <QAbstractItemModel>
+#include <QSet>
 
 // There are two different representations of the dive list:
 // 1) Tree view: two-level model where dives are grouped by trips
@@ -73,7 +74,9 @@ public:
 	bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
 	DiveTripModelBase(QObject *parent = 0);
 	int columnCount(const QModelIndex&) const;
-	virtual void filterFinished() = 0;
+	// The filter flags of the given dives changed. Signal the changed rows, so
+	// that the filter proxy model only re-filters these.
+	virtual void filterFinished(const QSet<dive *> &dives) = 0;
 
 	// Used for sorting. This is a bit of a layering violation, as sorting should be performed
 	// by the higher-up QSortFilterProxyModel, but it makes things so much easier!
@@ -122,7 +125,7 @@ private:
 	QModelIndex index(int row, int column, const QModelIndex &parent) const override;
 	QModelIndex parent(const QModelIndex &index) const override;
 	QVariant data(const QModelIndex &index, int role) const override;
-	void filterFinished() override;
+	void filterFinished(const QSet<dive *> &dives) override;
 	bool lessThan(const QModelIndex &i1, const QModelIndex &i2) const override;
 	void changeDiveSelection(dive_trip *trip, const QVector<dive *> &dives, bool select) override;
 	dive *diveOrNull(const QModelIndex &index) const override;
@@ -183,7 +186,7 @@ private:
 	QModelIndex index(int row, int column, const QModelIndex &parent) const override;
 	QModelIndex parent(const QModelIndex &index) const override;
 	QVariant data(const QModelIndex &index, int role) const override;
-	void filterFinished() override;
+	void filterFinished(const QSet<dive *> &dives) override;
 	bool lessThan(const QModelIndex &i1, const QModelIndex &i2) const override;
 	void changeDiveSelection(dive_trip *trip, const QVector<dive *> &dives, bool select) override;
 	dive *diveOrNull(const QModelIndex &index) const override;
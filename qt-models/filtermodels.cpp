@@ -6,6 +6,7 @@
 #include "core/divesite.h"
 #include "core/subsurface-string.h"
 #include "core/subsurface-qt/DiveListNotifier.h"
+#include "core/fulltext.h"
 #include "qt-models/divetripmodel.h"
 
 #if !defined(SUBSURFACE_MOBILE)
@@ -15,87 +16,104 @@
 
 #include <QDebug>
 #include <algorithm>
+#include <limits>
 
 namespace {
-	// Check if a string-list contains at least one string containing the second argument.
-	// Comparison is non case sensitive and removes white space.
-	bool listContainsSuperstring(const QStringList &list, const QString &s)
+	// Check whether either all, any or none of the search terms match the dive.
+	// The mode is controlled by the third argument
+	bool check(const std::vector<FullTextQuery> &queries, const struct dive *d, FilterData::Mode mode)
 	{
-		return std::any_of(list.begin(), list.end(), [&s](const QString &s2)
-				   { return s2.trimmed().contains(s.trimmed(), Qt::CaseInsensitive); } );
+		if (queries.empty())
+			return true;
+		bool negate = mode == FilterData::Mode::NONE_OF;
+		bool any_of = mode == FilterData::Mode::ANY_OF;
+		auto fun = [d, negate](const FullTextQuery &query)
+			   { return query.matches(d) != negate; };
+		return any_of ? std::any_of(queries.begin(), queries.end(), fun)
+			      : std::all_of(queries.begin(), queries.end(), fun);
 	}
 
-	// Check whether either all, any or none of the items of the first list is
-	// in the second list as a super string.
-	// The mode is controlled by the second argument
-	bool check(const QStringList &items, const QStringList &list, FilterData::Mode mode)
+	// Terms without any words, such as "-", are dropped. Since empty queries match every dive,
+	// they would otherwise hide all dives in the "none of" mode.
+	std::vector<FullTextQuery> makeQueries(const QStringList &terms, unsigned fields)
 	{
-		bool negate = mode == FilterData::Mode::NONE_OF;
-		bool any_of = mode == FilterData::Mode::ANY_OF;
-		auto fun = [&list, negate](const QString &item)
-			   { return listContainsSuperstring(list, item) != negate; };
-		return any_of ? std::any_of(items.begin(), items.end(), fun)
-			      : std::all_of(items.begin(), items.end(), fun);
+		std::vector<FullTextQuery> res;
+		res.reserve(terms.size());
+		for (const QString &term: terms) {
+			FullTextQuery query(term, fields);
+			if (!query.isEmpty())
+				res.push_back(std::move(query));
+		}
+		return res;
 	}
 
-	bool hasTags(const QStringList &tags, const struct dive *d, FilterData::Mode mode)
+	// True if every query of q1 implies a query of q2
+	bool impliesAny(const std::vector<FullTextQuery> &q1, const std::vector<FullTextQuery> &q2)
 	{
-		if (tags.isEmpty())
-			return true;
-		QStringList dive_tags = get_taglist_string(d->tag_list).split(",");
-		dive_tags.append(gettextFromC::tr(divemode_text_ui[d->dc.divemode]));
-		return check(tags, dive_tags, mode);
+		return std::all_of(q1.begin(), q1.end(), [&q2](const FullTextQuery &q)
+				   { return std::any_of(q2.begin(), q2.end(), [&q](const FullTextQuery &other)
+							{ return q.implies(other); }); });
 	}
 
-	bool hasPersons(const QStringList &people, const struct dive *d, FilterData::Mode mode)
+	// True if every query of q1 is implied by a query of q2
+	bool impliedByAny(const std::vector<FullTextQuery> &q1, const std::vector<FullTextQuery> &q2)
 	{
-		if (people.isEmpty())
-			return true;
-		QStringList dive_people = QString(d->buddy).split(",", QString::SkipEmptyParts)
-			+ QString(d->divemaster).split(",", QString::SkipEmptyParts);
-		return check(people, dive_people, mode);
+		return std::all_of(q1.begin(), q1.end(), [&q2](const FullTextQuery &q)
+				   { return std::any_of(q2.begin(), q2.end(), [&q](const FullTextQuery &other)
+							{ return other.implies(q); }); });
 	}
 
-	bool hasLocations(const QStringList &locations, const struct dive *d, FilterData::Mode mode)
+	// True if every dive shown with the new terms is shown with the old terms
+	bool narrowerTerms(const std::vector<FullTextQuery> &oldQueries, const std::vector<FullTextQuery> &newQueries, FilterData::Mode mode)
 	{
-		if (locations.isEmpty())
+		// No terms show all dives
+		if (oldQueries.empty())
 			return true;
-		QStringList diveLocations;
-		if (d->divetrip)
-			diveLocations.push_back(QString(d->divetrip->location));
-
-		if (d->dive_site)
-			diveLocations.push_back(QString(d->dive_site->name));
-
-		return check(locations, diveLocations, mode);
+		if (newQueries.empty())
+			return false;
+		switch (mode) {
+		case FilterData::Mode::ALL_OF:
+			return impliedByAny(oldQueries, newQueries);
+		case FilterData::Mode::ANY_OF:
+			return impliesAny(newQueries, oldQueries);
+		case FilterData::Mode::NONE_OF:
+		default:
+			return impliesAny(oldQueries, newQueries);
+		}
 	}
 
-	// TODO: Finish this implementation.
-	bool hasEquipment(const QStringList &, const struct dive *, FilterData::Mode)
+	QVector<dive *> divesOfTable(const struct dive_table &table)
 	{
-		return true;
+		QVector<dive *> res;
+		res.reserve(table.nr);
+		for (int i = 0; i < table.nr; ++i)
+			res.push_back(table.dives[i]);
+		return res;
 	}
 
-	bool hasSuits(const QStringList &suits, const struct dive *d, FilterData::Mode mode)
+	timestamp_t fromTimestamp(const FilterData &data)
 	{
-		if (suits.isEmpty())
-			return true;
-		QStringList diveSuits;
-		if (d->suit)
-			diveSuits.push_back(QString(d->suit));
-		return check(suits, diveSuits, mode);
+		if (!data.fromDate.isValid() || !data.fromTime.isValid())
+			return std::numeric_limits<timestamp_t>::min();
+		QDateTime t = data.fromDate;
+		t.setTime(data.fromTime);
+		return t.toMSecsSinceEpoch()/1000 + t.offsetFromUtc();
 	}
 
-	bool hasNotes(const QStringList &dnotes, const struct dive *d, FilterData::Mode mode)
+	timestamp_t toTimestamp(const FilterData &data)
 	{
-		if (dnotes.isEmpty())
-			return true;
-		QStringList diveNotes;
-		if (d->notes)
-			diveNotes.push_back(QString(d->notes));
-		return check(dnotes, diveNotes, mode);
+		if (!data.toDate.isValid() || !data.toTime.isValid())
+			return std::numeric_limits<timestamp_t>::max();
+		QDateTime t = data.toDate;
+		t.setTime(data.toTime);
+		return t.toMSecsSinceEpoch()/1000 + t.offsetFromUtc();
 	}
 
+	// TODO: Finish this implementation.
+	bool hasEquipment(const QStringList &, const struct dive *, FilterData::Mode)
+	{
+		return true;
+	}
 }
 
 MultiFilterSortModel *MultiFilterSortModel::instance()
@@ -104,14 +122,35 @@ MultiFilterSortModel *MultiFilterSortModel::instance()
 	return &self;
 }
 
+MultiFilterSortModel::Queries::Queries(const FilterData &data) :
+	tags(makeQueries(data.tags, FULLTEXT_TAGS | FULLTEXT_MODE)),	// the dive mode is shown as a tag
+	people(makeQueries(data.people, FULLTEXT_PEOPLE)),
+	location(makeQueries(data.location, FULLTEXT_LOCATION)),
+	suit(makeQueries(data.suit, FULLTEXT_SUIT)),
+	notes(makeQueries(data.dnotes, FULLTEXT_NOTES))
+{
+}
+
 MultiFilterSortModel::MultiFilterSortModel(QObject *parent) : QSortFilterProxyModel(parent),
-	divesDisplayed(0)
+	divesDisplayed(0),
+	fromTime(fromTimestamp(filterData)),
+	toTime(toTimestamp(filterData))
 {
 	setFilterKeyColumn(-1); // filter all columns
 	setFilterCaseSensitivity(Qt::CaseInsensitive);
 
+	// The full text index has to update the words of changed dives before
+	// the models re-evaluate the filter. Therefore, connect it first.
+	FullText::instance();
 	connect(&diveListNotifier, &DiveListNotifier::divesAdded, this, &MultiFilterSortModel::divesAdded);
 	connect(&diveListNotifier, &DiveListNotifier::divesDeleted, this, &MultiFilterSortModel::divesDeleted);
+	// These are connected before the dive trip model is created, so that the
+	// filter flags are updated when the model signals the changed rows.
+	connect(&diveListNotifier, &DiveListNotifier::divesChanged, this, &MultiFilterSortModel::divesChanged);
+	connect(&diveListNotifier, &DiveListNotifier::divesTimeChanged, this, &MultiFilterSortModel::divesTimeChanged);
+	connect(&diveListNotifier, &DiveListNotifier::divesMovedBetweenTrips, this, &MultiFilterSortModel::divesMovedBetweenTrips);
+	connect(&diveListNotifier, &DiveListNotifier::tripChanged, this, &MultiFilterSortModel::tripChanged);
+	connect(&diveListNotifier, &DiveListNotifier::diveSiteChanged, this, &MultiFilterSortModel::diveSiteChanged);
 }
 
 void MultiFilterSortModel::resetModel(DiveTripModelBase::Layout layout)
@@ -146,36 +185,27 @@ bool MultiFilterSortModel::showDive(const struct dive *d) const
 	    (d->airtemp.mkelvin < (*temp_comp)(filterData.minAirTemp) || d->airtemp.mkelvin > (*temp_comp)(filterData.maxAirTemp)))
 		return false;
 
-	QDateTime t = filterData.fromDate;
-	t.setTime(filterData.fromTime);
-	if (filterData.fromDate.isValid() && filterData.fromTime.isValid() &&
-	    d->when < t.toMSecsSinceEpoch()/1000 + t.offsetFromUtc())
-		return false;
-
-	t = filterData.toDate;
-	t.setTime(filterData.toTime);
-	if (filterData.toDate.isValid() && filterData.toTime.isValid() &&
-	    d->when > t.toMSecsSinceEpoch()/1000 + t.offsetFromUtc())
+	if (d->when < fromTime || d->when > toTime)
 		return false;
 
 	// tags.
-	if (!hasTags(filterData.tags, d, filterData.tagsMode))
+	if (!check(queries.tags, d, filterData.tagsMode))
 		return false;
 
 	// people
-	if (!hasPersons(filterData.people, d, filterData.peopleMode))
+	if (!check(queries.people, d, filterData.peopleMode))
 		return false;
 
 	// Location
-	if (!hasLocations(filterData.location, d, filterData.locationMode))
+	if (!check(queries.location, d, filterData.locationMode))
 		return false;
 
 	// Suit
-	if (!hasSuits(filterData.suit, d, filterData.suitMode))
+	if (!check(queries.suit, d, filterData.suitMode))
 		return false;
 
 	// Notes
-	if (!hasNotes(filterData.dnotes, d, filterData.dnotesMode))
+	if (!check(queries.notes, d, filterData.dnotesMode))
 		return false;
 
 	if (!hasEquipment(filterData.equipment, d, filterData.equipmentMode))
@@ -222,24 +252,33 @@ void MultiFilterSortModel::filterChanged(const QModelIndex &from, const QModelIn
 }
 
 void MultiFilterSortModel::myInvalidate()
+{
+	applyFilter(Recheck::ALL);
+}
+
+// Re-evaluate the filter of the dives that may change their visibility. Instead of
+// invalidating the whole filter, the dive trip model signals the changed rows, so
+// that only these are re-filtered.
+void MultiFilterSortModel::applyFilter(Recheck recheck)
 {
 	int i;
 	struct dive *d;
+	int shown = 0;
+	QSet<dive *> changed;
 
-	divesDisplayed = 0;
-
-	// Apply filter for each dive
 	for_each_dive (i, d) {
-		bool show = showDive(d);
-		filter_dive(d, show);
-		if (show)
-			divesDisplayed++;
+		if ((recheck == Recheck::ALL ||
+		     (recheck == Recheck::SHOWN && !d->hidden_by_filter) ||
+		     (recheck == Recheck::HIDDEN && d->hidden_by_filter)) &&
+		    updateDive(d))
+			changed.insert(d);
+		if (!d->hidden_by_filter)
+			shown++;
 	}
+	// Recount, since loading dives doesn't go through the filter
+	divesDisplayed = shown;
 
-	invalidateFilter();
-
-	// Tell the dive trip model to update the displayed-counts
-	DiveTripModelBase::instance()->filterFinished();
+	DiveTripModelBase::instance()->filterFinished(changed);
 	countsChanged();
 	emit filterFinished();
 
@@ -284,10 +323,39 @@ bool MultiFilterSortModel::lessThan(const QModelIndex &i1, const QModelIndex &i2
 	return DiveTripModelBase::instance()->lessThan(i1, i2);
 }
 
+bool MultiFilterSortModel::narrower(const FilterData &oldData, const Queries &oldQueries, const FilterData &newData, const Queries &newQueries)
+{
+	// Without a valid filter, all dives are shown
+	if (!oldData.validFilter)
+		return true;
+	if (!newData.validFilter)
+		return false;
+
+	return newData.minVisibility >= oldData.minVisibility && newData.maxVisibility <= oldData.maxVisibility &&
+	       newData.minRating >= oldData.minRating && newData.maxRating <= oldData.maxRating &&
+	       newData.minWaterTemp >= oldData.minWaterTemp && newData.maxWaterTemp <= oldData.maxWaterTemp &&
+	       newData.minAirTemp >= oldData.minAirTemp && newData.maxAirTemp <= oldData.maxAirTemp &&
+	       fromTimestamp(newData) >= fromTimestamp(oldData) && toTimestamp(newData) <= toTimestamp(oldData) &&
+	       newData.tagsMode == oldData.tagsMode && narrowerTerms(oldQueries.tags, newQueries.tags, newData.tagsMode) &&
+	       newData.peopleMode == oldData.peopleMode && narrowerTerms(oldQueries.people, newQueries.people, newData.peopleMode) &&
+	       newData.locationMode == oldData.locationMode && narrowerTerms(oldQueries.location, newQueries.location, newData.locationMode) &&
+	       newData.suitMode == oldData.suitMode && narrowerTerms(oldQueries.suit, newQueries.suit, newData.suitMode) &&
+	       newData.dnotesMode == oldData.dnotesMode && narrowerTerms(oldQueries.notes, newQueries.notes, newData.dnotesMode) &&
+	       (oldData.logged || !newData.logged) && (oldData.planned || !newData.planned);
+}
+
 void MultiFilterSortModel::filterDataChanged(const FilterData &data)
 {
+	// When the user narrows the filter, only the shown dives can be hidden,
+	// when the filter is widened, only the hidden dives can be shown.
+	Queries newQueries(data);
+	Recheck recheck = narrower(filterData, queries, data, newQueries) ? Recheck::SHOWN :
+			  narrower(data, newQueries, filterData, queries) ? Recheck::HIDDEN : Recheck::ALL;
 	filterData = data;
-	myInvalidate();
+	queries = std::move(newQueries);
+	fromTime = fromTimestamp(data);
+	toTime = toTimestamp(data);
+	applyFilter(recheck);
 }
 
 void MultiFilterSortModel::divesAdded(dive_trip *, bool, const QVector<dive *> &dives)
@@ -308,6 +376,49 @@ void MultiFilterSortModel::divesDeleted(dive_trip *, bool, const QVector<dive *>
 	countsChanged();
 }
 
+QSet<dive *> MultiFilterSortModel::updateDives(const QVector<dive *> &dives)
+{
+	QSet<dive *> changed;
+	for (dive *d: dives) {
+		if (updateDive(d))
+			changed.insert(d);
+	}
+	if (!changed.isEmpty())
+		countsChanged();
+	return changed;
+}
+
+// The dive trip model signals the rows of changed dives itself.
+// Thus, only the filter flags have to be updated.
+void MultiFilterSortModel::divesChanged(dive_trip *, const QVector<dive *> &dives, DiveField)
+{
+	updateDives(dives);
+}
+
+void MultiFilterSortModel::divesTimeChanged(dive_trip *, timestamp_t, const QVector<dive *> &dives)
+{
+	updateDives(dives);
+}
+
+void MultiFilterSortModel::divesMovedBetweenTrips(dive_trip *, dive_trip *, bool, bool, const QVector<dive *> &dives)
+{
+	updateDives(dives);
+}
+
+// The location of the dives changed, but the dive trip model only updates the trip
+// or site. Tell it which dives changed their visibility.
+void MultiFilterSortModel::tripChanged(dive_trip *trip, TripField field)
+{
+	if (field != TripField::LOCATION)
+		return;
+	DiveTripModelBase::instance()->filterFinished(updateDives(divesOfTable(trip->dives)));
+}
+
+void MultiFilterSortModel::diveSiteChanged(dive_site *ds, int)
+{
+	DiveTripModelBase::instance()->filterFinished(updateDives(divesOfTable(ds->dives)));
+}
+
 void MultiFilterSortModel::countsChanged()
 {
 	updateWindowTitle();
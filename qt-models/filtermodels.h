@@ -3,10 +3,12 @@
 #define FILTERMODELS_H
 
 #include "divetripmodel.h"
+#include "core/fulltext.h"
 
 #include <QStringListModel>
 #include <QSortFilterProxyModel>
 #include <QDateTime>
+#include <QSet>
 
 #include <stdint.h>
 #include <vector>
@@ -74,6 +76,11 @@ slots:
 	void filterDataChanged(const FilterData &data);
 	void divesAdded(struct dive_trip *, bool, const QVector<dive *> &dives);
 	void divesDeleted(struct dive_trip *, bool, const QVector<dive *> &dives);
+	void divesChanged(struct dive_trip *, const QVector<dive *> &dives, DiveField);
+	void divesTimeChanged(struct dive_trip *, timestamp_t, const QVector<dive *> &dives);
+	void divesMovedBetweenTrips(struct dive_trip *, struct dive_trip *, bool, bool, const QVector<dive *> &dives);
+	void tripChanged(struct dive_trip *trip, TripField field);
+	void diveSiteChanged(struct dive_site *ds, int field);
 
 signals:
 	void filterFinished();
@@ -84,6 +91,29 @@ private:
 	QVector<dive_site *> dive_sites;
 	void countsChanged();
 	FilterData filterData;
+	timestamp_t fromTime, toTime;	// The date range of filterData
+	// The text filters of filterData, looked up in the full text index
+	struct Queries {
+		std::vector<FullTextQuery> tags;
+		std::vector<FullTextQuery> people;
+		std::vector<FullTextQuery> location;
+		std::vector<FullTextQuery> suit;
+		std::vector<FullTextQuery> notes;
+		Queries() = default;
+		Queries(const FilterData &data);
+	};
+	Queries queries;
+	// True if the new filter shows no dive that the old filter hides
+	static bool narrower(const FilterData &oldData, const Queries &oldQueries, const FilterData &newData, const Queries &newQueries);
+
+	// When the filter changes, only the dives that may change their visibility are re-checked
+	enum class Recheck {
+		ALL,
+		SHOWN,	// the filter was narrowed
+		HIDDEN	// the filter was widened
+	};
+	void applyFilter(Recheck recheck);
+	QSet<dive *> updateDives(const QVector<dive *> &dives); // returns the dives that changed visibility
 };
 
 #endif
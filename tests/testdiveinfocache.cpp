@@ -0,0 +1,95 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "testdiveinfocache.h"
+#include "core/diveinfocache.h"
+#include "core/dive.h"
+#include "core/divesite.h"
+#include "core/divelist.h"
+#include "core/statistics.h"
+#include "core/subsurface-string.h"
+#include "core/subsurface-qt/DiveListNotifier.h"
+
+void TestDiveInfoCache::cleanup()
+{
+	clear_dive_file_data();
+}
+
+static struct dive *addDive()
+{
+	struct dive *d = alloc_dive();
+	d->weightsystem[0].weight.grams = 4000;
+	d->weightsystem[1].weight.grams = 2000;
+	d->cylinder[0].type.size.mliter = 12000;
+	d->cylinder[0].type.workingpressure.mbar = 232000;
+	d->cylinder[0].start.mbar = 200000;
+	d->cylinder[0].end.mbar = 50000;
+	taglist_add_tag(&d->tag_list, "boat");
+	taglist_add_tag(&d->tag_list, "wreck");
+	append_dive(d);
+	return d;
+}
+
+void TestDiveInfoCache::testValues()
+{
+	struct dive *d = addDive();
+	DiveInfoCache *cache = DiveInfoCache::instance();
+
+	QCOMPARE(cache->totalWeight(d), 6000);
+	QCOMPARE(cache->tags(d), QString("boat, wreck"));
+	QVERIFY(cache->location(d).isNull());
+
+	char *gas_string = get_dive_gas_string(d);
+	QCOMPARE(cache->gasString(d), QString(gas_string));
+	free(gas_string);
+
+	volume_t gases[MAX_CYLINDERS] = {};
+	get_gas_used(d, gases);
+	QVERIFY(gases[0].mliter > 0);
+	for (int i = 0; i < MAX_CYLINDERS; i++)
+		QCOMPARE(cache->gasUsed(d, i).mliter, gases[i].mliter);
+}
+
+void TestDiveInfoCache::testInvalidation()
+{
+	struct dive *d = addDive();
+	DiveInfoCache *cache = DiveInfoCache::instance();
+	QVector<dive *> dives { d };
+	QCOMPARE(cache->totalWeight(d), 6000);
+
+	// The values are kept until the dive is signaled as changed
+	d->weightsystem[1].weight.grams = 0;
+	QCOMPARE(cache->totalWeight(d), 6000);
+	emit diveListNotifier.weightsystemsReset(nullptr, dives);
+	QCOMPARE(cache->totalWeight(d), 4000);
+
+	d->cylinder[0].end.mbar = 200000;
+	QVERIFY(cache->gasUsed(d, 0).mliter > 0);
+	emit diveListNotifier.cylindersReset(nullptr, dives);
+	QCOMPARE(cache->gasUsed(d, 0).mliter, 0);
+
+	taglist_add_tag(&d->tag_list, "night");
+	emit diveListNotifier.divesChanged(nullptr, dives, DiveField::TAGS);
+	QCOMPARE(cache->tags(d), QString("boat, night, wreck"));
+
+	// Unsignaled changes are registered explicitly
+	d->weightsystem[0].weight.grams = 3000;
+	diveinfo_invalidate(d);
+	QCOMPARE(cache->totalWeight(d), 3000);
+}
+
+void TestDiveInfoCache::testDiveSite()
+{
+	struct dive *d = addDive();
+	DiveInfoCache *cache = DiveInfoCache::instance();
+	struct dive_site *ds = create_dive_site("Blue Hole", &dive_site_table);
+	add_dive_to_dive_site(d, ds);
+	QVector<dive *> dives { d };
+	emit diveListNotifier.divesChanged(nullptr, dives, DiveField::DIVESITE);
+	QCOMPARE(cache->location(d), QString("Blue Hole"));
+
+	free(ds->name);
+	ds->name = copy_string("Green Hole");
+	emit diveListNotifier.diveSiteChanged(ds, 0);
+	QCOMPARE(cache->location(d), QString("Green Hole"));
+}
+
+QTEST_GUILESS_MAIN(TestDiveInfoCache)
@@ -0,0 +1,17 @@
+// SPDX-License-Identifier: GPL-2.0
+#ifndef TESTDIVEINFOCACHE_H
+#define TESTDIVEINFOCACHE_H
+
+#include <QTest>
+
+class TestDiveInfoCache : public QObject {
+	Q_OBJECT
+private slots:
+	void cleanup();
+
+	void testValues();
+	void testInvalidation();
+	void testDiveSite();
+};
+
+#endif // TESTDIVEINFOCACHE_H
@@ -0,0 +1,258 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "testfilter.h"
+#include "qt-models/filtermodels.h"
+#include "core/dive.h"
+#include "core/divelist.h"
+#include "core/subsurface-string.h"
+
+Q_DECLARE_METATYPE(FilterData::Mode)
+
+static timestamp_t timestamp(int year, int month, int day)
+{
+	return QDateTime(QDate(year, month, day), QTime(12, 0), Qt::UTC).toMSecsSinceEpoch() / 1000;
+}
+
+static struct dive *addDive(const char *tags, const char *buddy, timestamp_t when, double watertemp, double airtemp, bool planned)
+{
+	struct dive *d = alloc_dive();
+	for (const QString &tag: QString(tags).split(',', QString::SkipEmptyParts))
+		taglist_add_tag(&d->tag_list, qPrintable(tag));
+	d->buddy = copy_string(buddy);
+	d->when = when;
+	d->watertemp.mkelvin = watertemp ? C_to_mkelvin(watertemp) : 0;
+	d->airtemp.mkelvin = airtemp ? C_to_mkelvin(airtemp) : 0;
+	if (planned)
+		d->dc.model = copy_string("planned dive");
+	append_dive(d);
+	return d;
+}
+
+void TestFilter::init()
+{
+	prefs.units.temperature = units::CELSIUS;
+	addDive("boat,wreck", "Jane Doe", timestamp(2019, 6, 1), 20.0, 25.0, false);
+	addDive("shore", "John Smith", timestamp(2019, 8, 1), 10.0, 0.0, true);
+	addDive("boat,cave", "John Doe", timestamp(2018, 3, 1), 0.0, 30.0, false);
+	addDive("", "Jack", timestamp(2020, 1, 1), 25.0, 5.0, false);
+	addDive("shore,night", "", timestamp(2019, 6, 2), 15.0, 12.0, true);
+	MultiFilterSortModel::instance()->myInvalidate();
+}
+
+void TestFilter::cleanup()
+{
+	MultiFilterSortModel::instance()->filterDataChanged(FilterData());
+	clear_dive_file_data();
+}
+
+// Set the filter and compare the visibility of the dives to a full
+// re-evaluation of the filter, independent of the dives that were re-checked.
+static void checkFilter(const FilterData &data)
+{
+	MultiFilterSortModel *model = MultiFilterSortModel::instance();
+	model->filterDataChanged(data);
+
+	int i, shown = 0;
+	struct dive *d;
+	for_each_dive (i, d) {
+		QVERIFY2(d->hidden_by_filter == !model->showDive(d), qPrintable(QString("dive %1").arg(i)));
+		if (!d->hidden_by_filter)
+			++shown;
+	}
+	QCOMPARE(model->divesDisplayed, shown);
+}
+
+static FilterData filter()
+{
+	FilterData data;
+	data.validFilter = true;
+	data.toDate = QDateTime(QDate(2030, 1, 1));
+	return data;
+}
+
+void TestFilter::testTerms_data()
+{
+	QTest::addColumn<FilterData::Mode>("mode");
+	QTest::newRow("all of") << FilterData::Mode::ALL_OF;
+	QTest::newRow("any of") << FilterData::Mode::ANY_OF;
+	QTest::newRow("none of") << FilterData::Mode::NONE_OF;
+}
+
+void TestFilter::testTerms()
+{
+	QFETCH(FilterData::Mode, mode);
+
+	// Narrow and widen the terms step by step and jump between unrelated terms
+	const QList<QStringList> tagTerms {
+		{}, { "b" }, { "bo" }, { "boat" }, { "boat", "wr" }, { "boat", "wreck" }, { "boat" },
+		{ "boat", "shore" }, { "shore" }, { "sh", "ca" }, { "c" }, { "nothing" }, { "shore night" },
+		{ "shore" }, {}
+	};
+	FilterData data = filter();
+	data.tagsMode = mode;
+	for (const QStringList &terms: tagTerms) {
+		data.tags = terms;
+		checkFilter(data);
+	}
+
+	const QList<QStringList> peopleTerms {
+		{ "j" }, { "john" }, { "john doe" }, { "doe" }, { "doe", "smith" }, { "jane", "smith" },
+		{ "j" }, {}
+	};
+	data = filter();
+	data.peopleMode = mode;
+	for (const QStringList &terms: peopleTerms) {
+		data.people = terms;
+		checkFilter(data);
+	}
+}
+
+void TestFilter::testEmptyTerms()
+{
+	// Terms without any words don't restrict the dives in any mode
+	FilterData data = filter();
+	data.tags = QStringList({ "-", " , " });
+	for (FilterData::Mode mode: { FilterData::Mode::ALL_OF, FilterData::Mode::ANY_OF, FilterData::Mode::NONE_OF }) {
+		data.tagsMode = mode;
+		checkFilter(data);
+		QCOMPARE(MultiFilterSortModel::instance()->divesDisplayed, dive_table.nr);
+	}
+
+	// and are ignored next to other terms
+	data.tags = QStringList({ "-", "boat" });
+	data.tagsMode = FilterData::Mode::NONE_OF;
+	checkFilter(data);
+	QCOMPARE(MultiFilterSortModel::instance()->divesDisplayed, 3);
+	data.tagsMode = FilterData::Mode::ANY_OF;
+	checkFilter(data);
+	QCOMPARE(MultiFilterSortModel::instance()->divesDisplayed, 2);
+}
+
+void TestFilter::testModes()
+{
+	// Changing the mode with the same terms
+	FilterData data = filter();
+	data.tags = QStringList({ "boat", "shore" });
+	for (FilterData::Mode mode: { FilterData::Mode::ALL_OF, FilterData::Mode::ANY_OF, FilterData::Mode::NONE_OF,
+				      FilterData::Mode::ALL_OF, FilterData::Mode::NONE_OF, FilterData::Mode::ANY_OF }) {
+		data.tagsMode = mode;
+		checkFilter(data);
+	}
+
+	// Switching the filter on and off
+	data.validFilter = false;
+	checkFilter(data);
+	data.validFilter = true;
+	checkFilter(data);
+}
+
+void TestFilter::testDates()
+{
+	FilterData data = filter();
+	checkFilter(data);
+
+	// Narrow the range from both sides, then widen it again
+	const QList<QPair<QDate, QDate>> ranges {
+		{ QDate(2018, 1, 1), QDate(2021, 1, 1) }, { QDate(2019, 1, 1), QDate(2021, 1, 1) },
+		{ QDate(2019, 1, 1), QDate(2019, 12, 31) }, { QDate(2019, 6, 1), QDate(2019, 6, 1) },
+		{ QDate(2019, 6, 2), QDate(2019, 7, 1) }, { QDate(2019, 1, 1), QDate(2019, 12, 31) },
+		{ QDate(2015, 1, 1), QDate(2019, 1, 1) }, { QDate(2020, 1, 1), QDate(2030, 1, 1) },
+		{ QDate(1980, 1, 1), QDate(2030, 1, 1) }
+	};
+	for (const auto &range: ranges) {
+		data.fromDate = QDateTime(range.first);
+		data.toDate = QDateTime(range.second);
+		checkFilter(data);
+	}
+
+	// The times of day
+	data.fromDate = data.toDate = QDateTime(QDate(2019, 6, 1));
+	data.fromTime = QTime(0, 0);
+	data.toTime = QTime(23, 59);
+	checkFilter(data);
+	data.toTime = QTime(11, 0);
+	checkFilter(data);
+	data.toTime = QTime(13, 0);
+	checkFilter(data);
+	data.fromTime = QTime(12, 30);
+	checkFilter(data);
+}
+
+void TestFilter::testTemperatures()
+{
+	FilterData data = filter();
+	const QList<QPair<double, double>> waterTemps {
+		{ -10, 200 }, { 5, 200 }, { 12, 200 }, { 12, 22 }, { 16, 22 }, { 16, 30 }, { 0, 18 }, { -10, 200 }
+	};
+	for (const auto &temps: waterTemps) {
+		data.minWaterTemp = temps.first;
+		data.maxWaterTemp = temps.second;
+		checkFilter(data);
+	}
+
+	const QList<QPair<double, double>> airTemps {
+		{ -50, 200 }, { 10, 200 }, { 10, 27 }, { 20, 27 }, { 20, 40 }, { -50, 20 }, { -50, 200 }
+	};
+	for (const auto &temps: airTemps) {
+		data.minAirTemp = temps.first;
+		data.maxAirTemp = temps.second;
+		checkFilter(data);
+	}
+}
+
+void TestFilter::testPlanned()
+{
+	FilterData data = filter();
+	const QList<QPair<bool, bool>> states {
+		{ true, true }, { true, false }, { false, false }, { false, true }, { true, true }, { false, true }, { true, false }
+	};
+	for (const auto &state: states) {
+		data.logged = state.first;
+		data.planned = state.second;
+		checkFilter(data);
+	}
+}
+
+// A narrowed filter only re-checks the shown dives, a widened filter only the hidden
+// ones. To see which dives were re-checked, mark a dive inconsistently beforehand.
+void TestFilter::testRecheck()
+{
+	MultiFilterSortModel *model = MultiFilterSortModel::instance();
+	FilterData data = filter();
+	data.tags = QStringList({ "bo" });
+	checkFilter(data);
+
+	struct dive *boat = get_dive(0);
+	struct dive *shore = get_dive(1);
+	QVERIFY(!boat->hidden_by_filter);
+	QVERIFY(shore->hidden_by_filter);
+
+	// Narrowing doesn't re-check the hidden dives
+	filter_dive(boat, false);
+	--model->divesDisplayed;
+	data.tags = QStringList({ "boat" });
+	model->filterDataChanged(data);
+	QVERIFY(boat->hidden_by_filter);
+	filter_dive(boat, true);
+	++model->divesDisplayed;
+	checkFilter(data);
+
+	// Widening doesn't re-check the shown dives
+	filter_dive(shore, true);
+	++model->divesDisplayed;
+	data.tags = QStringList({ "b" });
+	model->filterDataChanged(data);
+	QVERIFY(!shore->hidden_by_filter);
+	filter_dive(shore, false);
+	--model->divesDisplayed;
+	checkFilter(data);
+
+	// Other changes re-check all dives
+	filter_dive(boat, false);
+	--model->divesDisplayed;
+	data.tags = QStringList();
+	data.people = QStringList({ "jane" });
+	checkFilter(data);
+	QVERIFY(!boat->hidden_by_filter);
+}
+
+QTEST_GUILESS_MAIN(TestFilter)
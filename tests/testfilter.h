@@ -0,0 +1,23 @@
+// SPDX-License-Identifier: GPL-2.0
+#ifndef TESTFILTER_H
+#define TESTFILTER_H
+
+#include <QTest>
+
+class TestFilter : public QObject {
+	Q_OBJECT
+private slots:
+	void init();
+	void cleanup();
+
+	void testTerms_data();
+	void testTerms();
+	void testEmptyTerms();
+	void testModes();
+	void testDates();
+	void testTemperatures();
+	void testPlanned();
+	void testRecheck();
+};
+
+#endif // TESTFILTER_H
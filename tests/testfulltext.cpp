@@ -0,0 +1,144 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "testfulltext.h"
+#include "core/fulltext.h"
+#include "core/dive.h"
+#include "core/divesite.h"
+#include "core/divelist.h"
+#include "core/file.h"
+#include "core/subsurface-string.h"
+#include "core/subsurface-qt/DiveListNotifier.h"
+
+void TestFullText::cleanup()
+{
+	clear_dive_file_data();
+}
+
+static struct dive *addDive(const char *buddy, const char *notes, const char *suit)
+{
+	struct dive *d = alloc_dive();
+	d->buddy = copy_string(buddy);
+	d->notes = copy_string(notes);
+	d->suit = copy_string(suit);
+	append_dive(d);
+	return d;
+}
+
+void TestFullText::testSplitIntoWords()
+{
+	QCOMPARE(FullText::splitIntoWords("Hello, World! 5mm"), QStringList({ "hello", "world", "5mm" }));
+	QCOMPARE(FullText::splitIntoWords("Jane-Doe"), QStringList({ "jane", "doe" }));
+	QCOMPARE(FullText::splitIntoWords(" ,; "), QStringList());
+	QCOMPARE(FullText::splitIntoWords(QString()), QStringList());
+}
+
+void TestFullText::testQuery()
+{
+	struct dive *d1 = addDive("Jane Doe, John Smith", "Saw a turtle", "Drysuit");
+	struct dive *d2 = addDive("John Doe", "Turtles everywhere", "Wetsuit 5mm");
+
+	QVERIFY(FullTextQuery("john").matches(d1));
+	QVERIFY(FullTextQuery("john").matches(d2));
+	QVERIFY(FullTextQuery("TURTLE").matches(d1));
+	QVERIFY(FullTextQuery("turtle").matches(d2));
+	QVERIFY(!FullTextQuery("turtles").matches(d1));
+
+	// All words have to match, in any order
+	QVERIFY(FullTextQuery("doe ja").matches(d1));
+	QVERIFY(!FullTextQuery("doe ja").matches(d2));
+
+	// Words are matched by prefix
+	QVERIFY(FullTextQuery("dry").matches(d1));
+	QVERIFY(!FullTextQuery("suit").matches(d1));
+
+	// Only the given fields are searched
+	QVERIFY(FullTextQuery("dry", FULLTEXT_SUIT).matches(d1));
+	QVERIFY(!FullTextQuery("dry", FULLTEXT_NOTES).matches(d1));
+	QVERIFY(FullTextQuery("smith", FULLTEXT_PEOPLE).matches(d1));
+	QVERIFY(!FullTextQuery("smith", FULLTEXT_ALL & ~FULLTEXT_PEOPLE).matches(d1));
+
+	// The dive mode is a field of its own
+	d1->dc.divemode = CCR;
+	fulltext_register(d1);
+	QVERIFY(FullTextQuery("ccr", FULLTEXT_MODE).matches(d1));
+	QVERIFY(!FullTextQuery("ccr", FULLTEXT_ALL & ~FULLTEXT_MODE).matches(d1));
+
+	// Empty queries match everything
+	QVERIFY(FullTextQuery().isEmpty());
+	QVERIFY(FullTextQuery(" , ").matches(d1));
+
+	// Dives that are not in the dive list are searched directly
+	struct dive *d3 = alloc_dive();
+	d3->notes = copy_string("A turtle");
+	QVERIFY(FullTextQuery("turt").matches(d3));
+	QVERIFY(!FullTextQuery("john").matches(d3));
+	free_dive(d3);
+}
+
+void TestFullText::testUpdates()
+{
+	struct dive *d = addDive("Jane", "", "");
+	FullTextQuery query("bob", FULLTEXT_PEOPLE);
+	QVERIFY(!query.matches(d));
+
+	free(d->buddy);
+	d->buddy = copy_string("Bob");
+	QVector<dive *> dives { d };
+	emit diveListNotifier.divesChanged(nullptr, dives, DiveField::BUDDY);
+	QVERIFY(query.matches(d));
+	QVERIFY(!FullTextQuery("jane").matches(d));
+
+	// Removing the last dive removes all words
+	QVERIFY(FullText::instance()->wordCount() > 0);
+	delete_single_dive(get_divenr(d));
+	QCOMPARE(FullText::instance()->wordCount(), 0);
+}
+
+void TestFullText::testImplies()
+{
+	QVERIFY(FullTextQuery("john").implies(FullTextQuery("jo")));
+	QVERIFY(!FullTextQuery("jo").implies(FullTextQuery("john")));
+	QVERIFY(FullTextQuery("john doe").implies(FullTextQuery("doe")));
+	QVERIFY(!FullTextQuery("doe").implies(FullTextQuery("john doe")));
+	QVERIFY(FullTextQuery("doe", FULLTEXT_PEOPLE).implies(FullTextQuery("doe")));
+	QVERIFY(!FullTextQuery("doe").implies(FullTextQuery("doe", FULLTEXT_PEOPLE)));
+
+	// Empty queries match all dives
+	QVERIFY(FullTextQuery("john").implies(FullTextQuery()));
+	QVERIFY(!FullTextQuery().implies(FullTextQuery("john")));
+}
+
+static bool containsPrefix(const QString &s, const QString &word)
+{
+	for (const QString &w: FullText::splitIntoWords(s)) {
+		if (w.startsWith(word))
+			return true;
+	}
+	return false;
+}
+
+// Compare the index to a search of every dive
+void TestFullText::testLoadedDives()
+{
+	QCOMPARE(parse_file(SUBSURFACE_TEST_DATA "/dives/SampleDivesV2.ssrf", &dive_table, &trip_table, &dive_site_table), 0);
+	process_loaded_dives();
+	QVERIFY(dive_table.nr > 2);
+
+	int i, found = 0;
+	struct dive *d;
+	for (const char *word: { "a", "b", "d", "m", "s", "the", "dive", "test" }) {
+		FullTextQuery query(word, FULLTEXT_NOTES | FULLTEXT_PEOPLE | FULLTEXT_SUIT | FULLTEXT_LOCATION);
+		for_each_dive (i, d) {
+			bool expected = containsPrefix(d->notes, word) ||
+					containsPrefix(d->buddy, word) ||
+					containsPrefix(d->divemaster, word) ||
+					containsPrefix(d->suit, word) ||
+					(d->dive_site && containsPrefix(d->dive_site->name, word)) ||
+					(d->divetrip && containsPrefix(d->divetrip->location, word));
+			QCOMPARE(query.matches(d), expected);
+			found += expected;
+		}
+	}
+	QVERIFY(found > 0);
+}
+
+QTEST_GUILESS_MAIN(TestFullText)
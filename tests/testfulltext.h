@@ -0,0 +1,19 @@
+// SPDX-License-Identifier: GPL-2.0
+#ifndef TESTFULLTEXT_H
+#define TESTFULLTEXT_H
+
+#include <QTest>
+
+class TestFullText : public QObject {
+	Q_OBJECT
+private slots:
+	void cleanup();
+
+	void testSplitIntoWords();
+	void testQuery();
+	void testUpdates();
+	void testImplies();
+	void testLoadedDives();
+};
+
+#endif // TESTFULLTEXT_H
@@ -0,0 +1,304 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "testlookup.h"
+#include "core/divesite.h"
+#include "core/divelist.h"
+#include "core/file.h"
+#include "core/subsurface-string.h"
+#include <QSet>
+
+void TestLookup::cleanup()
+{
+	clear_dive_file_data();
+}
+
+static void checkDiveIds()
+{
+	int i;
+	struct dive *d;
+	for_each_dive (i, d) {
+		QCOMPARE(get_dive_by_uniq_id(d->id), d);
+		QCOMPARE(get_idx_by_uniq_id(d->id), i);
+	}
+}
+
+void TestLookup::testDiveIds()
+{
+	QCOMPARE(parse_file(SUBSURFACE_TEST_DATA "/dives/SampleDivesV2.ssrf", &dive_table, &trip_table, &dive_site_table), 0);
+	process_loaded_dives();
+	QVERIFY(dive_table.nr > 2);
+	checkDiveIds();
+
+	// removing the first dive moves all the others
+	struct dive *d = unregister_dive(0);
+	QVERIFY(get_dive_by_uniq_id(d->id) == NULL);
+	QCOMPARE(get_idx_by_uniq_id(d->id), dive_table.nr);
+	checkDiveIds();
+
+	// and so does adding it again
+	add_to_dive_table(&dive_table, 0, d);
+	checkDiveIds();
+
+	struct dive *d2 = unregister_dive(dive_table.nr - 1);
+	add_to_dive_table(&dive_table, 1, d2);
+	checkDiveIds();
+
+	// the index follows the dives added and deleted by the undo commands
+	d = unregister_dive(1);
+	QVERIFY(get_dive_by_uniq_id(d->id) == NULL);
+	add_single_dive(dive_table_get_insertion_index(&dive_table, d), d);
+	checkDiveIds();
+	int id = get_dive(0)->id;
+	delete_single_dive(0);
+	QVERIFY(get_dive_by_uniq_id(id) == NULL);
+	checkDiveIds();
+}
+
+static timestamp_t timeFromDive(const struct dive *d, timestamp_t when)
+{
+	if (when < d->when)
+		return d->when - when;
+	return when > dive_endtime(d) ? when - dive_endtime(d) : 0;
+}
+
+static bool isSelected(const struct dive *d)
+{
+	return d->selected;
+}
+
+static void checkDiveTimes(int seed)
+{
+	qsrand(seed);
+	for (int n = 0; n < 500; n++) {
+		timestamp_t when = 990000 + qrand() % 520000;
+		timestamp_t range = qrand() % 20000;
+		int i;
+		struct dive *d, *including = NULL, *nearest = NULL;
+		QList<int> overlapping, found;
+		for_each_dive (i, d) {
+			if (!including && d->when <= when && when <= dive_endtime(d))
+				including = d;
+			if (d->when <= when + range && dive_endtime(d) >= when)
+				overlapping.append(i);
+			if (d->selected && (!nearest || timeFromDive(d, when) < timeFromDive(nearest, when)))
+				nearest = d;
+		}
+		QCOMPARE(find_dive_including(when), including);
+		for_each_dive_overlapping (i, when, when + range)
+			found.append(i);
+		QCOMPARE(found, overlapping);
+		QCOMPARE(find_nearest_dive(when, &isSelected), nearest);
+	}
+	int i;
+	struct dive *d;
+	for_each_dive (i, d)
+		QCOMPARE(get_divenr(d), i);
+}
+
+void TestLookup::testDiveTimes()
+{
+	qsrand(7);
+	for (int i = 0; i < 1000; i++) {
+		struct dive *d = alloc_dive();
+		d->id = i + 1;
+		d->when = 1000000 + qrand() % 500000;
+		// mostly short dives, some of them overlapping
+		d->dc.duration.seconds = qrand() % (i % 10 ? 3000 : 30000);
+		d->selected = qrand() % 5 == 0;
+		append_dive(d);
+	}
+	process_loaded_dives();
+	checkDiveTimes(1);
+
+	// moving dives around
+	for (int i = 0; i < 100; i++) {
+		struct dive *d = get_dive(qrand() % dive_table.nr);
+		d->when += qrand() % 100000 - 50000;
+		invalidate_dive_cache(d);
+	}
+	sort_dive_table(&dive_table);
+	checkDiveTimes(2);
+
+	// and removing them
+	while (dive_table.nr > 500)
+		delete_single_dive(qrand() % dive_table.nr);
+	checkDiveTimes(3);
+	QCOMPARE(find_dive_including(0), (struct dive *)NULL);
+	QCOMPARE(find_nearest_dive(0, NULL), get_dive(0));
+}
+
+static struct dive_site *firstSiteByName(const char *name, struct dive_site_table *table)
+{
+	int i;
+	struct dive_site *ds;
+	for_each_dive_site (i, ds, table) {
+		if (same_string(ds->name, name))
+			return ds;
+	}
+	return NULL;
+}
+
+static void checkSiteNames(struct dive_site_table *table)
+{
+	int i;
+	struct dive_site *ds;
+	for_each_dive_site (i, ds, table)
+		QCOMPARE(get_dive_site_by_name(ds->name, table), firstSiteByName(ds->name, table));
+}
+
+void TestLookup::testDiveSiteUuids()
+{
+	struct dive_site_table table = { 0 };
+	int i;
+	struct dive_site *ds;
+
+	for (i = 0; i < 100; i++)
+		create_dive_site(qPrintable(QString("Site %1").arg(i)), &table);
+	// an explicit uuid that is already taken gets bumped
+	ds = alloc_or_get_dive_site(0, &table);
+	QCOMPARE(get_dive_site_by_uuid(ds->uuid, &table), ds);
+	uint32_t uuid = table.dive_sites[0]->uuid;
+	QCOMPARE(alloc_or_get_dive_site(uuid, &table), table.dive_sites[0]);
+	QCOMPARE(table.nr, 101);
+
+	for_each_dive_site (i, ds, &table) {
+		QCOMPARE(get_dive_site_by_uuid(ds->uuid, &table), ds);
+		QCOMPARE(get_divesite_idx(ds, &table), i);
+	}
+
+	ds = table.dive_sites[50];
+	uuid = ds->uuid;
+	delete_dive_site(ds, &table);
+	QVERIFY(get_dive_site_by_uuid(uuid, &table) == NULL);
+	for_each_dive_site (i, ds, &table)
+		QCOMPARE(get_divesite_idx(ds, &table), i);
+
+	// a site that is not in the table
+	struct dive_site *other = create_dive_site("Elsewhere", &dive_site_table);
+	QCOMPARE(get_divesite_idx(other, &table), -1);
+	QCOMPARE(get_divesite_idx(NULL, &table), -1);
+
+	clear_dive_site_table(&table);
+}
+
+void TestLookup::testDiveSiteNames()
+{
+	struct dive_site_table table = { 0 };
+	int i;
+
+	for (i = 0; i < 100; i++)
+		create_dive_site(qPrintable(QString("Site %1").arg(i % 30)), &table);
+	create_dive_site(NULL, &table);
+	checkSiteNames(&table);
+	QVERIFY(get_dive_site_by_name("Nowhere", &table) == NULL);
+
+	// sites added later are found, even if they come first in the table
+	struct dive_site *ds = create_dive_site("Site 3", &table);
+	checkSiteNames(&table);
+	ds = create_dive_site("Nowhere", &table);
+	QCOMPARE(get_dive_site_by_name("Nowhere", &table), ds);
+
+	// renaming sites
+	set_dive_site_name(ds, "Somewhere");
+	QVERIFY(get_dive_site_by_name("Nowhere", &table) == NULL);
+	QCOMPARE(get_dive_site_by_name("Somewhere", &table), ds);
+	ds = firstSiteByName("Site 7", &table);
+	set_dive_site_name(ds, "Site 99");
+	checkSiteNames(&table);
+	set_dive_site_name(ds, "Site 7");
+	checkSiteNames(&table);
+
+	// looking up names in another table
+	struct dive_site *other = create_dive_site("Site 8", &dive_site_table);
+	QCOMPARE(get_dive_site_by_name("Site 8", &dive_site_table), other);
+	checkSiteNames(&table);
+
+	// deleting sites
+	while (table.nr > 50) {
+		delete_dive_site(table.dive_sites[table.nr / 2], &table);
+		checkSiteNames(&table);
+	}
+
+	clear_dive_site_table(&table);
+}
+
+static struct dive_site *closestSite(const location_t *loc, int distance, struct dive_site_table *table)
+{
+	int i;
+	struct dive_site *ds, *res = NULL;
+	unsigned int min_distance = distance;
+	for_each_dive_site (i, ds, table) {
+		unsigned int d;
+		if (dive_site_has_gps_location(ds) && (d = get_distance(&ds->location, loc)) < min_distance) {
+			min_distance = d;
+			res = ds;
+		}
+	}
+	return res;
+}
+
+static void addSite(struct dive_site *ds, void *data)
+{
+	static_cast<QSet<struct dive_site *> *>(data)->insert(ds);
+}
+
+static void checkLocations(struct dive_site_table *table, int seed)
+{
+	qsrand(seed);
+	for (int i = 0; i < 200; i++) {
+		// close to the sites, which are around the 180th meridian
+		location_t loc = create_location(qrand() % 2000 / 1000.0 - 1.0, 179.0 + qrand() % 2000 / 1000.0);
+		if (loc.lon.udeg > 180000000)
+			loc.lon.udeg -= 360000000;
+		int distance = qrand() % 3000;
+		QCOMPARE(get_dive_site_by_gps_proximity(&loc, distance, table), closestSite(&loc, distance, table));
+	}
+
+	location_t sw = create_location(-0.5, 179.5);
+	location_t ne = create_location(0.5, -179.5);
+	QSet<struct dive_site *> found, expected;
+	for_each_dive_site_in_rectangle(&sw, &ne, table, addSite, &found);
+	int i;
+	struct dive_site *ds;
+	for_each_dive_site (i, ds, table) {
+		if (dive_site_has_gps_location(ds) &&
+		    ds->location.lat.udeg >= sw.lat.udeg && ds->location.lat.udeg <= ne.lat.udeg &&
+		    (ds->location.lon.udeg >= sw.lon.udeg || ds->location.lon.udeg <= ne.lon.udeg))
+			expected.insert(ds);
+	}
+	QVERIFY(!expected.isEmpty());
+	QCOMPARE(found, expected);
+}
+
+void TestLookup::testDiveSiteLocations()
+{
+	struct dive_site_table table = { 0 };
+	int i;
+
+	qsrand(42);
+	for (i = 0; i < 500; i++) {
+		double lon = 179.0 + qrand() % 2000 / 1000.0;
+		location_t loc = create_location(qrand() % 2000 / 1000.0 - 1.0, lon > 180.0 ? lon - 360.0 : lon);
+		create_dive_site_with_gps(qPrintable(QString("Site %1").arg(i)), &loc, &table);
+	}
+	create_dive_site("No location", &table);
+	checkLocations(&table, 1);
+
+	// sites at the same location
+	struct dive_site *ds = table.dive_sites[10];
+	struct dive_site *ds2 = create_dive_site_with_gps("Same place", &ds->location, &table);
+	QCOMPARE(get_dive_site_by_gps(&ds->location, &table), ds->uuid < ds2->uuid ? ds : ds2);
+	QCOMPARE(get_dive_site_by_gps_and_name(ds2->name, &ds->location, &table), ds2);
+	checkLocations(&table, 2);
+
+	// moving and deleting sites
+	for (i = 0; i < 50; i++) {
+		location_t loc = create_location(qrand() % 2000 / 1000.0 - 1.0, 179.5);
+		set_dive_site_location(table.dive_sites[i * 5], &loc);
+		delete_dive_site(table.dive_sites[i * 7], &table);
+	}
+	checkLocations(&table, 3);
+
+	clear_dive_site_table(&table);
+}
+
+QTEST_GUILESS_MAIN(TestLookup)
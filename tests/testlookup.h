@@ -0,0 +1,19 @@
+// SPDX-License-Identifier: GPL-2.0
+#ifndef TESTLOOKUP_H
+#define TESTLOOKUP_H
+
+#include <QTest>
+
+class TestLookup : public QObject {
+	Q_OBJECT
+private slots:
+	void cleanup();
+
+	void testDiveIds();
+	void testDiveTimes();
+	void testDiveSiteUuids();
+	void testDiveSiteNames();
+	void testDiveSiteLocations();
+};
+
+#endif // TESTLOOKUP_H
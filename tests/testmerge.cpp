@@ -4,6 +4,7 @@
 #include "core/divelist.h"
 #include "core/file.h"
 #include <QTextStream>
+#include <algorithm>
 
 void TestMerge::initTestCase()
 {
@@ -68,4 +69,30 @@ void TestMerge::testMergeBackwards()
 	}
 }
 
+void TestMerge::testMergeTwice()
+{
+	/*
+	 * importing a log a second time merges every dive with its copy,
+	 * which replaces all dives of the dive list
+	 */
+	struct dive_table table = { 0 };
+	struct trip_table trips = { 0 };
+	struct dive_site_table sites = { 0 };
+	QCOMPARE(parse_file(SUBSURFACE_TEST_DATA "/dives/SampleDivesV2.ssrf", &table, &trips, &sites), 0);
+	add_imported_dives(&table, &trips, &sites, IMPORT_MERGE_ALL_TRIPS);
+	int nr = dive_table.nr;
+	QCOMPARE(parse_file(SUBSURFACE_TEST_DATA "/dives/SampleDivesV2.ssrf", &table, &trips, &sites), 0);
+	add_imported_dives(&table, &trips, &sites, IMPORT_MERGE_ALL_TRIPS);
+	QCOMPARE(dive_table.nr, nr);
+	for (int i = 1; i < dive_table.nr; i++)
+		QVERIFY(dive_less_than(dive_table.dives[i - 1], dive_table.dives[i]));
+	for (int i = 0; i < dive_table.nr; i++) {
+		struct dive *d = dive_table.dives[i];
+		if (d->divetrip)
+			QVERIFY(std::count(d->divetrip->dives.dives, d->divetrip->dives.dives + d->divetrip->dives.nr, d) == 1);
+		if (d->dive_site)
+			QVERIFY(std::count(d->dive_site->dives.dives, d->dive_site->dives.dives + d->dive_site->dives.nr, d) == 1);
+	}
+}
+
 QTEST_GUILESS_MAIN(TestMerge)
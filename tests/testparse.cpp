@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: GPL-2.0
 #include "testparse.h"
 #include "core/divesite.h"
+#include "core/divecomputer.h"
 #include "core/divelist.h"
 #include "core/file.h"
 #include "core/import-csv.h"
@@ -176,7 +177,7 @@ void TestParse::testParseDM5()
 		     SUBSURFACE_TEST_DATA "/dives/TestDiveDM5.xml");
 }
 
-void TestParse::testParseHUDC()
+static int parseHUDC(const char *file)
 {
 	char *params[37];
 	int pnr = 0;
@@ -215,9 +216,12 @@ void TestParse::testParseHUDC()
 	params[pnr++] = strdup("\"DC text\"");
 	params[pnr++] = NULL;
 
-	QCOMPARE(parse_csv_file(SUBSURFACE_TEST_DATA "/dives/TestDiveSeabearHUDC.csv",
-				params, pnr - 1, "csv", &dive_table, &trip_table, &dive_site_table),
-		 0);
+	return parse_csv_file(file, params, pnr - 1, "csv", &dive_table, &trip_table, &dive_site_table);
+}
+
+void TestParse::testParseHUDC()
+{
+	QCOMPARE(parseHUDC(SUBSURFACE_TEST_DATA "/dives/TestDiveSeabearHUDC.csv"), 0);
 
 	QCOMPARE(dive_table.nr, 1);
 
@@ -520,5 +524,113 @@ void TestParse::parseDL7()
 	clear_dive_file_data();
 }
 
+void TestParse::parseTruncated()
+{
+	// a native log that breaks off halfway must not leave any of its dives behind
+	QCOMPARE(parseV3(), 0);
+	int nr_dives = dive_table.nr;
+	int nr_trips = trip_table.nr;
+	int nr_sites = dive_site_table.nr;
+
+	QFile file(SUBSURFACE_TEST_DATA "/dives/test40-42.xml");
+	QVERIFY(file.open(QFile::ReadOnly));
+	QByteArray data = file.readAll();
+	data.truncate(data.size() / 2);
+	QVERIFY(parse_xml_buffer("truncated.xml", data.constData(), data.size(), &dive_table, &trip_table, &dive_site_table, NULL) != 0);
+	QCOMPARE(dive_table.nr, nr_dives);
+	QCOMPARE(trip_table.nr, nr_trips);
+	QCOMPARE(dive_site_table.nr, nr_sites);
+
+	// nor any of its dive computers and dive sites in the indexes
+	int nr_devices = dcList.dcs.size();
+	const char broken[] =
+		"<divelog program='subsurface' version='3'>\n"
+		"<settings>\n"
+		"<divecomputerid model='Broken DC' deviceid='12345678' serial='42'/>\n"
+		"</settings>\n"
+		"<divesites>\n"
+		"<site uuid='1234abcd' name='Broken site' gps='12.345600 6.543210'>\n"
+		"</site>\n"
+		"</divesites>\n"
+		"<dives>\n"
+		"<dive number='1' divesiteid='1234abcd' date='2013-10-01' time='10:34:00' duration='45:00 min'>\n"
+		"  <buddy>Dirk</buddy>\n";
+	QVERIFY(parse_xml_buffer("broken.xml", broken, sizeof(broken) - 1, &dive_table, &trip_table, &dive_site_table, NULL) != 0);
+	QCOMPARE(dive_table.nr, nr_dives);
+	QCOMPARE(dive_site_table.nr, nr_sites);
+	QCOMPARE(dcList.dcs.size(), nr_devices);
+	QVERIFY(!dcList.getExact("Broken DC", 0x12345678));
+	QVERIFY(!get_dive_site_by_name("Broken site", &dive_site_table));
+	location_t loc = create_location(12.3456, 6.54321);
+	QVERIFY(!get_dive_site_by_gps(&loc, &dive_site_table));
+}
+
+void TestParse::testParseHUDCLineEnds()
+{
+	QFile file(SUBSURFACE_TEST_DATA "/dives/TestDiveSeabearHUDC.csv");
+	QVERIFY(file.open(QFile::ReadOnly));
+	QList<QByteArray> lines = file.readAll().split('\n');
+
+	// The CSV reader streams the file in chunks. Repeated lines are
+	// dropped on import, so repeating each one makes the file span
+	// several chunks, with line ends split between them, and still
+	// gives the same dive.
+	for (const char *eol: { "\r\n", "\r" }) {
+		QByteArray data;
+		for (int i = 0; i < lines.size() - 1; i++) {
+			for (int j = 0; j < 8; j++)
+				data += lines[i] + eol;
+		}
+		data += lines.last();
+		QFile csv("./testhudclineends.csv");
+		QVERIFY(csv.open(QFile::WriteOnly | QFile::Truncate));
+		QCOMPARE(csv.write(data), (qint64)data.size());
+		csv.close();
+
+		QCOMPARE(parseHUDC("./testhudclineends.csv"), 0);
+		QCOMPARE(dive_table.nr, 1);
+		struct dive *dive = dive_table.dives[0];
+		dive->when = 1255152761;
+		dive->dc.when = 1255152761;
+
+		QCOMPARE(save_dives("./testhudclineends.ssrf"), 0);
+		FILE_COMPARE("./testhudclineends.ssrf",
+			     SUBSURFACE_TEST_DATA "/dives/TestDiveSeabearHUDC.xml");
+		clear_dive_file_data();
+	}
+}
+
+void TestParse::testParseDivingLogDives()
+{
+	// The queries for the cylinders and the profile of a dive are prepared
+	// once, so add a second dive with other cylinders and no profile
+	QFile::remove("./testdivinglog.sql");
+	QVERIFY(QFile::copy(SUBSURFACE_TEST_DATA "/dives/TestDivingLog4.1.1.sql", "./testdivinglog.sql"));
+	QFile::setPermissions("./testdivinglog.sql", QFile::ReadOwner | QFile::WriteOwner);
+	QCOMPARE(sqlite3_open("./testdivinglog.sql", &_sqlite3_handle), 0);
+	const char *add_dive =
+		"create temp table Copy as select * from Logbook where ID = 417;"
+		"update Copy set ID = 418, Number = 418, Divedate = '2015-05-24', O2 = 21, He = 0, Profile = NULL;"
+		"insert into Logbook select * from Copy;"
+		"insert into Tank (LogID, TankID, Tanksize, O2, He) values (418, 1, 12, 32, 0);";
+	QCOMPARE(sqlite3_exec(_sqlite3_handle, add_dive, NULL, NULL, NULL), SQLITE_OK);
+
+	QCOMPARE(parse_divinglog_buffer(_sqlite3_handle, 0, 0, 0, &dive_table, &trip_table, &dive_site_table), 0);
+	QCOMPARE(dive_table.nr, 2);
+	struct dive *first = dive_table.dives[0];
+	struct dive *second = dive_table.dives[1];
+	QCOMPARE(first->number, 417);
+	QCOMPARE(second->number, 418);
+
+	QCOMPARE(first->cylinder[0].gasmix.o2.permille, 500);
+	QCOMPARE(first->cylinder[6].gasmix.o2.permille, 1000);
+	QVERIFY(first->dc.samples > 0);
+
+	QCOMPARE(second->cylinder[0].gasmix.o2.permille, 210);
+	QCOMPARE(second->cylinder[1].gasmix.o2.permille, 320);
+	QCOMPARE(second->cylinder[1].type.size.mliter, 12000);
+	QVERIFY(cylinder_none(&second->cylinder[2]));
+	QCOMPARE(second->dc.samples, 0);
+}
 
 QTEST_GUILESS_MAIN(TestParse)
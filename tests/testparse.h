@@ -33,6 +33,9 @@ private slots:
 	void testExport();
 
 	void parseDL7();
+	void parseTruncated();
+	void testParseHUDCLineEnds();
+	void testParseDivingLogDives();
 
 private:
 	sqlite3 *_sqlite3_handle = NULL;
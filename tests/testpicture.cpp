@@ -3,7 +3,16 @@
 #include "core/divesite.h"
 #include "core/divelist.h"
 #include "core/file.h"
+#include "core/metadata.h"
+#include "core/mediascanner.h"
+#include "core/thumbnailstore.h"
 #include <QString>
+#include <QTemporaryDir>
+#include <QDir>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QEventLoop>
+#include <QCryptographicHash>
 #include <core/qthelper.h>
 
 void TestPicture::initTestCase()
@@ -52,5 +61,109 @@ void TestPicture::addPicture()
 	QCOMPARE(localFilePath(pic2->filename), QString(PIC2_NAME));
 }
 
+void TestPicture::readMetadata()
+{
+	struct metadata md1, md2, md;
+	QCOMPARE(get_metadata(SUBSURFACE_TEST_DATA PIC1_NAME, &md1), MEDIATYPE_PICTURE);
+	QCOMPARE(get_metadata(SUBSURFACE_TEST_DATA PIC2_NAME, &md2), MEDIATYPE_PICTURE);
+	QVERIFY(md1.timestamp != md2.timestamp);
+
+	// the second time the metadata come from the cache
+	QTemporaryDir dir;
+	QString filename = dir.path() + "/picture.jpg";
+	QVERIFY(QFile::copy(SUBSURFACE_TEST_DATA PIC1_NAME, filename));
+	QCOMPARE(get_metadata(qPrintable(filename), &md), MEDIATYPE_PICTURE);
+	QCOMPARE(md.timestamp, md1.timestamp);
+
+	// even if the file doesn't hold them anymore, as long as its size and time are the same
+	QFile file(filename);
+	QDateTime mtime = QFileInfo(file).lastModified();
+	QVERIFY(file.open(QIODevice::ReadWrite));
+	QCOMPARE(file.write(QByteArray(file.size(), '\0')), file.size());
+	QVERIFY(file.flush());
+	QVERIFY(file.setFileTime(mtime, QFileDevice::FileModificationTime));
+	file.close();
+	QCOMPARE(QFileInfo(filename).lastModified(), mtime);
+	QCOMPARE(get_metadata(qPrintable(filename), &md), MEDIATYPE_PICTURE);
+	QCOMPARE(md.timestamp, md1.timestamp);
+	QCOMPARE(md.location.lat.udeg, 47934500);
+
+	// unless the file was changed
+	QVERIFY(QFile::remove(filename));
+	QVERIFY(QFile::copy(SUBSURFACE_TEST_DATA PIC2_NAME, filename));
+	QCOMPARE(get_metadata(qPrintable(filename), &md), MEDIATYPE_PICTURE);
+	QCOMPARE(md.timestamp, md2.timestamp);
+	QVERIFY(QFile::remove(filename));
+	QCOMPARE(get_metadata(qPrintable(filename), &md), MEDIATYPE_IO_ERROR);
+
+	// scanning in the background
+	QStringList fileNames;
+	for (int i = 0; i < 50; ++i)
+		fileNames << QString(SUBSURFACE_TEST_DATA) + (i % 3 ? PIC1_NAME : PIC2_NAME);
+	MediaScanner scanner;
+	QVector<timestamp_t> timestamps(fileNames.size());
+	int scanned = 0;
+	connect(&scanner, &MediaScanner::scanned, [&](int first, const QVector<MediaMetadata> &batch) {
+		for (int i = 0; i < batch.size(); ++i) {
+			QCOMPARE(batch[i].filename, fileNames[first + i]);
+			timestamps[first + i] = batch[i].data.timestamp;
+		}
+		scanned += batch.size();
+	});
+	// the batches arrive in this thread, before finished()
+	QEventLoop loop;
+	connect(&scanner, &MediaScanner::finished, &loop, &QEventLoop::quit);
+	scanner.scan(fileNames);
+	loop.exec();
+	QCOMPARE(scanned, fileNames.size());
+	for (int i = 0; i < fileNames.size(); ++i)
+		QCOMPARE(timestamps[i], i % 3 ? md1.timestamp : md2.timestamp);
+}
+
+void TestPicture::thumbnailStore()
+{
+	QTemporaryDir dir;
+
+	// thumbnails of an older version, one file per picture
+	QVERIFY(QDir().mkpath(dir.path() + "/thumbnails"));
+	QFile old(dir.path() + "/thumbnails/" + QCryptographicHash::hash("old.jpg", QCryptographicHash::Sha1).toHex());
+	QVERIFY(old.open(QIODevice::WriteOnly));
+	old.write("old thumbnail");
+	old.close();
+
+	QVector<QString> filenames;
+	{
+		ThumbnailStore store(dir.path());
+		QCOMPARE(store.get("old.jpg").data, QByteArray("old thumbnail"));
+		QVERIFY(!QDir(dir.path() + "/thumbnails").exists());
+		QVERIFY(store.get("missing.jpg").data.isEmpty());
+
+		for (int i = 0; i < 100; ++i) {
+			filenames.append(QString("picture%1.jpg").arg(i));
+			store.put(filenames.last(), QByteArray(1000, 'a' + i % 26));
+		}
+		// replace some of them
+		for (int i = 0; i < 100; i += 2)
+			store.put(filenames[i], QByteArray(500, 'A' + i % 26));
+		QCOMPARE(store.liveSize(), (qint64)(50 * 1000 + 50 * 500 + 13));
+		QVERIFY(store.dataSize() > 100 * 1000 + 50 * 500);
+	}
+
+	// reopened, the thumbnails are still there
+	ThumbnailStore store(dir.path());
+	QVector<ThumbnailStore::Thumbnail> thumbnails = store.get(filenames);
+	QCOMPARE(thumbnails.size(), 100);
+	for (int i = 0; i < 100; ++i)
+		QCOMPARE(thumbnails[i].data, i % 2 ? QByteArray(1000, 'a' + i % 26) : QByteArray(500, 'A' + i % 26));
+
+	// compaction drops the replaced thumbnails
+	store.compact();
+	QVERIFY(store.dataSize() < 100 * 1000);
+	QCOMPARE(store.get(filenames[3]).data, QByteArray(1000, 'a' + 3));
+	QCOMPARE(store.get(filenames[4]).data, QByteArray(500, 'A' + 4));
+	QCOMPARE(store.get("old.jpg").data, QByteArray("old thumbnail"));
+	store.put(filenames[4], "new");
+	QCOMPARE(store.get(filenames[4]).data, QByteArray("new"));
+}
 
 QTEST_GUILESS_MAIN(TestPicture)
@@ -1,7 +1,9 @@
 // SPDX-License-Identifier: GPL-2.0
 #include "testplan.h"
 #include "core/dive.h"
+#include "core/deco.h"
 #include "core/planner.h"
+#include "core/plansweep.h"
 #include "core/qthelper.h"
 #include "core/subsurfacestartup.h"
 #include "core/units.h"
@@ -865,4 +867,198 @@ void TestPlan::testVpmbMetricRepeat()
 	QCOMPARE(finalDiveRunTimeSeconds, firstDiveRunTimeSeconds);
 }
 
+/* Run the test plans with the portable tissue kernel and with each vectorized
+ * kernel the CPU supports. All of them have to arrive at the same plan and the
+ * same tissue loadings.
+ */
+void TestPlan::testDecoKernels()
+{
+	void (*setups[])(struct diveplan *) = {
+		setupPlan, setupPlanVpmb45m30mTx, setupPlanVpmb60m10mTx, setupPlanVpmb60m30minAir,
+		setupPlanVpmb60m30minEan50, setupPlanVpmb60m30minTx, setupPlanVpmbMultiLevelAir,
+		setupPlanVpmb100m60min, setupPlanVpmb100m10min, setupPlanVpmb30m20min,
+		setupPlanVpmb100mTo70m30min, setupPlanSeveralGases
+	};
+	enum deco_kernel kernels[] = { DECO_KERNEL_SSE2, DECO_KERNEL_AVX2 };
+	enum deco_mode modes[] = { BUEHLMANN, VPMB };
+
+	setupPrefsVpmb();
+	prefs.unit_system = METRIC;
+	prefs.units.length = units::METERS;
+	setCurrentAppState("PlanDive");
+
+	for (enum deco_kernel kernel: kernels) {
+		if (set_deco_kernel(kernel) != kernel) {
+			qWarning("Deco kernel %d not supported on this CPU", kernel);
+			continue;
+		}
+		for (enum deco_mode mode: modes) {
+			prefs.planner_deco_mode = mode;
+			for (auto setup: setups) {
+				struct deco_state *cache = NULL;
+				struct diveplan testPlan = {};
+
+				set_deco_kernel(DECO_KERNEL_SCALAR);
+				setup(&testPlan);
+				plan(&test_deco_state, &testPlan, &displayed_dive, 60, stoptable, &cache, 1, 0);
+				struct deco_state scalar_state = test_deco_state;
+				int scalar_duration = displayed_dive.dc.duration.seconds;
+
+				set_deco_kernel(kernel);
+				setup(&testPlan);
+				plan(&test_deco_state, &testPlan, &displayed_dive, 60, stoptable, &cache, 1, 0);
+
+				QCOMPARE(displayed_dive.dc.duration.seconds, scalar_duration);
+				for (int ci = 0; ci < 16; ci++) {
+					QVERIFY(fabs(test_deco_state.tissue_n2_sat[ci] - scalar_state.tissue_n2_sat[ci]) < 1e-12);
+					QVERIFY(fabs(test_deco_state.tissue_he_sat[ci] - scalar_state.tissue_he_sat[ci]) < 1e-12);
+					QVERIFY(fabs(test_deco_state.tolerated_by_tissue[ci] - scalar_state.tolerated_by_tissue[ci]) < 1e-12);
+				}
+				QCOMPARE(test_deco_state.ci_pointing_to_guiding_tissue, scalar_state.ci_pointing_to_guiding_tissue);
+			}
+		}
+	}
+	set_deco_kernel(DECO_KERNEL_AUTO);
+}
+
+void TestPlan::testWaypointCache()
+{
+	void (*setups[])(struct diveplan *) = {
+		setupPlan, setupPlanVpmb45m30mTx, setupPlanVpmb60m10mTx, setupPlanVpmb60m30minAir,
+		setupPlanVpmb60m30minEan50, setupPlanVpmb60m30minTx, setupPlanVpmbMultiLevelAir,
+		setupPlanVpmb100m60min, setupPlanVpmb100m10min, setupPlanVpmb30m20min,
+		setupPlanVpmb100mTo70m30min, setupPlanSeveralGases
+	};
+	enum deco_mode modes[] = { BUEHLMANN, VPMB };
+
+	setupPrefsVpmb();
+	prefs.unit_system = METRIC;
+	prefs.units.length = units::METERS;
+	setCurrentAppState("PlanDive");
+
+	for (enum deco_mode mode: modes) {
+		prefs.planner_deco_mode = mode;
+		for (auto setup: setups) {
+			struct deco_state *cache = NULL;
+			struct diveplan testPlan = {};
+
+			setup(&testPlan);
+			memset(&test_deco_state, 0, sizeof(test_deco_state));
+			plan(&test_deco_state, &testPlan, &displayed_dive, 60, stoptable, &cache, 1, 0);
+			struct deco_state uncached_state = test_deco_state;
+			int uncached_duration = displayed_dive.dc.duration.seconds;
+
+			// Plan with a longer last segment first, then the original plan twice:
+			// once from the shared part of the cached states and once from all of them.
+			testPlan.waypoint_cache = alloc_waypoint_cache();
+			for (int i = 0; i < 3; i++) {
+				setup(&testPlan);
+				if (i == 0) {
+					struct divedatapoint *last = NULL;
+					for (struct divedatapoint *dp = testPlan.dp; dp; dp = dp->next) {
+						if (dp->time)
+							last = dp;
+					}
+					last->time += 5 * 60;
+				}
+				memset(&test_deco_state, 0, sizeof(test_deco_state));
+				plan(&test_deco_state, &testPlan, &displayed_dive, 60, stoptable, &cache, 1, 0);
+				if (i == 0)
+					continue;
+
+				QCOMPARE(displayed_dive.dc.duration.seconds, uncached_duration);
+				for (int ci = 0; ci < 16; ci++) {
+					QVERIFY(fabs(test_deco_state.tissue_n2_sat[ci] - uncached_state.tissue_n2_sat[ci]) < 1e-12);
+					QVERIFY(fabs(test_deco_state.tissue_he_sat[ci] - uncached_state.tissue_he_sat[ci]) < 1e-12);
+				}
+			}
+			free_waypoint_cache(testPlan.waypoint_cache);
+			free_dps(&testPlan);
+			free(cache);
+		}
+	}
+}
+
+// The runtimes of a sweep, compared to the known ones of the single plans above
+static void checkSweep(struct plan_sweep *sweep, const int *benchmark, const int *known)
+{
+	int nr = sweep_size(sweep);
+	struct sweep_result *results = run_plan_sweep(sweep);
+
+	QVERIFY(results != NULL);
+	for (int i = 0; i < nr; i++) {
+		const struct sweep_result *res = &results[i];
+		int stoptime = 0;
+
+		QCOMPARE(res->gases, i);
+		QVERIFY(res->deco);
+		QVERIFY(compareDecoTime(res->runtime, benchmark[i], known[i]));
+		QCOMPARE(res->tts, res->runtime - sweep->times[res->time]);
+		for (int j = 0; j < res->nr_stops; j++) {
+			QVERIFY(res->stops[j].time > 0);
+			QVERIFY(j == 0 || res->stops[j].depth < res->stops[j - 1].depth);
+			stoptime += res->stops[j].time;
+		}
+		QVERIFY(stoptime < res->tts);
+	}
+	free(results);
+}
+
+void TestPlan::testPlanSweep()
+{
+	struct sweep_gases gases[3] = {};
+	struct plan_sweep sweep = {};
+
+	prefs.unit_system = METRIC;
+	prefs.units.length = units::METERS;
+	setCurrentAppState("PlanDive");
+	sweep.nr_depths = 1;
+	sweep.nr_times = 1;
+	sweep.nr_gfs = 1;
+	sweep.surface_pressure = 1013;
+	sweep.salinity = 10300;
+
+	// 79m for 30 minutes on 15/45 with EAN36 and oxygen, as in testMetric
+	const int depthMetric[] = { 79000 };
+	const int timeMetric[] = { 30 * 60 };
+	const struct sweep_gf gf100[] = { { 100, 100 } };
+	const int benchmarkMetric[] = { 109 * 60 };
+	setupPrefs();
+	prefs.planner_deco_mode = BUEHLMANN;
+	prefs.descrate = 23000 / 60;
+	validate_gas("15/45", &gases[0].gasmix[0]);
+	validate_gas("36", &gases[0].gasmix[1]);
+	validate_gas("oxygen", &gases[0].gasmix[2]);
+	gases[0].nr = 3;
+	sweep.depths = depthMetric;
+	sweep.times = timeMetric;
+	sweep.nr_gases = 1;
+	sweep.gases = gases;
+	sweep.gfs = gf100;
+	sweep.bottomsac = prefs.bottomsac;
+	sweep.decosac = prefs.decosac;
+	checkSweep(&sweep, benchmarkMetric, benchmarkMetric);
+
+	// 60m for 30 minutes with VPM-B on air, on air with EAN50 and on 18/45 with EAN50,
+	// as in testVpmbMetric60m30minAir, testVpmbMetric60m30minEan50 and testVpmbMetric60m30minTx
+	const int depthVpmb[] = { 60000 };
+	const int benchmarkVpmb[] = { 141 * 60 + 20, 95 * 60 + 20, 89 * 60 + 20 };
+	const int knownVpmb[] = { 139 * 60 + 20, 96 * 60 + 20, 89 * 60 + 20 };
+	setupPrefsVpmb();
+	memset(gases, 0, sizeof(gases));
+	validate_gas("21", &gases[0].gasmix[0]);
+	gases[0].nr = 1;
+	validate_gas("21", &gases[1].gasmix[0]);
+	validate_gas("50", &gases[1].gasmix[1]);
+	gases[1].nr = 2;
+	validate_gas("18/45", &gases[2].gasmix[0]);
+	validate_gas("50", &gases[2].gasmix[1]);
+	gases[2].nr = 2;
+	sweep.depths = depthVpmb;
+	sweep.nr_gases = 3;
+	sweep.bottomsac = prefs.bottomsac;
+	sweep.decosac = prefs.decosac;
+	checkSweep(&sweep, benchmarkVpmb, knownVpmb);
+}
+
 QTEST_GUILESS_MAIN(TestPlan)
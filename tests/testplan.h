@@ -19,6 +19,9 @@ private slots:
 	void testVpmbMetric100m10min();
 	void testVpmbMetricRepeat();
 	void testMultipleGases();
+	void testDecoKernels();
+	void testWaypointCache();
+	void testPlanSweep();
 };
 
 #endif // TESTPLAN_H
@@ -2,10 +2,281 @@
 #include "testprofile.h"
 #include "core/divesite.h"
 #include "core/file.h"
+#include "core/display.h"
+#include "core/profile.h"
+#include "core/divelist.h"
+#include "core/deco.h"
+
+#include <algorithm>
+#include <vector>
 
 void TestProfile::testRedCeiling()
 {
 	parse_file("../dives/deep.xml", &dive_table, &trip_table, &dive_site_table);
 }
 
+// A synthetic profile of the given length: a sawtooth between 3m and 40m with some noise
+static void synthetic_plot_info(struct plot_info *pi, int seconds, int interval)
+{
+	memset(pi, 0, sizeof(*pi));
+	pi->nr = seconds / interval + 1;
+	pi->entry = (struct plot_data *)calloc(pi->nr, sizeof(struct plot_data));
+	qsrand(42);
+	for (int i = 0; i < pi->nr; i++) {
+		struct plot_data *entry = pi->entry + i;
+		entry->sec = i * interval;
+		entry->depth = 3000 + abs(entry->sec % 1200 - 600) * 60 + qrand() % 500;
+	}
+}
+
+void TestProfile::testMinMax()
+{
+	// The min/max of the sliding window must be the first entry with the
+	// lowest/highest depth in the 9 minutes around each entry
+	struct plot_info pi;
+	synthetic_plot_info(&pi, 4 * 3600, 2);
+	// Flat parts, to check that ties go to the first entry
+	for (int i = 1000; i < 2000; i++)
+		pi.entry[i].depth = 20000;
+	analyze_plot_info(&pi);
+	for (int i = 0; i < pi.nr; i++) {
+		int min = -1, max = -1;
+		for (int j = 0; j < pi.nr; j++) {
+			if (abs(pi.entry[j].sec - pi.entry[i].sec) > 9 * 30)
+				continue;
+			if (min < 0 || pi.entry[j].depth < pi.entry[min].depth)
+				min = j;
+			if (max < 0 || pi.entry[j].depth > pi.entry[max].depth)
+				max = j;
+		}
+		QCOMPARE(pi.entry[i].min, min);
+		QCOMPARE(pi.entry[i].max, max);
+	}
+	free_plot_info_data(&pi);
+}
+
+void TestProfile::benchmarkAnalyzePlotInfo()
+{
+	// A 12 hour dive with one second samples
+	struct plot_info pi;
+	synthetic_plot_info(&pi, 12 * 3600, 1);
+	QBENCHMARK {
+		analyze_plot_info(&pi);
+	}
+	free_plot_info_data(&pi);
+}
+
+void TestProfile::benchmarkCalculateSac()
+{
+	// A 12 hour dive with one second samples, breathing from two cylinders. The second
+	// cylinder only has pressure data in the second half, with surface intervals in between.
+	struct plot_info pi;
+	synthetic_plot_info(&pi, 12 * 3600, 1);
+	for (int i = 0; i < pi.nr; i++) {
+		if (i % 7200 < 300)
+			pi.entry[i].depth = 0;
+	}
+	struct dive *d = alloc_dive();
+	for (int cyl = 0; cyl < 2; cyl++) {
+		d->cylinder[cyl].type.size.mliter = 12000;
+		d->cylinder[cyl].type.workingpressure.mbar = 232000;
+	}
+	pi.nr_cylinders = 2;
+	pi.pressures = (struct plot_pressure_data *)calloc(pi.nr * pi.nr_cylinders, sizeof(struct plot_pressure_data));
+	for (int i = 0; i < pi.nr; i++) {
+		set_plot_pressure_data(&pi, i, SENSOR_PR, 0, 230000 - i * 2);
+		if (i > pi.nr / 2)
+			set_plot_pressure_data(&pi, i, SENSOR_PR, 1, 230000 - (i - pi.nr / 2) * 3);
+	}
+
+	QBENCHMARK {
+		for (int i = 0; i < pi.nr; i++)
+			pi.entry[i].sac = 0;
+		calculate_sac_information(d, &d->dc, &pi);
+	}
+	QVERIFY(pi.entry[1000].sac > 0);
+	QVERIFY(pi.entry[pi.nr - 1000].sac > pi.entry[1000].sac);
+	QCOMPARE(pi.entry[7200 * 3 + 100].sac, 0);
+
+	free_plot_info_data(&pi);
+	free_dive(d);
+}
+
+static int deco_state_of(struct dive *d, struct deco_state *ds)
+{
+	memset(ds, 0, sizeof(*ds));
+	init_deco_config(&ds->config, false);
+	return init_decompression(ds, d);
+}
+
+// The CNS is only calculated by hand if the dive computers didn't record it
+static int cns_of(struct dive *d)
+{
+	d->cns = d->maxcns = 0;
+	update_cylinder_related_info(d);
+	return d->maxcns;
+}
+
+// Calculate the tissues and the CNS of all dives, to fill the cache
+static void fill_deco_cache()
+{
+	for (int i = 0; i < dive_table.nr; i++) {
+		struct deco_state ds;
+		deco_state_of(get_dive(i), &ds);
+		cns_of(get_dive(i));
+	}
+}
+
+// Compare the tissues and CNS of the dives, calculated with the cache as it is,
+// to the ones calculated from scratch
+static void compare_to_uncached()
+{
+	std::vector<struct deco_state> states(dive_table.nr);
+	std::vector<int> surface_times(dive_table.nr);
+	std::vector<int> cns(dive_table.nr);
+	for (int i = 0; i < dive_table.nr; i++) {
+		surface_times[i] = deco_state_of(get_dive(i), &states[i]);
+		cns[i] = cns_of(get_dive(i));
+	}
+	for (int i = 0; i < dive_table.nr; i++) {
+		struct deco_state expected;
+		clear_deco_cache();
+		QCOMPARE(surface_times[i], deco_state_of(get_dive(i), &expected));
+		for (int ci = 0; ci < 16; ci++) {
+			QCOMPARE(states[i].tissue_n2_sat[ci], expected.tissue_n2_sat[ci]);
+			QCOMPARE(states[i].tissue_he_sat[ci], expected.tissue_he_sat[ci]);
+		}
+		clear_deco_cache();
+		QCOMPARE(cns[i], cns_of(get_dive(i)));
+	}
+}
+
+void TestProfile::testDecoCache()
+{
+	// Series of repetitive dives must give the same tissues when continued from the cache
+	QCOMPARE(parse_file(SUBSURFACE_TEST_DATA "/dives/SampleDivesV2.ssrf", &dive_table, &trip_table, &dive_site_table), 0);
+	process_loaded_dives();
+	clear_deco_cache();
+	compare_to_uncached();
+
+	// Removing the second dive of the first series must invalidate the states of the following dives
+	fill_deco_cache();
+	delete_single_dive(1);
+	compare_to_uncached();
+
+	// Shifting the time of a dive, as ShiftTime does, past the following dive changes the state of that dive
+	fill_deco_cache();
+	struct dive *d = get_dive(1);
+	set_dive_time(d, dive_endtime(get_dive(2)) + 3600);
+	sort_dive_table(&dive_table);
+	compare_to_uncached();
+
+	// Rewriting a plan copies the plan into the dive, which may move it past the following dive.
+	// The cache is filled while planning, as the profile is shown.
+	d = get_dive(0);
+	struct dive *plan = alloc_dive();
+	copy_dive(d, plan);
+	fill_deco_cache();
+	plan->when = dive_endtime(get_dive(1)) + 3600;
+	replace_dive_contents(d, plan);
+	free_dive(plan);
+	sort_dive_table(&dive_table);
+	compare_to_uncached();
+
+	// Editing the gases of a dive in the equipment tab changes the states of this and the following dives
+	fill_deco_cache();
+	d = get_dive(0);
+	d->cylinder[0].gasmix.o2.permille = 320;
+	invalidate_dive_cache(d);
+	compare_to_uncached();
+
+	// The gradient factors only enter the ceilings, so the states are shared between them
+	fill_deco_cache();
+	int gflow = prefs.gflow, gfhigh = prefs.gfhigh;
+	prefs.gflow = gflow == 50 ? 40 : 50;
+	prefs.gfhigh = gfhigh == 95 ? 90 : 95;
+	compare_to_uncached();
+	prefs.gflow = gflow;
+	prefs.gfhigh = gfhigh;
+
+	clear_dive_file_data();
+}
+
+// The number of minutes at constant depth until there is a ceiling, simulated
+// minute by minute as calculate_ndl_tts() used to do, up to two hours
+static int stepwise_ndl(struct deco_state ds, const struct dive *d, double pressure, double surface_pressure, struct gasmix gasmix)
+{
+	int minutes = 0;
+	while (minutes < 120 && deco_allowed_depth(tissue_tolerance_calc(&ds, d, pressure), surface_pressure, d, 1) <= 0) {
+		add_segment(&ds, pressure, gasmix, 60, 0, OC, 0);
+		minutes++;
+	}
+	return minutes;
+}
+
+void TestProfile::testClosedFormDeco()
+{
+	// The closed-form NDL solver must agree with the stepwise simulation
+	const int depths[] = { 10000, 18000, 30000, 40000, 60000 };
+	const struct gasmix gasmixes[] = { { { 209 }, { 0 } }, { { 320 }, { 0 } }, { { 500 }, { 0 } },
+					   { { 180 }, { 450 } }, { { 100 }, { 700 } } };
+	const short gfs[][2] = { { 30, 70 }, { 50, 95 }, { 100, 100 } };
+	struct dive *d = alloc_dive();
+	double surface_pressure = get_surface_pressure_in_mbar(d, true) / 1000.0;
+
+	for (const short *gf: gfs) {
+		for (const struct gasmix &gasmix: gasmixes) {
+			for (int depth: depths) {
+				for (int bottom_time = 60; bottom_time <= 660; bottom_time += 300) {
+					struct deco_state ds;
+					double pressure = depth_to_bar(depth, d);
+					memset(&ds, 0, sizeof(ds));
+					init_deco_config(&ds.config, false);
+					ds.config.deco_mode = BUEHLMANN;
+					set_gf(&ds.config, gf[0], gf[1]);
+					clear_deco(&ds, surface_pressure);
+					add_segment(&ds, pressure, gasmix, bottom_time, 0, OC, 0);
+
+					// The estimate is exact up to the rounding of the ceiling for a single inert gas.
+					// With helium it is approximate and is then pinned against the real ceiling.
+					int ndl = stepwise_ndl(ds, d, pressure, surface_pressure, gasmix);
+					int estimate = std::min(periods_to_surfacing_limit(&ds, pressure, surface_pressure, gasmix, 60, 0, OC), 120);
+					if (get_he(gasmix))
+						QVERIFY(estimate <= ndl);
+					else
+						QVERIFY(abs(estimate - ndl) <= 1);
+
+					// Adding the minutes in one go gives the same tissues as adding them one by one
+					struct deco_state stepwise = ds;
+					for (int i = 0; i < ndl; i++)
+						add_segment(&stepwise, pressure, gasmix, 60, 0, OC, 0);
+					add_segments(&ds, pressure, gasmix, 60, ndl, 0, OC);
+					for (int ci = 0; ci < 16; ci++) {
+						QVERIFY(fabs(ds.tissue_n2_sat[ci] - stepwise.tissue_n2_sat[ci]) < 1e-9);
+						QVERIFY(fabs(ds.tissue_he_sat[ci] - stepwise.tissue_he_sat[ci]) < 1e-9);
+					}
+				}
+			}
+		}
+	}
+
+	// The same while off-gassing at a stop
+	struct deco_state ds, stepwise;
+	struct gasmix trimix = { { 180 }, { 450 } }, ean50 = { { 500 }, { 0 } };
+	memset(&ds, 0, sizeof(ds));
+	init_deco_config(&ds.config, false);
+	ds.config.deco_mode = BUEHLMANN;
+	clear_deco(&ds, surface_pressure);
+	add_segment(&ds, depth_to_bar(60000, d), trimix, 1800, 0, OC, 0);
+	stepwise = ds;
+	for (int i = 0; i < 30; i++)
+		add_segment(&stepwise, depth_to_bar(6000, d), ean50, 60, 0, OC, 0);
+	add_segments(&ds, depth_to_bar(6000, d), ean50, 60, 30, 0, OC);
+	for (int ci = 0; ci < 16; ci++) {
+		QVERIFY(fabs(ds.tissue_n2_sat[ci] - stepwise.tissue_n2_sat[ci]) < 1e-9);
+		QVERIFY(fabs(ds.tissue_he_sat[ci] - stepwise.tissue_he_sat[ci]) < 1e-9);
+	}
+	free_dive(d);
+}
+
 QTEST_GUILESS_MAIN(TestProfile)
@@ -9,6 +9,11 @@ class TestProfile : public QObject {
 	Q_OBJECT
 private slots:
 	void testRedCeiling();
+	void testMinMax();
+	void benchmarkAnalyzePlotInfo();
+	void benchmarkCalculateSac();
+	void testDecoCache();
+	void testClosedFormDeco();
 };
 
 #endif